@@ -0,0 +1,214 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Activity.h"
+
+#ifdef _WIN32
+// Not in VS 2005's headers, or only for newer Windows than it targets by default
+#define WTS_CONSOLE_CONNECT_EDW590 0x1
+#define WTS_CONSOLE_DISCONNECT_EDW590 0x2
+#define WTS_REMOTE_CONNECT_EDW590 0x3
+#define WTS_REMOTE_DISCONNECT_EDW590 0x4
+#define WTS_SESSION_LOCK_EDW590 0x7
+#define WTS_SESSION_UNLOCK_EDW590 0x8
+#define NOTIFY_FOR_THIS_SESSION_EDW590 0
+#define PBT_POWERSETTINGCHANGE_EDW590 0x8013
+#define SC_MONITORPOWER_EDW590 0xF170
+#define DEVICE_NOTIFY_WINDOW_HANDLE_EDW590 0x0
+typedef BOOL (WINAPI *WTSRegisterFunc)(HWND, DWORD);
+typedef BOOL (WINAPI *WTSUnRegisterFunc)(HWND);
+typedef void *(WINAPI *RegisterPowerFunc)(HANDLE, const GUID *, DWORD);
+typedef BOOL (WINAPI *UnregisterPowerFunc)(void *);
+
+struct PowerSetting {
+	GUID setting;
+	DWORD length;
+	unsigned char data[1];
+};
+
+// GUID_CONSOLE_DISPLAY_STATE (Windows 8 and up) and GUID_MONITOR_POWER_ON (Vista and 7). Both say 0 for off.
+static const GUID display_state_guid = {0x6FE69556, 0x704A, 0x47A0, {0x8F, 0x24, 0xC2, 0x8D, 0x93, 0x6F, 0xDA, 0x47}};
+static const GUID monitor_power_guid = {0x02731015, 0x4510, 0x4526, {0x99, 0xE6, 0xE5, 0xA1, 0x7E, 0xBD, 0x1A, 0xEA}};
+#endif
+
+void ActivityInit(struct Activity *activity, long long release_delay, long long poll_interval) {
+	memset(activity, 0, sizeof(*activity));
+	activity->release_delay = release_delay;
+	activity->poll_interval = poll_interval;
+}
+
+int ActivitySet(struct Activity *activity, unsigned int reason, int on) {
+	unsigned int old_reasons = activity->reasons;
+	if (on) {
+		activity->reasons |= reason;
+	} else {
+		activity->reasons &= ~reason;
+	}
+
+	return (old_reasons == 0) != (activity->reasons == 0);
+}
+
+enum ActivityAction ActivityPoll(struct Activity *activity, long long now, long long *wait) {
+	if (activity->reasons == 0) {
+		if (!activity->suspended) {
+			return ACTIVITY_RUN;
+		}
+		activity->suspended = 0;
+		activity->suspended_time += now - activity->suspended_at;
+
+		return ACTIVITY_RESUME;
+	}
+
+	if (!activity->suspended) {
+		activity->suspended = 1;
+		activity->suspended_at = now;
+		activity->released = 0;
+		activity->suspensions++;
+	}
+
+	*wait = -1;
+	if (!activity->released) {
+		long long left = activity->suspended_at + activity->release_delay - now;
+		if (left <= 0) {
+			activity->released = 1;
+
+			return ACTIVITY_RELEASE;
+		}
+		*wait = left;
+	}
+	if ((activity->reasons & ACTIVITY_POLLED) != 0 && (*wait < 0 || *wait > activity->poll_interval)) {
+		*wait = activity->poll_interval;
+	}
+
+	return ACTIVITY_SLEEP;
+}
+
+long long ActivityTrimFrames(struct Frame *frames, int num_frames, int keep, long long budget) {
+	long long total = 0;
+	for (int i = 0; i < num_frames; i++) {
+		if (frames[i].pixels != NULL) {
+			total += (long long) frames[i].stride * frames[i].height * 4;
+		}
+	}
+
+	long long freed = 0;
+	for (int i = 0; i < num_frames && total - freed > budget; i++) {
+		if (i != keep && frames[i].pixels != NULL) {
+			freed += (long long) frames[i].stride * frames[i].height * 4;
+			FrameFree(&frames[i]);
+		}
+	}
+
+	return freed;
+}
+
+#ifdef _WIN32
+
+void ActivityRegister(struct Activity *activity, HWND hwnd) {
+	activity->hwnd = hwnd;
+	activity->wtsapi32 = LoadLibrary(TEXT("wtsapi32.dll"));
+	if (activity->wtsapi32 != NULL) {
+		WTSRegisterFunc wts_register = (WTSRegisterFunc)
+				GetProcAddress(activity->wtsapi32, "WTSRegisterSessionNotification");
+		if (wts_register == NULL || !wts_register(hwnd, NOTIFY_FOR_THIS_SESSION_EDW590)) {
+			FreeLibrary(activity->wtsapi32);
+			activity->wtsapi32 = NULL;
+		}
+	}
+
+	RegisterPowerFunc power_register = (RegisterPowerFunc)
+			GetProcAddress(GetModuleHandle(TEXT("user32.dll")), "RegisterPowerSettingNotification");
+	if (power_register != NULL) {
+		const GUID *guids[2] = {&display_state_guid, &monitor_power_guid};
+		for (int i = 0; i < 2; i++) {
+			activity->power_notifications[i] = power_register(hwnd, guids[i], DEVICE_NOTIFY_WINDOW_HANDLE_EDW590);
+		}
+	}
+}
+
+void ActivityUnregister(struct Activity *activity) {
+	if (activity->wtsapi32 != NULL) {
+		WTSUnRegisterFunc wts_unregister = (WTSUnRegisterFunc)
+				GetProcAddress(activity->wtsapi32, "WTSUnRegisterSessionNotification");
+		if (wts_unregister != NULL) {
+			wts_unregister(activity->hwnd);
+		}
+		FreeLibrary(activity->wtsapi32);
+		activity->wtsapi32 = NULL;
+	}
+
+	UnregisterPowerFunc power_unregister = (UnregisterPowerFunc)
+			GetProcAddress(GetModuleHandle(TEXT("user32.dll")), "UnregisterPowerSettingNotification");
+	for (int i = 0; i < 2; i++) {
+		if (activity->power_notifications[i] != NULL && power_unregister != NULL) {
+			power_unregister(activity->power_notifications[i]);
+		}
+		activity->power_notifications[i] = NULL;
+	}
+	activity->hwnd = NULL;
+}
+
+int ActivityMessage(struct Activity *activity, UINT msg, WPARAM wParam, LPARAM lParam) {
+	switch (msg) {
+		case WM_WTSSESSION_CHANGE_EDW590: {
+			switch (wParam) {
+				case WTS_SESSION_LOCK_EDW590:
+					return ActivitySet(activity, ACTIVITY_LOCKED, 1);
+				case WTS_SESSION_UNLOCK_EDW590:
+					return ActivitySet(activity, ACTIVITY_LOCKED, 0);
+				case WTS_CONSOLE_DISCONNECT_EDW590:
+				case WTS_REMOTE_DISCONNECT_EDW590:
+					return ActivitySet(activity, ACTIVITY_DISCONNECTED, 1);
+				case WTS_CONSOLE_CONNECT_EDW590:
+				case WTS_REMOTE_CONNECT_EDW590:
+					return ActivitySet(activity, ACTIVITY_DISCONNECTED, 0);
+				default:
+					return 0;
+			}
+		}
+		case WM_POWERBROADCAST: {
+			const struct PowerSetting *setting = (const struct PowerSetting *) lParam;
+			if (wParam != PBT_POWERSETTINGCHANGE_EDW590 || setting == NULL || setting->length < sizeof(DWORD)) {
+				return 0;
+			}
+			if (memcmp(&setting->setting, &display_state_guid, sizeof(GUID)) != 0 &&
+					memcmp(&setting->setting, &monitor_power_guid, sizeof(GUID)) != 0) {
+				return 0;
+			}
+			DWORD state;
+			memcpy(&state, setting->data, sizeof(DWORD));
+
+			// 2 is dimmed, which can still be seen
+			return ActivitySet(activity, ACTIVITY_DISPLAY_OFF, state == 0);
+		}
+		case WM_SYSCOMMAND: {
+			// Only from whatever asked for the monitors to be powered off or on (XP has nothing better)
+			if ((wParam & 0xFFF0) != SC_MONITORPOWER_EDW590) {
+				return 0;
+			}
+
+			return ActivitySet(activity, ACTIVITY_DISPLAY_OFF, lParam == 2);
+		}
+		default:
+			return 0;
+	}
+}
+
+#endif
@@ -0,0 +1,106 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_ACTIVITY_H
+#define EDW590SCR_ACTIVITY_H
+
+
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "Frame.h"
+
+// Whether anyone can see the saver, and so whether it's worth drawing. Nobody can when its windows are hidden or
+// covered (the preview inside a Display Properties dialog that's been closed, say), when the session's locked or
+// disconnected (terminal servers have dozens of those), or when the monitors are off. Then the render thread stops
+// waiting for frames altogether and sleeps until that changes, and if it goes on for a while, it lets go of whatever
+// can be made again. Everything else (the frame numbers, the quality level) is left as it was, so it picks up from
+// where it stopped as soon as it's resumed.
+//
+// The reasons get turned on and off with ActivitySet(), so the rules can be tried out anywhere with made-up events.
+// On Windows, ActivityRegister() and ActivityMessage() get them from the session and power notifications.
+
+enum ActivityReason {
+	ACTIVITY_HIDDEN = 1,        // none of the windows can be seen
+	ACTIVITY_LOCKED = 2,        // the session's locked
+	ACTIVITY_DISCONNECTED = 4,  // the session's been disconnected (from its console or its remote client)
+	ACTIVITY_DISPLAY_OFF = 8,   // the monitors are powered off
+};
+
+// The reasons nothing says have gone away, so they have to be checked for every so often
+#define ACTIVITY_POLLED ACTIVITY_HIDDEN
+
+enum ActivityAction {
+	ACTIVITY_RUN,               // draw the next frame
+	ACTIVITY_RESUME,            // the same, but it's just been resumed, so the frames start over from now
+	ACTIVITY_SLEEP,             // suspended: wait for a change, or at most as long as ActivityPoll() says
+	ACTIVITY_RELEASE,           // suspended for release_delay now: let go of the caches, then ask again
+};
+
+struct Activity {
+	unsigned int reasons;       // ActivityReasons, 0 when it's running
+	long long release_delay;    // how long to be suspended before releasing the caches, in microseconds
+	long long poll_interval;    // how often to check the ACTIVITY_POLLED reasons again while suspended
+
+	int suspended;              // as of the last ActivityPoll()
+	long long suspended_at;
+	int released;               // the caches have been released since
+
+	long long suspensions;      // how many times it's been suspended in all
+	long long suspended_time;   // and for how long, up to the last resume, in microseconds
+
+#ifdef _WIN32
+	HWND hwnd;                  // the window that gets the notifications
+	HMODULE wtsapi32;
+	void *power_notifications[2];
+#endif
+};
+
+// ActivityInit - running, with the given delays in microseconds.
+void ActivityInit(struct Activity *activity, long long release_delay, long long poll_interval);
+
+// ActivitySet - turns a reason on or off. Returns 1 if that's changed whether it's suspended.
+int ActivitySet(struct Activity *activity, unsigned int reason, int on);
+
+// ActivityPoll - what the render thread should do now. For ACTIVITY_SLEEP, *wait says for how long at most, in
+// microseconds (-1 for until something's changed).
+enum ActivityAction ActivityPoll(struct Activity *activity, long long now, long long *wait);
+
+// ActivityTrimFrames - frees decoded frames, bar frames[keep], until the ones left take no more than budget bytes.
+// Returns how many bytes were freed.
+long long ActivityTrimFrames(struct Frame *frames, int num_frames, int keep, long long budget);
+
+#ifdef _WIN32
+// Not in VS 2005's headers unless for XP and up
+#define WM_WTSSESSION_CHANGE_EDW590 0x02B1
+
+// ActivityRegister - asks for hwnd to be told about the session being locked and disconnected (WTS, from XP) and the
+// monitors being powered off (from Vista), where Windows can. ActivityUnregister() must come before it's destroyed.
+void ActivityRegister(struct Activity *activity, HWND hwnd);
+void ActivityUnregister(struct Activity *activity);
+
+// ActivityMessage - turns the reasons on and off for the window messages that say to: WM_WTSSESSION_CHANGE,
+// WM_POWERBROADCAST and SC_MONITORPOWER. Returns 1 if that's changed whether it's suspended.
+int ActivityMessage(struct Activity *activity, UINT msg, WPARAM wParam, LPARAM lParam);
+#endif
+
+
+
+#endif //EDW590SCR_ACTIVITY_H
@@ -0,0 +1,514 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "Canvas.h"
+#include "Simd.h"
+
+static void setRect(struct CanvasRect *rect, int left, int top, int right, int bottom) {
+	rect->left = left;
+	rect->top = top;
+	rect->right = right;
+	rect->bottom = bottom;
+}
+
+static int isRectEmpty(const struct CanvasRect *rect) {
+	return rect->right <= rect->left || rect->bottom <= rect->top;
+}
+
+void CanvasFit(int frame_width, int frame_height, int width, int height, struct CanvasRect *dst) {
+	if (frame_width <= 0 || frame_height <= 0) {
+		frame_width = 1;
+		frame_height = 1;
+	}
+
+	// As wide as the canvas if that leaves room for the height, else as tall as the canvas.
+	if ((double) width * frame_height <= (double) height * frame_width) {
+		int image_height = (int) ((double) width * frame_height / frame_width);
+		int y = height / 2 - image_height / 2;
+		setRect(dst, 0, y, width, y + image_height);
+	} else {
+		int image_width = (int) ((double) height * frame_width / frame_height);
+		int x = width / 2 - image_width / 2;
+		setRect(dst, x, 0, x + image_width, height);
+	}
+}
+
+// Works out dst and the bars for the current canvas and frame sizes.
+static void computeGeometry(struct Canvas *canvas) {
+	int width = canvas->width;
+	int height = canvas->height;
+	CanvasFit(canvas->frame_width, canvas->frame_height, width, height, &canvas->dst);
+	const struct CanvasRect *dst = &canvas->dst;
+	if (dst->left == 0 && dst->right == width) {
+		setRect(&canvas->bars[0], 0, 0, width, dst->top);
+		setRect(&canvas->bars[1], 0, dst->bottom, width, height);
+	} else {
+		setRect(&canvas->bars[0], 0, 0, dst->left, height);
+		setRect(&canvas->bars[1], dst->right, 0, width, height);
+	}
+
+	canvas->num_bars = 0;
+	if (!isRectEmpty(&canvas->bars[0])) {
+		canvas->num_bars++;
+	}
+	if (!isRectEmpty(&canvas->bars[1])) {
+		canvas->bars[canvas->num_bars] = canvas->bars[1];
+		canvas->num_bars++;
+	}
+	canvas->geometry_changed = 1;
+	canvas->tiles_valid = 0;
+}
+
+static void fillRect(struct Canvas *canvas, const struct CanvasRect *rect, unsigned int color) {
+	for (int y = rect->top; y < rect->bottom; y++) {
+		unsigned int *row = canvas->pixels + (size_t) y * canvas->width;
+		for (int x = rect->left; x < rect->right; x++) {
+			row[x] = color;
+		}
+	}
+}
+
+void CanvasInit(struct Canvas *canvas) {
+	memset(canvas, 0, sizeof(*canvas));
+	canvas->filter = -1;
+	canvas->divisor = 1;
+	canvas->dirty_tiles = 1;
+	canvas->channel_bits = 8;
+}
+
+void CanvasSetQuality(struct Canvas *canvas, int filter, int divisor) {
+	if (divisor < 1) {
+		divisor = 1;
+	}
+	if (filter != canvas->filter || divisor != canvas->divisor) {
+		canvas->filter = filter;
+		canvas->divisor = divisor;
+		canvas->frame = NULL;
+	}
+}
+
+// Gets low and low_plan ready for a dst_width x dst_height dst, or frees them if the divisor's 1. Returns 0 if out of
+// memory.
+static int prepareLow(struct Canvas *canvas, int dst_width, int dst_height) {
+	if (canvas->divisor <= 1) {
+		if (canvas->low.pixels != NULL) {
+			FrameFree(&canvas->low);
+			ScalePlanFree(&canvas->low_plan);
+		}
+
+		return 1;
+	}
+
+	int low_width = (dst_width + canvas->divisor - 1) / canvas->divisor;
+	int low_height = (dst_height + canvas->divisor - 1) / canvas->divisor;
+	if (canvas->low.width != low_width || canvas->low.height != low_height) {
+		FrameFree(&canvas->low);
+		if (!FrameAlloc(&canvas->low, low_width, low_height)) {
+			return 0;
+		}
+	}
+	if (!ScalePlanMatches(&canvas->low_plan, low_width, low_height, dst_width, dst_height, SCALE_NEAREST)) {
+		ScalePlanFree(&canvas->low_plan);
+		if (!ScalePlanInit(&canvas->low_plan, low_width, low_height, dst_width, dst_height, SCALE_NEAREST)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void CanvasSetPixels(struct Canvas *canvas, unsigned int *pixels, int width, int height) {
+	canvas->pixels = pixels;
+	canvas->width = width;
+	canvas->height = height;
+	canvas->frame = NULL;
+	canvas->step = 0;
+	computeGeometry(canvas);
+}
+
+// The transition's next step, in step, if there's one going.
+static void nextStep(struct Canvas *canvas, struct TransitionJob *step) {
+	if (canvas->step <= 0 || canvas->step > canvas->transition_steps || canvas->next.pixels == NULL) {
+		canvas->step = 0;
+
+		return;
+	}
+
+	step->kind = (enum TransitionKind) canvas->transition;
+	step->dst = canvas->pixels + (size_t) canvas->dst.top * canvas->width + canvas->dst.left;
+	step->dst_stride = canvas->width;
+	step->next = canvas->next.pixels;
+	step->next_stride = canvas->next.stride;
+	step->width = canvas->next.width;
+	step->height = canvas->next.height;
+	step->step = canvas->step;
+	step->steps = canvas->transition_steps;
+	step->seed = canvas->transitions;
+	canvas->step = canvas->step < canvas->transition_steps ? canvas->step + 1 : 0;
+}
+
+int CanvasBeginFrame(struct Canvas *canvas, const struct Frame *frame, struct ScaleJob *job, struct ScaleJob *upscale,
+					 struct TransitionJob *step) {
+	job->plan = NULL;
+	upscale->plan = NULL;
+	step->steps = 0;
+	if (canvas->pixels == NULL) {
+		return 0;
+	}
+	if (frame == canvas->frame && !canvas->geometry_changed) {
+		nextStep(canvas, step);
+
+		return 1;
+	}
+
+	// Only a whole frame that's still where it was can be transitioned from: anything else is a cut
+	int transition = canvas->transition != TRANSITION_CUT && canvas->transition_steps > 1 && canvas->frame != NULL &&
+					 !canvas->geometry_changed;
+	canvas->step = 0;
+
+	if (frame->width != canvas->frame_width || frame->height != canvas->frame_height) {
+		canvas->frame_width = frame->width;
+		canvas->frame_height = frame->height;
+		computeGeometry(canvas);
+	}
+
+	int dst_width = canvas->dst.right - canvas->dst.left;
+	int dst_height = canvas->dst.bottom - canvas->dst.top;
+	if (dst_width <= 0 || dst_height <= 0) {
+		return 0;
+	}
+	if (!prepareLow(canvas, dst_width, dst_height)) {
+		return 0;
+	}
+	int scaled_width = canvas->low.pixels != NULL ? canvas->low.width : dst_width;
+	int scaled_height = canvas->low.pixels != NULL ? canvas->low.height : dst_height;
+	const struct Frame *src = ScalePickMip(frame, scaled_width, scaled_height);
+	enum ScaleFilter filter = (enum ScaleFilter) canvas->filter;
+	if (canvas->filter < 0) {
+		filter = scaled_width < src->width ? SCALE_AREA : SCALE_BILINEAR;
+	}
+	if (!ScalePlanMatches(&canvas->plan, src->width, src->height, scaled_width, scaled_height, filter)) {
+		ScalePlanFree(&canvas->plan);
+		if (!ScalePlanInit(&canvas->plan, src->width, src->height, scaled_width, scaled_height, filter)) {
+			return 0;
+		}
+	}
+
+	if (canvas->geometry_changed) {
+		for (int i = 0; i < canvas->num_bars; i++) {
+			fillRect(canvas, &canvas->bars[i], 0);
+		}
+		canvas->geometry_changed = 0;
+		canvas->present_bars = 1;
+	}
+
+	// The old frame's half overwritten from here on
+	canvas->frame = NULL;
+	if (transition && (canvas->next.width != dst_width || canvas->next.height != dst_height)) {
+		FrameFree(&canvas->next);
+		transition = FrameAlloc(&canvas->next, dst_width, dst_height);
+	}
+	unsigned int *dst = canvas->pixels + (size_t) canvas->dst.top * canvas->width + canvas->dst.left;
+	int dst_stride = canvas->width;
+	if (transition) {
+		dst = canvas->next.pixels;
+		dst_stride = canvas->next.stride;
+		canvas->step = 1;
+		canvas->transitions++;
+		nextStep(canvas, step);
+	}
+
+	job->plan = &canvas->plan;
+	job->src = src;
+	if (canvas->low.pixels != NULL) {
+		job->dst = canvas->low.pixels;
+		job->dst_stride = canvas->low.stride;
+		upscale->plan = &canvas->low_plan;
+		upscale->src = &canvas->low;
+		upscale->dst = dst;
+		upscale->dst_stride = dst_stride;
+	} else {
+		job->dst = dst;
+		job->dst_stride = dst_stride;
+	}
+
+	return 1;
+}
+
+void CanvasEndFrame(struct Canvas *canvas, const struct Frame *frame) {
+	canvas->frame = frame;
+}
+
+// lowbias32, as in Glitch.c.
+static unsigned int mix(unsigned int x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352DU;
+	x ^= x >> 15;
+	x *= 0x846CA68BU;
+	x ^= x >> 16;
+
+	return x;
+}
+
+int CanvasTileRows(struct Canvas *canvas) {
+	int dst_width = canvas->dst.right - canvas->dst.left;
+	int dst_height = canvas->dst.bottom - canvas->dst.top;
+	if ((!canvas->dirty_tiles && canvas->channel_bits >= 8) || canvas->pixels == NULL || dst_width <= 0 ||
+		dst_height <= 0) {
+		return 0;
+	}
+
+	int tiles_x = (dst_width + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE;
+	int tiles_y = (dst_height + CANVAS_TILE_SIZE - 1) / CANVAS_TILE_SIZE;
+	if (canvas->tile_hashes == NULL || tiles_x != canvas->tiles_x || tiles_y != canvas->tiles_y) {
+		free(canvas->tile_hashes);
+		free(canvas->tile_pixels);
+		free(canvas->tile_dirty);
+		canvas->tile_hashes = (unsigned int *) malloc((size_t) tiles_x * tiles_y * sizeof(unsigned int));
+		size_t tile_bytes = CANVAS_TILE_SIZE * CANVAS_TILE_SIZE * 4;
+		canvas->tile_pixels = (unsigned int *) malloc((size_t) tiles_x * tiles_y * tile_bytes);
+		canvas->tile_dirty = (unsigned char *) malloc((size_t) tiles_x * tiles_y);
+		canvas->tiles_x = tiles_x;
+		canvas->tiles_y = tiles_y;
+		canvas->tiles_valid = 0;
+		if (canvas->tile_hashes == NULL || canvas->tile_pixels == NULL || canvas->tile_dirty == NULL) {
+			free(canvas->tile_hashes);
+			free(canvas->tile_pixels);
+			free(canvas->tile_dirty);
+			canvas->tile_hashes = NULL;
+			canvas->tile_pixels = NULL;
+			canvas->tile_dirty = NULL;
+
+			return 0;
+		}
+	}
+
+	return tiles_y;
+}
+
+// A tile's signature is 4 lanes, each taking every 4th pixel of each row of the tile in turn, with a step of Bob
+// Jenkins' one-at-a-time hash (a word at a time rather than a byte): only XORs, shifts and adds, so SSE2 gets the same
+// numbers, 4 pixels at once. Rows go across all the tiles, so there are as many independent lanes on the go as there
+// are tiles in the row.
+#define TILE_GROUP 32
+
+// Keeps the top bits of each channel, and fills the rest in with copies of the top ones, so white stays white. 4 bits
+// and up only: then the rest fit in one copy.
+static void reduceRow(unsigned int *row, int width, int bits) {
+	unsigned int top_mask = ((0xFFU << (8 - bits)) & 0xFFU) * 0x01010101U;
+	unsigned int fill_mask = (0xFFU >> bits) * 0x01010101U;
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i top = _mm_set1_epi32((int) top_mask);
+		const __m128i fill = _mm_set1_epi32((int) fill_mask);
+		const __m128i shift = _mm_cvtsi32_si128(bits);
+		for (; x + 4 <= width; x += 4) {
+			__m128i p = _mm_and_si128(_mm_loadu_si128((const __m128i *) (row + x)), top);
+			p = _mm_or_si128(p, _mm_and_si128(_mm_srl_epi32(p, shift), fill));
+			_mm_storeu_si128((__m128i *) (row + x), p);
+		}
+	}
+#endif
+	for (; x < width; x++) {
+		unsigned int p = row[x] & top_mask;
+		row[x] = p | ((p >> bits) & fill_mask);
+	}
+}
+
+// Compares tile tx (of the row from top to bottom) with the copy of it, if compare, and then copies whatever's there
+// now over the copy. Returns 1 if they were the same. A 32-bit signature's only ever a good guess: with a frame's
+// worth of tiles changing 60 times a second, 2 different ones have the same one every day or two, and that tile
+// would stay as it was until it changed again.
+static int compareTile(struct Canvas *canvas, int tx, int top, int bottom, int compare) {
+	int left = canvas->dst.left + tx * CANVAS_TILE_SIZE;
+	int right = left + CANVAS_TILE_SIZE < canvas->dst.right ? left + CANVAS_TILE_SIZE : canvas->dst.right;
+	size_t bytes = (size_t) (right - left) * 4;
+	size_t stride = (size_t) canvas->tiles_x * CANVAS_TILE_SIZE;
+	unsigned int *copy = canvas->tile_pixels + (size_t) (top - canvas->dst.top) * stride + tx * CANVAS_TILE_SIZE;
+	int same = compare;
+	for (int y = top; y < bottom; y++) {
+		const unsigned int *pixels = canvas->pixels + (size_t) y * canvas->width + left;
+		// The rows before the first that differs are already the same
+		if (same && memcmp(copy, pixels, bytes) != 0) {
+			same = 0;
+		}
+		if (!same) {
+			memcpy(copy, pixels, bytes);
+		}
+		copy += stride;
+	}
+
+	return same;
+}
+
+void CanvasHashTiles(struct Canvas *canvas, int row) {
+	int top = canvas->dst.top + row * CANVAS_TILE_SIZE;
+	int bottom = top + CANVAS_TILE_SIZE < canvas->dst.bottom ? top + CANVAS_TILE_SIZE : canvas->dst.bottom;
+	if (canvas->channel_bits >= 4 && canvas->channel_bits < 8) {
+		for (int y = top; y < bottom; y++) {
+			reduceRow(canvas->pixels + (size_t) y * canvas->width + canvas->dst.left,
+					  canvas->dst.right - canvas->dst.left, canvas->channel_bits);
+		}
+	}
+	if (!canvas->dirty_tiles) {
+		return;
+	}
+
+	for (int first = 0; first < canvas->tiles_x; first += TILE_GROUP) {
+		int num = canvas->tiles_x - first < TILE_GROUP ? canvas->tiles_x - first : TILE_GROUP;
+		SIMD_ALIGN(16) unsigned int lanes[TILE_GROUP][4];
+		memset(lanes, 0, sizeof(lanes));
+		for (int y = top; y < bottom; y++) {
+			const unsigned int *pixels = canvas->pixels + (size_t) y * canvas->width;
+			for (int t = 0; t < num; t++) {
+				int left = canvas->dst.left + (first + t) * CANVAS_TILE_SIZE;
+				int right = left + CANVAS_TILE_SIZE < canvas->dst.right ? left + CANVAS_TILE_SIZE : canvas->dst.right;
+				int x = left;
+#ifdef EDW590SCR_SSE2
+				if (SimdHasSSE2()) {
+					__m128i h = _mm_load_si128((const __m128i *) lanes[t]);
+					for (; x + 4 <= right; x += 4) {
+						h = _mm_xor_si128(h, _mm_loadu_si128((const __m128i *) (pixels + x)));
+						h = _mm_add_epi32(h, _mm_slli_epi32(h, 10));
+						h = _mm_xor_si128(h, _mm_srli_epi32(h, 6));
+					}
+					_mm_store_si128((__m128i *) lanes[t], h);
+				}
+#endif
+				for (; x < right; x++) {
+					unsigned int h = lanes[t][(x - left) & 3] ^ pixels[x];
+					h += h << 10;
+					h ^= h >> 6;
+					lanes[t][(x - left) & 3] = h;
+				}
+			}
+		}
+
+		for (int t = 0; t < num; t++) {
+			int i = row * canvas->tiles_x + first + t;
+			unsigned int hash = mix(mix(mix(mix(lanes[t][0]) ^ lanes[t][1]) ^ lanes[t][2]) ^ lanes[t][3]);
+			int matches = canvas->tiles_valid && hash == canvas->tile_hashes[i];
+			canvas->tile_dirty[i] = !compareTile(canvas, first + t, top, bottom, matches);
+			canvas->tile_hashes[i] = hash;
+		}
+	}
+}
+
+int CanvasDirtyRects(struct Canvas *canvas) {
+	canvas->num_rects = 0;
+	if (canvas->present_bars) {
+		// Whatever was on the screen where the bars are now is still there
+		setRect(&canvas->rects[0], 0, 0, canvas->width, canvas->height);
+		canvas->num_rects = 1;
+		canvas->present_bars = 0;
+		canvas->tiles_valid = canvas->tile_hashes != NULL && canvas->dirty_tiles;
+
+		return 1;
+	}
+	if (canvas->tile_hashes == NULL || !canvas->dirty_tiles) {
+		canvas->rects[0] = canvas->dst;
+		canvas->num_rects = 1;
+
+		return 1;
+	}
+
+	// Runs of changed tiles along each row, joined to the same run in the row above if there was one. If that comes to
+	// too many, just the one rectangle round all of them.
+	struct CanvasRect bounds;
+	setRect(&bounds, canvas->dst.right, canvas->dst.bottom, canvas->dst.left, canvas->dst.top);
+	int too_many = 0;
+	for (int ty = 0; ty < canvas->tiles_y; ty++) {
+		int top = canvas->dst.top + ty * CANVAS_TILE_SIZE;
+		int bottom = top + CANVAS_TILE_SIZE < canvas->dst.bottom ? top + CANVAS_TILE_SIZE : canvas->dst.bottom;
+		int row_start = canvas->num_rects;
+		const unsigned char *dirty = canvas->tile_dirty + ty * canvas->tiles_x;
+		for (int tx = 0; tx < canvas->tiles_x; tx++) {
+			if (!dirty[tx]) {
+				continue;
+			}
+
+			int run = tx;
+			while (tx + 1 < canvas->tiles_x && dirty[tx + 1]) {
+				tx++;
+			}
+			int left = canvas->dst.left + run * CANVAS_TILE_SIZE;
+			int right = canvas->dst.left + (tx + 1) * CANVAS_TILE_SIZE;
+			if (right > canvas->dst.right) {
+				right = canvas->dst.right;
+			}
+			bounds.left = left < bounds.left ? left : bounds.left;
+			bounds.top = top < bounds.top ? top : bounds.top;
+			bounds.right = right > bounds.right ? right : bounds.right;
+			bounds.bottom = bottom;
+			if (too_many) {
+				continue;
+			}
+
+			int joined = 0;
+			for (int i = 0; i < row_start; i++) {
+				struct CanvasRect *rect = &canvas->rects[i];
+				if (rect->left == left && rect->right == right && rect->bottom == top) {
+					rect->bottom = bottom;
+					joined = 1;
+					break;
+				}
+			}
+			if (!joined) {
+				if (canvas->num_rects == CANVAS_MAX_RECTS) {
+					too_many = 1;
+				} else {
+					setRect(&canvas->rects[canvas->num_rects], left, top, right, bottom);
+					canvas->num_rects++;
+				}
+			}
+		}
+	}
+	canvas->tiles_valid = 1;
+
+	if (too_many) {
+		canvas->rects[0] = bounds;
+		canvas->num_rects = 1;
+	}
+
+	return canvas->num_rects;
+}
+
+void CanvasRelease(struct Canvas *canvas) {
+	ScalePlanFree(&canvas->plan);
+	ScalePlanFree(&canvas->low_plan);
+	FrameFree(&canvas->low);
+	FrameFree(&canvas->next);
+	free(canvas->tile_hashes);
+	free(canvas->tile_pixels);
+	free(canvas->tile_dirty);
+	canvas->tile_hashes = NULL;
+	canvas->tile_pixels = NULL;
+	canvas->tile_dirty = NULL;
+	canvas->tiles_valid = 0;
+	canvas->frame = NULL;
+	canvas->step = 0;
+}
+
+void CanvasFree(struct Canvas *canvas) {
+	CanvasRelease(canvas);
+	CanvasInit(canvas);
+}
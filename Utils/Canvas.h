@@ -0,0 +1,138 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_CANVAS_H
+#define EDW590SCR_CANVAS_H
+
+
+
+#include "Frame.h"
+#include "Scaler.h"
+#include "Transition.h"
+
+// What gets drawn, whatever it then gets shown on: a 32 bpp buffer the size of a window (or a monitor, or nothing at
+// all, for the offscreen backend), with the frame scaled into the middle of it as big as fits, keeping its aspect
+// ratio, and black bars either side. Only the frame's part changes from frame to frame, and only if it's a different
+// frame. The buffer itself belongs to the backend (a DIB section, for GDI), which says where it is with
+// CanvasSetPixels().
+
+struct CanvasRect {
+	int left;
+	int top;
+	int right;              // not included
+	int bottom;
+};
+
+#define CANVAS_TILE_SIZE 64
+#define CANVAS_MAX_RECTS 64
+
+struct Canvas {
+	int width;
+	int height;
+	unsigned int *pixels;   // width x height, top-down, rows width pixels apart
+
+	const struct Frame *frame;  // the frame that's in pixels now, or NULL (the frames belong to whoever loaded them)
+	int frame_width;
+	int frame_height;
+	int filter;             // a ScaleFilter, or -1 for SCALE_AREA when shrinking and SCALE_BILINEAR when enlarging
+	struct ScalePlan plan;  // for scaling frame_width x frame_height into dst (or into low)
+
+	// With divisor above 1, the frame's scaled to 1/divisor of dst's size, into low, and that's then blown up into dst
+	// with SCALE_NEAREST (low_plan), which costs little more than a copy. For when the full scale is too slow.
+	int divisor;
+	struct Frame low;
+	struct ScalePlan low_plan;
+
+	// With transition other than TRANSITION_CUT, a new frame's scaled into next instead, and then comes in over
+	// transition_steps frames (see Transition.h), a step each CanvasBeginFrame(), even with the same frame.
+	int transition;         // a TransitionKind
+	int transition_steps;
+	struct Frame next;
+	int step;               // the transition's next step, or 0 if there's none going
+	unsigned int transitions;   // how many there have been (the dissolve's seed)
+
+	// With dirty_tiles, dst is split into CANVAS_TILE_SIZE square tiles, and there's a signature and a copy of each as
+	// it was last presented, so that only the tiles that have changed since get presented again (consecutive frames
+	// often share most of their pixels: the glitches do, and the end of a wipe). See CanvasHashTiles().
+	int dirty_tiles;
+	int tiles_x;
+	int tiles_y;
+	int tiles_valid;        // 0 if tile_hashes say nothing about what's on the screen (nothing's been, or dst moved)
+	int channel_bits;       // the bits of each colour channel kept, from the top (8 for all of them; see Remote.h)
+	unsigned int *tile_hashes;
+	unsigned int *tile_pixels;  // the copies, tile by tile where they are in dst, tiles_x * CANVAS_TILE_SIZE apart
+	unsigned char *tile_dirty;
+	struct CanvasRect rects[CANVAS_MAX_RECTS];  // the tiles to present, joined up into rectangles
+	int num_rects;
+
+	struct CanvasRect dst;  // where the frame goes
+	struct CanvasRect bars[2];  // the letterbox or pillarbox bars on either side of dst
+	int num_bars;
+	int geometry_changed;   // the bars need filling again (the next CanvasBeginFrame() does it)
+	int present_bars;       // the bars need presenting: they've just been filled, or a present failed (the next
+							// CanvasDirtyRects() sees to it)
+};
+
+// CanvasInit - an empty canvas, with no pixels yet.
+void CanvasInit(struct Canvas *canvas);
+
+// CanvasSetPixels - the canvas's buffer is now pixels, of width x height (which has none of the old frame in it).
+void CanvasSetPixels(struct Canvas *canvas, unsigned int *pixels, int width, int height);
+
+// CanvasFit - where a frame_width x frame_height frame goes in a width x height canvas: as big as fits, keeping its
+// aspect ratio, in the middle.
+void CanvasFit(int frame_width, int frame_height, int width, int height, struct CanvasRect *dst);
+
+// CanvasSetQuality - changes the filter and the divisor. The frame that's there gets drawn again the next time, if
+// they're not what they were.
+void CanvasSetQuality(struct Canvas *canvas, int filter, int divisor);
+
+// CanvasBeginFrame - gets the canvas ready for frame and says what needs scaling into it in job (job->plan is NULL if
+// nothing does: the frame's already there), and in upscale what then needs blowing up once job's done (upscale->plan
+// is NULL unless divisor is above 1). Once they're done (with ScaleJobsTiled()), CanvasEndFrame() says so. Then
+// there's step, the transition step to do (with TransitionJobsTiled()), if step->steps isn't 0. Returns 0 if there's
+// no room for the frame or no memory for the plans.
+int CanvasBeginFrame(struct Canvas *canvas, const struct Frame *frame, struct ScaleJob *job, struct ScaleJob *upscale,
+					 struct TransitionJob *step);
+void CanvasEndFrame(struct Canvas *canvas, const struct Frame *frame);
+
+// CanvasTileRows - gets the tiles ready for dst, for once the frame's all drawn, and returns how many rows of them
+// there are to give CanvasHashTiles(). Returns 0 if there's nothing to do to them (no dirty_tiles, and all the
+// channel_bits) or no memory for them: all of dst gets presented as it is.
+int CanvasTileRows(struct Canvas *canvas);
+
+// CanvasHashTiles - cuts the colours in the row-th row of tiles down to channel_bits, then works out their signatures,
+// and which have changed: those whose signatures differ, and (as 2 can have the same one) those whose pixels differ
+// from the copy. Different rows can be done on different threads at once.
+void CanvasHashTiles(struct Canvas *canvas, int row);
+
+// CanvasDirtyRects - once all the rows are done, puts the tiles that changed in rects (all of dst, without the tiles),
+// and takes them to be on the screen from then on. If the bars have moved since the last time, it's the whole canvas
+// instead (all of dst has changed then anyway). Returns how many rects there are, 0 if nothing changed.
+int CanvasDirtyRects(struct Canvas *canvas);
+
+// CanvasRelease - frees what can be worked out again (the plans, low, next and the tiles), for while nothing's being
+// drawn. The next frame's drawn and presented in full, even if it's the one that's there.
+void CanvasRelease(struct Canvas *canvas);
+
+void CanvasFree(struct Canvas *canvas);
+
+
+
+#endif //EDW590SCR_CANVAS_H
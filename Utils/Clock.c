@@ -0,0 +1,233 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "Clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <time.h>
+#endif
+
+#ifdef _WIN32
+
+// Not in VS 2005's headers: high resolution waitable timers are Windows 10 1803 and up, and DwmFlush() is Vista and
+// up, so both are looked up at runtime.
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION_EDW590 0x00000002
+#define TIMER_ALL_ACCESS_EDW590 0x1F0003
+typedef HANDLE (WINAPI *CreateWaitableTimerExWFunc)(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+typedef LONG (WINAPI *DwmFlushFunc)(void);
+typedef UINT (WINAPI *TimePeriodFunc)(UINT);
+
+struct SystemClock {
+	struct Clock clock;
+	LARGE_INTEGER frequency;
+	HANDLE timer;
+	HMODULE winmm;          // if the timer isn't a high resolution one, timeBeginPeriod(1) makes it better
+	HMODULE dwmapi;
+	DwmFlushFunc dwm_flush;
+};
+
+static long long systemNow(struct Clock *clock) {
+	const struct SystemClock *system = (const struct SystemClock *) clock;
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	// In 2 parts, or counter * 1000000 overflows after a few weeks of uptime
+	return counter.QuadPart / system->frequency.QuadPart * 1000000 +
+		   counter.QuadPart % system->frequency.QuadPart * 1000000 / system->frequency.QuadPart;
+}
+
+static void systemSleepUntil(struct Clock *clock, long long deadline) {
+	const struct SystemClock *system = (const struct SystemClock *) clock;
+	long long left = deadline - systemNow(clock);
+	if (left <= 0) {
+		return;
+	}
+
+	LARGE_INTEGER due;
+	due.QuadPart = -left * 10; // relative, in 100 ns units
+	if (system->timer != NULL && SetWaitableTimer(system->timer, &due, 0, NULL, NULL, FALSE)) {
+		WaitForSingleObject(system->timer, INFINITE);
+	} else {
+		Sleep((DWORD) ((left + 999) / 1000));
+	}
+}
+
+static int systemWaitRefresh(struct Clock *clock) {
+	const struct SystemClock *system = (const struct SystemClock *) clock;
+
+	// DwmFlush() fails if desktop composition is off, and then there's no refresh to wait for this way
+	return system->dwm_flush != NULL && system->dwm_flush() >= 0;
+}
+
+static void systemYield(struct Clock *clock) {
+	(void) clock;
+	Sleep(0);
+}
+
+struct Clock *ClockCreateSystem(void) {
+	struct SystemClock *system = (struct SystemClock *) calloc(1, sizeof(struct SystemClock));
+	if (system == NULL) {
+		return NULL;
+	}
+	system->clock.now = systemNow;
+	system->clock.sleepUntil = systemSleepUntil;
+	system->clock.waitRefresh = systemWaitRefresh;
+	system->clock.yield = systemYield;
+	QueryPerformanceFrequency(&system->frequency);
+
+	CreateWaitableTimerExWFunc create_timer_ex = (CreateWaitableTimerExWFunc)
+			GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")), "CreateWaitableTimerExW");
+	if (create_timer_ex != NULL) {
+		system->timer = create_timer_ex(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION_EDW590,
+										TIMER_ALL_ACCESS_EDW590);
+	}
+	if (system->timer == NULL) {
+		system->timer = CreateWaitableTimer(NULL, TRUE, NULL);
+		system->winmm = LoadLibrary(TEXT("winmm.dll"));
+		if (system->winmm != NULL) {
+			TimePeriodFunc begin_period = (TimePeriodFunc) GetProcAddress(system->winmm, "timeBeginPeriod");
+			if (begin_period != NULL) {
+				begin_period(1);
+			}
+		}
+	}
+
+	system->dwmapi = LoadLibrary(TEXT("dwmapi.dll"));
+	if (system->dwmapi != NULL) {
+		system->dwm_flush = (DwmFlushFunc) GetProcAddress(system->dwmapi, "DwmFlush");
+	}
+
+	return &system->clock;
+}
+
+void ClockDestroySystem(struct Clock *clock) {
+	struct SystemClock *system = (struct SystemClock *) clock;
+	if (system == NULL) {
+		return;
+	}
+
+	if (system->timer != NULL) {
+		CloseHandle(system->timer);
+	}
+	if (system->winmm != NULL) {
+		TimePeriodFunc end_period = (TimePeriodFunc) GetProcAddress(system->winmm, "timeEndPeriod");
+		if (end_period != NULL) {
+			end_period(1);
+		}
+		FreeLibrary(system->winmm);
+	}
+	if (system->dwmapi != NULL) {
+		FreeLibrary(system->dwmapi);
+	}
+	free(system);
+}
+
+#else
+
+static long long systemNow(struct Clock *clock) {
+	struct timespec ts;
+	(void) clock;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void systemSleepUntil(struct Clock *clock, long long deadline) {
+	struct timespec ts;
+	(void) clock;
+	ts.tv_sec = (time_t) (deadline / 1000000);
+	ts.tv_nsec = (long) (deadline % 1000000 * 1000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+		// interrupted by a signal: go back to sleep
+	}
+}
+
+static int systemWaitRefresh(struct Clock *clock) {
+	(void) clock;
+
+	return 0;
+}
+
+static void systemYield(struct Clock *clock) {
+	(void) clock;
+	sched_yield();
+}
+
+struct Clock *ClockCreateSystem(void) {
+	struct Clock *clock = (struct Clock *) calloc(1, sizeof(struct Clock));
+	if (clock == NULL) {
+		return NULL;
+	}
+	clock->now = systemNow;
+	clock->sleepUntil = systemSleepUntil;
+	clock->waitRefresh = systemWaitRefresh;
+	clock->yield = systemYield;
+
+	return clock;
+}
+
+void ClockDestroySystem(struct Clock *clock) {
+	free(clock);
+}
+
+#endif
+
+static long long virtualNow(struct Clock *clock) {
+	return ((struct VirtualClock *) clock)->time;
+}
+
+static void virtualSleepUntil(struct Clock *clock, long long deadline) {
+	struct VirtualClock *virt = (struct VirtualClock *) clock;
+	if (deadline <= virt->time) {
+		return;
+	}
+
+	if (virt->granularity > 0) {
+		deadline = (deadline + virt->granularity - 1) / virt->granularity * virt->granularity;
+	}
+	virt->time = deadline + virt->oversleep;
+}
+
+static int virtualWaitRefresh(struct Clock *clock) {
+	struct VirtualClock *virt = (struct VirtualClock *) clock;
+	if (virt->refresh <= 0) {
+		return 0;
+	}
+
+	virt->time = (virt->time / virt->refresh + 1) * virt->refresh;
+
+	return 1;
+}
+
+static void virtualYield(struct Clock *clock) {
+	((struct VirtualClock *) clock)->time++;
+}
+
+void ClockInitVirtual(struct VirtualClock *clock) {
+	memset(clock, 0, sizeof(*clock));
+	clock->clock.now = virtualNow;
+	clock->clock.sleepUntil = virtualSleepUntil;
+	clock->clock.waitRefresh = virtualWaitRefresh;
+	clock->clock.yield = virtualYield;
+}
@@ -0,0 +1,64 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_CLOCK_H
+#define EDW590SCR_CLOCK_H
+
+
+
+// What the Pacer tells and waits for the time with. There's the system's clock, on Windows and on Linux, and a virtual
+// one, whose time only moves when something waits on it (a yield() counts as 1 microsecond), so pacing can be tried
+// out deterministically (with whatever timer resolution, oversleeping or refresh rate one cares to give it) without
+// waiting for real.
+//
+// Times are in microseconds, from whenever the clock likes.
+
+struct Clock {
+	long long (*now)(struct Clock *clock);
+
+	// Sleeps until deadline or a bit after it (timers are only so precise): never before.
+	void (*sleepUntil)(struct Clock *clock, long long deadline);
+
+	// Waits for the display's next refresh. Returns 0 at once if the clock has no way to.
+	int (*waitRefresh)(struct Clock *clock);
+
+	// Gives up the rest of the thread's time slice, for spin loops.
+	void (*yield)(struct Clock *clock);
+};
+
+// ClockCreateSystem - the system's clock: QueryPerformanceCounter and a waitable timer (a high resolution one where
+// Windows has them), with refreshes from DwmFlush() where there's DWM; or the monotonic clock on Linux, with no
+// refreshes. Returns NULL if out of memory.
+struct Clock *ClockCreateSystem(void);
+void ClockDestroySystem(struct Clock *clock);
+
+struct VirtualClock {
+	struct Clock clock;
+	long long time;
+	long long granularity;  // sleeps only end on multiples of this (like Windows' default 15.6 ms timer), or 0
+	long long oversleep;    // and then this much later still
+	long long refresh;      // the display refreshes at multiples of this, or 0 for no display
+};
+
+// ClockInitVirtual - a virtual clock at time 0 with a perfect timer and no display. Change the rest after.
+void ClockInitVirtual(struct VirtualClock *clock);
+
+
+
+#endif //EDW590SCR_CLOCK_H
@@ -0,0 +1,147 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Frame.h"
+
+static unsigned int get16(const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+int FrameAlloc(struct Frame *frame, int width, int height) {
+	memset(frame, 0, sizeof(*frame));
+	if (width <= 0 || height <= 0 || width > 32768 || height > 32768) {
+		return 0;
+	}
+	// Or the size wraps around on 32 bits, and the frame gets written way past what was allocated
+	if ((size_t) width * height > FRAME_MAX_PIXELS) {
+		return 0;
+	}
+
+	frame->pixels = (unsigned int *) malloc((size_t) width * height * 4);
+	if (frame->pixels == NULL) {
+		return 0;
+	}
+	frame->width = width;
+	frame->height = height;
+	frame->stride = width;
+
+	return 1;
+}
+
+void FrameFree(struct Frame *frame) {
+	free(frame->pixels);
+	memset(frame, 0, sizeof(*frame));
+}
+
+int FrameFromBMP(struct Frame *frame, const void *buf, unsigned long len) {
+	const unsigned char *p = (const unsigned char *) buf;
+	memset(frame, 0, sizeof(*frame));
+
+	// BITMAPFILEHEADER (14 bytes), then at least a BITMAPINFOHEADER (40)
+	if (len < 14 + 40 || p[0] != 'B' || p[1] != 'M') {
+		return 0;
+	}
+	unsigned int off_bits = get32(p + 10);
+	const unsigned char *info = p + 14;
+	unsigned int info_size = get32(info);
+	int width = (int) get32(info + 4);
+	int height = (int) get32(info + 8);
+	unsigned int bit_count = get16(info + 14);
+	unsigned int compression = get32(info + 16);
+	unsigned int clr_used = get32(info + 32);
+
+	// -INT_MIN doesn't fit in an int
+	if (height == INT_MIN) {
+		return 0;
+	}
+	int top_down = height < 0;
+	if (top_down) {
+		height = -height;
+	}
+	if (info_size < 40 || 14 + info_size > len || compression != 0 /*BI_RGB*/) {
+		return 0;
+	}
+	if (bit_count != 1 && bit_count != 4 && bit_count != 8 && bit_count != 24 && bit_count != 32) {
+		return 0;
+	}
+
+	unsigned int palette[256] = {0};
+	if (bit_count <= 8) {
+		unsigned int max_colors = 1u << bit_count;
+		unsigned int num_colors = clr_used == 0 || clr_used > max_colors ? max_colors : clr_used;
+		const unsigned char *pal = info + info_size;
+		if ((unsigned long) (pal - p) + num_colors * 4 > len) {
+			return 0;
+		}
+		for (unsigned int i = 0; i < num_colors; i++) {
+			palette[i] = get32(pal + i * 4) & 0xFFFFFF;
+		}
+	}
+
+	if (!FrameAlloc(frame, width, height)) {
+		return 0;
+	}
+	unsigned long row_bytes = (((unsigned long) width * bit_count + 31) / 32) * 4;
+	if (off_bits > len || (len - off_bits) / row_bytes < (unsigned long) height) {
+		FrameFree(frame);
+
+		return 0;
+	}
+
+	for (int y = 0; y < height; y++) {
+		const unsigned char *src = p + off_bits + row_bytes * (unsigned long) (top_down ? y : height - 1 - y);
+		unsigned int *dst = frame->pixels + (size_t) y * frame->stride;
+		switch (bit_count) {
+			case 32:
+				for (int x = 0; x < width; x++) {
+					dst[x] = get32(src + x * 4) & 0xFFFFFF;
+				}
+				break;
+			case 24:
+				for (int x = 0; x < width; x++) {
+					dst[x] = src[x * 3] | (src[x * 3 + 1] << 8) | (src[x * 3 + 2] << 16);
+				}
+				break;
+			case 8:
+				for (int x = 0; x < width; x++) {
+					dst[x] = palette[src[x]];
+				}
+				break;
+			case 4:
+				for (int x = 0; x < width; x++) {
+					dst[x] = palette[(src[x / 2] >> (x & 1 ? 0 : 4)) & 0xF];
+				}
+				break;
+			case 1:
+				for (int x = 0; x < width; x++) {
+					dst[x] = palette[(src[x / 8] >> (7 - (x & 7))) & 1];
+				}
+				break;
+		}
+	}
+
+	return 1;
+}
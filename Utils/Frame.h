@@ -0,0 +1,55 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_FRAME_H
+#define EDW590SCR_FRAME_H
+
+
+
+// A decoded frame, in the one pixel format that everything from here on works in: 32 bits per pixel, laid out as
+// the bytes B, G, R, X (the same as a 32 bpp DIB section), top row first. No Windows in here, so that the rendering
+// code can be built and run on Linux too.
+struct Frame {
+	int width;
+	int height;
+	int stride;             // in pixels, from one row to the next
+	unsigned int *pixels;
+
+	// The same at half the size, with its own half size in its mips, and so on (see ScaleBuildMips()), or NULL. They
+	// live at the end of pixels' block, so FrameFree() frees them too.
+	struct Frame *mips;
+};
+
+// FrameFromBMP - decodes a .bmp file held in memory (1, 4, 8, 24 or 32 bpp, uncompressed, either way up) into
+// frame, whose pixels then have to be freed with FrameFree. Returns 0 if it's not a .bmp it understands.
+int FrameFromBMP(struct Frame *frame, const void *buf, unsigned long len);
+
+// The most pixels a frame may have (16384 x 16384): 1 GB of them, and a third more with the mips, which still fits in
+// a size_t on 32-bit Windows.
+#define FRAME_MAX_PIXELS (1 << 28)
+
+// FrameAlloc - a frame of the given size, with its pixels not set to anything. Returns 0 if out of memory, or if it's
+// more than 32768 pixels either way or more than FRAME_MAX_PIXELS in all.
+int FrameAlloc(struct Frame *frame, int width, int height);
+
+void FrameFree(struct Frame *frame);
+
+
+
+#endif //EDW590SCR_FRAME_H
@@ -0,0 +1,307 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Glitch.h"
+#include "Simd.h"
+
+#define GLITCH_TASK_ROWS 32     // rows per ThreadPool task
+#define GLITCH_CALM_TICKS 16    // how long the channels stay the same distance apart outside the bands
+
+// lowbias32: a 32-bit hash, for random numbers that only depend on what they're for.
+static unsigned int mix(unsigned int x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352DU;
+	x ^= x >> 15;
+	x *= 0x846CA68BU;
+	x ^= x >> 16;
+
+	return x;
+}
+
+// xorshift32. state must never be 0.
+static unsigned int next(unsigned int *state) {
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+// A random number from lo to hi, both included.
+static int range(unsigned int *state, int lo, int hi) {
+	if (hi <= lo) {
+		return lo;
+	}
+
+	return lo + (int) (next(state) % (unsigned int) (hi - lo + 1));
+}
+
+void GlitchPlanInit(struct GlitchPlan *plan, int width, int height, unsigned int seed, unsigned long tick) {
+	static const unsigned int noise_masks[3] = {0x070707, 0x1F1F1F, 0x7F7F7F};
+	memset(plan, 0, sizeof(*plan));
+	plan->width = width;
+	plan->height = height;
+	unsigned int state = mix(seed ^ mix((unsigned int) tick * 0x9E3779B9U)) | 1;
+	plan->seed = next(&state);
+
+	// Most ticks are calm, with just the channels a little apart. Every so often there's a burst, and now and then a
+	// heavy one. How far apart only changes every GLITCH_CALM_TICKS ticks, so a tick after a calm one leaves most of
+	// the frame as it was, and only the rest needs presenting.
+	int unit = width / 320 + 1;
+	unsigned int calm = mix(seed ^ mix((unsigned int) (tick / GLITCH_CALM_TICKS) * 0x85EBCA6BU)) | 1;
+	plan->red_shift = range(&calm, -unit, unit);
+	plan->blue_shift = range(&calm, -unit, unit);
+	int level = range(&state, 0, 99);
+	if (level < 55) {
+		return;
+	}
+	int heavy = level >= 85;
+
+	plan->num_bands = range(&state, 1, heavy ? GLITCH_MAX_BANDS : 3);
+	for (int i = 0; i < plan->num_bands; i++) {
+		struct GlitchBand *band = &plan->bands[i];
+		int band_height = range(&state, height / 100 + 1, height / (heavy ? 5 : 10) + 1);
+		if (band_height > height) {
+			band_height = height;
+		}
+		band->top = range(&state, 0, height - band_height);
+		band->bottom = band->top + band_height;
+		int most = width / (heavy ? 6 : 20);
+		band->shift = range(&state, -most, most);
+		band->jitter = range(&state, 0, 2) == 0 ? range(&state, 1, unit * 2) : 0;
+		band->red_shift = range(&state, -unit * 4, unit * 4);
+		band->blue_shift = range(&state, -unit * 4, unit * 4);
+		band->noise = range(&state, 0, 3) == 0 ? noise_masks[range(&state, 0, 2)] : 0;
+	}
+
+	plan->num_blocks = heavy ? range(&state, 4, GLITCH_MAX_BLOCKS) : range(&state, 0, 4);
+	for (int i = 0; i < plan->num_blocks; i++) {
+		struct GlitchBlock *block = &plan->blocks[i];
+		block->width = range(&state, width / 40 + 1, width / (heavy ? 4 : 8) + 1);
+		block->height = range(&state, height / 60 + 1, height / 12 + 1);
+		if (block->width > width) {
+			block->width = width;
+		}
+		if (block->height > height) {
+			block->height = height;
+		}
+		block->x = range(&state, 0, width - block->width);
+		block->y = range(&state, 0, height - block->height);
+		block->src_x = range(&state, 0, width - block->width);
+		// Half of them smeared along their own rows
+		block->src_y = range(&state, 0, 1) == 0 ? block->y : range(&state, 0, height - block->height);
+		block->swap = range(&state, 0, 2) == 0;
+	}
+}
+
+static __inline int clampIndex(int i, int width) {
+	return i < 0 ? 0 : i >= width ? width - 1 : i;
+}
+
+// Row y of the output before the blocks: src moved right by shift, with red and blue from red_shift and blue_shift
+// further right than green.
+static void composeRow(const unsigned int *src, unsigned int *dst, int width, int shift, int red_shift,
+					   int blue_shift) {
+	int lowest = red_shift < blue_shift ? red_shift : blue_shift;
+	int highest = red_shift > blue_shift ? red_shift : blue_shift;
+	if (lowest > 0) {
+		lowest = 0;
+	}
+	if (highest < 0) {
+		highest = 0;
+	}
+
+	// From lo to hi - 1, none of the 3 need clamping to the row
+	int lo = shift - lowest;
+	int hi = width + shift - highest;
+	if (lo < 0) {
+		lo = 0;
+	}
+	// Or a shift past the end of the row runs the middle past it too
+	if (lo > width) {
+		lo = width;
+	}
+	if (hi > width) {
+		hi = width;
+	}
+	if (hi < lo) {
+		hi = lo;
+	}
+
+	int x = 0;
+	for (; x < lo; x++) {
+		dst[x] = (src[clampIndex(x - shift + red_shift, width)] & 0xFF0000) |
+				 (src[clampIndex(x - shift, width)] & 0xFF00) | (src[clampIndex(x - shift + blue_shift, width)] & 0xFF);
+	}
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i red = _mm_set1_epi32(0xFF0000);
+		const __m128i green = _mm_set1_epi32(0xFF00);
+		const __m128i blue = _mm_set1_epi32(0xFF);
+		for (; x + 4 <= hi; x += 4) {
+			__m128i r = _mm_loadu_si128((const __m128i *) (src + x - shift + red_shift));
+			__m128i g = _mm_loadu_si128((const __m128i *) (src + x - shift));
+			__m128i b = _mm_loadu_si128((const __m128i *) (src + x - shift + blue_shift));
+			__m128i out = _mm_or_si128(_mm_or_si128(_mm_and_si128(r, red), _mm_and_si128(g, green)),
+									   _mm_and_si128(b, blue));
+			_mm_storeu_si128((__m128i *) (dst + x), out);
+		}
+	}
+#endif
+	for (; x < hi; x++) {
+		dst[x] = (src[x - shift + red_shift] & 0xFF0000) | (src[x - shift] & 0xFF00) |
+				 (src[x - shift + blue_shift] & 0xFF);
+	}
+	for (; x < width; x++) {
+		dst[x] = (src[clampIndex(x - shift + red_shift, width)] & 0xFF0000) |
+				 (src[clampIndex(x - shift, width)] & 0xFF00) | (src[clampIndex(x - shift + blue_shift, width)] & 0xFF);
+	}
+}
+
+// XORs noise into the mask bits of a row. Pixel x gets its noise from xorshift32 number x / 4 of lane x % 4, so the
+// SSE2 version (which steps all 4 lanes at once) gives exactly the same noise.
+static void noiseRow(unsigned int *row, int width, unsigned int mask, unsigned int seed) {
+	SIMD_ALIGN(16) unsigned int lanes[4];
+	for (int k = 0; k < 4; k++) {
+		lanes[k] = mix(seed + k) | 1;
+	}
+
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		__m128i state = _mm_load_si128((const __m128i *) lanes);
+		const __m128i bits = _mm_set1_epi32((int) mask);
+		for (; x + 4 <= width; x += 4) {
+			state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+			state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+			state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+			__m128i pixels = _mm_loadu_si128((const __m128i *) (row + x));
+			_mm_storeu_si128((__m128i *) (row + x), _mm_xor_si128(pixels, _mm_and_si128(state, bits)));
+		}
+		_mm_store_si128((__m128i *) lanes, state);
+	}
+#endif
+	for (; x < width; x += 4) {
+		for (int k = 0; k < 4; k++) {
+			unsigned int noise = next(&lanes[k]);
+			if (x + k < width) {
+				row[x + k] ^= noise & mask;
+			}
+		}
+	}
+}
+
+// Copies a run of pixels with red and blue swapped.
+static void copySwapped(const unsigned int *src, unsigned int *dst, int count) {
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i keep = _mm_set1_epi32((int) 0xFF00FF00);
+		const __m128i low = _mm_set1_epi32(0xFF);
+		for (; x + 4 <= count; x += 4) {
+			__m128i p = _mm_loadu_si128((const __m128i *) (src + x));
+			__m128i out = _mm_or_si128(_mm_and_si128(p, keep),
+									   _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low),
+													_mm_slli_epi32(_mm_and_si128(p, low), 16)));
+			_mm_storeu_si128((__m128i *) (dst + x), out);
+		}
+	}
+#endif
+	for (; x < count; x++) {
+		unsigned int p = src[x];
+		dst[x] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+	}
+}
+
+void GlitchRows(const struct GlitchPlan *plan, const struct Frame *src, struct Frame *dst, int y_start, int y_end) {
+	int width = plan->width;
+	for (int y = y_start; y < y_end; y++) {
+		const unsigned int *in = src->pixels + (size_t) y * src->stride;
+		unsigned int *out = dst->pixels + (size_t) y * dst->stride;
+
+		// The last band over the row is the one that counts
+		const struct GlitchBand *band = NULL;
+		for (int i = 0; i < plan->num_bands; i++) {
+			if (y >= plan->bands[i].top && y < plan->bands[i].bottom) {
+				band = &plan->bands[i];
+			}
+		}
+		if (band == NULL) {
+			composeRow(in, out, width, 0, plan->red_shift, plan->blue_shift);
+		} else {
+			int shift = band->shift;
+			if (band->jitter > 0) {
+				shift += (int) (mix(plan->seed ^ (unsigned int) (y * 2 + 1)) % (unsigned int) (band->jitter * 2 + 1)) -
+						 band->jitter;
+			}
+			composeRow(in, out, width, shift, band->red_shift, band->blue_shift);
+			if (band->noise != 0) {
+				noiseRow(out, width, band->noise, mix(plan->seed + (unsigned int) y));
+			}
+		}
+
+		for (int i = 0; i < plan->num_blocks; i++) {
+			const struct GlitchBlock *block = &plan->blocks[i];
+			if (y < block->y || y >= block->y + block->height) {
+				continue;
+			}
+			int from_y = block->src_y + y - block->y;
+			const unsigned int *from = src->pixels + (size_t) from_y * src->stride + block->src_x;
+			if (block->swap) {
+				copySwapped(from, out + block->x, block->width);
+			} else {
+				memcpy(out + block->x, from, block->width * 4);
+			}
+		}
+	}
+}
+
+struct GlitchTasks {
+	const struct GlitchPlan *plan;
+	const struct Frame *src;
+	struct Frame *dst;
+};
+
+static void glitchTask(void *context, int task, int worker) {
+	struct GlitchTasks *tasks = (struct GlitchTasks *) context;
+	int y_start = task * GLITCH_TASK_ROWS;
+	int y_end = y_start + GLITCH_TASK_ROWS;
+	if (y_end > tasks->plan->height) {
+		y_end = tasks->plan->height;
+	}
+	GlitchRows(tasks->plan, tasks->src, tasks->dst, y_start, y_end);
+	(void) worker;
+}
+
+void GlitchFrame(const struct GlitchPlan *plan, const struct Frame *src, struct Frame *dst, struct ThreadPool *pool) {
+	if (pool == NULL) {
+		GlitchRows(plan, src, dst, 0, plan->height);
+
+		return;
+	}
+
+	struct GlitchTasks tasks;
+	tasks.plan = plan;
+	tasks.src = src;
+	tasks.dst = dst;
+	ThreadPoolRun(pool, (plan->height + GLITCH_TASK_ROWS - 1) / GLITCH_TASK_ROWS, glitchTask, &tasks);
+}
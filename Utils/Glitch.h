@@ -0,0 +1,83 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_GLITCH_H
+#define EDW590SCR_GLITCH_H
+
+
+
+#include "Frame.h"
+#include "ThreadPool.h"
+
+// Makes glitched frames out of one clean image, as they're needed, instead of loading pre-made ones: the colour
+// channels pulled apart, bands of scanlines knocked sideways, blocks of the image copied to where they don't belong
+// (sometimes with red and blue swapped), and bands of noise.
+//
+// What a tick's glitches are comes only from the seed and the tick's number, so the same seed always gives the same
+// frames, on any machine, with or without SIMD. Everything a pixel needs comes from the source image, never from the
+// rest of the output, so the rows can be done in any order, on any thread.
+
+#define GLITCH_MAX_BANDS 8
+#define GLITCH_MAX_BLOCKS 16
+
+struct GlitchBand {
+	int top;
+	int bottom;             // not included
+	int shift;              // how far right its rows are moved (left if negative), before...
+	int jitter;             // ...each row gets up to this much more, either way
+	int red_shift;          // how much further right red comes from than green (left if negative)...
+	int blue_shift;         // ...and blue
+	unsigned int noise;     // the bits of each channel that get noise XORed into them (0 for none)
+};
+
+struct GlitchBlock {
+	int x;
+	int y;
+	int width;
+	int height;
+	int src_x;              // where in the source it's copied from
+	int src_y;
+	int swap;               // red and blue swapped
+};
+
+struct GlitchPlan {
+	int width;
+	int height;
+	unsigned int seed;      // of this tick, for the row jitter and the noise
+	int red_shift;          // for the rows outside the bands
+	int blue_shift;
+	struct GlitchBand bands[GLITCH_MAX_BANDS];
+	int num_bands;
+	struct GlitchBlock blocks[GLITCH_MAX_BLOCKS];
+	int num_blocks;
+};
+
+// GlitchPlanInit - works out tick's glitches for a width x height image.
+void GlitchPlanInit(struct GlitchPlan *plan, int width, int height, unsigned int seed, unsigned long tick);
+
+// GlitchRows - makes rows y_start to y_end - 1 of dst out of src. Both must be plan->width x plan->height, and not the
+// same frame.
+void GlitchRows(const struct GlitchPlan *plan, const struct Frame *src, struct Frame *dst, int y_start, int y_end);
+
+// GlitchFrame - all the rows, in bands shared out over pool's threads (pool may be NULL).
+void GlitchFrame(const struct GlitchPlan *plan, const struct Frame *src, struct Frame *dst, struct ThreadPool *pool);
+
+
+
+#endif //EDW590SCR_GLITCH_H
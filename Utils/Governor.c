@@ -0,0 +1,121 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Governor.h"
+
+#define DOWN_FRAMES 8           // frames in a row over budget before stepping down
+#define MIN_UP_FRAMES 60        // frames in a row well under budget before first trying a step up
+#define MAX_UP_FRAMES 1800
+#define DOWN_PERCENT 90
+#define UP_PERCENT 60
+
+static int fpsOf(const struct Governor *governor, int level) {
+	int fps = governor->fps * governor->levels[level].fps_percent / 100;
+
+	return fps > 0 ? fps : 1;
+}
+
+// How long a frame has at a level, in microseconds.
+static long long budgetOf(const struct Governor *governor, int level) {
+	return 1000000 / fpsOf(governor, level);
+}
+
+static void setLevel(struct Governor *governor, int level) {
+	governor->level = level;
+	governor->average = 0; // the old level's frame times say nothing about this one's
+	governor->over = 0;
+	governor->under = 0;
+	governor->changes++;
+}
+
+void GovernorInit(struct Governor *governor, const struct GovernorLevel *levels, int num_levels, int fps) {
+	memset(governor, 0, sizeof(*governor));
+	if (num_levels > GOVERNOR_MAX_LEVELS) {
+		num_levels = GOVERNOR_MAX_LEVELS;
+	}
+	if (num_levels > 0) {
+		memcpy(governor->levels, levels, num_levels * sizeof(struct GovernorLevel));
+	} else {
+		governor->levels[0].fps_percent = 100;
+		governor->levels[0].filter = -1;
+		governor->levels[0].divisor = 1;
+		num_levels = 1;
+	}
+	governor->num_levels = num_levels;
+	governor->fps = fps > 0 ? fps : 1;
+	governor->up_after = MIN_UP_FRAMES;
+	governor->since_up = MAX_UP_FRAMES * 2;
+}
+
+int GovernorUpdate(struct Governor *governor, long long frame_time) {
+	if (governor->average == 0) {
+		governor->average = frame_time;
+	} else {
+		governor->average += (frame_time - governor->average) / 8;
+	}
+	// A step up that's held: the next one can come sooner again
+	if (governor->since_up < MAX_UP_FRAMES * 2) {
+		governor->since_up++;
+		if (governor->since_up == governor->up_after * 2 && governor->up_after > MIN_UP_FRAMES) {
+			governor->up_after /= 2;
+		}
+	}
+
+	int level = governor->level;
+	if (governor->average * 100 > budgetOf(governor, level) * DOWN_PERCENT) {
+		governor->under = 0;
+		if (++governor->over >= DOWN_FRAMES && level + 1 < governor->num_levels) {
+			// Too soon after stepping up: that level's too slow, so it won't be tried again for a while
+			if (governor->since_up < governor->up_after * 2) {
+				governor->up_after *= 2;
+				if (governor->up_after > MAX_UP_FRAMES) {
+					governor->up_after = MAX_UP_FRAMES;
+				}
+			}
+			setLevel(governor, level + 1);
+
+			return 1;
+		}
+
+		return 0;
+	}
+	governor->over = 0;
+
+	if (level > 0 && governor->average * 100 < budgetOf(governor, level - 1) * UP_PERCENT) {
+		if (++governor->under >= governor->up_after) {
+			setLevel(governor, level - 1);
+			governor->since_up = 0;
+
+			return 1;
+		}
+	} else {
+		governor->under = 0;
+	}
+
+	return 0;
+}
+
+int GovernorFps(const struct Governor *governor) {
+	return fpsOf(governor, governor->level);
+}
+
+const struct GovernorLevel *GovernorCurrent(const struct Governor *governor) {
+	return &governor->levels[governor->level];
+}
@@ -0,0 +1,69 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_GOVERNOR_H
+#define EDW590SCR_GOVERNOR_H
+
+
+
+// Steps the quality down when frames take longer than they have, and back up once there's room again, so a slow
+// machine (a thin client) shows a steady, lower rate instead of stuttering as it falls behind.
+//
+// The levels go from the best (0) to the cheapest. The governor keeps a running average of how long a frame's work
+// takes, and steps down once it's been over 90% of the level's period for a while. It only steps back up once it's
+// been under 60% of the better level's period for a good while longer, and if that better level then turns out too
+// slow after all, it waits twice as long before trying it again, so it doesn't go up and down all the time.
+
+#define GOVERNOR_MAX_LEVELS 8
+
+struct GovernorLevel {
+	int fps_percent;        // of the configured FPS
+	int filter;             // a ScaleFilter, or -1 for the configured one
+	int divisor;            // scale to 1/divisor the size and blow that up (see Canvas.h), or 1
+};
+
+struct Governor {
+	struct GovernorLevel levels[GOVERNOR_MAX_LEVELS];
+	int num_levels;
+	int fps;                // the configured FPS
+	int level;              // the one in use now
+
+	long long average;      // how long the frames have been taking lately, in microseconds
+	int over;               // frames in a row with the average over budget
+	int under;              // and under the better level's
+	int up_after;           // how many of those before stepping up
+	int since_up;           // frames since the last step up
+	long long changes;      // how many times the level's changed in all
+};
+
+// GovernorInit - starts at level 0 of levels, for a configured FPS of fps.
+void GovernorInit(struct Governor *governor, const struct GovernorLevel *levels, int num_levels, int fps);
+
+// GovernorUpdate - says how long the last frame's work took, in microseconds. Returns 1 if the level's changed.
+int GovernorUpdate(struct Governor *governor, long long frame_time);
+
+// GovernorFps - the FPS of the level in use.
+int GovernorFps(const struct Governor *governor);
+
+// GovernorCurrent - the level in use.
+const struct GovernorLevel *GovernorCurrent(const struct Governor *governor);
+
+
+
+#endif //EDW590SCR_GOVERNOR_H
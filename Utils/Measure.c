@@ -0,0 +1,35 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stddef.h>
+#include "Measure.h"
+
+static MeasureHook hook_GL = NULL;
+static void *hook_context_GL = NULL;
+
+void MeasureSetHook(MeasureHook hook, void *context) {
+	hook_GL = hook;
+	hook_context_GL = context;
+}
+
+void Measure(const char *name, long long value, const char *unit) {
+	if (hook_GL != NULL) {
+		hook_GL(hook_context_GL, name, value, unit);
+	}
+}
@@ -0,0 +1,43 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_MEASURE_H
+#define EDW590SCR_MEASURE_H
+
+
+
+// Measurements of how long things took and how much got done, for whoever wants them: the debugger's output (see
+// main.c), a test, a log. Whatever measured something says so with Measure(), which passes it on to the hook if
+// there is one and does nothing if not, so nothing's formatted or written while nobody's listening. The hook gets
+// called on whichever thread did the measuring.
+
+// MeasureHook - a measurement: of what (like "render.scale"), how much, and in what ("us", "ms", "B", "B/s", or "" for
+// a plain number).
+typedef void (*MeasureHook)(void *context, const char *name, long long value, const char *unit);
+
+// MeasureSetHook - the measurements go to hook, with context, from now on (NULL for nowhere). Set it before anything
+// might be measured, not while.
+void MeasureSetHook(MeasureHook hook, void *context);
+
+// Measure - a measurement, for the hook.
+void Measure(const char *name, long long value, const char *unit);
+
+
+
+#endif //EDW590SCR_MEASURE_H
@@ -0,0 +1,73 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "Offscreen.h"
+
+static int offscreenPresent(struct RenderTarget *target, const struct CanvasRect *rects, int num_rects) {
+	struct Offscreen *offscreen = (struct Offscreen *) target;
+	int width = offscreen->canvas.width;
+	for (int i = 0; i < num_rects; i++) {
+		const struct CanvasRect *rect = &rects[i];
+		for (int y = rect->top; y < rect->bottom; y++) {
+			memcpy(offscreen->front + (size_t) y * width + rect->left,
+				   offscreen->back + (size_t) y * width + rect->left, (rect->right - rect->left) * 4);
+		}
+		offscreen->bytes_written += (long long) (rect->right - rect->left) * (rect->bottom - rect->top) * 4;
+	}
+	offscreen->num_presents++;
+
+	return 1;
+}
+
+struct Offscreen *OffscreenCreate(int width, int height) {
+	if (width <= 0 || height <= 0) {
+		return NULL;
+	}
+
+	struct Offscreen *offscreen = (struct Offscreen *) calloc(1, sizeof(struct Offscreen));
+	if (offscreen == NULL) {
+		return NULL;
+	}
+	offscreen->back = (unsigned int *) calloc((size_t) width * height, 4);
+	offscreen->front = (unsigned int *) calloc((size_t) width * height, 4);
+	if (offscreen->back == NULL || offscreen->front == NULL) {
+		OffscreenDestroy(offscreen);
+
+		return NULL;
+	}
+	CanvasInit(&offscreen->canvas);
+	CanvasSetPixels(&offscreen->canvas, offscreen->back, width, height);
+	offscreen->target.canvas = &offscreen->canvas;
+	offscreen->target.present = offscreenPresent;
+
+	return offscreen;
+}
+
+void OffscreenDestroy(struct Offscreen *offscreen) {
+	if (offscreen == NULL) {
+		return;
+	}
+
+	CanvasFree(&offscreen->canvas);
+	free(offscreen->back);
+	free(offscreen->front);
+	free(offscreen);
+}
@@ -0,0 +1,46 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_OFFSCREEN_H
+#define EDW590SCR_OFFSCREEN_H
+
+
+
+#include "Canvas.h"
+#include "Render.h"
+
+// A RenderTarget that's just memory: for running and timing the rendering without any windows, on Windows or Linux.
+// Presenting copies the canvas into front, like a BitBlt to a window would, so that's timed too (and counted, in
+// bytes_written), and front is what would be on the screen.
+struct Offscreen {
+	struct RenderTarget target;
+	struct Canvas canvas;
+	unsigned int *back;     // the canvas's pixels
+	unsigned int *front;    // width x height too
+	int num_presents;
+	long long bytes_written;
+};
+
+// OffscreenCreate - an offscreen target of width x height, all black. Returns NULL if out of memory.
+struct Offscreen *OffscreenCreate(int width, int height);
+void OffscreenDestroy(struct Offscreen *offscreen);
+
+
+
+#endif //EDW590SCR_OFFSCREEN_H
@@ -0,0 +1,137 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Pacer.h"
+
+#define MIN_SPIN_MARGIN 500     // microseconds
+
+static long long deadlineOf(const struct Pacer *pacer, long long frame) {
+	return pacer->start + (frame - pacer->base) * 1000000000 / pacer->rate;
+}
+
+void PacerInit(struct Pacer *pacer, struct Clock *clock, int fps, enum PacerBackend backend) {
+	memset(pacer, 0, sizeof(*pacer));
+	pacer->clock = clock;
+	pacer->backend = backend;
+	pacer->rate = fps > 0 ? (long long) fps * 1000 : 1000;
+	pacer->start = clock->now(clock);
+	pacer->spin_margin = 2000;
+}
+
+void PacerSetFps(struct Pacer *pacer, int fps) {
+	PacerSetRate(pacer, (long long) fps * 1000);
+}
+
+void PacerSetRate(struct Pacer *pacer, long long rate) {
+	pacer->start = deadlineOf(pacer, pacer->frame);
+	pacer->base = pacer->frame;
+	pacer->rate = rate > 0 ? rate : 1000;
+}
+
+long long PacerDeadline(const struct Pacer *pacer) {
+	return deadlineOf(pacer, pacer->frame);
+}
+
+void PacerRestart(struct Pacer *pacer) {
+	pacer->start = pacer->clock->now(pacer->clock);
+	pacer->base = pacer->frame;
+	pacer->last_refresh = 0; // the refreshes waited for before say nothing about when the next one is
+}
+
+// Sleeps until spin_margin before the deadline, and spins from there. The margin is kept at a little more than the
+// timer's recent oversleeping: straight up to it when it oversleeps more, and slowly back down when less.
+static void spinUntil(struct Pacer *pacer, long long deadline) {
+	struct Clock *clock = pacer->clock;
+	long long wake = deadline - pacer->spin_margin;
+	if (clock->now(clock) < wake) {
+		clock->sleepUntil(clock, wake);
+
+		long long wanted = clock->now(clock) - wake + MIN_SPIN_MARGIN;
+		if (wanted > pacer->spin_margin) {
+			pacer->spin_margin = wanted;
+		} else {
+			pacer->spin_margin -= (pacer->spin_margin - wanted) / 16;
+		}
+		// Never spin for more than a quarter of the frame
+		long long most = 1000000000 / pacer->rate / 4;
+		if (pacer->spin_margin > most) {
+			pacer->spin_margin = most;
+		}
+		if (pacer->spin_margin < MIN_SPIN_MARGIN) {
+			pacer->spin_margin = MIN_SPIN_MARGIN;
+		}
+	}
+	while (clock->now(clock) < deadline) {
+		clock->yield(clock);
+	}
+}
+
+// Waits for refreshes until the one nearest the deadline. Returns 0 if the clock has none to wait for.
+static int refreshUntil(struct Pacer *pacer, long long deadline) {
+	struct Clock *clock = pacer->clock;
+	while (clock->now(clock) < deadline - pacer->refresh / 2) {
+		if (!clock->waitRefresh(clock)) {
+			return 0;
+		}
+
+		long long now = clock->now(clock);
+		long long interval = now - pacer->last_refresh;
+		if (pacer->last_refresh != 0 && interval > 2000 && interval < 100000) { // between 500 and 10 Hz
+			pacer->refresh = pacer->refresh == 0 ? interval : pacer->refresh + (interval - pacer->refresh) / 8;
+		}
+		pacer->last_refresh = now;
+	}
+
+	return 1;
+}
+
+long long PacerWait(struct Pacer *pacer) {
+	struct Clock *clock = pacer->clock;
+	long long deadline = deadlineOf(pacer, pacer->frame);
+	long long now = clock->now(clock);
+
+	// A period or more late already: skip to the frame that's due now
+	if (now - deadline >= 1000000000 / pacer->rate) {
+		long long due = pacer->base + (now - pacer->start) * pacer->rate / 1000000000;
+		pacer->skipped += due - pacer->frame;
+		pacer->frame = due;
+		deadline = deadlineOf(pacer, due);
+	}
+
+	if (now < deadline) {
+		switch (pacer->backend) {
+			case PACER_TIMER:
+				clock->sleepUntil(clock, deadline);
+				break;
+			case PACER_REFRESH:
+				if (refreshUntil(pacer, deadline)) {
+					break;
+				}
+				// fall through
+			case PACER_SPIN:
+				spinUntil(pacer, deadline);
+				break;
+		}
+	}
+
+	pacer->late = clock->now(clock) - deadline;
+
+	return pacer->frame++;
+}
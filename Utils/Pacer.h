@@ -0,0 +1,78 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_PACER_H
+#define EDW590SCR_PACER_H
+
+
+
+#include "Clock.h"
+
+// Says when it's time for the next frame, at a steady FPS. It replaced SetTimer(33), whose WM_TIMERs come on the
+// system timer's 15.6 ms ticks, so frames took 31 and 47 ms in turn, and late ones pushed all the next ones later.
+//
+// Frame n is due at start + (n - base) / FPS seconds, worked out from scratch each time, so lateness never adds up. A
+// frame that's already a whole period late when its turn comes is skipped, rather than rushing several out to catch up.
+
+enum PacerBackend {
+	PACER_TIMER,        // sleep on the clock's timer until the deadline. Cheapest, but only as precise as the timer
+	PACER_SPIN,         // sleep until just before the deadline, then spin the rest. How long before adapts to how
+						// late the timer has been waking up lately
+	PACER_REFRESH,      // wait on display refreshes, and go on the one nearest the deadline, so frames never tear or
+						// judder against the refresh. Same as PACER_SPIN if the clock can't wait on refreshes
+};
+
+struct Pacer {
+	struct Clock *clock;
+	enum PacerBackend backend;
+	long long rate;         // frames per 1000 seconds (millihertz), so it can be 37.5 FPS
+	long long base;         // the frame the rate was last set on
+	long long start;        // when it was due
+	long long frame;        // the next frame
+
+	long long spin_margin;  // PACER_SPIN: how long before the deadline to stop sleeping
+	long long refresh;      // PACER_REFRESH: the time between refreshes, as measured so far (0 before it knows)
+	long long last_refresh; // when the last refresh wait returned
+
+	long long late;         // how late the last frame came, in microseconds
+	long long skipped;      // how many frames have been skipped in all
+};
+
+// PacerInit - frame 0 is due now.
+void PacerInit(struct Pacer *pacer, struct Clock *clock, int fps, enum PacerBackend backend);
+
+// PacerSetFps - changes the FPS from the next frame on, which is still due when it was.
+void PacerSetFps(struct Pacer *pacer, int fps);
+
+// PacerSetRate - the same, in frames per 1000 seconds.
+void PacerSetRate(struct Pacer *pacer, long long rate);
+
+// PacerDeadline - when the next frame's due (if it's not skipped).
+long long PacerDeadline(const struct Pacer *pacer);
+
+// PacerRestart - the next frame is due now, for when nothing's waited for frames for a while (they'd all count as
+// skipped otherwise). The frame numbers go on from where they were.
+void PacerRestart(struct Pacer *pacer);
+
+// PacerWait - waits until the next frame is due, and returns its number (which skips any that were skipped).
+long long PacerWait(struct Pacer *pacer);
+
+
+
+#endif //EDW590SCR_PACER_H
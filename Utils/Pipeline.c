@@ -0,0 +1,202 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "Pipeline.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define RETRY_MS 100            // how long to wait before asking again for a frame that couldn't be had
+
+struct Pipeline {
+	struct Clock *clock;
+	PipelineProduce produce;
+	void *context;
+	struct PipelineItem items[PIPELINE_SLOTS];
+	struct Queue made;      // from the pipeline's thread to the drawing one
+	struct Queue done;      // and back
+	long long sequence;
+	volatile int quit;
+#ifdef _WIN32
+	HANDLE thread;
+	HANDLE wake;            // auto-reset: set when an item comes back (or the pipeline is going away)
+#else
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	int woken;
+#endif
+};
+
+// Waits up to ms milliseconds (for ever if it's -1) for an item to come back, or for quit.
+static void waitForItem(struct Pipeline *pipeline, int ms) {
+#ifdef _WIN32
+	WaitForSingleObject(pipeline->wake, ms < 0 ? INFINITE : (DWORD) ms);
+#else
+	struct timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec += ms / 1000;
+	until.tv_nsec += (long) (ms % 1000) * 1000000;
+	if (until.tv_nsec >= 1000000000) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&pipeline->mutex);
+	while (!pipeline->woken && !pipeline->quit) {
+		if (ms < 0) {
+			pthread_cond_wait(&pipeline->wake, &pipeline->mutex);
+		} else if (pthread_cond_timedwait(&pipeline->wake, &pipeline->mutex, &until) != 0) {
+			break;
+		}
+	}
+	pipeline->woken = 0;
+	pthread_mutex_unlock(&pipeline->mutex);
+#endif
+}
+
+static void wakeUp(struct Pipeline *pipeline) {
+#ifdef _WIN32
+	SetEvent(pipeline->wake);
+#else
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->woken = 1;
+	pthread_cond_signal(&pipeline->wake);
+	pthread_mutex_unlock(&pipeline->mutex);
+#endif
+}
+
+static void run(struct Pipeline *pipeline) {
+	struct PipelineItem *item = NULL;
+	while (!pipeline->quit) {
+		if (item == NULL) {
+			item = (struct PipelineItem *) QueuePop(&pipeline->done);
+			if (item == NULL) {
+				waitForItem(pipeline, -1);
+				continue;
+			}
+		}
+
+		item->frame = NULL;
+		item->sequence = pipeline->sequence;
+		memset(&item->timings, 0, sizeof(item->timings));
+		if (!pipeline->produce(pipeline->context, item)) {
+			// Keep the item for the next try
+			waitForItem(pipeline, RETRY_MS);
+			continue;
+		}
+		item->made = pipeline->clock->now(pipeline->clock);
+		pipeline->sequence++;
+		QueuePush(&pipeline->made, item); // there's always room: there are only PIPELINE_SLOTS items
+		item = NULL;
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pipelineThread(LPVOID param) {
+	run((struct Pipeline *) param);
+
+	return 0;
+}
+#else
+static void *pipelineThread(void *param) {
+	run((struct Pipeline *) param);
+
+	return NULL;
+}
+#endif
+
+struct Pipeline *PipelineCreate(struct Clock *clock, PipelineProduce produce, void *context) {
+	struct Pipeline *pipeline = (struct Pipeline *) calloc(1, sizeof(struct Pipeline));
+	if (pipeline == NULL) {
+		return NULL;
+	}
+	pipeline->clock = clock;
+	pipeline->produce = produce;
+	pipeline->context = context;
+	QueueInit(&pipeline->made, PIPELINE_SLOTS);
+	QueueInit(&pipeline->done, PIPELINE_SLOTS);
+	// They all start off done with, as if they'd come back
+	for (int i = 0; i < PIPELINE_SLOTS; i++) {
+		QueuePush(&pipeline->done, &pipeline->items[i]);
+	}
+
+#ifdef _WIN32
+	pipeline->wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (pipeline->wake != NULL) {
+		pipeline->thread = CreateThread(NULL, 0, pipelineThread, pipeline, 0, NULL);
+	}
+	if (pipeline->thread == NULL) {
+		if (pipeline->wake != NULL) {
+			CloseHandle(pipeline->wake);
+		}
+		free(pipeline);
+
+		return NULL;
+	}
+#else
+	pthread_mutex_init(&pipeline->mutex, NULL);
+	pthread_cond_init(&pipeline->wake, NULL);
+	if (pthread_create(&pipeline->thread, NULL, pipelineThread, pipeline) != 0) {
+		pthread_mutex_destroy(&pipeline->mutex);
+		pthread_cond_destroy(&pipeline->wake);
+		free(pipeline);
+
+		return NULL;
+	}
+#endif
+
+	return pipeline;
+}
+
+struct PipelineItem *PipelineTake(struct Pipeline *pipeline) {
+	return (struct PipelineItem *) QueuePop(&pipeline->made);
+}
+
+void PipelineRelease(struct Pipeline *pipeline, struct PipelineItem *item) {
+	QueuePush(&pipeline->done, item);
+	wakeUp(pipeline);
+}
+
+void PipelineDestroy(struct Pipeline *pipeline) {
+	if (pipeline == NULL) {
+		return;
+	}
+
+	pipeline->quit = 1;
+	wakeUp(pipeline);
+#ifdef _WIN32
+	WaitForSingleObject(pipeline->thread, INFINITE);
+	CloseHandle(pipeline->thread);
+	CloseHandle(pipeline->wake);
+#else
+	pthread_join(pipeline->thread, NULL);
+	pthread_mutex_destroy(&pipeline->mutex);
+	pthread_cond_destroy(&pipeline->wake);
+#endif
+	for (int i = 0; i < PIPELINE_SLOTS; i++) {
+		FrameFree(&pipeline->items[i].buffer);
+	}
+	free(pipeline);
+}
@@ -0,0 +1,76 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_PIPELINE_H
+#define EDW590SCR_PIPELINE_H
+
+
+
+#include "Clock.h"
+#include "Frame.h"
+#include "Queue.h"
+
+// The frames get made on a thread of their own, ahead of the one that draws them: picking the frame, decoding it if it
+// hasn't been yet, and converting it (glitching it, say) all happen there, while the drawing thread scales and presents
+// the frame before, so a frame takes as long as the slower of the 2 rather than both together.
+//
+// There are PIPELINE_SLOTS items, which go round between the 2 threads in 2 lock-free queues (see Queue.h): made ones
+// to the drawing thread, and ones it's done with back again. Each has a frame buffer of its own, so there's the frame
+// being drawn, the next one ready, and the one after being made, all at once. The making thread waits when it's got no
+// item to make a frame in; the drawing thread never waits: if there's no new frame yet, it goes on with the one it has.
+
+#define PIPELINE_SLOTS 3
+
+// How long the stages of making an item's frame took, in microseconds.
+struct PipelineTimings {
+	long long select;       // picking the frame
+	long long decode;       // loading it, if it wasn't already
+	long long convert;      // making it into what gets shown, if it's not shown as it is
+};
+
+struct PipelineItem {
+	struct Frame *frame;    // the frame to show: buffer, or one the producer keeps itself
+	struct Frame buffer;    // the item's own, for frames that are made fresh each time. Kept from use to use
+	long long sequence;     // 0 for the first item made, then 1, and so on
+	struct PipelineTimings timings;
+	long long made;         // when it was finished
+};
+
+// PipelineProduce - makes the frame for item, on the pipeline's thread: sets item->frame and item->timings. Returns 0
+// if there's no frame to be had, and then it's asked again a little later.
+typedef int (*PipelineProduce)(void *context, struct PipelineItem *item);
+
+struct Pipeline;
+
+// PipelineCreate - starts making frames with produce, straight away. Returns NULL if out of memory or threads.
+struct Pipeline *PipelineCreate(struct Clock *clock, PipelineProduce produce, void *context);
+
+// PipelineTake - the next item made, or NULL if there isn't one ready. Never waits. Give it back with
+// PipelineRelease() once its frame's not needed any more: with one item kept, there's one ready and one being made;
+// with none, more get made ahead.
+struct PipelineItem *PipelineTake(struct Pipeline *pipeline);
+void PipelineRelease(struct Pipeline *pipeline, struct PipelineItem *item);
+
+// PipelineDestroy - stops making frames (after the one being made), and frees the items' buffers. Any items taken are
+// gone too.
+void PipelineDestroy(struct Pipeline *pipeline);
+
+
+
+#endif //EDW590SCR_PIPELINE_H
@@ -0,0 +1,76 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Canvas.h"
+#include "Preview.h"
+#include "Scaler.h"
+
+void PreviewInit(struct Preview *preview) {
+	memset(preview, 0, sizeof(*preview));
+}
+
+int PreviewAddFrame(struct Preview *preview, const struct Frame *frame, int width, int height) {
+	if (preview->num_frames >= PREVIEW_MAX_FRAMES) {
+		return 0;
+	}
+
+	// Where the canvas would put it, so it then gets drawn as it is
+	struct CanvasRect dst;
+	CanvasFit(frame->width, frame->height, width, height, &dst);
+	int thumb_width = dst.right - dst.left;
+	int thumb_height = dst.bottom - dst.top;
+	if (thumb_width > frame->width || thumb_height > frame->height) {
+		thumb_width = frame->width;
+		thumb_height = frame->height;
+	}
+
+	struct Frame *thumb = &preview->frames[preview->num_frames];
+	if (!FrameAlloc(thumb, thumb_width, thumb_height)) {
+		return 0;
+	}
+	struct ScalePlan plan;
+	int ok = ScalePlanInit(&plan, frame->width, frame->height, thumb_width, thumb_height, SCALE_AREA) &&
+			 ScaleFrame(&plan, frame, thumb->pixels, thumb->stride);
+	ScalePlanFree(&plan);
+	if (!ok) {
+		FrameFree(thumb);
+
+		return 0;
+	}
+	preview->num_frames++;
+
+	return 1;
+}
+
+long long PreviewBytes(const struct Preview *preview) {
+	long long bytes = 0;
+	for (int i = 0; i < preview->num_frames; i++) {
+		bytes += (long long) preview->frames[i].stride * preview->frames[i].height * 4;
+	}
+
+	return bytes;
+}
+
+void PreviewFree(struct Preview *preview) {
+	for (int i = 0; i < preview->num_frames; i++) {
+		FrameFree(&preview->frames[i]);
+	}
+	preview->num_frames = 0;
+}
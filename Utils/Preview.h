@@ -0,0 +1,54 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_PREVIEW_H
+#define EDW590SCR_PREVIEW_H
+
+
+
+#include "Frame.h"
+
+// The frames for the little preview in Display Properties, which is only about 150 x 110. Each one's made once, from a
+// full size frame, with the area-average (box) filter, as big as fits the preview window, and the full size frame can
+// then be freed straight away. A handful of them at that size is a few hundred KB, where the full size frames are
+// several MB each.
+
+#define PREVIEW_MAX_FRAMES 4
+// The frame rate it's drawn at, which is plenty at that size
+#define PREVIEW_FPS 5
+
+struct Preview {
+	struct Frame frames[PREVIEW_MAX_FRAMES];
+	int num_frames;
+};
+
+void PreviewInit(struct Preview *preview);
+
+// PreviewAddFrame - adds frame, shrunk to fit width x height (or as it is if it's smaller), as the next preview frame.
+// Returns 0 if there's no room left or no memory.
+int PreviewAddFrame(struct Preview *preview, const struct Frame *frame, int width, int height);
+
+// PreviewBytes - how much memory the preview frames take.
+long long PreviewBytes(const struct Preview *preview);
+
+void PreviewFree(struct Preview *preview);
+
+
+
+#endif //EDW590SCR_PREVIEW_H
@@ -0,0 +1,70 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Queue.h"
+
+// The item has to be written before the counter that hands it over, and read after the counter that says it's there.
+// x86 keeps stores in order and loads in order by itself, but ARM (Windows on ARM64 too) doesn't, so it takes a full
+// barrier for the processor and not only one for the compiler.
+#ifdef _WIN32
+#include <windows.h>
+#define queueBarrier() MemoryBarrier()
+#else
+#define queueBarrier() __sync_synchronize()
+#endif
+
+void QueueInit(struct Queue *queue, int capacity) {
+	memset(queue, 0, sizeof(*queue));
+	queue->capacity = 1;
+	while (queue->capacity < capacity && queue->capacity < QUEUE_MAX_ITEMS) {
+		queue->capacity *= 2;
+	}
+}
+
+int QueuePush(struct Queue *queue, void *item) {
+	unsigned int tail = queue->tail;
+	if (tail - queue->head >= (unsigned int) queue->capacity) {
+		return 0;
+	}
+
+	queue->items[tail & (queue->capacity - 1)] = item;
+	queueBarrier();
+	queue->tail = tail + 1;
+
+	return 1;
+}
+
+void *QueuePop(struct Queue *queue) {
+	unsigned int head = queue->head;
+	if (head == queue->tail) {
+		return NULL;
+	}
+
+	queueBarrier();
+	void *item = queue->items[head & (queue->capacity - 1)];
+	queueBarrier(); // done with the slot before the pusher can have it again
+	queue->head = head + 1;
+
+	return item;
+}
+
+int QueueCount(const struct Queue *queue) {
+	return (int) (queue->tail - queue->head);
+}
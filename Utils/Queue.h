@@ -0,0 +1,52 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_QUEUE_H
+#define EDW590SCR_QUEUE_H
+
+
+
+// A bounded queue of pointers between exactly 2 threads, one that only pushes and one that only pops, with no locks:
+// each end only ever writes its own counter, and only reads the other's. Neither ever waits: a push to a full queue or
+// a pop from an empty one just fails, and it's up to the caller what to do then.
+
+#define QUEUE_MAX_ITEMS 16      // a power of 2
+
+struct Queue {
+	void *items[QUEUE_MAX_ITEMS];
+	int capacity;           // a power of 2, up to QUEUE_MAX_ITEMS
+	volatile unsigned int head;     // how many have been popped in all. Only the popping thread changes it
+	volatile unsigned int tail;     // how many have been pushed in all. Only the pushing thread changes it
+};
+
+// QueueInit - an empty queue that holds up to capacity items (rounded up to a power of 2).
+void QueueInit(struct Queue *queue, int capacity);
+
+// QueuePush - adds item at the back. Returns 0 if the queue's full.
+int QueuePush(struct Queue *queue, void *item);
+
+// QueuePop - takes the item at the front. Returns NULL if the queue's empty.
+void *QueuePop(struct Queue *queue);
+
+// QueueCount - how many items are in the queue (already out of date, to whichever thread didn't just change it).
+int QueueCount(const struct Queue *queue);
+
+
+
+#endif //EDW590SCR_QUEUE_H
@@ -0,0 +1,57 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Remote.h"
+
+int RemoteFps(const struct RemotePolicy *policy, int fps) {
+	return policy->fps > 0 && policy->fps < fps ? policy->fps : fps;
+}
+
+void RemoteApply(const struct RemotePolicy *policy, struct Canvas *canvas) {
+	int bits = policy->channel_bits;
+	if (bits < 4) {
+		bits = 4;
+	} else if (bits > 8) {
+		bits = 8;
+	}
+	if (bits != canvas->channel_bits) {
+		canvas->channel_bits = bits;
+		canvas->frame = NULL; // so it's drawn again, cut down
+	}
+	canvas->dirty_tiles = 1;
+	canvas->transition = TRANSITION_CUT;
+}
+
+void RemoteMeterInit(struct RemoteMeter *meter, long long now) {
+	memset(meter, 0, sizeof(*meter));
+	meter->start = now;
+	meter->rate = -1;
+}
+
+void RemoteMeterAdd(struct RemoteMeter *meter, long long now, long long bytes) {
+	meter->total += bytes;
+	long long elapsed = now - meter->start;
+	if (elapsed >= 1000000) {
+		meter->rate = meter->bytes * 1000000 / elapsed;
+		meter->start = now;
+		meter->bytes = 0;
+	}
+	meter->bytes += bytes;
+}
@@ -0,0 +1,64 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_REMOTE_H
+#define EDW590SCR_REMOTE_H
+
+
+
+#include "Canvas.h"
+
+// For when the saver's being shown over a remote desktop connection (RDP, or VNC and the like), where every pixel that
+// changes has to be encoded and sent, and a frame that changes all of them 30 times a second is the whole screen's
+// worth of traffic, 30 times a second. So: fewer frames, each held for a while, only the tiles that changed presented
+// (see Canvas.h), no transitions (which change everything on every step), and the colours cut down a few bits, so the
+// small changes don't count as changes at all (and the encoder, which has usually cut them down too, has less to do).
+//
+// None of it's Windows' business, except finding out whether the session's a remote one.
+
+struct RemotePolicy {
+	int fps;                // at most this many frames a second
+	int hold_ticks;         // each frame shown for at least this many of them
+	int channel_bits;       // the bits of each colour channel kept (from 4 to 8)
+};
+
+// RemoteFps - the frame rate to use, for a configured one of fps.
+int RemoteFps(const struct RemotePolicy *policy, int fps);
+
+// RemoteApply - sets canvas up the policy's way.
+void RemoteApply(const struct RemotePolicy *policy, struct Canvas *canvas);
+
+// Changed bytes per second: how much of the canvases gets presented, which is (about) what the remote session has to
+// send on.
+struct RemoteMeter {
+	long long start;        // of the second being counted
+	long long bytes;        // so far in it
+	long long rate;         // bytes per second, in the last whole second (-1 until there's been one)
+	long long total;
+};
+
+// RemoteMeterInit - starts counting at now (in microseconds).
+void RemoteMeterInit(struct RemoteMeter *meter, long long now);
+
+// RemoteMeterAdd - bytes got presented at now.
+void RemoteMeterAdd(struct RemoteMeter *meter, long long now, long long bytes);
+
+
+
+#endif //EDW590SCR_REMOTE_H
@@ -0,0 +1,186 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Render.h"
+
+struct Presentation {
+	struct RenderTarget *targets[RENDER_MAX_TARGETS];
+	int num_targets;
+	volatile int failed;
+};
+
+// A ThreadPoolTask: presents the new frame on the task-th target. Only the frame's part of the canvas has changed (and
+// maybe only some tiles of it): the bars around it are left alone, unless they've just moved.
+static void presentTarget(void *context, int task, int worker) {
+	struct Presentation *presentation = (struct Presentation *) context;
+	struct RenderTarget *target = presentation->targets[task];
+	struct Canvas *canvas = target->canvas;
+	if (!target->present(target, canvas->rects, canvas->num_rects)) {
+		// Who knows what's on the screen now: all of it goes again next time
+		canvas->tiles_valid = 0;
+		canvas->present_bars = 1;
+		presentation->failed = 1;
+	}
+	(void) worker;
+}
+
+struct TileRows {
+	struct Canvas *canvases[RENDER_MAX_TARGETS];
+	int first_row[RENDER_MAX_TARGETS + 1];
+};
+
+// A ThreadPoolTask: hashes the task-th row of tiles, counting across all the canvases.
+static void hashTileRow(void *context, int task, int worker) {
+	struct TileRows *rows = (struct TileRows *) context;
+	int i = 0;
+	while (task >= rows->first_row[i + 1]) {
+		i++;
+	}
+	CanvasHashTiles(rows->canvases[i], task - rows->first_row[i]);
+	(void) worker;
+}
+
+static long long now(struct Clock *clock) {
+	return clock != NULL ? clock->now(clock) : 0;
+}
+
+int RenderFrame(struct RenderTarget *const *targets, int num_targets, const struct Frame *frame,
+				struct ThreadPool *pool, struct Clock *clock, struct RenderTimings *timings) {
+	if (num_targets > RENDER_MAX_TARGETS) {
+		num_targets = RENDER_MAX_TARGETS;
+	}
+
+	long long start = now(clock);
+	struct Presentation presentation;
+	struct ScaleJob jobs[RENDER_MAX_TARGETS];
+	struct ScaleJob upscales[RENDER_MAX_TARGETS];
+	struct TransitionJob steps[RENDER_MAX_TARGETS];
+	struct Canvas *scaled[RENDER_MAX_TARGETS];
+	int num_jobs = 0;
+	int num_upscales = 0;
+	int num_steps = 0;
+	presentation.num_targets = 0;
+	presentation.failed = 0;
+	int ok = 1;
+	for (int i = 0; i < num_targets; i++) {
+		struct RenderTarget *target = targets[i];
+		if (target->acquire != NULL) {
+			target->acquire(target);
+		}
+		struct ScaleJob *job = &jobs[num_jobs];
+		if (!CanvasBeginFrame(target->canvas, frame, job, &upscales[num_upscales], &steps[num_steps])) {
+			ok = 0;
+			continue;
+		}
+
+		int changed = 0;
+		if (job->plan != NULL) {
+			scaled[num_jobs] = target->canvas;
+			num_jobs++;
+			if (upscales[num_upscales].plan != NULL) {
+				num_upscales++;
+			}
+			changed = 1;
+		}
+		if (steps[num_steps].steps != 0) {
+			num_steps++;
+			changed = 1;
+		}
+		// Or with the same frame as before, if the last present failed (see presentTarget())
+		if (changed || target->canvas->present_bars) {
+			presentation.targets[presentation.num_targets] = target;
+			presentation.num_targets++;
+		}
+	}
+	long long prepared = now(clock);
+
+	// The canvases at less than full size are only blown up once all the scaling into them is done
+	if (ScaleJobsTiled(jobs, num_jobs, pool) && ScaleJobsTiled(upscales, num_upscales, pool)) {
+		for (int i = 0; i < num_jobs; i++) {
+			CanvasEndFrame(scaled[i], frame);
+		}
+	} else {
+		ok = 0;
+		num_steps = 0; // the next frames they'd go to aren't all there
+	}
+	long long scaled_time = now(clock);
+
+	TransitionJobsTiled(steps, num_steps, pool);
+	long long transitioned = now(clock);
+
+	// Which tiles changed, on all the targets at once, and then only the targets with any get presented
+	struct TileRows rows;
+	int num_rows = 0;
+	int num_canvases = 0;
+	rows.first_row[0] = 0;
+	for (int i = 0; i < presentation.num_targets; i++) {
+		struct Canvas *canvas = presentation.targets[i]->canvas;
+		int canvas_rows = CanvasTileRows(canvas);
+		if (canvas_rows > 0) {
+			rows.canvases[num_canvases] = canvas;
+			num_rows += canvas_rows;
+			num_canvases++;
+			rows.first_row[num_canvases] = num_rows;
+		}
+	}
+	if (pool != NULL) {
+		ThreadPoolRun(pool, num_rows, hashTileRow, &rows);
+	} else {
+		for (int i = 0; i < num_rows; i++) {
+			hashTileRow(&rows, i, 0);
+		}
+	}
+	long long bytes = 0;
+	int num_changed = 0;
+	for (int i = 0; i < presentation.num_targets; i++) {
+		struct Canvas *canvas = presentation.targets[i]->canvas;
+		if (CanvasDirtyRects(canvas) > 0) {
+			for (int r = 0; r < canvas->num_rects; r++) {
+				const struct CanvasRect *rect = &canvas->rects[r];
+				bytes += (long long) (rect->right - rect->left) * (rect->bottom - rect->top) * 4;
+			}
+			presentation.targets[num_changed] = presentation.targets[i];
+			num_changed++;
+		}
+	}
+	presentation.num_targets = num_changed;
+	long long hashed = now(clock);
+
+	if (pool != NULL) {
+		ThreadPoolRun(pool, presentation.num_targets, presentTarget, &presentation);
+	} else {
+		for (int i = 0; i < presentation.num_targets; i++) {
+			presentTarget(&presentation, i, 0);
+		}
+	}
+	long long presented = now(clock);
+
+	if (timings != NULL) {
+		timings->prepare = prepared - start;
+		timings->scale = scaled_time - prepared;
+		timings->transition = transitioned - scaled_time;
+		timings->tiles = hashed - transitioned;
+		timings->present = presented - hashed;
+		timings->num_presented = presentation.num_targets;
+		timings->bytes_presented = bytes;
+	}
+
+	return ok && !presentation.failed;
+}
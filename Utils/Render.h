@@ -0,0 +1,68 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_RENDER_H
+#define EDW590SCR_RENDER_H
+
+
+
+#include "Canvas.h"
+#include "Clock.h"
+#include "Frame.h"
+#include "ThreadPool.h"
+
+// Putting a frame on the screens, whatever they are. Each one is a RenderTarget: a Canvas, and how to show it. The
+// backends are Surface (a window, with GDI) and Offscreen (just memory, and builds anywhere, for running all this
+// without a desktop). RenderFrame() does the rest, the same for all of them.
+
+#define RENDER_MAX_TARGETS 128
+
+struct RenderTarget {
+	struct Canvas *canvas;
+
+	// Called before anything gets written into the canvas's pixels (GDI may still be reading them). May be NULL.
+	void (*acquire)(struct RenderTarget *target);
+
+	// Shows rects of the canvas (num_rects of them, at least 1). Can be called for several targets at once, from
+	// different threads.
+	int (*present)(struct RenderTarget *target, const struct CanvasRect *rects, int num_rects);
+};
+
+// How long the stages of the last RenderFrame() took, in microseconds.
+struct RenderTimings {
+	long long prepare;      // getting the canvases ready (the plans, the bars)
+	long long scale;
+	long long transition;   // the transition steps, if any targets are in one
+	long long tiles;        // finding the tiles that changed
+	long long present;
+	int num_presented;      // how many of the targets got the frame (the rest had it already, or all its tiles)
+	long long bytes_presented;  // how much of the canvases was presented, in bytes
+};
+
+// RenderFrame - puts frame on all the targets: the scaling for all of them is shared out over pool's threads together
+// (and done only once for targets with the same size), then any transition steps, and only once all of it's done are
+// they presented, in parallel too, so they all change at once, and only the tiles of them that changed (see
+// Canvas.h). pool may be NULL, and clock and timings too if the timings aren't wanted.
+// Returns 0 if any of the targets didn't get the frame.
+int RenderFrame(struct RenderTarget *const *targets, int num_targets, const struct Frame *frame,
+				struct ThreadPool *pool, struct Clock *clock, struct RenderTimings *timings);
+
+
+
+#endif //EDW590SCR_RENDER_H
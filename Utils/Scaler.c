@@ -0,0 +1,755 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Scaler.h"
+#include "Simd.h"
+
+// The fixed point in between the two passes: the vertical one leaves each channel as value * 128 (7 bits of fraction,
+// which still fits a signed 16 bits), and the horizontal one takes that back down to 8 bits.
+#define VERTICAL_SHIFT   (SCALE_WEIGHT_BITS - 7)
+#define HORIZONTAL_SHIFT (SCALE_WEIGHT_BITS + 7)
+
+int simd_enabled_GL = 2;
+
+// What one call of scaleRows() works with, for each of num_workers threads: one row of 16-bit channels (with room
+// after it for the horizontal pass's padding weights to read past the end) and the source rows under a destination
+// row. Each thread's are worker_bytes apart, a multiple of a cache line, so no two threads write the same line.
+struct ScaleScratch {
+	int num_workers;
+	size_t worker_bytes;
+	unsigned char *buffers;
+};
+
+#define SCRATCH_ALIGN 64
+
+static void freeAxis(struct ScaleAxis *axis) {
+	free(axis->start);
+	free(axis->count);
+	free(axis->offset);
+	free(axis->weights);
+	memset(axis, 0, sizeof(*axis));
+}
+
+static int initAxis(struct ScaleAxis *axis, int src_size, int dst_size, enum ScaleFilter filter) {
+	const int one = 1 << SCALE_WEIGHT_BITS;
+	memset(axis, 0, sizeof(*axis));
+	axis->src_size = src_size;
+	axis->dst_size = dst_size;
+	axis->ratio = dst_size % src_size == 0 ? dst_size / src_size : 0;
+
+	int max_count = 2;
+	if (filter == SCALE_AREA) {
+		max_count = src_size / dst_size + 2;
+	}
+	max_count = (max_count + 1) & ~1;
+
+	axis->start = (int *) malloc(dst_size * sizeof(int));
+	axis->count = (int *) malloc(dst_size * sizeof(int));
+	axis->offset = (int *) malloc(dst_size * sizeof(int));
+	axis->weights = (short *) calloc((size_t) dst_size * max_count, sizeof(short));
+	if (axis->start == NULL || axis->count == NULL || axis->offset == NULL || axis->weights == NULL) {
+		freeAxis(axis);
+
+		return 0;
+	}
+
+	int offset = 0;
+	for (int i = 0; i < dst_size; i++) {
+		short *weights = axis->weights + offset;
+		int start = 0;
+		int count = 1;
+		switch (filter) {
+			case SCALE_NEAREST: {
+				start = (int) (((double) i + 0.5) * src_size / dst_size);
+				weights[0] = (short) one;
+				break;
+			}
+			case SCALE_BILINEAR: {
+				double center = ((double) i + 0.5) * src_size / dst_size - 0.5;
+				start = (int) floor(center);
+				double frac = center - start;
+				if (start < 0) {
+					start = 0;
+					frac = 0;
+				}
+				if (start >= src_size - 1) {
+					start = src_size - 1;
+					frac = 0;
+				}
+				int w1 = (int) (frac * one + 0.5);
+				if (w1 == one) {
+					start++;
+					w1 = 0;
+				}
+				weights[0] = (short) (one - w1);
+				if (w1 != 0) {
+					weights[1] = (short) w1;
+					count = 2;
+				}
+				break;
+			}
+			case SCALE_AREA: {
+				// In units of 1/dst_size of a source pixel, this destination pixel covers [i * src_size,
+				// (i + 1) * src_size), and source pixel j covers [j * dst_size, (j + 1) * dst_size). Each weight is
+				// the overlap, rounded such that they still add up to exactly one.
+				int lo = i * src_size;
+				int hi = lo + src_size;
+				start = lo / dst_size;
+				int end = (hi - 1) / dst_size;
+				int covered = 0;
+				int given = 0;
+				count = end - start + 1;
+				for (int j = start; j <= end; j++) {
+					int from = j * dst_size > lo ? j * dst_size : lo;
+					int to = (j + 1) * dst_size < hi ? (j + 1) * dst_size : hi;
+					covered += to - from;
+					int total = (int) (((long long) covered * one + src_size / 2) / src_size);
+					weights[j - start] = (short) (total - given);
+					given = total;
+				}
+				break;
+			}
+		}
+		axis->start[i] = start;
+		axis->count[i] = count;
+		axis->offset[i] = offset;
+		offset += (count + 1) & ~1;
+	}
+
+	return 1;
+}
+
+int ScalePlanInit(struct ScalePlan *plan, int src_width, int src_height, int dst_width, int dst_height,
+				  enum ScaleFilter filter) {
+	memset(plan, 0, sizeof(*plan));
+	if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+		return 0;
+	}
+	plan->src_width = src_width;
+	plan->src_height = src_height;
+	plan->dst_width = dst_width;
+	plan->dst_height = dst_height;
+	plan->filter = filter;
+	plan->scratch = (struct ScaleScratch *) calloc(1, sizeof(struct ScaleScratch));
+	if (plan->scratch == NULL || !initAxis(&plan->x, src_width, dst_width, filter) ||
+			!initAxis(&plan->y, src_height, dst_height, filter)) {
+		ScalePlanFree(plan);
+
+		return 0;
+	}
+
+	return 1;
+}
+
+int ScalePlanMatches(const struct ScalePlan *plan, int src_width, int src_height, int dst_width, int dst_height,
+					 enum ScaleFilter filter) {
+	return plan->x.start != NULL && plan->src_width == src_width && plan->src_height == src_height &&
+		   plan->dst_width == dst_width && plan->dst_height == dst_height && plan->filter == filter;
+}
+
+void ScalePlanFree(struct ScalePlan *plan) {
+	freeAxis(&plan->x);
+	freeAxis(&plan->y);
+	if (plan->scratch != NULL) {
+		free(plan->scratch->buffers);
+		free(plan->scratch);
+	}
+	memset(plan, 0, sizeof(*plan));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The vertical pass: num_rows rows (num_rows even: the caller pads with a repeated row and a 0 weight) weighted into
+// out, num_bytes channels of them.
+
+static void verticalC(const unsigned char *const *rows, const short *weights, int num_rows, int from, int num_bytes,
+					  short *out) {
+	for (int c = from; c < num_bytes; c++) {
+		int sum = 0;
+		for (int k = 0; k < num_rows; k++) {
+			sum += rows[k][c] * weights[k];
+		}
+		out[c] = (short) ((sum + (1 << (VERTICAL_SHIFT - 1))) >> VERTICAL_SHIFT);
+	}
+}
+
+#ifdef EDW590SCR_SSE2
+static int verticalSSE2(const unsigned char *const *rows, const short *weights, int num_rows, int num_bytes,
+						short *out) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+	int c = 0;
+	for (; c + 16 <= num_bytes; c += 16) {
+		__m128i acc0 = zero;
+		__m128i acc1 = zero;
+		__m128i acc2 = zero;
+		__m128i acc3 = zero;
+		for (int k = 0; k < num_rows; k += 2) {
+			// Rows k and k + 1 interleaved channel by channel, so that one madd does both of their weights.
+			__m128i a = _mm_loadu_si128((const __m128i *) (rows[k] + c));
+			__m128i b = _mm_loadu_si128((const __m128i *) (rows[k + 1] + c));
+			__m128i w = _mm_set1_epi32((int) (((unsigned int) (unsigned short) weights[k + 1] << 16) |
+											  (unsigned short) weights[k]));
+			__m128i a_lo = _mm_unpacklo_epi8(a, zero);
+			__m128i b_lo = _mm_unpacklo_epi8(b, zero);
+			__m128i a_hi = _mm_unpackhi_epi8(a, zero);
+			__m128i b_hi = _mm_unpackhi_epi8(b, zero);
+			acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(a_lo, b_lo), w));
+			acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(a_lo, b_lo), w));
+			acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(a_hi, b_hi), w));
+			acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(a_hi, b_hi), w));
+		}
+		acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, round), VERTICAL_SHIFT);
+		acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, round), VERTICAL_SHIFT);
+		acc2 = _mm_srai_epi32(_mm_add_epi32(acc2, round), VERTICAL_SHIFT);
+		acc3 = _mm_srai_epi32(_mm_add_epi32(acc3, round), VERTICAL_SHIFT);
+		_mm_storeu_si128((__m128i *) (out + c), _mm_packs_epi32(acc0, acc1));
+		_mm_storeu_si128((__m128i *) (out + c + 8), _mm_packs_epi32(acc2, acc3));
+	}
+
+	return c;
+}
+#endif
+
+#ifdef EDW590SCR_AVX2
+static int verticalAVX2(const unsigned char *const *rows, const short *weights, int num_rows, int num_bytes,
+						short *out) {
+	const __m256i round = _mm256_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+	int c = 0;
+	for (; c + 16 <= num_bytes; c += 16) {
+		__m256i acc_lo = _mm256_setzero_si256();
+		__m256i acc_hi = _mm256_setzero_si256();
+		for (int k = 0; k < num_rows; k += 2) {
+			// The unpacks work within each 128-bit half, and so does the pack at the end, which puts it all back in
+			// order again.
+			__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (rows[k] + c)));
+			__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (rows[k + 1] + c)));
+			__m256i w = _mm256_set1_epi32((int) (((unsigned int) (unsigned short) weights[k + 1] << 16) |
+												 (unsigned short) weights[k]));
+			acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+			acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+		}
+		acc_lo = _mm256_srai_epi32(_mm256_add_epi32(acc_lo, round), VERTICAL_SHIFT);
+		acc_hi = _mm256_srai_epi32(_mm256_add_epi32(acc_hi, round), VERTICAL_SHIFT);
+		_mm256_storeu_si256((__m256i *) (out + c), _mm256_packs_epi32(acc_lo, acc_hi));
+	}
+
+	return c;
+}
+#endif
+
+static void vertical(const unsigned char *const *rows, const short *weights, int num_rows, int num_bytes, short *out) {
+	int done = 0;
+#ifdef EDW590SCR_AVX2
+	if (SimdHasAVX2()) {
+		done = verticalAVX2(rows, weights, num_rows, num_bytes, out);
+	} else
+#endif
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		done = verticalSSE2(rows, weights, num_rows, num_bytes, out);
+	}
+#endif
+	verticalC(rows, weights, num_rows, done, num_bytes, out);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The horizontal pass: each destination pixel from the row that the vertical pass made.
+
+static void horizontalC(const struct ScaleAxis *axis, const short *row, unsigned int *dst) {
+	for (int x = 0; x < axis->dst_size; x++) {
+		const short *p = row + axis->start[x] * 4;
+		const short *weights = axis->weights + axis->offset[x];
+		int count = axis->count[x];
+		unsigned int pixel = 0;
+		for (int c = 0; c < 4; c++) {
+			int sum = 0;
+			for (int k = 0; k < count; k++) {
+				sum += p[k * 4 + c] * weights[k];
+			}
+			sum = (sum + (1 << (HORIZONTAL_SHIFT - 1))) >> HORIZONTAL_SHIFT;
+			pixel |= (unsigned int) (sum < 0 ? 0 : sum > 255 ? 255 : sum) << (c * 8);
+		}
+		dst[x] = pixel;
+	}
+}
+
+#ifdef EDW590SCR_SSE2
+static void horizontalSSE2(const struct ScaleAxis *axis, const short *row, unsigned int *dst) {
+	const __m128i round = _mm_set1_epi32(1 << (HORIZONTAL_SHIFT - 1));
+	for (int x = 0; x < axis->dst_size; x++) {
+		const short *p = row + axis->start[x] * 4;
+		const short *weights = axis->weights + axis->offset[x];
+		int count = axis->count[x];
+		__m128i acc = _mm_setzero_si128();
+		for (int k = 0; k < count; k += 2) {
+			// Two pixels, as b0 g0 r0 x0 b1 g1 r1 x1, into b0 b1 g0 g1 r0 r1 x0 x1, for one madd to weigh both.
+			__m128i v = _mm_loadu_si128((const __m128i *) (p + k * 4));
+			v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+			__m128i w = _mm_set1_epi32((int) (((unsigned int) (unsigned short) weights[k + 1] << 16) |
+											  (unsigned short) weights[k]));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(v, w));
+		}
+		acc = _mm_srai_epi32(_mm_add_epi32(acc, round), HORIZONTAL_SHIFT);
+		acc = _mm_packs_epi32(acc, acc);
+		dst[x] = (unsigned int) _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+	}
+}
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void nearestRow(const struct ScaleAxis *axis, const unsigned int *src, unsigned int *dst) {
+	int x = 0;
+	if (axis->ratio == 1) {
+		memcpy(dst, src, axis->dst_size * 4);
+
+		return;
+	}
+#ifdef EDW590SCR_SSE2
+	if (axis->ratio == 2 && SimdHasSSE2()) {
+		for (; x + 8 <= axis->dst_size; x += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i *) (src + x / 2));
+			_mm_storeu_si128((__m128i *) (dst + x), _mm_unpacklo_epi32(v, v));
+			_mm_storeu_si128((__m128i *) (dst + x + 4), _mm_unpackhi_epi32(v, v));
+		}
+	}
+#endif
+	if (axis->ratio > 1) {
+		for (; x < axis->dst_size; x++) {
+			dst[x] = src[x / axis->ratio];
+		}
+
+		return;
+	}
+	for (; x < axis->dst_size; x++) {
+		dst[x] = src[axis->start[x]];
+	}
+}
+
+// Whether destination rows a and b come out the same (which they do a lot when enlarging).
+static int sameRow(const struct ScaleAxis *axis, int a, int b) {
+	if (axis->start[a] != axis->start[b] || axis->count[a] != axis->count[b]) {
+		return 0;
+	}
+
+	return memcmp(axis->weights + axis->offset[a], axis->weights + axis->offset[b], axis->count[a] * sizeof(short))
+		   == 0;
+}
+
+// Whether scaleRows() needs a row and the source rows (so not a plain copy or nearest).
+static int needsScratch(const struct ScalePlan *plan) {
+	return plan->filter != SCALE_NEAREST &&
+		   (plan->src_width != plan->dst_width || plan->src_height != plan->dst_height);
+}
+
+static int scratchRows(const struct ScalePlan *plan) {
+	return plan->y.src_size / plan->y.dst_size + 4;
+}
+
+static size_t scratchBytes(const struct ScalePlan *plan) {
+	size_t bytes = scratchRows(plan) * sizeof(unsigned char *) + (plan->src_width * 4 + 16) * sizeof(short);
+
+	return (bytes + SCRATCH_ALIGN - 1) & ~(size_t) (SCRATCH_ALIGN - 1);
+}
+
+// The row goes first, on a cache line, for the SIMD passes. Its size is a multiple of 8 bytes, so the source row
+// pointers after it are aligned too.
+static short *scratchRowOf(unsigned char *buffer) {
+	return (short *) buffer;
+}
+
+static const unsigned char **scratchRowsOf(const struct ScalePlan *plan, unsigned char *buffer) {
+	return (const unsigned char **) (buffer + (plan->src_width * 4 + 16) * sizeof(short));
+}
+
+// Makes sure plan has scratch for num_workers threads. Returns 0 if out of memory.
+static int growScratch(const struct ScalePlan *plan, int num_workers) {
+	struct ScaleScratch *scratch = plan->scratch;
+	if (!needsScratch(plan) || scratch->num_workers >= num_workers) {
+		return 1;
+	}
+	size_t worker_bytes = scratchBytes(plan);
+	// One line more than needed, to start on a line
+	unsigned char *buffers = (unsigned char *) malloc(worker_bytes * num_workers + SCRATCH_ALIGN);
+	if (buffers == NULL) {
+		return 0;
+	}
+	free(scratch->buffers);
+	scratch->buffers = buffers;
+	scratch->worker_bytes = worker_bytes;
+	scratch->num_workers = num_workers;
+
+	return 1;
+}
+
+static unsigned char *workerScratch(const struct ScalePlan *plan, int worker) {
+	const struct ScaleScratch *scratch = plan->scratch;
+	size_t misalign = (size_t) scratch->buffers & (SCRATCH_ALIGN - 1);
+	unsigned char *first = scratch->buffers + (misalign != 0 ? SCRATCH_ALIGN - misalign : 0);
+
+	return first + worker * scratch->worker_bytes;
+}
+
+// ScaleRows(), with buffer holding the row and the source rows, unless needsScratch() says it needs none.
+static void scaleRows(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride,
+					  int y_start, int y_end, unsigned char *buffer) {
+	if (plan->src_width == plan->dst_width && plan->src_height == plan->dst_height) {
+		for (int y = y_start; y < y_end; y++) {
+			memcpy(dst + (size_t) y * dst_stride, src->pixels + (size_t) y * src->stride, plan->dst_width * 4);
+		}
+
+		return;
+	}
+
+	if (plan->filter == SCALE_NEAREST) {
+		for (int y = y_start; y < y_end; y++) {
+			unsigned int *out = dst + (size_t) y * dst_stride;
+			if (y > y_start && plan->y.start[y] == plan->y.start[y - 1]) {
+				memcpy(out, out - dst_stride, plan->dst_width * 4);
+			} else {
+				nearestRow(&plan->x, src->pixels + (size_t) plan->y.start[y] * src->stride, out);
+			}
+		}
+
+		return;
+	}
+
+	int num_bytes = plan->src_width * 4;
+	short *row = scratchRowOf(buffer);
+	const unsigned char **rows = scratchRowsOf(plan, buffer);
+	memset(row + num_bytes, 0, 16 * sizeof(short));
+
+	for (int y = y_start; y < y_end; y++) {
+		unsigned int *out = dst + (size_t) y * dst_stride;
+		if (y > y_start && sameRow(&plan->y, y, y - 1)) {
+			memcpy(out, out - dst_stride, plan->dst_width * 4);
+			continue;
+		}
+
+		int count = plan->y.count[y];
+		for (int k = 0; k < count; k++) {
+			rows[k] = (const unsigned char *) (src->pixels + (size_t) (plan->y.start[y] + k) * src->stride);
+		}
+		if (count & 1) {
+			rows[count] = rows[count - 1]; // with a weight of 0
+			count++;
+		}
+		vertical(rows, plan->y.weights + plan->y.offset[y], count, num_bytes, row);
+
+#ifdef EDW590SCR_SSE2
+		if (SimdHasSSE2()) {
+			horizontalSSE2(&plan->x, row, out);
+			continue;
+		}
+#endif
+		horizontalC(&plan->x, row, out);
+	}
+}
+
+int ScaleRows(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride, int y_start,
+			  int y_end) {
+	if (src->width != plan->src_width || src->height != plan->src_height) {
+		return 0;
+	}
+
+	unsigned char *buffer = NULL;
+	if (needsScratch(plan)) {
+		buffer = (unsigned char *) malloc(scratchBytes(plan));
+		if (buffer == NULL) {
+			return 0;
+		}
+	}
+	scaleRows(plan, src, dst, dst_stride, y_start, y_end, buffer);
+	free(buffer);
+
+	return 1;
+}
+
+int ScaleFrame(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride) {
+	return ScaleRows(plan, src, dst, dst_stride, 0, plan->dst_height);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define MIP_MIN_SIZE 16
+#define MIP_MAX_LEVELS 12
+#define MIP_TASK_ROWS 32
+
+// A row of a mip from the 2 rows under it: each pixel the average of the 2 x 2 under it, rounded to nearest.
+static void mipRow(const unsigned int *row0, const unsigned int *row1, unsigned int *dst, int width) {
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 4 <= width; x += 4) {
+			__m128i a = _mm_loadu_si128((const __m128i *) (row0 + 2 * x));
+			__m128i b = _mm_loadu_si128((const __m128i *) (row0 + 2 * x + 4));
+			__m128i c = _mm_loadu_si128((const __m128i *) (row1 + 2 * x));
+			__m128i d = _mm_loadu_si128((const __m128i *) (row1 + 2 * x + 4));
+			// The 2 rows added up, at 16 bits a channel: source pixels 0 and 1 in p01, and so on...
+			__m128i p01 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero));
+			__m128i p23 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero));
+			__m128i p45 = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(d, zero));
+			__m128i p67 = _mm_add_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(d, zero));
+			// ...and then the 2 pixels of each pair: destination pixels 0 and 1 in s01, 2 and 3 in s23
+			__m128i s01 = _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+			__m128i s23 = _mm_add_epi16(_mm_unpacklo_epi64(p45, p67), _mm_unpackhi_epi64(p45, p67));
+			s01 = _mm_srli_epi16(_mm_add_epi16(s01, two), 2);
+			s23 = _mm_srli_epi16(_mm_add_epi16(s23, two), 2);
+			_mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(s01, s23));
+		}
+	}
+#endif
+	for (; x < width; x++) {
+		unsigned int out = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			unsigned int sum = ((row0[2 * x] >> shift) & 0xFF) + ((row0[2 * x + 1] >> shift) & 0xFF) +
+							   ((row1[2 * x] >> shift) & 0xFF) + ((row1[2 * x + 1] >> shift) & 0xFF);
+			out |= ((sum + 2) >> 2) << shift;
+		}
+		dst[x] = out;
+	}
+}
+
+struct MipRows {
+	const struct Frame *src;
+	struct Frame *dst;
+};
+
+static void mipTask(void *context, int task, int worker) {
+	struct MipRows *rows = (struct MipRows *) context;
+	const struct Frame *src = rows->src;
+	struct Frame *dst = rows->dst;
+	int y_end = (task + 1) * MIP_TASK_ROWS;
+	if (y_end > dst->height) {
+		y_end = dst->height;
+	}
+	for (int y = task * MIP_TASK_ROWS; y < y_end; y++) {
+		mipRow(src->pixels + (size_t) 2 * y * src->stride, src->pixels + (size_t) (2 * y + 1) * src->stride,
+			   dst->pixels + (size_t) y * dst->stride, dst->width);
+	}
+	(void) worker;
+}
+
+int ScaleBuildMips(struct Frame *frame, struct ThreadPool *pool) {
+	if (frame->pixels == NULL || frame->mips != NULL) {
+		return 1;
+	}
+
+	// Halving, rounding down (the odd last row or column is left out), while that's still big enough
+	int num_levels = 0;
+	size_t mips_bytes = 0;
+	int width = frame->width;
+	int height = frame->height;
+	while (num_levels < MIP_MAX_LEVELS && width / 2 >= MIP_MIN_SIZE && height / 2 >= MIP_MIN_SIZE) {
+		width /= 2;
+		height /= 2;
+		mips_bytes += (size_t) width * height * 4;
+		num_levels++;
+	}
+	if (num_levels == 0) {
+		return 1;
+	}
+
+	// The frame's pixels, then the mips' Frames, then their pixels, all in the one block
+	size_t frame_bytes = ((size_t) frame->stride * frame->height * 4 + 15) & ~(size_t) 15;
+	size_t levels_bytes = (num_levels * sizeof(struct Frame) + 15) & ~(size_t) 15;
+	unsigned char *block = (unsigned char *) realloc(frame->pixels, frame_bytes + levels_bytes + mips_bytes);
+	if (block == NULL) {
+		return 0;
+	}
+	frame->pixels = (unsigned int *) block;
+	struct Frame *levels = (struct Frame *) (block + frame_bytes);
+	unsigned int *pixels = (unsigned int *) (block + frame_bytes + levels_bytes);
+
+	// Each one from the one before, so one at a time, but each one's rows all at once
+	struct Frame *src = frame;
+	for (int i = 0; i < num_levels; i++) {
+		struct Frame *level = &levels[i];
+		level->width = src->width / 2;
+		level->height = src->height / 2;
+		level->stride = level->width;
+		level->pixels = pixels;
+		level->mips = NULL;
+		pixels += (size_t) level->width * level->height;
+
+		struct MipRows rows;
+		rows.src = src;
+		rows.dst = level;
+		int num_tasks = (level->height + MIP_TASK_ROWS - 1) / MIP_TASK_ROWS;
+		if (pool == NULL) {
+			for (int task = 0; task < num_tasks; task++) {
+				mipTask(&rows, task, 0);
+			}
+		} else {
+			ThreadPoolRun(pool, num_tasks, mipTask, &rows);
+		}
+		src->mips = level;
+		src = level;
+	}
+
+	return 1;
+}
+
+const struct Frame *ScalePickMip(const struct Frame *frame, int width, int height) {
+	while (frame->mips != NULL && frame->mips->width >= width && frame->mips->height >= height) {
+		frame = frame->mips;
+	}
+
+	return frame;
+}
+
+int ScaleBandHeight(const struct ScalePlan *plan, int cache_bytes) {
+	// Per band: the horizontal weights, which every row uses, and the row in between the passes. Then per destination
+	// row: the row itself and the source rows it moves on by, plus the source rows the first one needs (the filter's
+	// reach). Nearest and plain copies have no weights or in-between row, but counting them does no harm.
+	double fixed = plan->dst_width * (3 * sizeof(int)) + (double) plan->x.offset[plan->dst_width - 1] * sizeof(short)
+				   + plan->src_width * 4 * sizeof(short);
+	double reach = 0;
+	for (int y = 0; y < plan->dst_height; y++) {
+		if (plan->y.count[y] > reach) {
+			reach = plan->y.count[y];
+		}
+	}
+	fixed += reach * plan->src_width * 4;
+	double per_row = plan->dst_width * 4 + (double) plan->src_height / plan->dst_height * plan->src_width * 4;
+
+	double rows = (cache_bytes - fixed) / per_row;
+	if (rows < 8) {
+		return 8;
+	}
+
+	return rows > plan->dst_height ? plan->dst_height : (int) rows;
+}
+
+#define MAX_TILED_JOBS 64
+#define COPY_BAND_HEIGHT 32
+
+struct Tiles {
+	const struct ScaleJob *jobs;
+	int num_jobs;
+	int copy_of[MAX_TILED_JOBS];        // the earlier job that scales the same frame to the same size, or -1
+	int copying;                        // 0 while scaling the others, 1 while copying these
+	int band_height[MAX_TILED_JOBS];
+	int first_band[MAX_TILED_JOBS + 1]; // the bands of job i are first_band[i] to first_band[i + 1] - 1
+};
+
+static void scaleTile(void *context, int task, int worker) {
+	struct Tiles *tiles = (struct Tiles *) context;
+	int i = 0;
+	while (task >= tiles->first_band[i + 1]) {
+		i++;
+	}
+	const struct ScaleJob *job = &tiles->jobs[i];
+	int y_start = (task - tiles->first_band[i]) * tiles->band_height[i];
+	int y_end = y_start + tiles->band_height[i];
+	if (y_end > job->plan->dst_height) {
+		y_end = job->plan->dst_height;
+	}
+	if (tiles->copying) {
+		const struct ScaleJob *from = &tiles->jobs[tiles->copy_of[i]];
+		for (int y = y_start; y < y_end; y++) {
+			memcpy(job->dst + (size_t) y * job->dst_stride, from->dst + (size_t) y * from->dst_stride,
+				   job->plan->dst_width * 4);
+		}
+	} else {
+		unsigned char *buffer = needsScratch(job->plan) ? workerScratch(job->plan, worker) : NULL;
+		scaleRows(job->plan, job->src, job->dst, job->dst_stride, y_start, y_end, buffer);
+	}
+}
+
+// Runs the bands of the jobs that get scaled (copying 0) or copied (copying 1).
+static void runTiles(struct Tiles *tiles, int copying, struct ThreadPool *pool) {
+	tiles->copying = copying;
+	tiles->first_band[0] = 0;
+	for (int i = 0; i < tiles->num_jobs; i++) {
+		const struct ScalePlan *plan = tiles->jobs[i].plan;
+		int num_bands = 0;
+		if ((tiles->copy_of[i] >= 0) == copying) {
+			tiles->band_height[i] = copying ? COPY_BAND_HEIGHT : ScaleBandHeight(plan, SCALE_CACHE_BYTES);
+			num_bands = (plan->dst_height + tiles->band_height[i] - 1) / tiles->band_height[i];
+		}
+		tiles->first_band[i + 1] = tiles->first_band[i] + num_bands;
+	}
+
+	int num_bands = tiles->first_band[tiles->num_jobs];
+	if (pool == NULL) {
+		for (int i = 0; i < num_bands; i++) {
+			scaleTile(tiles, i, 0);
+		}
+	} else {
+		ThreadPoolRun(pool, num_bands, scaleTile, tiles);
+	}
+}
+
+int ScaleJobsTiled(const struct ScaleJob *jobs, int num_jobs, struct ThreadPool *pool) {
+	if (num_jobs > MAX_TILED_JOBS) {
+		return ScaleJobsTiled(jobs, MAX_TILED_JOBS, pool) &&
+			   ScaleJobsTiled(jobs + MAX_TILED_JOBS, num_jobs - MAX_TILED_JOBS, pool);
+	}
+
+	struct Tiles tiles;
+	tiles.jobs = jobs;
+	tiles.num_jobs = num_jobs;
+	int num_copies = 0;
+	for (int i = 0; i < num_jobs; i++) {
+		const struct ScalePlan *plan = jobs[i].plan;
+		tiles.copy_of[i] = -1;
+		for (int j = 0; j < i; j++) {
+			if (tiles.copy_of[j] < 0 && jobs[j].src == jobs[i].src && ScalePlanMatches(jobs[j].plan,
+					plan->src_width, plan->src_height, plan->dst_width, plan->dst_height, plan->filter)) {
+				tiles.copy_of[i] = j;
+				num_copies++;
+				break;
+			}
+		}
+	}
+
+	// All the checks the threads would fail on, and the scratch they'd need, before they start
+	int num_workers = pool != NULL ? ThreadPoolSize(pool) : 1;
+	for (int i = 0; i < num_jobs; i++) {
+		const struct ScaleJob *job = &jobs[i];
+		if (job->src->width != job->plan->src_width || job->src->height != job->plan->src_height ||
+				(tiles.copy_of[i] < 0 && !growScratch(job->plan, num_workers))) {
+			return 0;
+		}
+	}
+
+	runTiles(&tiles, 0, pool);
+	if (num_copies > 0) {
+		runTiles(&tiles, 1, pool);
+	}
+
+	return 1;
+}
+
+int ScaleFrameTiled(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride,
+					struct ThreadPool *pool) {
+	struct ScaleJob job;
+	job.plan = plan;
+	job.src = src;
+	job.dst = dst;
+	job.dst_stride = dst_stride;
+
+	return ScaleJobsTiled(&job, 1, pool);
+}
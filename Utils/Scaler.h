@@ -0,0 +1,128 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_SCALER_H
+#define EDW590SCR_SCALER_H
+
+
+
+#include "Frame.h"
+#include "ThreadPool.h"
+
+// The software scaler that replaced StretchBlt. It scales a Frame straight into 32 bpp memory (the windows' DIB
+// section back buffers), with SSE2 (and AVX2, if the compiler allows it) kernels, and plain C ones that give exactly
+// the same result, bit for bit.
+//
+// Bilinear and area-average are both done as separable filters: for each destination row, the source rows under it
+// are weighted together into one row of 16 bits per channel, and then for each destination pixel the source pixels
+// under it are weighted together from that row. The weights for a given pair of sizes only need working out once,
+// and are kept in a ScalePlan.
+
+enum ScaleFilter {
+	SCALE_NEAREST,      // fastest, blocky. Integer ratios just replicate pixels
+	SCALE_BILINEAR,     // smooth when enlarging, but aliases when shrinking to less than half
+	SCALE_AREA,         // each destination pixel is the average of the source area it covers: best for shrinking
+};
+
+#define SCALE_WEIGHT_BITS 12    // the weights of each destination pixel add up to exactly 1 << this
+
+// The weights along one axis, for each destination pixel: which source pixels, and how much of each.
+struct ScaleAxis {
+	int *start;             // the first source pixel
+	int *count;             // how many, from start (for SCALE_NEAREST, always 1)
+	int *offset;            // where in weights its weights start. Each pixel's count is padded out to an even number
+							// of weights, with 0s, for the SIMD kernels to take them in pairs
+	short *weights;
+	int src_size;
+	int dst_size;
+	int ratio;              // dst_size / src_size, if that's a whole number (else 0)
+};
+
+struct ScaleScratch;
+
+struct ScalePlan {
+	int src_width;
+	int src_height;
+	int dst_width;
+	int dst_height;
+	enum ScaleFilter filter;
+	struct ScaleAxis x;
+	struct ScaleAxis y;
+	struct ScaleScratch *scratch;   // what each of ScaleJobsTiled()'s threads scales with, kept for the next frame
+};
+
+// ScalePlanInit - works out the weights for scaling from one size to another. Returns 0 if out of memory.
+int ScalePlanInit(struct ScalePlan *plan, int src_width, int src_height, int dst_width, int dst_height,
+				  enum ScaleFilter filter);
+
+// ScalePlanMatches - whether plan is already the one for these sizes and filter.
+int ScalePlanMatches(const struct ScalePlan *plan, int src_width, int src_height, int dst_width, int dst_height,
+					 enum ScaleFilter filter);
+
+void ScalePlanFree(struct ScalePlan *plan);
+
+// ScaleRows - scales src (which must be plan->src_width x plan->src_height) into rows y_start to y_end - 1 of the
+// plan->dst_width x plan->dst_height image at dst, whose rows are dst_stride pixels apart. Different row ranges can be
+// done on different threads at the same time. Returns 0 if out of memory.
+int ScaleRows(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride, int y_start,
+			  int y_end);
+
+// ScaleFrame - all of the rows.
+int ScaleFrame(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride);
+
+// ScaleBuildMips - gives frame its mips, down to 16 pixels either way, each one the 2 x 2 average of the one before,
+// with the rows shared out over pool's threads (pool may be NULL). frame's pixels block gets bigger (by a third) to
+// hold them, so it may move. Returns 0 if out of memory, and then frame is as it was.
+int ScaleBuildMips(struct Frame *frame, struct ThreadPool *pool);
+
+// ScalePickMip - the smallest of frame and its mips that's still at least width x height, to scale from: so shrinking
+// never reads more than 4 source pixels per destination one, however big frame is, and doesn't alias.
+const struct Frame *ScalePickMip(const struct Frame *frame, int width, int height);
+
+#define SCALE_CACHE_BYTES (256 * 1024)  // how much of the L2 cache a band may use (256 KB is the smallest L2 about)
+
+// ScaleBandHeight - how many destination rows to scale at a time so that what a band works on (the source rows under
+// it, the row in between the passes, its destination rows and the horizontal weights) fits in cache_bytes. Never less
+// than 8 rows.
+int ScaleBandHeight(const struct ScalePlan *plan, int cache_bytes);
+
+// One frame to scale into one place, for ScaleJobsTiled().
+struct ScaleJob {
+	const struct ScalePlan *plan;
+	const struct Frame *src;
+	unsigned int *dst;
+	int dst_stride;
+};
+
+// ScaleJobsTiled - does all the jobs, in bands of ScaleBandHeight(plan, SCALE_CACHE_BYTES) rows, all shared out over
+// pool's threads together (pool may be NULL, and then it's all done on this thread, still a band at a time). So one
+// window per monitor keeps all the threads as busy as one big window would, and it's all done when this returns.
+// Jobs that scale the same src to the same size with the same filter (monitors with the same resolution) are only
+// scaled once: the first one is, and the rest get copies of it. The memory each thread scales with is kept in the
+// plans, so only the first frame with a plan (or a bigger pool) allocates it, and so a plan must only be in one call
+// at a time.
+int ScaleJobsTiled(const struct ScaleJob *jobs, int num_jobs, struct ThreadPool *pool);
+
+// ScaleFrameTiled - ScaleJobsTiled() with just the one job.
+int ScaleFrameTiled(const struct ScalePlan *plan, const struct Frame *src, unsigned int *dst, int dst_stride,
+					struct ThreadPool *pool);
+
+
+
+#endif //EDW590SCR_SCALER_H
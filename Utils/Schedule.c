@@ -0,0 +1,125 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Schedule.h"
+
+int ScheduleInterval(int refresh, int fps) {
+	if (refresh <= 0 || fps <= 0) {
+		return 0;
+	}
+
+	// refresh / k nearest fps: it's between k = refresh / fps and the one after. Compared without dividing:
+	// |refresh / a - wanted| < |refresh / b - wanted| is |refresh - a * wanted| * b < |refresh - b * wanted| * a.
+	long long wanted = (long long) fps * 1000;
+	long long low = refresh / wanted;
+	if (low < 1) {
+		return 1;
+	}
+	long long high = low + 1;
+	long long low_off = refresh - low * wanted;
+	long long high_off = high * wanted - refresh;
+
+	return low_off * high < high_off * low ? (int) low : (int) high;
+}
+
+// The display's frames per 1000 seconds.
+static long long rateOf(const struct ScheduleDisplay *display, int fps) {
+	if (display->interval <= 0) {
+		return (long long) fps * 1000;
+	}
+
+	return display->refresh / display->interval;
+}
+
+static void setUp(struct ScheduleDisplay *display, int fps) {
+	display->interval = ScheduleInterval(display->refresh, fps);
+	PacerSetRate(&display->pacer, rateOf(display, fps));
+}
+
+void ScheduleInit(struct Schedule *schedule, struct Clock *clock, int fps, enum PacerBackend backend) {
+	memset(schedule, 0, sizeof(*schedule));
+	schedule->clock = clock;
+	schedule->backend = backend;
+	schedule->fps = fps > 0 ? fps : 1;
+}
+
+int ScheduleAddDisplay(struct Schedule *schedule, int refresh, int fps) {
+	if (schedule->num_displays >= SCHEDULE_MAX_DISPLAYS) {
+		return -1;
+	}
+
+	struct ScheduleDisplay *display = &schedule->displays[schedule->num_displays];
+	display->refresh = refresh > 0 ? refresh : 0;
+	display->fps = fps > 0 ? fps : 0;
+	enum PacerBackend backend = schedule->backend;
+	if (backend == PACER_REFRESH && schedule->num_displays > 0 && refresh != schedule->displays[0].refresh) {
+		backend = PACER_SPIN;
+	}
+	int wanted = display->fps > 0 ? display->fps : schedule->fps;
+	PacerInit(&display->pacer, schedule->clock, wanted, backend);
+	setUp(display, wanted);
+	// All the displays start together, so those with the same rate stay due at the same times
+	if (schedule->num_displays > 0) {
+		display->pacer.start = schedule->displays[0].pacer.start;
+	}
+
+	return schedule->num_displays++;
+}
+
+void ScheduleSetFps(struct Schedule *schedule, int fps) {
+	schedule->fps = fps > 0 ? fps : 1;
+	for (int i = 0; i < schedule->num_displays; i++) {
+		struct ScheduleDisplay *display = &schedule->displays[i];
+		if (display->fps == 0) {
+			setUp(display, schedule->fps);
+		}
+	}
+}
+
+void ScheduleRestart(struct Schedule *schedule) {
+	for (int i = 0; i < schedule->num_displays; i++) {
+		PacerRestart(&schedule->displays[i].pacer);
+		schedule->displays[i].pacer.start = schedule->displays[0].pacer.start;
+	}
+}
+
+void ScheduleWait(struct Schedule *schedule, unsigned char *due) {
+	if (schedule->num_displays == 0) {
+		return;
+	}
+
+	int first = 0;
+	for (int i = 1; i < schedule->num_displays; i++) {
+		if (PacerDeadline(&schedule->displays[i].pacer) < PacerDeadline(&schedule->displays[first].pacer)) {
+			first = i;
+		}
+	}
+	PacerWait(&schedule->displays[first].pacer);
+
+	// Any others due by now go too (their waits return straight away)
+	long long now = schedule->clock->now(schedule->clock);
+	for (int i = 0; i < schedule->num_displays; i++) {
+		due[i] = i == first;
+		if (i != first && PacerDeadline(&schedule->displays[i].pacer) <= now) {
+			PacerWait(&schedule->displays[i].pacer);
+			due[i] = 1;
+		}
+	}
+}
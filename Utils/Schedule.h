@@ -0,0 +1,79 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_SCHEDULE_H
+#define EDW590SCR_SCHEDULE_H
+
+
+
+#include "Clock.h"
+#include "Pacer.h"
+
+// When each monitor gets a new frame, when they don't all refresh at the same rate. A frame that's up for 2 refreshes
+// and then 3 and then 2 again judders, which is what 30 FPS does on 75 Hz. So each display gets a pacer of its own, at
+// the FPS nearest the one wanted that's a whole number of its refreshes: 30 on 60 Hz (2 refreshes), 25 on 75 Hz (3),
+// 28.8 on 144 Hz (5), 27.5 on 165 Hz (6). Or each can be told an FPS of its own, which it then gets the same way.
+//
+// A display whose refresh isn't known just gets the FPS asked for. The refreshes can be made up, and the clock virtual
+// (see Clock.h), to try it all out without any monitors.
+
+#define SCHEDULE_MAX_DISPLAYS 128
+
+struct ScheduleDisplay {
+	int refresh;            // in millihertz (59940 for 59.94 Hz), or 0 if it's not known
+	int fps;                // the FPS it was asked for, or 0 for the schedule's
+	int interval;           // how many refreshes each frame is up for (0 if the refresh isn't known)
+	struct Pacer pacer;
+};
+
+struct Schedule {
+	struct Clock *clock;
+	enum PacerBackend backend;
+	int fps;
+	struct ScheduleDisplay displays[SCHEDULE_MAX_DISPLAYS];
+	int num_displays;
+};
+
+// ScheduleInit - no displays yet, for fps frames a second. The pacers wait with backend, except that PACER_REFRESH
+// only goes for the displays with the same refresh as the first one (the clock only waits on one display's
+// refreshes); the rest get PACER_SPIN.
+void ScheduleInit(struct Schedule *schedule, struct Clock *clock, int fps, enum PacerBackend backend);
+
+// ScheduleAddDisplay - adds a display that refreshes refresh times every 1000 seconds (0 if not known), which is to
+// get fps frames a second (0 for the schedule's). Its first frame is due now. Returns its number, from 0, or -1 if
+// there are SCHEDULE_MAX_DISPLAYS already.
+int ScheduleAddDisplay(struct Schedule *schedule, int refresh, int fps);
+
+// ScheduleInterval - how many of a display's refreshes each frame should be up for, to come nearest to fps. Ties go
+// to the lower FPS.
+int ScheduleInterval(int refresh, int fps);
+
+// ScheduleSetFps - changes the FPS of the displays without one of their own, from their next frames on.
+void ScheduleSetFps(struct Schedule *schedule, int fps);
+
+// ScheduleRestart - all the displays' next frames are due now (see PacerRestart()).
+void ScheduleRestart(struct Schedule *schedule);
+
+// ScheduleWait - waits until the next frame of any display is due, and sets due[i] to 1 for display i if it's due by
+// then, 0 if not.
+void ScheduleWait(struct Schedule *schedule, unsigned char *due);
+
+
+
+#endif //EDW590SCR_SCHEDULE_H
@@ -0,0 +1,88 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_SIMD_H
+#define EDW590SCR_SIMD_H
+
+
+
+// Which SIMD kernels get compiled in. SSE2 ones are, on anything x86: on 64 bits it's always there, and on 32 bits
+// SimdHasSSE2() checks for it at runtime, so VS 2005's default /arch still gets them. AVX2 ones only when the
+// compiler's been told it can use AVX2 (/arch:AVX2, -mavx2), since VS 2005 has no AVX2 intrinsics at all.
+// Every kernel has a plain C version too, which is also what the SIMD ones are checked against.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define EDW590SCR_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define EDW590SCR_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define SIMD_ALIGN(n) __declspec(align(n))
+#else
+#define SIMD_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
+// The most SIMD to use: 0 for the plain C versions of everything, 1 for no more than SSE2, 2 (the default) for all
+// that's compiled in. For comparing them against each other.
+extern int simd_enabled_GL;
+
+static __inline int SimdHasSSE2(void) {
+#if defined(EDW590SCR_SSE2)
+	if (simd_enabled_GL < 1) {
+		return 0;
+	}
+#  if defined(_MSC_VER) && defined(_M_IX86)
+	{
+		static int has_sse2 = -1;
+		if (has_sse2 == -1) {
+			int info[4];
+			__cpuid(info, 1);
+			has_sse2 = (info[3] >> 26) & 1;
+		}
+
+		return has_sse2;
+	}
+#  else
+	return 1;
+#  endif
+#else
+	return 0;
+#endif
+}
+
+static __inline int SimdHasAVX2(void) {
+#if defined(EDW590SCR_AVX2)
+	return simd_enabled_GL >= 2;
+#else
+	return 0;
+#endif
+}
+
+
+
+#endif //EDW590SCR_SIMD_H
@@ -0,0 +1,142 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <windows.h>
+#include "Surface.h"
+
+static void freeBackBuffer(struct Surface *surface) {
+	if (surface->back_bitmap != NULL) {
+		SelectObject(surface->hdc_back, surface->back_old);
+		DeleteObject(surface->back_bitmap);
+		surface->back_bitmap = NULL;
+		surface->back_bits = NULL;
+	}
+	CanvasSetPixels(&surface->canvas, NULL, 0, 0);
+}
+
+static void surfaceAcquire(struct RenderTarget *target) {
+	(void) target;
+
+	// GDI may not have finished with the back buffer yet.
+	GdiFlush();
+}
+
+static int surfacePresent(struct RenderTarget *target, const struct CanvasRect *rects, int num_rects) {
+	struct Surface *surface = (struct Surface *) target;
+	HDC hdc = GetDC(surface->hwnd); // the window's own DC (CS_OWNDC), so this costs next to nothing
+	if (hdc == NULL) {
+		return 0;
+	}
+	BOOL ok = TRUE;
+	for (int i = 0; i < num_rects; i++) {
+		RECT area;
+		SetRect(&area, rects[i].left, rects[i].top, rects[i].right, rects[i].bottom);
+		ok = SurfacePresent(surface, hdc, &area) && ok;
+	}
+	ReleaseDC(surface->hwnd, hdc);
+
+	return ok;
+}
+
+struct Surface *SurfaceCreate(HWND hwnd, int width, int height) {
+	struct Surface *surface = (struct Surface *) calloc(1, sizeof(struct Surface));
+	if (surface == NULL) {
+		return NULL;
+	}
+	surface->hwnd = hwnd;
+	CanvasInit(&surface->canvas);
+	surface->target.canvas = &surface->canvas;
+	surface->target.acquire = surfaceAcquire;
+	surface->target.present = surfacePresent;
+
+	HDC hdc = GetDC(hwnd);
+	surface->hdc_back = CreateCompatibleDC(hdc);
+	ReleaseDC(hwnd, hdc);
+	if (surface->hdc_back == NULL) {
+		SurfaceDestroy(surface);
+
+		return NULL;
+	}
+
+	if (!SurfaceResize(surface, width, height)) {
+		SurfaceDestroy(surface);
+
+		return NULL;
+	}
+
+	return surface;
+}
+
+BOOL SurfaceResize(struct Surface *surface, int width, int height) {
+	if (width <= 0 || height <= 0) {
+		// Minimized, or not shown yet. Keep what there is until there's a real size.
+		return TRUE;
+	}
+	if (surface->back_bitmap != NULL && width == surface->canvas.width && height == surface->canvas.height) {
+		return TRUE;
+	}
+
+	freeBackBuffer(surface);
+
+	BITMAPINFO bmi = {0};
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = -height; // top-down
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+	surface->back_bitmap = CreateDIBSection(surface->hdc_back, &bmi, DIB_RGB_COLORS, (void **) &surface->back_bits,
+										   NULL, 0);
+	if (surface->back_bitmap == NULL) {
+		return FALSE;
+	}
+	surface->back_old = SelectObject(surface->hdc_back, surface->back_bitmap);
+	CanvasSetPixels(&surface->canvas, surface->back_bits, width, height);
+
+	return TRUE;
+}
+
+BOOL SurfacePresent(struct Surface *surface, HDC hdc, const RECT *rect) {
+	if (surface->back_bitmap == NULL) {
+		return FALSE;
+	}
+
+	RECT area;
+	SetRect(&area, 0, 0, surface->canvas.width, surface->canvas.height);
+	if (rect != NULL && !IntersectRect(&area, &area, rect)) {
+		return TRUE;
+	}
+
+	return BitBlt(hdc, area.left, area.top, area.right - area.left, area.bottom - area.top, surface->hdc_back,
+				  area.left, area.top, SRCCOPY);
+}
+
+void SurfaceDestroy(struct Surface *surface) {
+	if (surface == NULL) {
+		return;
+	}
+
+	freeBackBuffer(surface);
+	if (surface->hdc_back != NULL) {
+		DeleteDC(surface->hdc_back);
+	}
+	CanvasFree(&surface->canvas);
+	free(surface);
+}
@@ -0,0 +1,62 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_SURFACE_H
+#define EDW590SCR_SURFACE_H
+
+
+
+#include <windows.h>
+#include "Canvas.h"
+#include "Render.h"
+
+// The GDI backend: what a saver window draws with. It's made on WM_CREATE and kept up to date on WM_SIZE. Its canvas
+// is a DIB section, selected into a memory DC for good, which presenting copies to the window.
+struct Surface {
+	struct RenderTarget target; // RenderFrame()'s view of it. Presents through the window's own DC (CS_OWNDC)
+	struct Canvas canvas;
+	HWND hwnd;
+	int display;            // which of the render thread's schedule's displays it's paced as (see Schedule.h)
+
+	HDC hdc_back;           // memory DC with the back buffer selected into it
+	HBITMAP back_bitmap;    // the back buffer and canvas pixels: a top-down 32 bpp DIB section as big as the window
+	HGDIOBJ back_old;
+	unsigned int *back_bits;
+
+	// While the render thread draws on it, which it does without render_lock_GL (see main.c), busy is set. Then the
+	// window's thread doesn't wait for it, but leaves what it would have done for the render thread to do after. Only
+	// touched with render_lock_GL held.
+	BOOL busy;
+	BOOL repaint;           // some of the window needs painting again
+	int new_width;          // the size to resize it to, or 0
+	int new_height;
+	BOOL closed;            // the window's gone, so it's to be freed
+};
+
+struct Surface *SurfaceCreate(HWND hwnd, int width, int height);
+BOOL SurfaceResize(struct Surface *surface, int width, int height);
+
+// Copies rect of the back buffer to the window (all of it if rect is NULL). Normally that's just the canvas's dst: the
+// bars only need copying when the window has just been resized or uncovered, or a frame of another shape moved them.
+BOOL SurfacePresent(struct Surface *surface, HDC hdc, const RECT *rect);
+void SurfaceDestroy(struct Surface *surface);
+
+
+
+#endif //EDW590SCR_SURFACE_H
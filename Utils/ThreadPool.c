@@ -0,0 +1,359 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "ThreadPool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION PoolLock;
+#define lockInit(l)    InitializeCriticalSection(l)
+#define lockFree(l)    DeleteCriticalSection(l)
+#define lock(l)        EnterCriticalSection(l)
+#define unlock(l)      LeaveCriticalSection(l)
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t PoolLock;
+#define lockInit(l)    pthread_mutex_init(l, NULL)
+#define lockFree(l)    pthread_mutex_destroy(l)
+#define lock(l)        pthread_mutex_lock(l)
+#define unlock(l)      pthread_mutex_unlock(l)
+#endif
+
+#define MAX_THREADS 64
+
+struct ThreadPool;
+
+// One per thread: the tasks it has yet to run, from begin to end - 1. It runs them from the front, and thieves take
+// from the back.
+struct Worker {
+	struct ThreadPool *pool;
+	int index;
+	PoolLock lock;
+	volatile int begin;     // thieves peek at these without the lock, to pick who to steal from
+	volatile int end;
+#ifdef _WIN32
+	HANDLE thread;
+	HANDLE wake;            // auto-reset: set when there's a job to help with (or the pool is going away)
+#else
+	pthread_t thread;
+	unsigned int generation;    // of the last job it helped with
+#endif
+};
+
+struct ThreadPool {
+	int num_threads;        // workers[0] is whoever calls ThreadPoolRun; the rest have threads of their own
+	struct Worker *workers;
+
+	ThreadPoolTask task;
+	void *context;
+	int quit;
+
+	// How many of the pool's own threads are still on the current job. The job's only over once they've all left it,
+	// not just once its tasks have all been run: a thread that's still looking for something to steal mustn't find
+	// the next job's tasks and run them with this job's task and context.
+#ifdef _WIN32
+	volatile LONG busy;
+	HANDLE done;            // auto-reset: set by the last thread to leave the job
+#else
+	int busy;
+	unsigned int generation;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+#endif
+};
+
+int ThreadPoolProcessors(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (int) n : 1;
+#endif
+}
+
+// Takes the next task for worker w to run: its own, or else half of the biggest run it can find on another thread.
+// Returns -1 once there's none left anywhere. Nothing gets added to a job once it's started, so if every run has been
+// seen empty, the job really is out of tasks.
+static int takeTask(struct ThreadPool *pool, int w) {
+	struct Worker *self = &pool->workers[w];
+	int task = -1;
+	lock(&self->lock);
+	if (self->begin < self->end) {
+		task = self->begin++;
+	}
+	unlock(&self->lock);
+	if (task >= 0) {
+		return task;
+	}
+
+	for (;;) {
+		int victim = -1;
+		int most = 0;
+		for (int i = 1; i < pool->num_threads; i++) {
+			int v = (w + i) % pool->num_threads;
+			int left = pool->workers[v].end - pool->workers[v].begin; // just a hint: checked again under the lock
+			if (left > most) {
+				most = left;
+				victim = v;
+			}
+		}
+		if (victim < 0) {
+			return -1;
+		}
+
+		struct Worker *other = &pool->workers[victim];
+		int begin = 0;
+		int end = 0;
+		lock(&other->lock);
+		int left = other->end - other->begin;
+		if (left > 0) {
+			// The back half, so the owner keeps the tasks next to the one it's on
+			end = other->end;
+			begin = other->end - (left + 1) / 2;
+			other->end = begin;
+		}
+		unlock(&other->lock);
+		if (begin < end) {
+			lock(&self->lock);
+			self->begin = begin + 1;
+			self->end = end;
+			unlock(&self->lock);
+
+			return begin;
+		}
+		// Someone else got there first. Look again.
+	}
+}
+
+static void work(struct ThreadPool *pool, int w) {
+	int task;
+	while ((task = takeTask(pool, w)) >= 0) {
+		pool->task(pool->context, task, w);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI workerThread(LPVOID param) {
+	struct Worker *self = (struct Worker *) param;
+	struct ThreadPool *pool = self->pool;
+	for (;;) {
+		WaitForSingleObject(self->wake, INFINITE);
+		if (pool->quit) {
+			break;
+		}
+		work(pool, self->index);
+		if (InterlockedDecrement(&pool->busy) == 0) {
+			SetEvent(pool->done);
+		}
+	}
+
+	return 0;
+}
+#else
+static void *workerThread(void *param) {
+	struct Worker *self = (struct Worker *) param;
+	struct ThreadPool *pool = self->pool;
+	for (;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while (!pool->quit && pool->generation == self->generation) {
+			pthread_cond_wait(&pool->wake, &pool->mutex);
+		}
+		self->generation = pool->generation;
+		int quit = pool->quit;
+		pthread_mutex_unlock(&pool->mutex);
+		if (quit) {
+			break;
+		}
+		work(pool, self->index);
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->busy == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+#endif
+
+struct ThreadPool *ThreadPoolCreate(int num_threads) {
+	if (num_threads <= 0) {
+		num_threads = ThreadPoolProcessors();
+	}
+	if (num_threads > MAX_THREADS) {
+		num_threads = MAX_THREADS;
+	}
+
+	struct ThreadPool *pool = (struct ThreadPool *) calloc(1, sizeof(struct ThreadPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->workers = (struct Worker *) calloc(num_threads, sizeof(struct Worker));
+	if (pool->workers == NULL) {
+		free(pool);
+
+		return NULL;
+	}
+#ifdef _WIN32
+	pool->done = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	pthread_cond_init(&pool->done, NULL);
+#endif
+
+	// If a thread can't be had, the pool just makes do with the ones it's got.
+	pool->num_threads = 1;
+	lockInit(&pool->workers[0].lock);
+#ifdef _WIN32
+	if (pool->done == NULL) {
+		num_threads = 1;
+	}
+#endif
+	for (int i = 1; i < num_threads; i++) {
+		struct Worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->index = i;
+		lockInit(&worker->lock);
+#ifdef _WIN32
+		worker->wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (worker->wake != NULL) {
+			worker->thread = CreateThread(NULL, 0, workerThread, worker, 0, NULL);
+		}
+		if (worker->thread == NULL) {
+			if (worker->wake != NULL) {
+				CloseHandle(worker->wake);
+			}
+			lockFree(&worker->lock);
+			break;
+		}
+#else
+		if (pthread_create(&worker->thread, NULL, workerThread, worker) != 0) {
+			lockFree(&worker->lock);
+			break;
+		}
+#endif
+		pool->num_threads++;
+	}
+
+	return pool;
+}
+
+void ThreadPoolRun(struct ThreadPool *pool, int num_tasks, ThreadPoolTask task, void *context) {
+	if (num_tasks <= 0) {
+		return;
+	}
+	int helpers = pool->num_threads - 1;
+	if (helpers > num_tasks - 1) {
+		helpers = num_tasks - 1;
+	}
+	if (helpers <= 0) {
+		for (int i = 0; i < num_tasks; i++) {
+			task(context, i, 0);
+		}
+
+		return;
+	}
+
+	// Equal runs of tasks for the threads that'll help, and empty ones for any that won't (there are fewer tasks than
+	// threads). None of them are running yet, so nobody else is looking at these.
+	pool->task = task;
+	pool->context = context;
+	for (int i = 0; i < pool->num_threads; i++) {
+		struct Worker *worker = &pool->workers[i];
+		lock(&worker->lock);
+		worker->begin = i <= helpers ? (int) ((long long) num_tasks * i / (helpers + 1)) : num_tasks;
+		worker->end = i <= helpers ? (int) ((long long) num_tasks * (i + 1) / (helpers + 1)) : num_tasks;
+		unlock(&worker->lock);
+	}
+
+#ifdef _WIN32
+	pool->busy = helpers;
+	for (int i = 1; i <= helpers; i++) {
+		SetEvent(pool->workers[i].wake);
+	}
+	work(pool, 0);
+	WaitForSingleObject(pool->done, INFINITE);
+#else
+	// Only the first helpers threads get woken: the generation tells the rest there's nothing for them.
+	pthread_mutex_lock(&pool->mutex);
+	pool->busy = helpers;
+	pool->generation++;
+	for (int i = helpers + 1; i < pool->num_threads; i++) {
+		pool->workers[i].generation = pool->generation;
+	}
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	work(pool, 0);
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->busy > 0) {
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+int ThreadPoolSize(const struct ThreadPool *pool) {
+	return pool->num_threads;
+}
+
+void ThreadPoolDestroy(struct ThreadPool *pool) {
+	if (pool == NULL) {
+		return;
+	}
+
+#ifdef _WIN32
+	pool->quit = 1;
+	for (int i = 1; i < pool->num_threads; i++) {
+		SetEvent(pool->workers[i].wake);
+	}
+	for (int i = 1; i < pool->num_threads; i++) {
+		WaitForSingleObject(pool->workers[i].thread, INFINITE);
+		CloseHandle(pool->workers[i].thread);
+		CloseHandle(pool->workers[i].wake);
+	}
+	if (pool->done != NULL) {
+		CloseHandle(pool->done);
+	}
+#else
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	for (int i = 1; i < pool->num_threads; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->wake);
+	pthread_cond_destroy(&pool->done);
+#endif
+	for (int i = 0; i < pool->num_threads; i++) {
+		lockFree(&pool->workers[i].lock);
+	}
+	free(pool->workers);
+	free(pool);
+}
@@ -0,0 +1,53 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_THREADPOOL_H
+#define EDW590SCR_THREADPOOL_H
+
+
+
+// A pool of worker threads for splitting one job (scaling a frame, say) into many tasks. The tasks of a job are
+// numbered 0 to num_tasks - 1 and shared out in equal runs, one per thread, and a thread that runs out of its own
+// steals the second half of what's left of someone else's. So a thread that got the expensive tasks, or got
+// descheduled, doesn't hold everyone up, and the runs keep neighbouring tasks (neighbouring rows) on the same thread.
+// Builds on Windows and on Linux.
+
+struct ThreadPool;
+
+// ThreadPoolTask - runs task number task of a job. worker is which thread it's on, from 0 to ThreadPoolSize() - 1,
+// for anything kept per thread.
+typedef void (*ThreadPoolTask)(void *context, int task, int worker);
+
+// ThreadPoolCreate - a pool of num_threads threads in all (0 for one per processor), counting the one that calls
+// ThreadPoolRun, which works too. Returns NULL if out of memory.
+struct ThreadPool *ThreadPoolCreate(int num_threads);
+
+// ThreadPoolRun - runs the tasks, and returns once they've all finished. Only one thread may call it at a time.
+void ThreadPoolRun(struct ThreadPool *pool, int num_tasks, ThreadPoolTask task, void *context);
+
+int ThreadPoolSize(const struct ThreadPool *pool);
+
+// ThreadPoolProcessors - how many processors there are.
+int ThreadPoolProcessors(void);
+
+void ThreadPoolDestroy(struct ThreadPool *pool);
+
+
+
+#endif //EDW590SCR_THREADPOOL_H
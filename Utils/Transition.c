@@ -0,0 +1,203 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string.h>
+#include "Simd.h"
+#include "Transition.h"
+
+#define MAX_TILED_JOBS 64
+#define BAND_HEIGHT 32
+
+// lowbias32, as in Glitch.c.
+static unsigned int mix(unsigned int x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352DU;
+	x ^= x >> 15;
+	x *= 0x846CA68BU;
+	x ^= x >> 16;
+
+	return x;
+}
+
+// Each channel (128 - weight) / 128 of what's there and weight / 128 of the next frame, rounded.
+static void crossfadeRow(unsigned int *dst, const unsigned int *next, int width, int weight) {
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i keep = _mm_set1_epi16((short) (128 - weight));
+		const __m128i take = _mm_set1_epi16((short) weight);
+		const __m128i half = _mm_set1_epi16(64);
+		for (; x + 4 <= width; x += 4) {
+			__m128i d = _mm_loadu_si128((const __m128i *) (dst + x));
+			__m128i n = _mm_loadu_si128((const __m128i *) (next + x));
+			// At most 255 * 128 + 64, so the 16 bits never overflow
+			__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), keep),
+									   _mm_mullo_epi16(_mm_unpacklo_epi8(n, zero), take));
+			__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), keep),
+									   _mm_mullo_epi16(_mm_unpackhi_epi8(n, zero), take));
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 7);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 7);
+			_mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(lo, hi));
+		}
+	}
+#endif
+	for (; x < width; x++) {
+		unsigned int out = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			unsigned int channel = (((dst[x] >> shift) & 0xFF) * (128 - weight) + ((next[x] >> shift) & 0xFF) * weight
+									+ 64) >> 7;
+			out |= channel << shift;
+		}
+		dst[x] = out;
+	}
+}
+
+// Pixel x of the row switches to the next frame once threshold is past its number, from 0 to 255: the low 8 bits of
+// 2 rounds of xorshift on x and the row's seed. Only shifts, XORs and adds, so SSE2 gets the same numbers.
+static void dissolveRow(unsigned int *dst, const unsigned int *next, int width, unsigned int seed, int threshold) {
+	int x = 0;
+#ifdef EDW590SCR_SSE2
+	if (SimdHasSSE2()) {
+		const __m128i seeds = _mm_set1_epi32((int) seed);
+		const __m128i low = _mm_set1_epi32(0xFF);
+		const __m128i limit = _mm_set1_epi32(threshold);
+		const __m128i four = _mm_set1_epi32(4);
+		__m128i xs = _mm_set_epi32(3, 2, 1, 0);
+		for (; x + 4 <= width; x += 4) {
+			__m128i h = _mm_xor_si128(xs, seeds);
+			for (int round = 0; round < 2; round++) {
+				h = _mm_xor_si128(h, _mm_slli_epi32(h, 13));
+				h = _mm_xor_si128(h, _mm_srli_epi32(h, 17));
+				h = _mm_xor_si128(h, _mm_slli_epi32(h, 5));
+				h = _mm_add_epi32(h, seeds);
+			}
+			__m128i take = _mm_cmplt_epi32(_mm_and_si128(h, low), limit);
+			__m128i d = _mm_loadu_si128((const __m128i *) (dst + x));
+			__m128i n = _mm_loadu_si128((const __m128i *) (next + x));
+			_mm_storeu_si128((__m128i *) (dst + x), _mm_or_si128(_mm_and_si128(take, n), _mm_andnot_si128(take, d)));
+			xs = _mm_add_epi32(xs, four);
+		}
+	}
+#endif
+	for (; x < width; x++) {
+		unsigned int h = (unsigned int) x ^ seed;
+		for (int round = 0; round < 2; round++) {
+			h ^= h << 13;
+			h ^= h >> 17;
+			h ^= h << 5;
+			h += seed;
+		}
+		if ((int) (h & 0xFF) < threshold) {
+			dst[x] = next[x];
+		}
+	}
+}
+
+void TransitionRows(const struct TransitionJob *job, int y_start, int y_end) {
+	int copy_start = y_start;
+	int copy_end = y_end;
+	if (job->kind != TRANSITION_CUT && job->step < job->steps) {
+		switch (job->kind) {
+			case TRANSITION_CROSSFADE: {
+				// 1 / (steps left) of the way there, each step, is a straight line from the old frame to the next
+				int left = job->steps - job->step + 1;
+				int weight = (128 + left / 2) / left;
+				for (int y = y_start; y < y_end; y++) {
+					crossfadeRow(job->dst + (size_t) y * job->dst_stride, job->next + (size_t) y * job->next_stride,
+								 job->width, weight);
+				}
+				copy_end = copy_start;
+				break;
+			}
+			case TRANSITION_WIPE: {
+				// Just the rows this step uncovers: the ones above them were done by the steps before
+				int top = (int) ((long long) job->height * (job->step - 1) / job->steps);
+				int bottom = (int) ((long long) job->height * job->step / job->steps);
+				copy_start = y_start > top ? y_start : top;
+				copy_end = y_end < bottom ? y_end : bottom;
+				break;
+			}
+			case TRANSITION_DISSOLVE: {
+				int threshold = 256 * job->step / job->steps;
+				for (int y = y_start; y < y_end; y++) {
+					dissolveRow(job->dst + (size_t) y * job->dst_stride, job->next + (size_t) y * job->next_stride,
+								job->width, mix(job->seed + (unsigned int) y), threshold);
+				}
+				copy_end = copy_start;
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	// The last step (or a cut) leaves exactly the next frame
+	for (int y = copy_start; y < copy_end; y++) {
+		memcpy(job->dst + (size_t) y * job->dst_stride, job->next + (size_t) y * job->next_stride, job->width * 4);
+	}
+}
+
+struct TransitionTiles {
+	const struct TransitionJob *jobs;
+	int num_jobs;
+	int first_band[MAX_TILED_JOBS + 1];
+};
+
+static void transitionTile(void *context, int task, int worker) {
+	struct TransitionTiles *tiles = (struct TransitionTiles *) context;
+	int i = 0;
+	while (task >= tiles->first_band[i + 1]) {
+		i++;
+	}
+	const struct TransitionJob *job = &tiles->jobs[i];
+	int y_start = (task - tiles->first_band[i]) * BAND_HEIGHT;
+	int y_end = y_start + BAND_HEIGHT;
+	if (y_end > job->height) {
+		y_end = job->height;
+	}
+	TransitionRows(job, y_start, y_end);
+	(void) worker;
+}
+
+void TransitionJobsTiled(const struct TransitionJob *jobs, int num_jobs, struct ThreadPool *pool) {
+	if (num_jobs > MAX_TILED_JOBS) {
+		TransitionJobsTiled(jobs, MAX_TILED_JOBS, pool);
+		TransitionJobsTiled(jobs + MAX_TILED_JOBS, num_jobs - MAX_TILED_JOBS, pool);
+
+		return;
+	}
+
+	struct TransitionTiles tiles;
+	tiles.jobs = jobs;
+	tiles.num_jobs = num_jobs;
+	tiles.first_band[0] = 0;
+	for (int i = 0; i < num_jobs; i++) {
+		tiles.first_band[i + 1] = tiles.first_band[i] + (jobs[i].height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	}
+
+	int num_bands = tiles.first_band[num_jobs];
+	if (pool == NULL) {
+		for (int i = 0; i < num_bands; i++) {
+			transitionTile(&tiles, i, 0);
+		}
+	} else {
+		ThreadPoolRun(pool, num_bands, transitionTile, &tiles);
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_TRANSITION_H
+#define EDW590SCR_TRANSITION_H
+
+
+
+#include "ThreadPool.h"
+
+// Going from one frame to the next over a few frames, instead of cutting straight to it. It's done in place, on what's
+// on the screen already (the canvas), a step at a time: each step takes it that much nearer the next frame (which is
+// kept scaled to the same size on the side), and the last one leaves exactly the next frame. So a transition can be
+// cut short by another one at any step, and that one just carries on from what's there.
+
+enum TransitionKind {
+	TRANSITION_CUT,         // none: straight to the next frame
+	TRANSITION_CROSSFADE,   // the 2 blended, more of the next frame each step
+	TRANSITION_WIPE,        // the next frame comes down over the old one, rows at a time
+	TRANSITION_DISSOLVE,    // pixels of the next frame come in at random places, more each step
+};
+
+struct TransitionJob {
+	enum TransitionKind kind;
+	unsigned int *dst;          // what's on the screen now, which this step is done to
+	int dst_stride;
+	const unsigned int *next;   // the next frame, the same size
+	int next_stride;
+	int width;
+	int height;
+	int step;                   // this step, from 1 to steps
+	int steps;
+	unsigned int seed;          // where the dissolve's pixels come in
+};
+
+// TransitionRows - does the job's step to rows y_start to y_end - 1.
+void TransitionRows(const struct TransitionJob *job, int y_start, int y_end);
+
+// TransitionJobsTiled - does all the jobs' steps, in bands of rows shared out over pool's threads together (pool may
+// be NULL), like ScaleJobsTiled().
+void TransitionJobsTiled(const struct TransitionJob *jobs, int num_jobs, struct ThreadPool *pool);
+
+
+
+#endif //EDW590SCR_TRANSITION_H
@@ -0,0 +1,234 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "Wall.h"
+
+static void setRect(struct CanvasRect *rect, int left, int top, int right, int bottom) {
+	rect->left = left;
+	rect->top = top;
+	rect->right = right;
+	rect->bottom = bottom;
+}
+
+// The part of a that's in b too, in out. Returns 0 if there's none.
+static int intersectRects(const struct CanvasRect *a, const struct CanvasRect *b, struct CanvasRect *out) {
+	setRect(out, a->left > b->left ? a->left : b->left, a->top > b->top ? a->top : b->top,
+			a->right < b->right ? a->right : b->right, a->bottom < b->bottom ? a->bottom : b->bottom);
+
+	return out->right > out->left && out->bottom > out->top;
+}
+
+static int startOf(const struct CanvasRect *rect, int vertical) {
+	return vertical ? rect->top : rect->left;
+}
+
+static int endOf(const struct CanvasRect *rect, int vertical) {
+	return vertical ? rect->bottom : rect->right;
+}
+
+// How many seams there are at or before position, across (or down, if vertical) the desktop: places where a monitor
+// starts right where another ends. Each counts once, however many monitors meet there.
+static int seamsUpTo(const struct CanvasRect *desktop, int num_monitors, int position, int vertical) {
+	int seams = 0;
+	for (int i = 0; i < num_monitors; i++) {
+		int start = startOf(&desktop[i], vertical);
+		if (start > position) {
+			continue;
+		}
+
+		int first = 1;
+		for (int j = 0; j < i && first; j++) {
+			first = startOf(&desktop[j], vertical) != start;
+		}
+		for (int j = 0; j < num_monitors && first; j++) {
+			if (endOf(&desktop[j], vertical) == start) {
+				seams++;
+				break;
+			}
+		}
+	}
+
+	return seams;
+}
+
+void WallLayout(const struct CanvasRect *desktop, int num_monitors, int bezel_x, int bezel_y, struct CanvasRect *crops,
+				int *width, int *height) {
+	*width = 0;
+	*height = 0;
+	if (num_monitors <= 0) {
+		return;
+	}
+
+	int min_x = desktop[0].left;
+	int min_y = desktop[0].top;
+	for (int i = 1; i < num_monitors; i++) {
+		min_x = desktop[i].left < min_x ? desktop[i].left : min_x;
+		min_y = desktop[i].top < min_y ? desktop[i].top : min_y;
+	}
+	for (int i = 0; i < num_monitors; i++) {
+		const struct CanvasRect *monitor = &desktop[i];
+		int x = monitor->left - min_x + bezel_x * seamsUpTo(desktop, num_monitors, monitor->left, 0);
+		int y = monitor->top - min_y + bezel_y * seamsUpTo(desktop, num_monitors, monitor->top, 1);
+		setRect(&crops[i], x, y, x + monitor->right - monitor->left, y + monitor->bottom - monitor->top);
+		*width = crops[i].right > *width ? crops[i].right : *width;
+		*height = crops[i].bottom > *height ? crops[i].bottom : *height;
+	}
+}
+
+// Copies rect of the wall (inside monitor's crop) into the monitor's canvas, and says where it went there in out.
+// Returns 0 if none of it's on the monitor's canvas (which may not be the monitor's size, while it's being resized).
+static int copyRect(const struct Wall *wall, const struct WallMonitor *monitor, const struct CanvasRect *rect,
+					struct CanvasRect *out) {
+	const struct Canvas *screen = monitor->target->canvas;
+	struct CanvasRect bounds;
+	setRect(&bounds, 0, 0, screen->width, screen->height);
+	struct CanvasRect moved;
+	setRect(&moved, rect->left - monitor->crop.left, rect->top - monitor->crop.top, rect->right - monitor->crop.left,
+			rect->bottom - monitor->crop.top);
+	if (!intersectRects(&moved, &bounds, out)) {
+		return 0;
+	}
+
+	for (int y = out->top; y < out->bottom; y++) {
+		memcpy(screen->pixels + (size_t) y * screen->width + out->left,
+			   wall->pixels + (size_t) (y + monitor->crop.top) * wall->canvas.width + out->left + monitor->crop.left,
+			   (out->right - out->left) * 4);
+	}
+
+	return 1;
+}
+
+// Copies the rects that changed to the monitors they're on, and presents them there. A monitor that hasn't had its
+// whole crop yet (or whose pixels are new, or whose bars have moved) gets all of it.
+static int wallPresent(struct RenderTarget *target, const struct CanvasRect *rects, int num_rects) {
+	struct Wall *wall = (struct Wall *) target;
+	int moved = memcmp(&wall->canvas.dst, &wall->dst, sizeof(wall->dst)) != 0;
+	wall->dst = wall->canvas.dst;
+	int ok = 1;
+	for (int m = 0; m < wall->num_monitors; m++) {
+		struct WallMonitor *monitor = &wall->monitors[m];
+		struct Canvas *screen = monitor->target->canvas;
+		if (screen->pixels == NULL) {
+			continue;
+		}
+
+		int whole = moved || screen->pixels != monitor->pixels;
+		const struct CanvasRect *parts = whole ? &monitor->crop : rects;
+		int num_parts = whole ? 1 : num_rects;
+		struct CanvasRect out[CANVAS_MAX_RECTS];
+		int num_out = 0;
+		for (int i = 0; i < num_parts && num_out < CANVAS_MAX_RECTS; i++) {
+			struct CanvasRect part;
+			if (!intersectRects(&parts[i], &monitor->crop, &part)) {
+				continue;
+			}
+			if (num_out == 0 && monitor->target->acquire != NULL) {
+				monitor->target->acquire(monitor->target);
+			}
+			if (copyRect(wall, monitor, &part, &out[num_out])) {
+				num_out++;
+			}
+		}
+		if (num_out == 0) {
+			continue;
+		}
+
+		// Whatever frame the monitor's canvas had drawn itself, it's not there any more
+		screen->frame = NULL;
+		screen->tiles_valid = 0;
+		if (monitor->target->present(monitor->target, out, num_out)) {
+			if (whole) {
+				monitor->pixels = screen->pixels;
+			}
+		} else {
+			monitor->pixels = NULL;
+			ok = 0;
+		}
+	}
+
+	return ok;
+}
+
+void WallInit(struct Wall *wall) {
+	memset(wall, 0, sizeof(*wall));
+	CanvasInit(&wall->canvas);
+	wall->target.canvas = &wall->canvas;
+	wall->target.present = wallPresent;
+}
+
+int WallSetMonitors(struct Wall *wall, struct RenderTarget *const *targets, const struct CanvasRect *desktop,
+					int num_monitors, int bezel_x, int bezel_y) {
+	if (num_monitors > RENDER_MAX_TARGETS) {
+		num_monitors = RENDER_MAX_TARGETS;
+	}
+	if (num_monitors <= 0) {
+		return 0;
+	}
+	bezel_x = bezel_x > 0 ? bezel_x : 0;
+	bezel_y = bezel_y > 0 ? bezel_y : 0;
+
+	int same = wall->pixels != NULL && num_monitors == wall->num_monitors && bezel_x == wall->bezel_x &&
+			   bezel_y == wall->bezel_y;
+	for (int i = 0; i < num_monitors && same; i++) {
+		same = targets[i] == wall->monitors[i].target &&
+			   memcmp(&desktop[i], &wall->monitors[i].desktop, sizeof(desktop[i])) == 0;
+	}
+	if (same) {
+		return 1;
+	}
+
+	struct CanvasRect crops[RENDER_MAX_TARGETS];
+	int width;
+	int height;
+	WallLayout(desktop, num_monitors, bezel_x, bezel_y, crops, &width, &height);
+	if (width <= 0 || height <= 0) {
+		return 0;
+	}
+	wall->num_monitors = 0;
+	if (wall->pixels == NULL || width != wall->canvas.width || height != wall->canvas.height) {
+		free(wall->pixels);
+		wall->pixels = (unsigned int *) calloc((size_t) width * height, 4);
+		CanvasSetPixels(&wall->canvas, wall->pixels, wall->pixels != NULL ? width : 0,
+						wall->pixels != NULL ? height : 0);
+		if (wall->pixels == NULL) {
+			return 0;
+		}
+	}
+
+	wall->bezel_x = bezel_x;
+	wall->bezel_y = bezel_y;
+	for (int i = 0; i < num_monitors; i++) {
+		struct WallMonitor *monitor = &wall->monitors[i];
+		monitor->target = targets[i];
+		monitor->desktop = desktop[i];
+		monitor->crop = crops[i];
+		monitor->pixels = NULL;
+	}
+	wall->num_monitors = num_monitors;
+
+	return 1;
+}
+
+void WallFree(struct Wall *wall) {
+	CanvasFree(&wall->canvas);
+	free(wall->pixels);
+	WallInit(wall);
+}
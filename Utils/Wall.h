@@ -0,0 +1,77 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_WALL_H
+#define EDW590SCR_WALL_H
+
+
+
+#include "Canvas.h"
+#include "Render.h"
+
+// A video wall: one frame across all the monitors, as if they were one big one. The frame's scaled once, into a canvas
+// as big as the box round all of them (see WallLayout()), and each monitor then gets its part of that copied into its
+// own canvas, rather than every monitor scaling the whole frame into itself. It's a RenderTarget of its own, so
+// RenderFrame() does the scaling, the transitions and the tiles for it like for any other: only the tiles that changed
+// get copied and presented, on whichever monitors they're on.
+//
+// With bezels, there are that many pixels of the frame between neighbouring monitors that nobody sees, as there would
+// be behind the frames of the monitors if the picture went on behind them, so lines stay straight across the seams.
+
+struct WallMonitor {
+	struct RenderTarget *target;
+	struct CanvasRect desktop;  // where the monitor is on the desktop
+	struct CanvasRect crop;     // and the part of the wall's canvas it shows
+	unsigned int *pixels;   // the target's pixels when the whole crop was last copied into them (NULL for never)
+};
+
+struct Wall {
+	struct RenderTarget target; // RenderFrame()'s view of it. Presenting copies to the monitors and presents them
+	struct Canvas canvas;
+	unsigned int *pixels;   // the canvas's
+	int bezel_x;            // pixels hidden between monitors side by side
+	int bezel_y;            // and one above the other
+	struct WallMonitor monitors[RENDER_MAX_TARGETS];
+	int num_monitors;
+	struct CanvasRect dst;  // the canvas's dst when last presented: if it's moved, the bars have too
+};
+
+// WallInit - a wall with no monitors, and no pixels yet.
+void WallInit(struct Wall *wall);
+
+// WallLayout - where each of num_monitors monitors at desktop (in desktop coordinates, which can be negative) goes on
+// the wall, in crops, and how big the wall is, in width and height. The box round them all starts at 0, 0, and each
+// seam between monitors (a left edge of one that's some other's right edge, or the same with top and bottom) moves
+// everything past it bezel_x or bezel_y further on. Monitors that don't line up, like an L, leave parts of the box
+// that no monitor shows.
+void WallLayout(const struct CanvasRect *desktop, int num_monitors, int bezel_x, int bezel_y, struct CanvasRect *crops,
+				int *width, int *height);
+
+// WallSetMonitors - the wall is now on num_monitors targets, at desktop, with those bezels. Only does anything if any
+// of it is different from before: then the canvas is made again if its size has changed, and the monitors all get
+// their whole crops next time. Returns 0 if there are no monitors or no memory for the canvas.
+int WallSetMonitors(struct Wall *wall, struct RenderTarget *const *targets, const struct CanvasRect *desktop,
+					int num_monitors, int bezel_x, int bezel_y);
+
+// WallFree - frees the canvas, and forgets the monitors.
+void WallFree(struct Wall *wall);
+
+
+
+#endif //EDW590SCR_WALL_H
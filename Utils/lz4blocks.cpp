@@ -0,0 +1,199 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "lz4blocks.h"
+
+// No Windows in here: the packer that uses this also gets built on Linux.
+
+#define HASH_LOG     16
+#define MIN_MATCH    4
+#define LAST_LITERALS 5     // the last 5 bytes of a block are always literals
+#define MF_LIMIT     12     // and no match starts in its last 12
+#define MAX_OFFSET   65535
+
+static unsigned int read32(const unsigned char *p) {
+	unsigned int v;
+	memcpy(&v, p, 4);
+
+	return v;
+}
+
+static unsigned int hash4(unsigned int v) {
+	return (v * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static void write32(unsigned char *p, unsigned int v) {
+	p[0] = (unsigned char) v;
+	p[1] = (unsigned char) (v >> 8);
+	p[2] = (unsigned char) (v >> 16);
+	p[3] = (unsigned char) (v >> 24);
+}
+
+// Writes a length that didn't fit in the token's 4 bits, as 255s and a remainder.
+static unsigned char *writeLength(unsigned char *op, unsigned int len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char) len;
+
+	return op;
+}
+
+// Writes one sequence: the literals, then the match (unless match_len is 0,
+// for the last sequence). Returns NULL if it doesn't fit before oend.
+static unsigned char *writeSequence(unsigned char *op, const unsigned char *oend, const unsigned char *literals,
+									unsigned int lit_len, unsigned int offset, unsigned int match_len) {
+	unsigned int worst = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+	if ((unsigned int) (oend - op) < worst) {
+		return NULL;
+	}
+
+	unsigned char *token = op++;
+	*token = (unsigned char) ((lit_len < 15 ? lit_len : 15) << 4);
+	if (lit_len >= 15) {
+		op = writeLength(op, lit_len - 15);
+	}
+	memcpy(op, literals, lit_len);
+	op += lit_len;
+	if (match_len == 0) {
+		return op;
+	}
+
+	*op++ = (unsigned char) offset;
+	*op++ = (unsigned char) (offset >> 8);
+	match_len -= MIN_MATCH;
+	*token |= (unsigned char) (match_len < 15 ? match_len : 15);
+	if (match_len >= 15) {
+		op = writeLength(op, match_len - 15);
+	}
+
+	return op;
+}
+
+unsigned int LZ4BlockBound(unsigned int len) {
+	return len + len / 255 + 16;
+}
+
+unsigned int LZ4BlockCompress(const unsigned char *src, unsigned int len, unsigned char *dst, unsigned int dstlen) {
+	if (len > LZ4BLOCKS_MAXBLOCK) {
+		return 0;
+	}
+
+	unsigned char *op = dst;
+	const unsigned char *oend = dst + dstlen;
+	const unsigned char *ip = src;
+	const unsigned char *anchor = src;
+	const unsigned char *iend = src + len;
+
+	if (len > MF_LIMIT) {
+		// Positions are kept relative to src, and 0 is as good a start as any,
+		// since every candidate gets checked anyway.
+		unsigned int *table = (unsigned int *) calloc(1 << HASH_LOG, sizeof(unsigned int));
+		if (table == NULL) {
+			return 0;
+		}
+		const unsigned char *mflimit = iend - MF_LIMIT;
+		const unsigned char *matchlimit = iend - LAST_LITERALS;
+		unsigned int misses = 0;
+
+		while (ip <= mflimit) {
+			unsigned int h = hash4(read32(ip));
+			const unsigned char *ref = src + table[h];
+			table[h] = (unsigned int) (ip - src);
+			if (ref >= ip || (unsigned int) (ip - ref) > MAX_OFFSET || read32(ref) != read32(ip)) {
+				// the longer it goes without a match, the faster it skips ahead,
+				// so that data which won't compress doesn't take long over it
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+			misses = 0;
+
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+				ip--;
+				ref--;
+			}
+			const unsigned char *mp = ip + MIN_MATCH;
+			const unsigned char *rp = ref + MIN_MATCH;
+			while (mp < matchlimit && *mp == *rp) {
+				mp++;
+				rp++;
+			}
+
+			op = writeSequence(op, oend, anchor, (unsigned int) (ip - anchor), (unsigned int) (ip - ref),
+							   (unsigned int) (mp - ip));
+			if (op == NULL) {
+				free(table);
+
+				return 0;
+			}
+			ip = mp;
+			anchor = ip;
+			if (ip <= mflimit) {
+				table[hash4(read32(ip - 2))] = (unsigned int) (ip - 2 - src);
+			}
+		}
+		free(table);
+	}
+
+	op = writeSequence(op, oend, anchor, (unsigned int) (iend - anchor), 0, 0);
+	if (op == NULL) {
+		return 0;
+	}
+
+	return (unsigned int) (op - dst);
+}
+
+unsigned int LZ4BlocksBound(unsigned int len) {
+	unsigned int num_blocks = (len + LZ4BLOCKS_BLOCKSIZE - 1) / LZ4BLOCKS_BLOCKSIZE;
+
+	return len + num_blocks * 8 + 4;
+}
+
+unsigned int LZ4BlocksCompress(const void *src, unsigned int len, void *dst, unsigned int dstlen) {
+	if (dstlen < LZ4BlocksBound(len)) {
+		return 0;
+	}
+
+	const unsigned char *ip = (const unsigned char *) src;
+	unsigned char *op = (unsigned char *) dst;
+	unsigned int left = len;
+	while (left > 0) {
+		unsigned int u = left < LZ4BLOCKS_BLOCKSIZE ? left : LZ4BLOCKS_BLOCKSIZE;
+		// anything that won't come out smaller than it went in is stored
+		unsigned int c = LZ4BlockCompress(ip, u, op + 8, u - 1);
+		if (c == 0) {
+			memcpy(op + 8, ip, u);
+			write32(op, 0x80000000 | u);
+			c = u;
+		} else {
+			write32(op, c);
+		}
+		write32(op + 4, u);
+		op += 8 + c;
+		ip += u;
+		left -= u;
+	}
+	write32(op, 0);
+	op += 4;
+
+	return (unsigned int) (op - (unsigned char *) dst);
+}
@@ -0,0 +1,61 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_LZ4BLOCKS_H
+#define EDW590SCR_LZ4BLOCKS_H
+
+
+
+// Encoder for the fast compression method that unzip.cpp decodes alongside
+// deflate. It trades ratio for decode speed: the frames are decoded with
+// little more than memcpy.
+//
+// The method isn't a registered zip one, so only our own unzip reads it.
+// An entry's data is a run of blocks, each starting with two little-endian
+// 32-bit words: c, its compressed size, and u, its uncompressed size. If c has
+// its top bit set then the block is stored, and the u bytes follow as they
+// are. Otherwise c bytes of LZ4 block format follow (token, literals, 2-byte
+// offset, match length), which decode to exactly u bytes. A c of 0, with no u
+// after it, ends the entry. Blocks never refer back into earlier blocks, so
+// they can be compressed in parallel and decoded straight into place.
+
+#define LZ4BLOCKS_METHOD    0x4C34          // the zip compression method ("L4"). Must match Z_LZ4BLOCKS in unzip.cpp
+#define LZ4BLOCKS_BLOCKSIZE (1024*1024)     // how much each block holds, before compression
+#define LZ4BLOCKS_MAXBLOCK  (4*1024*1024)   // the most the decoder accepts in one block
+
+unsigned int LZ4BlockBound(unsigned int len);
+// LZ4BlockBound - the most that LZ4BlockCompress can need for len bytes.
+
+unsigned int LZ4BlockCompress(const unsigned char *src, unsigned int len, unsigned char *dst, unsigned int dstlen);
+// LZ4BlockCompress - compresses len bytes (at most LZ4BLOCKS_MAXBLOCK) into
+// one bare LZ4 block, with no header. Returns its size, or 0 if it didn't fit
+// in dstlen, in which case the block had better be stored instead.
+
+unsigned int LZ4BlocksBound(unsigned int len);
+// LZ4BlocksBound - the most that LZ4BlocksCompress can need for len bytes:
+// the data itself, since a block that doesn't shrink is stored, plus the headers.
+
+unsigned int LZ4BlocksCompress(const void *src, unsigned int len, void *dst, unsigned int dstlen);
+// LZ4BlocksCompress - compresses a whole entry's data into the block
+// format described above, ready to be written out as the entry's data.
+// Returns its size, or 0 if dstlen was less than LZ4BlocksBound(len).
+
+
+
+#endif //EDW590SCR_LZ4BLOCKS_H
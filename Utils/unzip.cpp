@@ -1,4 +1,11 @@
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -124,8 +131,8 @@ typedef struct unz_file_info_s
   unsigned long compression_method;   // compression method              2 bytes
   unsigned long dosDate;              // last mod file date in Dos fmt   4 bytes
   unsigned long crc;                  // crc-32                          4 bytes
-  unsigned long compressed_size;      // compressed size                 4 bytes
-  unsigned long uncompressed_size;    // uncompressed size               4 bytes
+  unsigned __int64 compressed_size;   // compressed size                 4 bytes, or 8 in the zip64 extra field
+  unsigned __int64 uncompressed_size; // uncompressed size               4 bytes, or 8 in the zip64 extra field
   unsigned long size_filename;        // filename length                 2 bytes
   unsigned long size_file_extra;      // extra field length              2 bytes
   unsigned long size_file_comment;    // file comment length             2 bytes
@@ -177,8 +184,11 @@ typedef struct unz_file_info_s
 #define Z_ASCII    1
 #define Z_UNKNOWN  2
 
-// The deflate compression method (the only one supported in this version)
+// The deflate compression method
 #define Z_DEFLATED   8
+// Our own fast method, for when decode speed matters more than ratio: LZ4
+// blocks. Not a registered zip method. See lz4blocks.h, which has its encoder.
+#define Z_LZ4BLOCKS  0x4C34
 
 // for initializing zalloc, zfree, opaque
 #define Z_NULL  0
@@ -206,6 +216,7 @@ typedef struct unz_file_info_s
 typedef unsigned char  Byte;  // 8 bits
 typedef unsigned int   uInt;  // 16 bits or more
 typedef unsigned long  uLong; // 32 bits or more
+typedef unsigned __int64 uLong64; // 64 bits, for zip64 offsets and sizes
 typedef void *voidpf;
 typedef void     *voidp;
 typedef long z_off_t;
@@ -1656,16 +1667,16 @@ uInt *v)               // working area: values in order of bit length
   uInt f;                       // i repeats in table every f entries
   int g;                        // maximum code length
   int h;                        // table level
-  register uInt i;              // counter, current code
-  register uInt j;              // counter
-  register int k;               // number of bits in current code
+  uInt i;                       // counter, current code
+  uInt j;                       // counter
+  int k;                        // number of bits in current code
   int l;                        // bits per table (returned in m)
   uInt mask;                    // (1 << w) - 1, to avoid cc -O bug on HP
-  register uInt *p;            // pointer into c[], b[], or v[]
+  uInt *p;                     // pointer into c[], b[], or v[]
   inflate_huft *q;              // points to current table
   struct inflate_huft_s r;      // table entry for structure assignment
   inflate_huft *u[BMAX];        // table stack
-  register int w;               // bits before this table == (l * h)
+  int w;                        // bits before this table == (l * h)
   uInt x[BMAX+1];               // bit offsets, then code stack
   uInt *xp;                    // pointer into x
   int y;                        // number of dummy codes added
@@ -2181,9 +2192,45 @@ const uLong * get_crc_table()
 #define CRC_DO4(buf)  CRC_DO2(buf); CRC_DO2(buf);
 #define CRC_DO8(buf)  CRC_DO4(buf); CRC_DO4(buf);
 
+// Slicing-by-16: crc_slice[k][n] is the crc of byte n followed by k zero
+// bytes, so sixteen bytes can be folded in with sixteen lookups at once
+// instead of one after the other. That's what keeps the crc from being slower than the
+// fast method's decoding. The tables are made from crc_table the first time
+// they're needed; until they're ready, the byte-at-a-time loop is used.
+uLong crc_slice[16][256];
+volatile long crc_slice_state=0; // 0=not made, 1=being made, 2=ready
+
+#ifdef _WIN32
+long uatomic_cas(volatile long *v,long xchg,long cmp) {return InterlockedCompareExchange(v,xchg,cmp);}
+void uatomic_set(volatile long *v,long x) {InterlockedExchange(v,x);}
+#else
+long uatomic_cas(volatile long *v,long xchg,long cmp) {return __sync_val_compare_and_swap(v,cmp,xchg);}
+void uatomic_set(volatile long *v,long x) {__sync_synchronize(); *v=x; __sync_synchronize();}
+#endif
+
+void crc_make_slices()
+{ if (uatomic_cas(&crc_slice_state,1,0)!=0) return;
+  for (int n=0; n<256; n++) crc_slice[0][n]=crc_table[n];
+  for (int k=1; k<16; k++)
+  { for (int n=0; n<256; n++) crc_slice[k][n] = (crc_slice[k-1][n]>>8) ^ crc_table[crc_slice[k-1][n]&0xff];
+  }
+  uatomic_set(&crc_slice_state,2);
+}
+
 uLong ucrc32(uLong crc, const Byte *buf, uInt len)
 { if (buf == Z_NULL) return 0L;
   crc = crc ^ 0xffffffffL;
+  if (crc_slice_state!=2 && len>=64) crc_make_slices();
+  if (crc_slice_state==2)
+  { while (len >= 16)
+    { uLong lo = crc ^ ((uLong)buf[0] | ((uLong)buf[1]<<8) | ((uLong)buf[2]<<16) | ((uLong)buf[3]<<24));
+      crc = crc_slice[15][lo&0xff] ^ crc_slice[14][(lo>>8)&0xff] ^ crc_slice[13][(lo>>16)&0xff] ^ crc_slice[12][(lo>>24)&0xff] ^
+            crc_slice[11][buf[4]] ^ crc_slice[10][buf[5]] ^ crc_slice[9][buf[6]] ^ crc_slice[8][buf[7]] ^
+            crc_slice[7][buf[8]] ^ crc_slice[6][buf[9]] ^ crc_slice[5][buf[10]] ^ crc_slice[4][buf[11]] ^
+            crc_slice[3][buf[12]] ^ crc_slice[2][buf[13]] ^ crc_slice[1][buf[14]] ^ crc_slice[0][buf[15]];
+      buf+=16; len-=16;
+    }
+  }
   while (len >= 8)  {CRC_DO8(buf); len -= 8;}
   if (len) do {CRC_DO1(buf);} while (--len);
   return crc ^ 0xffffffffL;
@@ -2552,6 +2599,11 @@ int inflate(z_streamp z, int f)
 #define SIZECENTRALDIRITEM (0x2e)
 #define SIZEZIPLOCALHEADER (0x1e)
 
+// little-endian numbers out of a buffer, for the headers that are read in one go
+#define UNZ_GETSHORT(p) ((uLong)(p)[0] | ((uLong)(p)[1]<<8))
+#define UNZ_GETLONG(p)  (UNZ_GETSHORT(p) | (UNZ_GETSHORT((p)+2)<<16))
+#define UNZ_GETLONG64(p) ((uLong64)UNZ_GETLONG(p) | ((uLong64)UNZ_GETLONG((p)+4)<<32))
+
 
 
 
@@ -2560,7 +2612,7 @@ const char unz_copyright[] = " unzip 0.15 Copyright 1998 Gilles Vollant ";
 // unz_file_info_interntal contain internal info about a file in zipfile
 typedef struct unz_file_info_internal_s
 {
-    uLong offset_curfile;// relative offset of local header 4 bytes
+    uLong64 offset_curfile;// relative offset of local header 4 bytes, or 8 in the zip64 extra field
 } unz_file_info_internal;
 
 
@@ -2568,7 +2620,14 @@ typedef struct
 { bool is_handle; // either a handle or memory
   bool canseek;
   // for handles:
-  HANDLE h; bool herr; unsigned long initial_offset;
+#ifdef _WIN32
+  HANDLE h;
+#else
+  int h;     // a file descriptor
+#endif
+  bool herr; unsigned __int64 initial_offset;
+  // for handles that can't seek: bytes that were read too far and handed back
+  char *pushback; unsigned int pushlen,pushpos;
   // for memory:
   void *buf; unsigned int len,pos; // if it's a memory block
 } LUFILE;
@@ -2577,9 +2636,16 @@ typedef struct
 LUFILE *lufopen(void *z,unsigned int len,DWORD flags,ZRESULT *err)
 { if (flags!=ZIP_HANDLE && flags!=ZIP_FILENAME && flags!=ZIP_MEMORY) {*err=ZR_ARGS; return NULL;}
   //
-  HANDLE h=0; bool canseek=false; *err=ZR_OK;
+#ifdef _WIN32
+  HANDLE h=0;
+#else
+  int h=-1;
+#endif
+  bool canseek=false; *err=ZR_OK;
   if (flags==ZIP_HANDLE||flags==ZIP_FILENAME)
-  { if (flags==ZIP_HANDLE)
+  {
+#ifdef _WIN32
+    if (flags==ZIP_HANDLE)
     { HANDLE hf = z;
       BOOL res = DuplicateHandle(GetCurrentProcess(),hf,GetCurrentProcess(),&h,0,FALSE,DUPLICATE_SAME_ACCESS);
       if (!res) {*err=ZR_NODUPH; return NULL;}
@@ -2590,14 +2656,35 @@ LUFILE *lufopen(void *z,unsigned int len,DWORD flags,ZRESULT *err)
     }
     DWORD type = GetFileType(h);
     canseek = (type==FILE_TYPE_DISK);
+#else
+    if (flags==ZIP_HANDLE)
+    { h=dup((int)(size_t)z);
+      if (h<0) {*err=ZR_NODUPH; return NULL;}
+    }
+    else
+    { h=open((const char*)z,O_RDONLY);
+      if (h<0) {*err=ZR_NOFILE; return NULL;}
+    }
+    struct stat st;
+    canseek = (fstat(h,&st)==0 && S_ISREG(st.st_mode));
+#endif
   }
   LUFILE *lf = new LUFILE;
+  lf->pushback=NULL; lf->pushlen=0; lf->pushpos=0;
   if (flags==ZIP_HANDLE||flags==ZIP_FILENAME)
   { lf->is_handle=true;
     lf->canseek=canseek;
     lf->h=h; lf->herr=false;
     lf->initial_offset=0;
-    if (canseek) lf->initial_offset = SetFilePointer(h,0,NULL,FILE_CURRENT);
+    if (canseek)
+    {
+#ifdef _WIN32
+      LONG hi=0; DWORD lo = SetFilePointer(h,0,&hi,FILE_CURRENT);
+      lf->initial_offset = ((unsigned __int64)(DWORD)hi<<32) | lo;
+#else
+      lf->initial_offset = (unsigned __int64)lseek(h,0,SEEK_CUR);
+#endif
+    }
   }
   else
   { lf->is_handle=false;
@@ -2611,7 +2698,12 @@ LUFILE *lufopen(void *z,unsigned int len,DWORD flags,ZRESULT *err)
 
 int lufclose(LUFILE *stream)
 { if (stream==NULL) return EOF;
+#ifdef _WIN32
   if (stream->is_handle) CloseHandle(stream->h);
+#else
+  if (stream->is_handle) close(stream->h);
+#endif
+  if (stream->pushback!=NULL) zfree(stream->pushback);
   delete stream;
   return 0;
 }
@@ -2621,35 +2713,89 @@ int luferror(LUFILE *stream)
   else return 0;
 }
 
-long int luftell(LUFILE *stream)
-{ if (stream->is_handle && stream->canseek) return SetFilePointer(stream->h,0,NULL,FILE_CURRENT)-stream->initial_offset;
+// Offsets are 64 bits throughout, since a zip64 file can be larger than 4gb.
+unsigned __int64 luftell(LUFILE *stream)
+{ if (stream->is_handle && stream->canseek)
+  {
+#ifdef _WIN32
+    LONG hi=0; DWORD lo = SetFilePointer(stream->h,0,&hi,FILE_CURRENT);
+    return (((unsigned __int64)(DWORD)hi<<32) | lo) - stream->initial_offset;
+#else
+    return (unsigned __int64)lseek(stream->h,0,SEEK_CUR) - stream->initial_offset;
+#endif
+  }
   else if (stream->is_handle) return 0;
   else return stream->pos;
 }
 
-int lufseek(LUFILE *stream, long offset, int whence)
+int lufseek(LUFILE *stream, __int64 offset, int whence)
 { if (stream->is_handle && stream->canseek)
-  { if (whence==SEEK_SET) SetFilePointer(stream->h,stream->initial_offset+offset,0,FILE_BEGIN);
-    else if (whence==SEEK_CUR) SetFilePointer(stream->h,offset,NULL,FILE_CURRENT);
-    else if (whence==SEEK_END) SetFilePointer(stream->h,offset,NULL,FILE_END);
+    {
+#ifdef _WIN32
+    DWORD method;
+    if (whence==SEEK_SET) {offset+=stream->initial_offset; method=FILE_BEGIN;}
+    else if (whence==SEEK_CUR) method=FILE_CURRENT;
+    else if (whence==SEEK_END) method=FILE_END;
     else return 19; // EINVAL
+    LONG hi = (LONG)(offset>>32);
+    DWORD lo = SetFilePointer(stream->h,(LONG)(offset&0xFFFFFFFF),&hi,method);
+    if (lo==INVALID_SET_FILE_POINTER && GetLastError()!=NO_ERROR) return 22; // EINVAL
+#else
+    if (whence==SEEK_SET) offset+=stream->initial_offset;
+    else if (whence!=SEEK_CUR && whence!=SEEK_END) return 19; // EINVAL
+    if (lseek(stream->h,(off_t)offset,whence)<0) return 22; // EINVAL
+#endif
     return 0;
   }
   else if (stream->is_handle) return 29; // ESPIPE
   else
-  { if (whence==SEEK_SET) stream->pos=offset;
-    else if (whence==SEEK_CUR) stream->pos+=offset;
-    else if (whence==SEEK_END) stream->pos=stream->len+offset;
+  { if (whence==SEEK_CUR) offset+=stream->pos;
+    else if (whence==SEEK_END) offset+=stream->len;
+    if (offset<0 || offset>stream->len) return 22; // EINVAL
+    stream->pos=(unsigned int)offset;
     return 0;
   }
 }
 
 
+// Reads whatever is available right now, up to len bytes, waiting only if
+// nothing at all is. Returns 0 at the end of the data. This is what lets a
+// streamed item be unzipped as its bytes arrive through a pipe.
+unsigned int lufreadsome(void *ptr,unsigned int len,LUFILE *stream)
+{ if (len==0) return 0;
+  if (stream->pushback!=NULL && stream->pushpos<stream->pushlen)
+  { unsigned int n = stream->pushlen-stream->pushpos; if (n>len) n=len;
+    memcpy(ptr,stream->pushback+stream->pushpos,n); stream->pushpos+=n;
+    return n;
+  }
+  if (stream->is_handle)
+  {
+#ifdef _WIN32
+    DWORD red=0; BOOL res = ReadFile(stream->h,ptr,len,&red,NULL);
+    if (!res) {if (GetLastError()!=ERROR_BROKEN_PIPE) stream->herr=true; return 0;}
+#else
+    ssize_t red;
+    do red = read(stream->h,ptr,len); while (red<0 && errno==EINTR);
+    if (red<0) {stream->herr=true; return 0;}
+#endif
+    return (unsigned int)red;
+  }
+  if (stream->pos+len > stream->len) len = stream->len-stream->pos;
+  memcpy(ptr, (char*)stream->buf + stream->pos, len);
+  stream->pos += len;
+  return len;
+}
+
 size_t lufread(void *ptr,size_t size,size_t n,LUFILE *stream)
 { unsigned int toread = (unsigned int)(size*n);
   if (stream->is_handle)
-  { DWORD red; BOOL res = ReadFile(stream->h,ptr,toread,&red,NULL);
-    if (!res) stream->herr=true;
+  { // a pipe hands over its data in whatever pieces it was written in
+    unsigned int red=0;
+    while (red<toread)
+    { unsigned int r = lufreadsome((char*)ptr+red,toread-red,stream);
+      if (r==0) break;
+      red+=r;
+    }
     return red/size;
   }
   if (stream->pos+toread > stream->len) toread = stream->len-stream->pos;
@@ -2658,6 +2804,33 @@ size_t lufread(void *ptr,size_t size,size_t n,LUFILE *stream)
   return red/size;
 }
 
+// Hands back len bytes that were read from a stream that can't seek, so that
+// the next read returns them again.
+int lufunread(const void *ptr,unsigned int len,LUFILE *stream)
+{ if (len==0) return 0;
+  unsigned int left = (stream->pushback==NULL) ? 0 : stream->pushlen-stream->pushpos;
+  char *buf = (char*)zmalloc(len+left);
+  if (buf==NULL) return 12; // ENOMEM
+  memcpy(buf,ptr,len);
+  if (left>0) memcpy(buf+len,stream->pushback+stream->pushpos,left);
+  if (stream->pushback!=NULL) zfree(stream->pushback);
+  stream->pushback=buf; stream->pushlen=len+left; stream->pushpos=0;
+  return 0;
+}
+
+// Moves len bytes forward. Unlike lufseek, this also works on a pipe.
+int lufskip(LUFILE *stream,unsigned __int64 len)
+{ if (stream->canseek) return lufseek(stream,(__int64)len,SEEK_CUR);
+  char buf[1024];
+  while (len>0)
+  { unsigned int n = len<sizeof(buf) ? (unsigned int)len : (unsigned int)sizeof(buf);
+    n = lufreadsome(buf,n,stream);
+    if (n==0) return 5; // EIO
+    len-=n;
+  }
+  return 0;
+}
+
 
 
 
@@ -2668,20 +2841,28 @@ typedef struct
 	char  *read_buffer;         // internal buffer for compressed data
 	z_stream stream;            // zLib stream structure for inflate
 
-	uLong pos_in_zipfile;       // position in byte on the zipfile, for fseek
+	uLong64 pos_in_zipfile;     // position in byte on the zipfile, for fseek
 	uLong stream_initialised;   // flag set if stream structure is initialised
 
-	uLong offset_local_extrafield;// offset of the local extra field
+	uLong64 offset_local_extrafield;// offset of the local extra field
 	uInt  size_local_extrafield;// size of the local extra field
 	uLong pos_local_extrafield;   // position in the local extra field in read
 
 	uLong crc32;                // crc32 of all data uncompressed
 	uLong crc32_wait;           // crc32 we must obtain after decompress all
-	uLong rest_read_compressed; // number of byte to be decompressed
-	uLong rest_read_uncompressed;//number of byte to be obtained after decomp
+	uLong64 rest_read_compressed; // number of byte to be decompressed
+	uLong64 rest_read_uncompressed;//number of byte to be obtained after decomp
 	LUFILE* file;                 // io structore of the zipfile
 	uLong compression_method;   // compression method (0==store)
-	uLong byte_before_the_zipfile;// byte before the zipfile, (>0 for sfx)
+	uLong64 byte_before_the_zipfile;// byte before the zipfile, (>0 for sfx)
+	bool unknown_size;          // streaming, and the sizes are in a data descriptor: read until the stream ends
+	// for Z_LZ4BLOCKS:
+	unsigned char *lz_in;       // a block's compressed data, if it has to be read in (i.e. not from memory)
+	uLong lz_insize;            // how big lz_in is
+	unsigned char *lz_out;      // a block that was decoded here because the caller's buffer hadn't room for it
+	uLong lz_outsize;           // how big lz_out is
+	uLong lz_outpos,lz_outlen;  // how much of lz_out has been handed out, of how much
+	bool lz_done;               // the block that ends the data has been read
 } file_in_zip_read_info_s;
 
 
@@ -2690,20 +2871,35 @@ typedef struct
 {
 	LUFILE* file;               // io structore of the zipfile
 	unz_global_info gi;         // public global information
-	uLong byte_before_the_zipfile;// byte before the zipfile, (>0 for sfx)
+	uLong64 byte_before_the_zipfile;// byte before the zipfile, (>0 for sfx)
 	uLong num_file;             // number of the current file in the zipfile
-	uLong pos_in_central_dir;   // pos of the current file in the central dir
+	uLong64 pos_in_central_dir; // pos of the current file in the central dir
 	uLong current_file_ok;      // flag about the usability of the current file
-	uLong central_pos;          // position of the beginning of the central dir
+	uLong64 central_pos;        // position of the end of central dir record (the classic one, not the zip64 one)
 
-	uLong size_central_dir;     // size of the central directory
-	uLong offset_central_dir;   // offset of start of central directory with respect to the starting disk number
+	uLong64 size_central_dir;   // size of the central directory
+	uLong64 offset_central_dir; // offset of start of central directory with respect to the starting disk number
+	const unsigned char *central_dir; // the whole central directory, read in one go when the zipfile was opened
+	bool own_central_dir;       // whether central_dir was allocated by us, or points into a memory zipfile
+	uLong64 *file_pos;          // pos_in_central_dir of each file, so that any of them can be gone to directly
 
 	unz_file_info cur_file_info; // public info about the current file in zip
 	unz_file_info_internal cur_file_info_internal; // private info about it
     file_in_zip_read_info_s* pfile_in_zip_read; // structure about the current file if we are decompressing it
+
+	bool streaming;             // read front to back through a pipe, from the local headers: there's no central dir
+	int stream_state;           // for streaming: how far through the current file we are (UNZ_STREAM_*)
+	char stream_filename[MAX_PATH]; // for streaming: name of the current file, from its local header
+	char *stream_extra;         // for streaming: its local extra field
+	bool stream_zip64;          // for streaming: it had a zip64 extra field, so its data descriptor has 8-byte sizes
 } unz_s, *unzFile;
 
+#define UNZ_STREAM_NONE   0    // no local header has been read yet
+#define UNZ_STREAM_HEADER 1    // the current file's local header has been read, but none of its data
+#define UNZ_STREAM_DATA   2    // the current file is being decompressed
+#define UNZ_STREAM_DONE   3    // all of the current file, and its data descriptor, has been read
+#define UNZ_STREAM_END    4    // the central dir was reached: there are no more files
+
 
 int unzStringFileNameCompare (const char* fileName1,const char* fileName2,int iCaseSensitivity);
 //   Compare two filename (fileName1,fileName2).
@@ -2838,26 +3034,26 @@ int unzStringFileNameCompare (const char*fileName1,const char*fileName2,int iCas
 
 //  Locate the Central directory of a zipfile (at the end, just before
 // the global comment)
-uLong unzlocal_SearchCentralDir(LUFILE *fin)
+uLong64 unzlocal_SearchCentralDir(LUFILE *fin)
 { if (lufseek(fin,0,SEEK_END) != 0) return 0;
-  uLong uSizeFile = luftell(fin);
+  uLong64 uSizeFile = luftell(fin);
 
-  uLong uMaxBack=0xffff; // maximum size of global comment
+  uLong64 uMaxBack=0xffff; // maximum size of global comment
   if (uMaxBack>uSizeFile) uMaxBack = uSizeFile;
 
   unsigned char *buf = (unsigned char*)zmalloc(BUFREADCOMMENT+4);
   if (buf==NULL) return 0;
-  uLong uPosFound=0;
+  uLong64 uPosFound=0;
 
-  uLong uBackRead = 4;
+  uLong64 uBackRead = 4;
   while (uBackRead<uMaxBack)
-  { uLong uReadSize,uReadPos ;
+  { uLong64 uReadSize,uReadPos ;
     int i;
     if (uBackRead+BUFREADCOMMENT>uMaxBack) uBackRead = uMaxBack;
     else uBackRead+=BUFREADCOMMENT;
     uReadPos = uSizeFile-uBackRead ;
     uReadSize = ((BUFREADCOMMENT+4) < (uSizeFile-uReadPos)) ? (BUFREADCOMMENT+4) : (uSizeFile-uReadPos);
-    if (lufseek(fin,uReadPos,SEEK_SET)!=0) break;
+    if (lufseek(fin,(__int64)uReadPos,SEEK_SET)!=0) break;
     if (lufread(buf,(uInt)uReadSize,1,fin)!=1) break;
     for (i=(int)uReadSize-3; (i--)>0;)
     { if (((*(buf+i))==0x50) && ((*(buf+i+1))==0x4b) &&	((*(buf+i+2))==0x05) && ((*(buf+i+3))==0x06))
@@ -2877,45 +3073,122 @@ int unzCloseCurrentFile (unzFile file);
 // Open a Zip file.
 // If the zipfile cannot be opened (file don't exist or in not valid), return NULL.
 // Otherwise, the return value is a unzFile Handle, usable with other unzip functions
+//  Zip64: look for the locator that sits just before the end of central dir
+//  record, and if it's there then read the zip64 end of central dir record it
+//  points to. That one has the entry count, size and offset of the central
+//  dir, which the classic record only has as 0xFFFF/0xFFFFFFFF when they
+//  don't fit. Returns the position of the zip64 record, or 0 if there's none.
+uLong64 unzlocal_SearchCentralDir64(LUFILE *fin, uLong64 central_pos,
+  uLong64 *number_entry, uLong64 *size_central_dir, uLong64 *offset_central_dir)
+{ if (central_pos<20) return 0;
+  unsigned char loc[20];
+  if (lufseek(fin,(__int64)(central_pos-20),SEEK_SET)!=0) return 0;
+  if (lufread(loc,20,1,fin)!=1) return 0;
+  if (UNZ_GETLONG(loc)!=0x07064b50) return 0;
+  // the disk numbers are for spanning, unsupported
+  if (UNZ_GETLONG(loc+4)!=0 || UNZ_GETLONG(loc+16)>1) return 0;
+  uLong64 pos64 = UNZ_GETLONG64(loc+8);
+  // that's relative to the start of the zipfile, which may have something
+  // before it (e.g. an sfx stub): the record itself is right before the locator
+  unsigned char rec[56];
+  uLong64 at = pos64;
+  for (int tries=0; tries<2; tries++)
+  { if (lufseek(fin,(__int64)at,SEEK_SET)==0 && lufread(rec,56,1,fin)==1 && UNZ_GETLONG(rec)==0x06064b50)
+    { if (UNZ_GETLONG(rec+16)!=0 || UNZ_GETLONG(rec+20)!=0) return 0;
+      *number_entry = UNZ_GETLONG64(rec+32);
+      if (UNZ_GETLONG64(rec+24)!=*number_entry) return 0;
+      *size_central_dir = UNZ_GETLONG64(rec+40);
+      *offset_central_dir = UNZ_GETLONG64(rec+48);
+      return at;
+    }
+    if (central_pos<20+56) return 0;
+    at = central_pos-20-56; // only right when it has no extensible data, which is the usual case
+    if (at==pos64) return 0;
+  }
+  return 0;
+}
+
+
+int unzGoToFirstFile (unzFile file);
+int unzCloseCurrentFile (unzFile file);
+
+// Open a Zip file.
+// If the zipfile cannot be opened (file don't exist or in not valid), return NULL.
+// Otherwise, the return value is a unzFile Handle, usable with other unzip functions
+// The whole central dir is read in one go, and indexed, so that going from one
+// file to another (or straight to any of them) needs no more reads.
 unzFile unzOpenInternal(LUFILE *fin)
 { if (fin==NULL) return NULL;
   if (unz_copyright[0]!=' ') {lufclose(fin); return NULL;}
 
   int err=UNZ_OK;
-  unz_s us;
-  uLong central_pos,uL;
+  unz_s us; memset(&us,0,sizeof(us));
+  uLong64 central_pos;
   central_pos = unzlocal_SearchCentralDir(fin);
   if (central_pos==0) err=UNZ_ERRNO;
-  if (lufseek(fin,central_pos,SEEK_SET)!=0) err=UNZ_ERRNO;
+  unsigned char eocd[22];
+  if (err==UNZ_OK && lufseek(fin,(__int64)central_pos,SEEK_SET)!=0) err=UNZ_ERRNO;
+  if (err==UNZ_OK && lufread(eocd,22,1,fin)!=1) err=UNZ_ERRNO;
+  if (err!=UNZ_OK) {lufclose(fin);return NULL;}
   // the signature, already checked
-  if (unzlocal_getLong(fin,&uL)!=UNZ_OK) err=UNZ_ERRNO;
-  // number of this disk
-  uLong number_disk;          // number of the current dist, used for spanning ZIP, unsupported, always 0
-  if (unzlocal_getShort(fin,&number_disk)!=UNZ_OK) err=UNZ_ERRNO;
-  // number of the disk with the start of the central directory
-  uLong number_disk_with_CD;  // number the the disk with central dir, used for spaning ZIP, unsupported, always 0
-  if (unzlocal_getShort(fin,&number_disk_with_CD)!=UNZ_OK) err=UNZ_ERRNO;
-  // total number of entries in the central dir on this disk
-  if (unzlocal_getShort(fin,&us.gi.number_entry)!=UNZ_OK) err=UNZ_ERRNO;
-  // total number of entries in the central dir
-  uLong number_entry_CD;      // total number of entries in the central dir (same than number_entry on nospan)
-  if (unzlocal_getShort(fin,&number_entry_CD)!=UNZ_OK) err=UNZ_ERRNO;
-  if ((number_entry_CD!=us.gi.number_entry) || (number_disk_with_CD!=0) || (number_disk!=0)) err=UNZ_BADZIPFILE;
-  // size of the central directory
-  if (unzlocal_getLong(fin,&us.size_central_dir)!=UNZ_OK) err=UNZ_ERRNO;
-  // offset of start of central directory with respect to the starting disk number
-  if (unzlocal_getLong(fin,&us.offset_central_dir)!=UNZ_OK) err=UNZ_ERRNO;
-  // zipfile comment length
-  if (unzlocal_getShort(fin,&us.gi.size_comment)!=UNZ_OK) err=UNZ_ERRNO;
-  if ((central_pos+fin->initial_offset<us.offset_central_dir+us.size_central_dir) && (err==UNZ_OK)) err=UNZ_BADZIPFILE;
+  uLong number_disk = UNZ_GETSHORT(eocd+4);          // number of the current dist, used for spanning ZIP, unsupported, always 0
+  uLong number_disk_with_CD = UNZ_GETSHORT(eocd+6);  // number the the disk with central dir, used for spaning ZIP, unsupported, always 0
+  uLong64 number_entry = UNZ_GETSHORT(eocd+8);       // total number of entries in the central dir on this disk
+  uLong number_entry_CD = UNZ_GETSHORT(eocd+10);     // total number of entries in the central dir (same than number_entry on nospan)
+  us.size_central_dir = UNZ_GETLONG(eocd+12);        // size of the central directory
+  us.offset_central_dir = UNZ_GETLONG(eocd+16);      // offset of start of central directory with respect to the starting disk number
+  us.gi.size_comment = UNZ_GETSHORT(eocd+20);        // zipfile comment length
+  // zip64, if there's the locator for it: then it's the zip64 record that
+  // follows the central dir, and that the offsets are measured against
+  uLong64 end_pos = central_pos;
+  uLong64 central64_pos = unzlocal_SearchCentralDir64(fin,central_pos,&number_entry,&us.size_central_dir,&us.offset_central_dir);
+  if (central64_pos!=0) end_pos=central64_pos;
+  else if ((number_entry_CD!=number_entry) || (number_disk_with_CD!=0) || (number_disk!=0)) err=UNZ_BADZIPFILE;
+  if (number_entry>us.size_central_dir/SIZECENTRALDIRITEM) err=UNZ_BADZIPFILE;
+  if ((end_pos+fin->initial_offset<us.offset_central_dir+us.size_central_dir) && (err==UNZ_OK)) err=UNZ_BADZIPFILE;
+  if (us.size_central_dir>0x7FFFFFFF) err=UNZ_BADZIPFILE; // we hold it all in memory
   if (err!=UNZ_OK) {lufclose(fin);return NULL;}
+  us.gi.number_entry = (uLong)number_entry;
 
   us.file=fin;
-  us.byte_before_the_zipfile = central_pos+fin->initial_offset - (us.offset_central_dir+us.size_central_dir);
+  us.byte_before_the_zipfile = end_pos+fin->initial_offset - (us.offset_central_dir+us.size_central_dir);
   us.central_pos = central_pos;
   us.pfile_in_zip_read = NULL;
+  us.streaming = false;
+  us.stream_state = UNZ_STREAM_NONE;
+  us.stream_extra = NULL;
   fin->initial_offset = 0; // since the zipfile itself is expected to handle this
 
+  // One read for the whole central dir. A zipfile in memory is already
+  // there, so just point at it.
+  uLong64 cd = us.offset_central_dir+us.byte_before_the_zipfile;
+  if (!fin->is_handle) {us.central_dir=(const unsigned char*)fin->buf+cd; us.own_central_dir=false;}
+  else
+  { unsigned char *buf = (unsigned char*)zmalloc((uInt)us.size_central_dir+1);
+    if (buf==NULL) err=UNZ_INTERNALERROR;
+    else if (lufseek(fin,(__int64)cd,SEEK_SET)!=0) err=UNZ_ERRNO;
+    else if (us.size_central_dir>0 && lufread(buf,(uInt)us.size_central_dir,1,fin)!=1) err=UNZ_ERRNO;
+    us.central_dir=buf; us.own_central_dir=true;
+  }
+  // and one walk through it for where each file's record is
+  if (err==UNZ_OK)
+  { us.file_pos = (uLong64*)zmalloc((us.gi.number_entry+1)*sizeof(uLong64));
+    if (us.file_pos==NULL) err=UNZ_INTERNALERROR;
+  }
+  uLong64 pos=0;
+  for (uLong i=0; i<us.gi.number_entry && err==UNZ_OK; i++)
+  { const unsigned char *p = us.central_dir+pos;
+    if (pos+SIZECENTRALDIRITEM>us.size_central_dir || UNZ_GETLONG(p)!=0x02014b50) {err=UNZ_BADZIPFILE; break;}
+    us.file_pos[i] = us.offset_central_dir+pos;
+    pos += SIZECENTRALDIRITEM + UNZ_GETSHORT(p+28) + UNZ_GETSHORT(p+30) + UNZ_GETSHORT(p+32);
+    if (pos>us.size_central_dir) err=UNZ_BADZIPFILE;
+  }
+  if (err!=UNZ_OK)
+  { if (us.own_central_dir && us.central_dir!=NULL) zfree((void*)us.central_dir);
+    if (us.file_pos!=NULL) zfree(us.file_pos);
+    lufclose(fin); return NULL;
+  }
+
   unz_s *s = (unz_s*)zmalloc(sizeof(unz_s));
   *s=us;
   unzGoToFirstFile((unzFile)s);
@@ -2938,12 +3211,34 @@ int unzClose (unzFile file)
     if (s->pfile_in_zip_read!=NULL)
         unzCloseCurrentFile(file);
 
+	if (s->stream_extra!=NULL) zfree(s->stream_extra);
+	if (s->own_central_dir && s->central_dir!=NULL) zfree((void*)s->central_dir);
+	if (s->file_pos!=NULL) zfree(s->file_pos);
 	lufclose(s->file);
 	if (s) zfree(s); // unused s=0;
 	return UNZ_OK;
 }
 
 
+//  Open a Zip file that can only be read front to back, such as a pipe.
+//  There's no central dir to go by: instead the files are found one after
+//  the other with unzlocal_StreamNextFile, from their local headers, and
+//  each can be read as its data arrives.
+unzFile unzOpenStreamInternal(LUFILE *fin)
+{ if (fin==NULL) return NULL;
+  unz_s *s = (unz_s*)zmalloc(sizeof(unz_s));
+  if (s==NULL) {lufclose(fin); return NULL;}
+  memset(s,0,sizeof(unz_s));
+  s->file=fin;
+  s->gi.number_entry=0; // not known until the end
+  s->pfile_in_zip_read=NULL;
+  s->streaming=true;
+  s->stream_state=UNZ_STREAM_NONE;
+  s->stream_extra=NULL;
+  return (unzFile)s;
+}
+
+
 //  Write info about the ZipFile in the *pglobal_info structure.
 //  No preparation of the structure is needed
 //  return UNZ_OK if there is no problem.
@@ -2984,6 +3279,33 @@ int unzlocal_GetCurrentFileInfoInternal (unzFile file,
                                                   char *szComment,
 												  uLong commentBufferSize);
 
+//  Zip64: the sizes and offset that didn't fit in 32 bits are 0xFFFFFFFF (and
+//  the disk number 0xFFFF), and the real ones are in the 0x0001 extra field, in
+//  that order, but only those that overflowed. Returns whether there was one.
+bool unzlocal_GetZip64Extra (const unsigned char *extra, uLong extralen,
+  unz_file_info *fi, uLong64 *poffset)
+{
+	uLong pos=0;
+	while (pos+4<=extralen)
+	{ uLong id=UNZ_GETSHORT(extra+pos), len=UNZ_GETSHORT(extra+pos+2);
+	  pos+=4;
+	  if (pos+len>extralen) break;
+	  if (id==0x0001)
+	  { const unsigned char *p=extra+pos, *e=extra+pos+len;
+	    if (fi->uncompressed_size==0xFFFFFFFF && p+8<=e) {fi->uncompressed_size=UNZ_GETLONG64(p); p+=8;}
+	    if (fi->compressed_size==0xFFFFFFFF && p+8<=e) {fi->compressed_size=UNZ_GETLONG64(p); p+=8;}
+	    if (poffset!=NULL && *poffset==0xFFFFFFFF && p+8<=e) {*poffset=UNZ_GETLONG64(p); p+=8;}
+	    if (fi->disk_num_start==0xFFFF && p+4<=e) {fi->disk_num_start=UNZ_GETLONG(p); p+=4;}
+	    return true;
+	  }
+	  pos+=len;
+	}
+	return false;
+}
+
+
+//  The central dir is all in memory by now (see unzOpenInternal), so this is
+//  just a matter of picking the fields out of it.
 int unzlocal_GetCurrentFileInfoInternal (unzFile file, unz_file_info *pfile_info,
    unz_file_info_internal *pfile_info_internal, char *szFileName,
    uLong fileNameBufferSize, void *extraField, uLong extraFieldBufferSize,
@@ -2993,72 +3315,49 @@ int unzlocal_GetCurrentFileInfoInternal (unzFile file, unz_file_info *pfile_info
 	unz_file_info file_info;
 	unz_file_info_internal file_info_internal;
 	int err=UNZ_OK;
-	uLong uMagic;
-	long lSeek=0;
 
 	if (file==NULL)
 		return UNZ_PARAMERROR;
 	s=(unz_s*)file;
-	if (lufseek(s->file,s->pos_in_central_dir+s->byte_before_the_zipfile,SEEK_SET)!=0)
-		err=UNZ_ERRNO;
-
+	if (s->central_dir==NULL)
+		return UNZ_PARAMERROR;
+	if (s->pos_in_central_dir<s->offset_central_dir)
+		return UNZ_ERRNO;
+	uLong64 pos = s->pos_in_central_dir-s->offset_central_dir;
+	if (pos+SIZECENTRALDIRITEM>s->size_central_dir)
+		return UNZ_ERRNO;
+	const unsigned char *p = s->central_dir+pos;
 
 	// we check the magic
-	if (err==UNZ_OK)
-		if (unzlocal_getLong(s->file,&uMagic) != UNZ_OK)
-			err=UNZ_ERRNO;
-		else if (uMagic!=0x02014b50)
-			err=UNZ_BADZIPFILE;
-
-	if (unzlocal_getShort(s->file,&file_info.version) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.version_needed) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.flag) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.compression_method) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getLong(s->file,&file_info.dosDate) != UNZ_OK)
-		err=UNZ_ERRNO;
+	if (UNZ_GETLONG(p)!=0x02014b50)
+		return UNZ_BADZIPFILE;
 
+	file_info.version = UNZ_GETSHORT(p+4);
+	file_info.version_needed = UNZ_GETSHORT(p+6);
+	file_info.flag = UNZ_GETSHORT(p+8);
+	file_info.compression_method = UNZ_GETSHORT(p+10);
+	file_info.dosDate = UNZ_GETLONG(p+12);
     unzlocal_DosDateToTmuDate(file_info.dosDate,&file_info.tmu_date);
+	file_info.crc = UNZ_GETLONG(p+16);
+	file_info.compressed_size = UNZ_GETLONG(p+20);
+	file_info.uncompressed_size = UNZ_GETLONG(p+24);
+	file_info.size_filename = UNZ_GETSHORT(p+28);
+	file_info.size_file_extra = UNZ_GETSHORT(p+30);
+	file_info.size_file_comment = UNZ_GETSHORT(p+32);
+	file_info.disk_num_start = UNZ_GETSHORT(p+34);
+	file_info.internal_fa = UNZ_GETSHORT(p+36);
+	file_info.external_fa = UNZ_GETLONG(p+38);
+	file_info_internal.offset_curfile = UNZ_GETLONG(p+42);
+
+	if (pos+SIZECENTRALDIRITEM+file_info.size_filename+file_info.size_file_extra+file_info.size_file_comment>s->size_central_dir)
+		return UNZ_BADZIPFILE;
+	const unsigned char *pname = p+SIZECENTRALDIRITEM;
+	const unsigned char *pextra = pname+file_info.size_filename;
+	const unsigned char *pcomment = pextra+file_info.size_file_extra;
 
-	if (unzlocal_getLong(s->file,&file_info.crc) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getLong(s->file,&file_info.compressed_size) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getLong(s->file,&file_info.uncompressed_size) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.size_filename) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.size_file_extra) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.size_file_comment) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.disk_num_start) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getShort(s->file,&file_info.internal_fa) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getLong(s->file,&file_info.external_fa) != UNZ_OK)
-		err=UNZ_ERRNO;
-
-	if (unzlocal_getLong(s->file,&file_info_internal.offset_curfile) != UNZ_OK)
-		err=UNZ_ERRNO;
+	unzlocal_GetZip64Extra(pextra,file_info.size_file_extra,&file_info,&file_info_internal.offset_curfile);
 
-	lSeek+=file_info.size_filename;
-	if ((err==UNZ_OK) && (szFileName!=NULL))
+	if (szFileName!=NULL)
 	{
 		uLong uSizeRead ;
 		if (file_info.size_filename<fileNameBufferSize)
@@ -3068,37 +3367,22 @@ int unzlocal_GetCurrentFileInfoInternal (unzFile file, unz_file_info *pfile_info
 		}
 		else
 			uSizeRead = fileNameBufferSize;
-
-		if ((file_info.size_filename>0) && (fileNameBufferSize>0))
-			if (lufread(szFileName,(uInt)uSizeRead,1,s->file)!=1)
-				err=UNZ_ERRNO;
-		lSeek -= uSizeRead;
+		if (uSizeRead>0)
+			memcpy(szFileName,pname,uSizeRead);
 	}
 
-
-	if ((err==UNZ_OK) && (extraField!=NULL))
+	if (extraField!=NULL)
 	{
 		uLong uSizeRead ;
 		if (file_info.size_file_extra<extraFieldBufferSize)
 			uSizeRead = file_info.size_file_extra;
 		else
 			uSizeRead = extraFieldBufferSize;
-
-		if (lSeek!=0)
-			if (lufseek(s->file,lSeek,SEEK_CUR)==0)
-				lSeek=0;
-			else
-				err=UNZ_ERRNO;
-		if ((file_info.size_file_extra>0) && (extraFieldBufferSize>0))
-			if (lufread(extraField,(uInt)uSizeRead,1,s->file)!=1)
-				err=UNZ_ERRNO;
-		lSeek += file_info.size_file_extra - uSizeRead;
+		if (uSizeRead>0)
+			memcpy(extraField,pextra,uSizeRead);
 	}
-	else
-		lSeek+=file_info.size_file_extra;
 
-
-	if ((err==UNZ_OK) && (szComment!=NULL))
+	if (szComment!=NULL)
 	{
 		uLong uSizeRead ;
 		if (file_info.size_file_comment<commentBufferSize)
@@ -3108,18 +3392,9 @@ int unzlocal_GetCurrentFileInfoInternal (unzFile file, unz_file_info *pfile_info
 		}
 		else
 			uSizeRead = commentBufferSize;
-
-		if (lSeek!=0)
-			if (lufseek(s->file,lSeek,SEEK_CUR)==0)
-				{} // unused lSeek=0;
-			else
-				err=UNZ_ERRNO;
-		if ((file_info.size_file_comment>0) && (commentBufferSize>0))
-			if (lufread(szComment,(uInt)uSizeRead,1,s->file)!=1)
-				err=UNZ_ERRNO;
-		//unused lSeek+=file_info.size_file_comment - uSizeRead;
+		if (uSizeRead>0)
+			memcpy(szComment,pcomment,uSizeRead);
 	}
-	else {} //unused lSeek+=file_info.size_file_comment;
 
 	if ((err==UNZ_OK) && (pfile_info!=NULL))
 		*pfile_info=file_info;
@@ -3188,6 +3463,26 @@ int unzGoToNextFile (unzFile file)
 }
 
 
+//  Set the current file of the zipfile to the file number num_file, straight
+//  from the index that was made of the central dir when it was opened.
+//  return UNZ_OK if there is no problem
+int unzGoToFile (unzFile file, uLong num_file)
+{
+	int err;
+	unz_s* s;
+	if (file==NULL) return UNZ_PARAMERROR;
+	s=(unz_s*)file;
+	if (s->file_pos==NULL || num_file>=s->gi.number_entry) return UNZ_PARAMERROR;
+	s->pos_in_central_dir=s->file_pos[num_file];
+	s->num_file=num_file;
+	err=unzlocal_GetCurrentFileInfoInternal(file,&s->cur_file_info,
+											 &s->cur_file_info_internal,
+											 NULL,0,NULL,0,NULL,0);
+	s->current_file_ok = (err == UNZ_OK);
+	return err;
+}
+
+
 //  Try locate the file szFileName in the zipfile.
 //  For the iCaseSensitivity signification, see unzStringFileNameCompare
 //  return value :
@@ -3200,7 +3495,7 @@ int unzLocateFile (unzFile file, const char *szFileName, int iCaseSensitivity)
 
 
 	uLong num_fileSaved;
-	uLong pos_in_central_dirSaved;
+	uLong64 pos_in_central_dirSaved;
 
 
 	if (file==NULL)
@@ -3241,7 +3536,7 @@ int unzLocateFile (unzFile file, const char *szFileName, int iCaseSensitivity)
 //  store in *piSizeVar the size of extra info in local header
 //        (filename and size of extra field data)
 int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
-  uLong *poffset_local_extrafield, uInt  *psize_local_extrafield)
+  uLong64 *poffset_local_extrafield, uInt  *psize_local_extrafield)
 {
 	uLong uMagic,uData,uFlags;
 	uLong size_filename;
@@ -3252,7 +3547,7 @@ int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
 	*poffset_local_extrafield = 0;
 	*psize_local_extrafield = 0;
 
-	if (lufseek(s->file,s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile,SEEK_SET)!=0)
+	if (lufseek(s->file,(__int64)(s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile),SEEK_SET)!=0)
 		return UNZ_ERRNO;
 
 
@@ -3275,7 +3570,8 @@ int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
 		err=UNZ_BADZIPFILE;
 
     if ((err==UNZ_OK) && (s->cur_file_info.compression_method!=0) &&
-                         (s->cur_file_info.compression_method!=Z_DEFLATED))
+                         (s->cur_file_info.compression_method!=Z_DEFLATED) &&
+                         (s->cur_file_info.compression_method!=Z_LZ4BLOCKS))
         err=UNZ_BADZIPFILE;
 
 	if (unzlocal_getLong(s->file,&uData) != UNZ_OK) // date/time
@@ -3287,16 +3583,17 @@ int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
 		                      ((uFlags & 8)==0))
 		err=UNZ_BADZIPFILE;
 
+	// (for zip64 the sizes are 0xFFFFFFFF here, and the real ones are in the extra field)
 	if (unzlocal_getLong(s->file,&uData) != UNZ_OK) // size compr
 		err=UNZ_ERRNO;
 	else if ((err==UNZ_OK) && (uData!=s->cur_file_info.compressed_size) &&
-							  ((uFlags & 8)==0))
+							  (uData!=0xFFFFFFFF) && ((uFlags & 8)==0))
 		err=UNZ_BADZIPFILE;
 
 	if (unzlocal_getLong(s->file,&uData) != UNZ_OK) // size uncompr
 		err=UNZ_ERRNO;
 	else if ((err==UNZ_OK) && (uData!=s->cur_file_info.uncompressed_size) &&
-							  ((uFlags & 8)==0))
+							  (uData!=0xFFFFFFFF) && ((uFlags & 8)==0))
 		err=UNZ_BADZIPFILE;
 
 
@@ -3309,7 +3606,7 @@ int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
 
 	if (unzlocal_getShort(s->file,&size_extra_field) != UNZ_OK)
 		err=UNZ_ERRNO;
-	*poffset_local_extrafield= s->cur_file_info_internal.offset_curfile +
+	*poffset_local_extrafield= s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile +
 									SIZEZIPLOCALHEADER + size_filename;
 	*psize_local_extrafield = (uInt)size_extra_field;
 
@@ -3322,6 +3619,116 @@ int unzlocal_CheckCurrentFileCoherencyHeader (unz_s *s,uInt *piSizeVar,
 
 
 
+//  For streaming: read the data descriptor that follows the data of a file
+//  whose local header had bit 3 set. That's where its crc and sizes really are.
+//  For zip64 the sizes are 8 bytes each instead of 4.
+int unzlocal_StreamReadDescriptor (unz_s *s)
+{
+	unsigned char buf[24];
+	uInt len = s->stream_zip64 ? 20 : 12;
+	if (lufread(buf,len,1,s->file)!=1)
+		return UNZ_ERRNO;
+	unsigned char *p=buf;
+	if (UNZ_GETLONG(buf)==0x08074b50)
+	{ // the signature is optional
+		if (lufread(buf+len,4,1,s->file)!=1)
+			return UNZ_ERRNO;
+		p+=4;
+	}
+	s->cur_file_info.crc=UNZ_GETLONG(p);
+	if (s->stream_zip64)
+	{ s->cur_file_info.compressed_size=UNZ_GETLONG64(p+4);
+	  s->cur_file_info.uncompressed_size=UNZ_GETLONG64(p+12);
+	}
+	else
+	{ s->cur_file_info.compressed_size=UNZ_GETLONG(p+4);
+	  s->cur_file_info.uncompressed_size=UNZ_GETLONG(p+8);
+	}
+	return UNZ_OK;
+}
+
+
+int unzOpenCurrentFile (unzFile file);
+int unzCloseCurrentFile (unzFile file);
+
+//  For streaming: go on to the next file by reading its local header, after
+//  first reading past whatever is left of the current one.
+//  return UNZ_OK if there is no problem
+//  return UNZ_END_OF_LIST_OF_FILE once the central dir has been reached.
+int unzlocal_StreamNextFile (unz_s *s)
+{
+	int err;
+	if (s->stream_state==UNZ_STREAM_END)
+		return UNZ_END_OF_LIST_OF_FILE;
+	if (s->pfile_in_zip_read!=NULL)
+		unzCloseCurrentFile((unzFile)s);
+	if (s->stream_state==UNZ_STREAM_HEADER)
+	{ if ((s->cur_file_info.flag & 8)==0)
+	  { if (lufskip(s->file,s->cur_file_info.compressed_size)!=0)
+	      {s->stream_state=UNZ_STREAM_END; return UNZ_ERRNO;}
+	  }
+	  else
+	  { // no size up-front, so the only way to the end of it is to inflate it
+	    err=unzOpenCurrentFile((unzFile)s);
+	    if (err==UNZ_OK) err=unzCloseCurrentFile((unzFile)s);
+	    if ((err!=UNZ_OK) && (err!=UNZ_CRCERROR))
+	      {s->stream_state=UNZ_STREAM_END; return err;}
+	  }
+	}
+	if (s->stream_state==UNZ_STREAM_END)
+		return UNZ_END_OF_LIST_OF_FILE;
+
+	unsigned char hdr[SIZEZIPLOCALHEADER];
+	if (lufread(hdr,4,1,s->file)!=1 || UNZ_GETLONG(hdr)!=0x04034b50)
+	{ // the central dir, the end of it, or the end of the data: no more files either way
+	  s->stream_state=UNZ_STREAM_END;
+	  s->current_file_ok=0;
+	  return UNZ_END_OF_LIST_OF_FILE;
+	}
+	if (lufread(hdr+4,SIZEZIPLOCALHEADER-4,1,s->file)!=1)
+	  {s->stream_state=UNZ_STREAM_END; return UNZ_ERRNO;}
+
+	unz_file_info *fi = &s->cur_file_info;
+	memset(fi,0,sizeof(unz_file_info));
+	fi->version_needed = UNZ_GETSHORT(hdr+4);
+	fi->flag = UNZ_GETSHORT(hdr+6);
+	fi->compression_method = UNZ_GETSHORT(hdr+8);
+	fi->dosDate = UNZ_GETLONG(hdr+10);
+	unzlocal_DosDateToTmuDate(fi->dosDate,&fi->tmu_date);
+	fi->crc = UNZ_GETLONG(hdr+14);
+	fi->compressed_size = UNZ_GETLONG(hdr+18);
+	fi->uncompressed_size = UNZ_GETLONG(hdr+22);
+	fi->size_filename = UNZ_GETSHORT(hdr+26);
+	fi->size_file_extra = UNZ_GETSHORT(hdr+28);
+
+	uLong uSizeRead = fi->size_filename<MAX_PATH ? fi->size_filename : MAX_PATH-1;
+	if (uSizeRead>0 && lufread(s->stream_filename,(uInt)uSizeRead,1,s->file)!=1)
+	  {s->stream_state=UNZ_STREAM_END; return UNZ_ERRNO;}
+	s->stream_filename[uSizeRead]=0;
+	if (fi->size_filename>uSizeRead && lufskip(s->file,fi->size_filename-uSizeRead)!=0)
+	  {s->stream_state=UNZ_STREAM_END; return UNZ_ERRNO;}
+
+	if (s->stream_extra!=NULL) zfree(s->stream_extra);
+	s->stream_extra = (char*)zmalloc(fi->size_file_extra+1);
+	if (s->stream_extra==NULL)
+	  {s->stream_state=UNZ_STREAM_END; return UNZ_INTERNALERROR;}
+	if (fi->size_file_extra>0 && lufread(s->stream_extra,(uInt)fi->size_file_extra,1,s->file)!=1)
+	  {s->stream_state=UNZ_STREAM_END; return UNZ_ERRNO;}
+	s->stream_zip64 = unzlocal_GetZip64Extra((const unsigned char*)s->stream_extra,fi->size_file_extra,fi,NULL);
+
+	// The attributes are only in the central dir, so make do with what the name says
+	bool isdir = uSizeRead>0 && (s->stream_filename[uSizeRead-1]=='/' || s->stream_filename[uSizeRead-1]=='\\');
+	fi->external_fa = isdir ? 0x41ED0010 : 0x81A40020; // drwxr-xr-x+directory, or -rw-r--r--+archive
+
+	s->num_file = (s->stream_state==UNZ_STREAM_NONE) ? 0 : s->num_file+1;
+	s->gi.number_entry = s->num_file+1; // as far as we know yet
+	s->current_file_ok = 1;
+	s->stream_state = UNZ_STREAM_HEADER;
+	return UNZ_OK;
+}
+
+
+
 //  Open for reading data the current file in the zipfile.
 //  If there is no error and the file is opened, the return value is UNZ_OK.
 int unzOpenCurrentFile (unzFile file)
@@ -3331,7 +3738,7 @@ int unzOpenCurrentFile (unzFile file)
 	uInt iSizeVar;
 	unz_s* s;
 	file_in_zip_read_info_s* pfile_in_zip_read_info;
-	uLong offset_local_extrafield;  // offset of the local extra field
+	uLong64 offset_local_extrafield;  // offset of the local extra field
 	uInt  size_local_extrafield;    // size of the local extra field
 
 	if (file==NULL)
@@ -3343,7 +3750,19 @@ int unzOpenCurrentFile (unzFile file)
     if (s->pfile_in_zip_read != NULL)
         unzCloseCurrentFile(file);
 
-	if (unzlocal_CheckCurrentFileCoherencyHeader(s,&iSizeVar,
+	if (s->streaming)
+	{ // the local header has already been read, and we're sitting at the start of the data
+	  if (s->stream_state!=UNZ_STREAM_HEADER)
+		return UNZ_PARAMERROR;
+	  if ((s->cur_file_info.compression_method!=0) && (s->cur_file_info.compression_method!=Z_DEFLATED) &&
+	      (s->cur_file_info.compression_method!=Z_LZ4BLOCKS))
+		return UNZ_BADZIPFILE;
+	  // without its size, there's no telling where a stored file ends
+	  if (((s->cur_file_info.flag & 8)!=0) && (s->cur_file_info.compression_method==0))
+		return UNZ_BADZIPFILE;
+	  iSizeVar=0; offset_local_extrafield=0; size_local_extrafield=0;
+	}
+	else if (unzlocal_CheckCurrentFileCoherencyHeader(s,&iSizeVar,
 				&offset_local_extrafield,&size_local_extrafield)!=UNZ_OK)
 		return UNZ_BADZIPFILE;
 
@@ -3363,11 +3782,15 @@ int unzOpenCurrentFile (unzFile file)
 	}
 
 	pfile_in_zip_read_info->stream_initialised=0;
+	pfile_in_zip_read_info->lz_in=NULL; pfile_in_zip_read_info->lz_insize=0;
+	pfile_in_zip_read_info->lz_out=NULL; pfile_in_zip_read_info->lz_outsize=0;
+	pfile_in_zip_read_info->lz_outpos=0; pfile_in_zip_read_info->lz_outlen=0;
+	pfile_in_zip_read_info->lz_done=false;
 
 	if ((s->cur_file_info.compression_method!=0) && (s->cur_file_info.compression_method!=Z_DEFLATED))
         { // unused err=UNZ_BADZIPFILE;
         }
-	Store = s->cur_file_info.compression_method==0;
+	Store = s->cur_file_info.compression_method==0 || s->cur_file_info.compression_method==Z_LZ4BLOCKS;
 
 	pfile_in_zip_read_info->crc32_wait=s->cur_file_info.crc;
 	pfile_in_zip_read_info->crc32=0;
@@ -3400,6 +3823,14 @@ int unzOpenCurrentFile (unzFile file)
             s->cur_file_info.uncompressed_size ;
 
 
+	pfile_in_zip_read_info->unknown_size = s->streaming && ((s->cur_file_info.flag & 8)!=0);
+	if (pfile_in_zip_read_info->unknown_size)
+	{ // they're in the data descriptor, after the data: inflate tells us where that is
+	  pfile_in_zip_read_info->rest_read_compressed = ~(uLong64)0;
+	  pfile_in_zip_read_info->rest_read_uncompressed = ~(uLong64)0;
+	}
+
+
 	pfile_in_zip_read_info->pos_in_zipfile =
             s->cur_file_info_internal.offset_curfile + SIZEZIPLOCALHEADER +
 			  iSizeVar;
@@ -3408,10 +3839,145 @@ int unzOpenCurrentFile (unzFile file)
 
 
 	s->pfile_in_zip_read = pfile_in_zip_read_info;
+	if (s->streaming) s->stream_state=UNZ_STREAM_DATA;
     return UNZ_OK;
 }
 
 
+#define UNZ_LZ4_MAXBLOCK (4*1024*1024) // the most that one Z_LZ4BLOCKS block may hold
+
+//  Decodes one LZ4 block of srclen bytes into exactly dstlen bytes. Every
+//  length and offset is checked, so a corrupt block can't write out of dst or
+//  read out of src. Short literal runs and matches are copied in fixed 16-byte
+//  pieces while there's room to spare at both ends, since that's quicker than
+//  a memcpy of the exact length, and whatever lands past the end is written
+//  over by what comes next. Matches that overlap what they copy (a repeating
+//  pattern) double their distance until they can be copied 8 bytes at a time.
+int unzlocal_LZ4Decode (const unsigned char *src, uLong srclen, unsigned char *dst, uLong dstlen)
+{ const unsigned char *ip=src, *iend=src+srclen;
+  unsigned char *op=dst, *oend=dst+dstlen;
+  for (;;)
+  { if (ip>=iend) return UNZ_BADZIPFILE;
+    unsigned int token=*ip++;
+    uLong lit=token>>4;
+    if (lit==15)
+    { unsigned int b;
+      do {if (ip>=iend) return UNZ_BADZIPFILE; b=*ip++; lit+=b;} while (b==255);
+    }
+    if (lit>(uLong)(iend-ip) || lit>(uLong)(oend-op)) return UNZ_BADZIPFILE;
+    if (lit<=16 && iend-ip>=16 && oend-op>=16) memcpy(op,ip,16);
+    else memcpy(op,ip,lit);
+    op+=lit; ip+=lit;
+    if (ip==iend) break; // the last sequence is only literals
+    if (iend-ip<2) return UNZ_BADZIPFILE;
+    uLong off = (uLong)ip[0] | ((uLong)ip[1]<<8); ip+=2;
+    if (off==0 || off>(uLong)(op-dst)) return UNZ_BADZIPFILE;
+    uLong ml=(token&15)+4;
+    if ((token&15)==15)
+    { unsigned int b;
+      do {if (ip>=iend) return UNZ_BADZIPFILE; b=*ip++; ml+=b;} while (b==255);
+    }
+    if (ml>(uLong)(oend-op)) return UNZ_BADZIPFILE;
+    const unsigned char *m=op-off;
+    if (off>=16 && ml<=32 && oend-op>=32) {memcpy(op,m,16); memcpy(op+16,m+16,16);}
+    else if (off>=ml) memcpy(op,m,ml);
+    else
+    { uLong d=off, i=0;
+      // the output repeats every off bytes, so any multiple of off will do as the distance
+      while (d<8 && i<ml)
+      { uLong n = d<ml-i ? d : ml-i;
+        memcpy(op+i,op+i-d,n); i+=n; d*=2;
+      }
+      for (; i+8<=ml; i+=8) memcpy(op+i,op+i-d,8);
+      for (; i<ml; i++) op[i]=op[i-d];
+    }
+    op+=ml;
+  }
+  return (op==oend) ? UNZ_OK : UNZ_BADZIPFILE;
+}
+
+//  For Z_LZ4BLOCKS: gets the next n bytes of the file's data. From a zipfile
+//  in memory that's just a pointer into it; otherwise they're read into lz_in.
+const unsigned char *unzlocal_LZ4Input (file_in_zip_read_info_s *p, uLong n)
+{ if (!p->unknown_size && n>p->rest_read_compressed) return NULL;
+  uLong64 pos = p->pos_in_zipfile+p->byte_before_the_zipfile;
+  const unsigned char *res;
+  if (!p->file->is_handle)
+  { if (pos>p->file->len || n>p->file->len-pos) return NULL;
+    res = (const unsigned char*)p->file->buf+pos;
+  }
+  else
+  { if (n>p->lz_insize)
+    { if (p->lz_in!=NULL) zfree(p->lz_in);
+      p->lz_insize=0; p->lz_in=(unsigned char*)zmalloc(n);
+      if (p->lz_in==NULL) return NULL;
+      p->lz_insize=n;
+    }
+    if (p->file->canseek && lufseek(p->file,(__int64)pos,SEEK_SET)!=0) return NULL;
+    if (lufread(p->lz_in,n,1,p->file)!=1) return NULL;
+    res = p->lz_in;
+  }
+  p->pos_in_zipfile+=n;
+  if (!p->unknown_size) p->rest_read_compressed-=n;
+  return res;
+}
+
+//  For Z_LZ4BLOCKS: reads up to len bytes of the current file. Blocks are
+//  decoded straight into buf when it has room for the whole block, and
+//  otherwise into lz_out, from where the rest of them gets handed out over
+//  the next calls.
+int unzlocal_ReadLZ4Blocks (file_in_zip_read_info_s *p, Byte *buf, uInt len)
+{ uInt iRead=0;
+  // rest_read_uncompressed goes down as each block is decoded, not as it's handed out
+  uLong64 left = p->rest_read_uncompressed + (p->lz_outlen-p->lz_outpos);
+  if (len>left) len=(uInt)left;
+  while (iRead<len)
+  { if (p->lz_outpos<p->lz_outlen)
+    { uLong n=p->lz_outlen-p->lz_outpos; if (n>len-iRead) n=len-iRead;
+      memcpy(buf+iRead,p->lz_out+p->lz_outpos,n);
+      p->lz_outpos+=n; iRead+=(uInt)n;
+      continue;
+    }
+    if (p->lz_done) break;
+    const unsigned char *hdr = unzlocal_LZ4Input(p,4);
+    if (hdr==NULL) return UNZ_ERRNO;
+    uLong c=UNZ_GETLONG(hdr);
+    if (c==0)
+    { p->lz_done=true;
+      if (p->unknown_size) {p->rest_read_compressed=0; p->rest_read_uncompressed=0;}
+      break;
+    }
+    hdr = unzlocal_LZ4Input(p,4);
+    if (hdr==NULL) return UNZ_ERRNO;
+    uLong u=UNZ_GETLONG(hdr);
+    bool stored = (c&0x80000000)!=0; c&=0x7FFFFFFF;
+    if (u==0 || u>UNZ_LZ4_MAXBLOCK || (stored && c!=u) || (!stored && c>u+u/255+16)) return UNZ_BADZIPFILE;
+    if (!p->unknown_size && u>p->rest_read_uncompressed) return UNZ_BADZIPFILE;
+    unsigned char *dst;
+    if (u<=len-iRead) dst=buf+iRead;
+    else
+    { if (u>p->lz_outsize)
+      { if (p->lz_out!=NULL) zfree(p->lz_out);
+        p->lz_outsize=0; p->lz_out=(unsigned char*)zmalloc(u);
+        if (p->lz_out==NULL) return UNZ_INTERNALERROR;
+        p->lz_outsize=u;
+      }
+      dst=p->lz_out;
+    }
+    const unsigned char *src = unzlocal_LZ4Input(p,c);
+    if (src==NULL) return UNZ_ERRNO;
+    if (stored) memcpy(dst,src,u);
+    else if (unzlocal_LZ4Decode(src,c,dst,u)!=UNZ_OK) return UNZ_BADZIPFILE;
+    p->crc32 = ucrc32(p->crc32,dst,(uInt)u);
+    if (!p->unknown_size) p->rest_read_uncompressed-=u;
+    p->stream.total_out += u;
+    if (dst==buf+iRead) iRead+=(uInt)u;
+    else {p->lz_outpos=0; p->lz_outlen=u;}
+  }
+  return (int)iRead;
+}
+
+
 //  Read bytes from the current file.
 //  buf contain buffer where data must be copied
 //  len the size of buf.
@@ -3430,6 +3996,8 @@ int unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
   if (pfile_in_zip_read_info==NULL) return UNZ_PARAMERROR;
   if ((pfile_in_zip_read_info->read_buffer == NULL)) return UNZ_END_OF_LIST_OF_FILE;
   if (len==0) return 0;
+  if (pfile_in_zip_read_info->compression_method==Z_LZ4BLOCKS)
+    return unzlocal_ReadLZ4Blocks(pfile_in_zip_read_info,(Byte*)buf,len);
 
   pfile_in_zip_read_info->stream.next_out = (Byte*)buf;
   pfile_in_zip_read_info->stream.avail_out = (uInt)len;
@@ -3443,10 +4011,17 @@ int unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
     { uInt uReadThis = UNZ_BUFSIZE;
       if (pfile_in_zip_read_info->rest_read_compressed<uReadThis) uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
       if (uReadThis == 0) return UNZ_EOF;
-      if (lufseek(pfile_in_zip_read_info->file, pfile_in_zip_read_info->pos_in_zipfile + pfile_in_zip_read_info->byte_before_the_zipfile,SEEK_SET)!=0) return UNZ_ERRNO;
-      if (lufread(pfile_in_zip_read_info->read_buffer,uReadThis,1,pfile_in_zip_read_info->file)!=1) return UNZ_ERRNO;
+      if (!pfile_in_zip_read_info->file->canseek)
+      { // a pipe: take what has arrived so far, rather than wait for a whole buffer of it
+        uReadThis = lufreadsome(pfile_in_zip_read_info->read_buffer,uReadThis,pfile_in_zip_read_info->file);
+        if (uReadThis == 0) return UNZ_ERRNO;
+      }
+      else
+      { if (lufseek(pfile_in_zip_read_info->file,(__int64)(pfile_in_zip_read_info->pos_in_zipfile + pfile_in_zip_read_info->byte_before_the_zipfile),SEEK_SET)!=0) return UNZ_ERRNO;
+        if (lufread(pfile_in_zip_read_info->read_buffer,uReadThis,1,pfile_in_zip_read_info->file)!=1) return UNZ_ERRNO;
+      }
       pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
-      pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+      if (!pfile_in_zip_read_info->unknown_size) pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
       pfile_in_zip_read_info->stream.next_in = (Byte*)pfile_in_zip_read_info->read_buffer;
       pfile_in_zip_read_info->stream.avail_in = (uInt)uReadThis;
     }
@@ -3484,7 +4059,16 @@ int unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
       pfile_in_zip_read_info->crc32 = ucrc32(pfile_in_zip_read_info->crc32,bufBefore,(uInt)(uOutThis));
       pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
       iRead += (uInt)(uTotalOutAfter - uTotalOutBefore);
-      if (err==Z_STREAM_END) return (iRead==0) ? UNZ_EOF : iRead;
+      if (err==Z_STREAM_END)
+      { if (s->streaming)
+        { // whatever inflate didn't need belongs to the data descriptor or the next header
+          lufunread(pfile_in_zip_read_info->stream.next_in,pfile_in_zip_read_info->stream.avail_in,pfile_in_zip_read_info->file);
+          pfile_in_zip_read_info->stream.avail_in=0;
+          pfile_in_zip_read_info->rest_read_compressed=0;
+          pfile_in_zip_read_info->rest_read_uncompressed=0;
+        }
+        return (iRead==0) ? UNZ_EOF : iRead;
+      }
       if (err!=Z_OK) break;
     }
   }
@@ -3567,7 +4151,7 @@ int unzGetLocalExtrafield (unzFile file,voidp buf,unsigned len)
 	if (read_now==0)
 		return 0;
 
-	if (lufseek(pfile_in_zip_read_info->file, pfile_in_zip_read_info->offset_local_extrafield +  pfile_in_zip_read_info->pos_local_extrafield,SEEK_SET)!=0)
+	if (lufseek(pfile_in_zip_read_info->file,(__int64)(pfile_in_zip_read_info->offset_local_extrafield +  pfile_in_zip_read_info->pos_local_extrafield),SEEK_SET)!=0)
 		return UNZ_ERRNO;
 
 	if (lufread(buf,(uInt)size_to_read,1,pfile_in_zip_read_info->file)!=1)
@@ -3592,8 +4176,30 @@ int unzCloseCurrentFile (unzFile file)
 	if (pfile_in_zip_read_info==NULL)
 		return UNZ_PARAMERROR;
 
+	if (s->streaming)
+	{ // the next local header is only to be found after the rest of this file
+	  if (pfile_in_zip_read_info->unknown_size)
+	  { char *buf = (char*)zmalloc(UNZ_BUFSIZE);
+	    int res = 0;
+	    if (buf==NULL) err=UNZ_INTERNALERROR;
+	    else
+	    { do res=unzReadCurrentFile(file,buf,UNZ_BUFSIZE); while (res>0);
+	      zfree(buf);
+	    }
+	    if (res<0) err=res;
+	  }
+	  else if (pfile_in_zip_read_info->rest_read_compressed>0)
+	  { if (lufskip(pfile_in_zip_read_info->file,pfile_in_zip_read_info->rest_read_compressed)!=0)
+	      err=UNZ_ERRNO;
+	  }
+	  if ((err==UNZ_OK) && ((s->cur_file_info.flag & 8)!=0))
+	  { err=unzlocal_StreamReadDescriptor(s);
+	    pfile_in_zip_read_info->crc32_wait=s->cur_file_info.crc;
+	  }
+	  s->stream_state = (err==UNZ_OK) ? UNZ_STREAM_DONE : UNZ_STREAM_END;
+	}
 
-	if (pfile_in_zip_read_info->rest_read_uncompressed == 0)
+	if ((err==UNZ_OK) && (pfile_in_zip_read_info->rest_read_uncompressed == 0))
 	{
 		if (pfile_in_zip_read_info->crc32 != pfile_in_zip_read_info->crc32_wait)
 			err=UNZ_CRCERROR;
@@ -3606,6 +4212,8 @@ int unzCloseCurrentFile (unzFile file)
           pfile_in_zip_read_info->read_buffer=0;
         }
 	pfile_in_zip_read_info->read_buffer = NULL;
+	if (pfile_in_zip_read_info->lz_in!=NULL) zfree(pfile_in_zip_read_info->lz_in);
+	if (pfile_in_zip_read_info->lz_out!=NULL) zfree(pfile_in_zip_read_info->lz_out);
 	if (pfile_in_zip_read_info->stream_initialised)
 		inflateEnd(&pfile_in_zip_read_info->stream);
 
@@ -3629,7 +4237,7 @@ int unzGetGlobalComment (unzFile file, char *szComment, uLong uSizeBuf)
   s=(unz_s*)file;
   uReadThis = uSizeBuf;
   if (uReadThis>s->gi.size_comment) uReadThis = s->gi.size_comment;
-  if (lufseek(s->file,s->central_pos+22,SEEK_SET)!=0) return UNZ_ERRNO;
+  if (lufseek(s->file,(__int64)(s->central_pos+22),SEEK_SET)!=0) return UNZ_ERRNO;
   if (uReadThis>0)
   { *szComment='\0';
     if (lufread(szComment,(uInt)uReadThis,1,s->file)!=1) return UNZ_ERRNO;
@@ -3647,8 +4255,33 @@ int unzReadCurrentFile (unzFile file, void *buf, unsigned len);
 int unzCloseCurrentFile (unzFile file);
 
 
+#ifndef _WIN32
+// A FILETIME is in 100ns units since 1601, and time_t in seconds since 1970
+FILETIME secs2filetime(long long secs)
+{ unsigned long long t = (unsigned long long)(secs+11644473600LL)*10000000ULL;
+  FILETIME ft; ft.dwLowDateTime=(DWORD)(t&0xFFFFFFFF); ft.dwHighDateTime=(DWORD)(t>>32);
+  return ft;
+}
+
+// The date and time as they are, with no time zone, like Windows' own
+void DosDateTimeToFileTime(unsigned short dosdate,unsigned short dostime,FILETIME *ft)
+{ struct tm tm; memset(&tm,0,sizeof(tm));
+  tm.tm_year = ((dosdate>>9)&0x7F)+80;
+  tm.tm_mon = ((dosdate>>5)&0x0F)-1;
+  tm.tm_mday = dosdate&0x1F;
+  tm.tm_hour = (dostime>>11)&0x1F;
+  tm.tm_min = (dostime>>5)&0x3F;
+  tm.tm_sec = (dostime&0x1F)*2;
+  *ft = secs2filetime((long long)timegm(&tm));
+}
+#endif
+
 FILETIME timet2filetime(const time_t timer)
-{ struct tm *tm = gmtime(&timer);
+{
+#ifndef _WIN32
+  return secs2filetime((long long)timer);
+#else
+  struct tm *tm = gmtime(&timer);
   SYSTEMTIME st;
   st.wYear = (WORD)(tm->tm_year+1900);
   st.wMonth = (WORD)(tm->tm_mon+1);
@@ -3660,68 +4293,15 @@ FILETIME timet2filetime(const time_t timer)
   FILETIME ft;
   SystemTimeToFileTime(&st,&ft);
   return ft;
+#endif
 }
 
 
 
-class TUnzip
-{ public:
-  TUnzip() : uf(0), currentfile(-1), czei(-1) {}
-
-  unzFile uf; int currentfile; ZIPENTRY cze; int czei;
-  char rootdir[MAX_PATH];
-
-  ZRESULT Open(void *z,unsigned int len,DWORD flags);
-  ZRESULT Get(int index,ZIPENTRY *ze);
-  ZRESULT Find(const char *name,bool ic,int *index,ZIPENTRY *ze);
-  ZRESULT Unzip(int index,void *dst,unsigned int len,DWORD flags);
-  ZRESULT Close();
-};
-
-
-ZRESULT TUnzip::Open(void *z,unsigned int len,DWORD flags)
-{ if (uf!=0 || currentfile!=-1) return ZR_NOTINITED;
-  GetCurrentDirectoryA(MAX_PATH,rootdir);
-  strcat(rootdir,"\\");
-  if (flags==ZIP_HANDLE)
-  { DWORD type = GetFileType(z);
-    if (type!=FILE_TYPE_DISK) return ZR_SEEK;
-  }
-  ZRESULT e; LUFILE *f = lufopen(z,len,flags,&e);
-  if (f==NULL) return e;
-  uf = unzOpenInternal(f);
-  return ZR_OK;
-}
-
-ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
-{ if (index<-1 || index>=(int)uf->gi.number_entry) return ZR_ARGS;
-  if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
-  if (index==czei && index!=-1) {memcpy(ze,&cze,sizeof(ZIPENTRY)); return ZR_OK;}
-  if (index==-1)
-  { ze->index = uf->gi.number_entry;
-    ze->name[0]=0;
-    ze->attr=0;
-    ze->atime.dwLowDateTime=0; ze->atime.dwHighDateTime=0;
-    ze->ctime.dwLowDateTime=0; ze->ctime.dwHighDateTime=0;
-    ze->mtime.dwLowDateTime=0; ze->mtime.dwHighDateTime=0;
-    ze->comp_size=0;
-    ze->unc_size=0;
-    return ZR_OK;
-  }
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
-  unz_file_info ufi; char fn[MAX_PATH];
-  unzGetCurrentFileInfo(uf,&ufi,fn,MAX_PATH,NULL,0,NULL,0);
-  // now get the extra header. We do this ourselves, instead of
-  // calling unzOpenCurrentFile &c., to avoid allocating more than necessary.
-  unsigned int extralen,iSizeVar; unsigned long offset;
-  int res = unzlocal_CheckCurrentFileCoherencyHeader(uf,&iSizeVar,&offset,&extralen);
-  if (res!=UNZ_OK) return ZR_CORRUPT;
-  if (lufseek(uf->file,offset,SEEK_SET)!=0) return ZR_READ;
-  char *extra = new char[extralen];
-  if (lufread(extra,1,(uInt)extralen,uf->file)!=extralen) {delete[] extra; return ZR_READ;}
-  //
-  ze->index=uf->num_file;
+// Fills in a ZIPENTRY from what the central dir (or, for a pipe, the local
+// header) says about an item, and from its local extra field.
+void SetZipEntry(ZIPENTRY *ze,uLong index,const char *fn,const unz_file_info &ufi,const char *extra,unsigned int extralen)
+{ ze->index=index;
   strcpy(ze->name,fn);
   // zip has an 'attribute' 32bit value. Its lower half is windows stuff
   // its upper half is standard unix stat.st_mode
@@ -3744,8 +4324,8 @@ ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
   ze->comp_size = ufi.compressed_size;
   ze->unc_size = ufi.uncompressed_size;
   //
-  WORD dostime = (WORD)(ufi.dosDate&0xFFFF);
-  WORD dosdate = (WORD)((ufi.dosDate>>16)&0xFFFF);
+  unsigned short dostime = (unsigned short)(ufi.dosDate&0xFFFF);
+  unsigned short dosdate = (unsigned short)((ufi.dosDate>>16)&0xFFFF);
   FILETIME ft;
   DosDateTimeToFileTime(dosdate,dostime,&ft);
   ze->atime=ft; ze->ctime=ft; ze->mtime=ft;
@@ -3754,38 +4334,161 @@ ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
   unsigned int epos=0;
   while (epos+4<extralen)
   { char etype[3]; etype[0]=extra[epos+0]; etype[1]=extra[epos+1]; etype[2]=0;
-    int size = extra[epos+2];
+    // the size is 16 bits: zip's own writer pads stored items out with extra fields of up to a page
+    unsigned int size = (unsigned char)extra[epos+2] | ((unsigned int)(unsigned char)extra[epos+3]<<8);
     if (strcmp(etype,"UT")!=0) {epos += 4+size; continue;}
+    if (epos+4+size>extralen || size<1) break;
     int flags = extra[epos+4];
     bool hasmtime = (flags&1)!=0;
     bool hasatime = (flags&2)!=0;
     bool hasctime = (flags&4)!=0;
     epos+=5;
+    // each time is 4 bytes, whatever size time_t is
     if (hasmtime)
-    { time_t mtime = *(time_t*)(extra+epos); epos+=4;
+    { time_t mtime = (time_t)(int)UNZ_GETLONG((const unsigned char*)extra+epos); epos+=4;
       ze->mtime = timet2filetime(mtime);
     }
     if (hasatime)
-    { time_t atime = *(time_t*)(extra+epos); epos+=4;
+    { time_t atime = (time_t)(int)UNZ_GETLONG((const unsigned char*)extra+epos); epos+=4;
       ze->atime = timet2filetime(atime);
     }
     if (hasctime)
-    { time_t ctime = *(time_t*)(extra+epos);
+    { time_t ctime = (time_t)(int)UNZ_GETLONG((const unsigned char*)extra+epos);
       ze->ctime = timet2filetime(ctime);
     }
     break;
   }
+}
+
+class TUnzip
+{ public:
+  TUnzip() : uf(0), currentfile(-1), czei(-1), srcz(0), srclen(0), srcflags(0) {}
+
+  unzFile uf; int currentfile; ZIPENTRY cze; int czei;
+  char rootdir[MAX_PATH];
+  // how we were opened, so that UnzipAll's workers can open their own copies
+  void *srcz; unsigned int srclen; DWORD srcflags; char srcname[MAX_PATH];
+
+  ZRESULT Open(void *z,unsigned int len,DWORD flags);
+  ZRESULT Get(int index,ZIPENTRY *ze);
+  ZRESULT GetStream(int index,ZIPENTRY *ze);
+  ZRESULT GoTo(int index);
+  ZRESULT Find(const char *name,bool ic,int *index,ZIPENTRY *ze);
+  ZRESULT Unzip(int index,void *dst,unsigned int len,DWORD flags);
+  ZRESULT UnzipAll(const char *dir,int nthreads);
+  ZRESULT Close();
+};
+
+
+ZRESULT TUnzip::Open(void *z,unsigned int len,DWORD flags)
+{ if (uf!=0 || currentfile!=-1) return ZR_NOTINITED;
+#ifdef _WIN32
+  GetCurrentDirectoryA(MAX_PATH,rootdir);
+  strcat(rootdir,"\\");
+#else
+  if (getcwd(rootdir,MAX_PATH-1)==NULL) rootdir[0]=0;
+  strcat(rootdir,"/");
+#endif
+  ZRESULT e; LUFILE *f = lufopen(z,len,flags,&e);
+  if (f==NULL) return e;
+  // something we can't seek in, like a pipe, gets read front to back from the local headers
+  if (f->canseek) uf = unzOpenInternal(f);
+  else uf = unzOpenStreamInternal(f);
+  if (uf==0) return ZR_CORRUPT;
+  srcz=z; srclen=len; srcflags=flags;
+  if (flags==ZIP_FILENAME) {strncpy(srcname,(const char*)z,MAX_PATH-1); srcname[MAX_PATH-1]=0; srcz=srcname;}
+  return ZR_OK;
+}
+
+ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
+{ if (uf->streaming) return GetStream(index,ze);
+  if (index<-1 || index>=(int)uf->gi.number_entry) return ZR_ARGS;
+  if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
+  if (index==czei && index!=-1) {memcpy(ze,&cze,sizeof(ZIPENTRY)); return ZR_OK;}
+  if (index==-1)
+  { ze->index = uf->gi.number_entry;
+    ze->name[0]=0;
+    ze->attr=0;
+    ze->atime.dwLowDateTime=0; ze->atime.dwHighDateTime=0;
+    ze->ctime.dwLowDateTime=0; ze->ctime.dwHighDateTime=0;
+    ze->mtime.dwLowDateTime=0; ze->mtime.dwHighDateTime=0;
+    ze->comp_size=0;
+    ze->unc_size=0;
+    return ZR_OK;
+  }
+  if (unzGoToFile(uf,index)!=UNZ_OK) return ZR_CORRUPT;
+  unz_file_info ufi; char fn[MAX_PATH];
+  unzGetCurrentFileInfo(uf,&ufi,fn,MAX_PATH,NULL,0,NULL,0);
+  // now get the extra header. We do this ourselves, instead of
+  // calling unzOpenCurrentFile &c., to avoid allocating more than necessary.
+  unsigned int extralen,iSizeVar; uLong64 offset;
+  int res = unzlocal_CheckCurrentFileCoherencyHeader(uf,&iSizeVar,&offset,&extralen);
+  if (res!=UNZ_OK) return ZR_CORRUPT;
+  if (lufseek(uf->file,(__int64)offset,SEEK_SET)!=0) return ZR_READ;
+  char *extra = new char[extralen];
+  if (lufread(extra,1,(uInt)extralen,uf->file)!=extralen) {delete[] extra; return ZR_READ;}
   //
+  SetZipEntry(ze,uf->num_file,fn,ufi,extra,extralen);
   if (extra!=0) delete[] extra;
   memcpy(&cze,ze,sizeof(ZIPENTRY)); czei=index;
   return ZR_OK;
 }
 
+ZRESULT TUnzip::GetStream(int index,ZIPENTRY *ze)
+{ // Through a pipe, the items can only be got at in increasing order,
+  // and how many of them there are isn't known until the end.
+  if (index<0) return ZR_SEEK;
+  if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
+  int cur = (uf->stream_state==UNZ_STREAM_NONE) ? -1 : (int)uf->num_file;
+  if (index<cur) return ZR_SEEK;
+  while (cur<index)
+  { int err = unzlocal_StreamNextFile(uf);
+    if (err==UNZ_END_OF_LIST_OF_FILE) return ZR_ARGS;
+    if (err!=UNZ_OK) return ZR_CORRUPT;
+    cur++;
+  }
+  if (uf->stream_state==UNZ_STREAM_END) return ZR_ARGS;
+  // The entry is made afresh every time, since the sizes may only
+  // have become known now that the item has been unzipped.
+  SetZipEntry(ze,uf->num_file,uf->stream_filename,uf->cur_file_info,uf->stream_extra,uf->cur_file_info.size_file_extra);
+  if ((uf->cur_file_info.flag&8)!=0 && uf->stream_state!=UNZ_STREAM_DONE) {ze->comp_size=-1; ze->unc_size=-1;}
+  memcpy(&cze,ze,sizeof(ZIPENTRY)); czei=index;
+  return ZR_OK;
+}
+
+ZRESULT TUnzip::GoTo(int index)
+{ if (uf->streaming)
+  { ZIPENTRY ze; ZRESULT zres = GetStream(index,&ze);
+    if (zres!=ZR_OK) return zres;
+    if (uf->stream_state!=UNZ_STREAM_HEADER) return ZR_PARTIALUNZ; // it can only be read the once
+    return ZR_OK;
+  }
+  if (index<0 || index>=(int)uf->gi.number_entry) return ZR_ARGS;
+  if (unzGoToFile(uf,index)!=UNZ_OK) return ZR_CORRUPT;
+  return ZR_OK;
+}
+
 ZRESULT TUnzip::Find(const char *name,bool ic,int *index,ZIPENTRY *ze)
-{ int res = unzLocateFile(uf,name,ic?CASE_INSENSITIVE:CASE_SENSITIVE);
+{ if (uf->streaming)
+  { // only the current item and those after it can still be got at
+    int i = (uf->stream_state==UNZ_STREAM_NONE) ? 0 : (int)uf->num_file;
+    for (;;i++)
+    { ZIPENTRY zei; ZRESULT zres = GetStream(i,&zei);
+      if (zres!=ZR_OK) break;
+      if (unzStringFileNameCompare(zei.name,name,ic?CASE_INSENSITIVE:CASE_SENSITIVE)==0)
+      { if (index!=NULL) *index=i;
+        if (ze!=NULL) memcpy(ze,&zei,sizeof(ZIPENTRY));
+        return ZR_OK;
+      }
+    }
+    if (index!=0) *index=-1;
+    if (ze!=NULL) {memset(ze,0,sizeof(ZIPENTRY)); ze->index=-1;}
+    return ZR_NOTFOUND;
+  }
+  int res = unzLocateFile(uf,name,ic?CASE_INSENSITIVE:CASE_SENSITIVE);
   if (res!=UNZ_OK)
   { if (index!=0) *index=-1;
-    if (ze!=NULL) {ZeroMemory(ze,sizeof(ZIPENTRY)); ze->index=-1;}
+    if (ze!=NULL) {memset(ze,0,sizeof(ZIPENTRY)); ze->index=-1;}
     return ZR_NOTFOUND;
   }
   if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
@@ -3798,30 +4501,31 @@ ZRESULT TUnzip::Find(const char *name,bool ic,int *index,ZIPENTRY *ze)
   return ZR_OK;
 }
 
+#ifdef _WIN32
 void EnsureDirectory(const char *rootdir, const char *dir)
 { if (*dir==0) return;
   const char *lastslash=dir, *c=lastslash;
   while (*c!=0) {if (*c=='/' || *c=='\\') lastslash=c; c++;}
-  const char *name=lastslash;
   if (lastslash!=dir)
   { char tmp[MAX_PATH]; memcpy(tmp,dir,lastslash-dir);
     tmp[lastslash-dir]=0;
     EnsureDirectory(rootdir,tmp);
-    name++;
   }
-  char cd[MAX_PATH]; strcpy(cd,rootdir); strcat(cd,name);
+  // the whole of dir, not just its last component, since the parents are relative to rootdir too
+  char cd[MAX_PATH]; strcpy(cd,rootdir); strcat(cd,dir);
   CreateDirectoryA(cd,NULL);
 }
+#endif
 
 ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
 { if (flags!=ZIP_MEMORY && flags!=ZIP_FILENAME && flags!=ZIP_HANDLE) return ZR_ARGS;
   if (flags==ZIP_MEMORY)
   { if (index!=currentfile)
     { if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
-      if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-      if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-      while ((int)uf->num_file<index) unzGoToNextFile(uf);
-      unzOpenCurrentFile(uf); currentfile=index;
+      ZRESULT zres = GoTo(index);
+      if (zres!=ZR_OK) return zres;
+      if (unzOpenCurrentFile(uf)!=UNZ_OK) return ZR_CORRUPT;
+      currentfile=index;
     }
     int res = unzReadCurrentFile(uf,dst,len);
     if (res>0) return ZR_MORE;
@@ -3830,10 +4534,12 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
     else return ZR_FLATE;
   }
   // otherwise we're writing to a handle or a file
+#ifndef _WIN32
+  return ZR_ARGS;
+#else
   if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
-  if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
+  ZRESULT zres = GoTo(index);
+  if (zres!=ZR_OK) return zres;
   ZIPENTRY ze; Get(index,&ze);
   // zipentry=directory is handled specially
   if ((ze.attr&FILE_ATTRIBUTE_DIRECTORY)!=0)
@@ -3859,7 +4565,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
     h = CreateFileA((const char*)dst,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,ze.attr,NULL);
   }
   if (h==INVALID_HANDLE_VALUE) return ZR_NOFILE;
-  unzOpenCurrentFile(uf);
+  if (unzOpenCurrentFile(uf)!=UNZ_OK) {if (flags!=ZIP_HANDLE) CloseHandle(h); return ZR_CORRUPT;}
   char buf[16384]; bool haderr=false;
   for (;;)
   { int res = unzReadCurrentFile(uf,buf,16384);
@@ -3875,8 +4581,236 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
   unzCloseCurrentFile(uf);
   if (haderr) return ZR_WRITE;
   return ZR_OK;
+#endif
+}
+
+
+#ifdef _WIN32
+// UnzipAll extracts every item in one go. The central directory is walked once
+// to build a table of the items, the whole directory tree is created from that
+// table before any file is written, and the files are then shared out between
+// a pool of worker threads. Each worker opens its own unzFile, since the read
+// position lives in the LUFILE, preallocates each output file to its final size
+// and writes it through a large buffer instead of the 16k one used by Unzip.
+
+#define UNZ_WRITEBUFSIZE (1024*1024)
+
+typedef struct
+{ int index;                 // index of the item within the zip
+  uLong64 unc_size;          // uncompressed size, for preallocation and ordering
+  bool isdir;
+  char name[MAX_PATH];       // with all slashes turned into backslashes
+} TUnzipAllItem;
+
+typedef struct
+{ const char *name; int len; // a directory: the first len chars of name
+} TUnzipAllDir;
+
+typedef struct
+{ TUnzip *owner;             // the TUnzip that UnzipAll was called on
+  const char *basedir;       // where to unzip to. Ends in a backslash.
+  TUnzipAllItem *items; int numitems;
+  bool ownfile;              // whether each worker needs to open its own unzFile
+  volatile LONG next;        // the next item to be taken by a worker
+  volatile LONG err;         // the first error that a worker ran into
+} TUnzipAllJob;
+
+
+// Whether an item name (with its slashes already turned into backslashes)
+// stays inside the directory it gets unzipped to.
+bool IsRelativeZipName(const char *name)
+{ if (name[0]=='\\' || (name[0]!=0 && name[1]==':')) return false;
+  if (strcmp(name,"..")==0 || strncmp(name,"..\\",3)==0 || strstr(name,"\\..\\")!=0) return false;
+  size_t n=strlen(name);
+  if (n>=3 && strcmp(name+n-3,"\\..")==0) return false;
+  return true;
+}
+
+int CompareUnzipAllDirs(const void *a,const void *b)
+{ const TUnzipAllDir *da=(const TUnzipAllDir*)a, *db=(const TUnzipAllDir*)b;
+  int n = da->len<db->len ? da->len : db->len;
+  int res = strncmp(da->name,db->name,n);
+  if (res!=0) return res;
+  return da->len-db->len; // so that parents always come before their children
 }
 
+int CompareUnzipAllItems(const void *a,const void *b)
+{ const TUnzipAllItem *ia=(const TUnzipAllItem*)a, *ib=(const TUnzipAllItem*)b;
+  // biggest first, so that the workers all finish at about the same time
+  if (ia->unc_size!=ib->unc_size) return ia->unc_size>ib->unc_size ? -1 : 1;
+  return ia->index-ib->index;
+}
+
+ZRESULT UnzipAllOne(TUnzip *unz,const TUnzipAllItem *it,const char *basedir,char *buf)
+{ if (unz->currentfile!=-1) unzCloseCurrentFile(unz->uf); unz->currentfile=-1;
+  if (unzGoToFile(unz->uf,it->index)!=UNZ_OK) return ZR_CORRUPT;
+  ZIPENTRY ze; ZRESULT zres = unz->Get(it->index,&ze);
+  if (zres!=ZR_OK) return zres;
+  char fn[MAX_PATH];
+  if (strlen(basedir)+strlen(it->name)>=MAX_PATH) return ZR_NOFILE;
+  strcpy(fn,basedir); strcat(fn,it->name);
+  // ze.attr always has FILE_ATTRIBUTE_NORMAL in it, which CreateFile only takes on its own, so just the ones a file
+  // can be created with
+  DWORD attr = ze.attr&(FILE_ATTRIBUTE_READONLY|FILE_ATTRIBUTE_HIDDEN|FILE_ATTRIBUTE_SYSTEM|FILE_ATTRIBUTE_ARCHIVE);
+  if (attr==0) attr=FILE_ATTRIBUTE_NORMAL;
+  HANDLE h = CreateFileA(fn,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,attr|FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+  if (h==INVALID_HANDLE_VALUE) return ZR_NOFILE;
+  // preallocate, so that the file system can lay the file out in one go
+  if (it->unc_size>0)
+  { LONG hi=(LONG)(it->unc_size>>32);
+    if (SetFilePointer(h,(LONG)(it->unc_size&0xFFFFFFFF),&hi,FILE_BEGIN)!=INVALID_SET_FILE_POINTER || GetLastError()==NO_ERROR) SetEndOfFile(h);
+    hi=0; SetFilePointer(h,0,&hi,FILE_BEGIN);
+  }
+  bool haderr=false;
+  if (unzOpenCurrentFile(unz->uf)!=UNZ_OK) haderr=true;
+  while (!haderr)
+  { int res = unzReadCurrentFile(unz->uf,buf,UNZ_WRITEBUFSIZE);
+    if (res<0) {haderr=true; break;}
+    if (res==0) break;
+    DWORD writ; BOOL bres = WriteFile(h,buf,res,&writ,NULL);
+    if (!bres || writ!=(DWORD)res) {haderr=true; break;}
+  }
+  SetEndOfFile(h); // in case the item turned out shorter than it said
+  if (!haderr) SetFileTime(h,&ze.ctime,&ze.atime,&ze.mtime);
+  CloseHandle(h);
+  unzCloseCurrentFile(unz->uf);
+  if (haderr) return ZR_WRITE;
+  return ZR_OK;
+}
+
+DWORD WINAPI UnzipAllWorker(LPVOID param)
+{ TUnzipAllJob *job = (TUnzipAllJob*)param;
+  TUnzip *unz = job->owner;
+  if (job->ownfile)
+  { unz = new TUnzip();
+    ZRESULT zres = unz->Open(job->owner->srcz,job->owner->srclen,job->owner->srcflags);
+    if (zres!=ZR_OK) {InterlockedCompareExchange(&job->err,(LONG)zres,ZR_OK); delete unz; return 0;}
+  }
+  char *buf = (char*)zmalloc(UNZ_WRITEBUFSIZE);
+  if (buf==NULL) InterlockedCompareExchange(&job->err,(LONG)ZR_NOALLOC,ZR_OK);
+  else
+  { for (;;)
+    { LONG i = InterlockedIncrement(&job->next)-1;
+      if (i>=job->numitems) break;
+      ZRESULT zres = UnzipAllOne(unz,&job->items[i],job->basedir,buf);
+      if (zres!=ZR_OK) InterlockedCompareExchange(&job->err,(LONG)zres,ZR_OK);
+    }
+    zfree(buf);
+  }
+  if (job->ownfile) {unz->Close(); delete unz;}
+  return 0;
+}
+
+ZRESULT TUnzip::UnzipAll(const char *dir,int nthreads)
+{ if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
+  char basedir[MAX_PATH];
+  if (dir==NULL || *dir==0) strcpy(basedir,rootdir);
+  else
+  { bool isabsolute = (dir[0]=='/' || dir[0]=='\\' || dir[1]==':');
+    size_t dlen=strlen(dir);
+    if ((isabsolute?0:strlen(rootdir))+dlen+2>MAX_PATH) return ZR_ARGS;
+    if (isabsolute) strcpy(basedir,dir); else {strcpy(basedir,rootdir); strcat(basedir,dir);}
+    if (dir[dlen-1]!='/' && dir[dlen-1]!='\\') strcat(basedir,"\\");
+    EnsureDirectory(isabsolute?"":rootdir,isabsolute?basedir:dir);
+  }
+  //
+  if (uf->streaming)
+  { // Through a pipe there's no central directory to plan from, and the
+    // items can only be read one at a time, in order, as they arrive.
+    ZRESULT zres=ZR_OK;
+    for (int i=0; ; i++)
+    { ZIPENTRY ze; ZRESULT r = GetStream(i,&ze);
+      if (r==ZR_ARGS) break;
+      if (r!=ZR_OK) return r;
+      for (char *c=ze.name; *c!=0; c++) if (*c=='/') *c='\\';
+      if (!IsRelativeZipName(ze.name) || strlen(basedir)+strlen(ze.name)>=MAX_PATH) {zres=ZR_ARGS; continue;}
+      if ((ze.attr&FILE_ATTRIBUTE_DIRECTORY)!=0) {EnsureDirectory(basedir,ze.name); continue;}
+      char *lastslash = strrchr(ze.name,'\\');
+      if (lastslash!=NULL) {*lastslash=0; EnsureDirectory(basedir,ze.name); *lastslash='\\';}
+      char fn[MAX_PATH]; strcpy(fn,basedir); strcat(fn,ze.name);
+      r = Unzip(i,fn,0,ZIP_FILENAME);
+      if (r!=ZR_OK && zres==ZR_OK) zres=r;
+    }
+    return zres;
+  }
+  //
+  // One walk of the central directory gets us everything we need about every item
+  int numitems = (int)uf->gi.number_entry;
+  TUnzipAllItem *items = new TUnzipAllItem[numitems>0?numitems:1];
+  ZRESULT zres=ZR_OK;
+  int err = unzGoToFirstFile(uf);
+  for (int i=0; i<numitems; i++)
+  { if (err!=UNZ_OK) {zres=ZR_CORRUPT; break;}
+    TUnzipAllItem *it = &items[i];
+    unz_file_info ufi;
+    if (unzGetCurrentFileInfo(uf,&ufi,it->name,MAX_PATH,NULL,0,NULL,0)!=UNZ_OK) {zres=ZR_CORRUPT; break;}
+    it->index=(int)uf->num_file;
+    it->unc_size=ufi.uncompressed_size;
+    it->isdir = (ufi.external_fa&0x40000010)!=0;
+    for (char *c=it->name; *c!=0; c++) if (*c=='/') *c='\\';
+    size_t n=strlen(it->name);
+    if (n>0 && it->name[n-1]=='\\') {it->isdir=true; it->name[n-1]=0;}
+    if (!IsRelativeZipName(it->name)) {zres=ZR_ARGS; it->isdir=true; it->name[0]=0;} // refuse to escape basedir
+    if (i+1<numitems) err = unzGoToNextFile(uf);
+  }
+  if (zres==ZR_CORRUPT) {delete[] items; return zres;}
+  //
+  // Every directory that's needed, each created once: parents sort before their children
+  int numdirs=0;
+  for (int i=0; i<numitems; i++)
+  { for (const char *c=items[i].name; *c!=0; c++) if (*c=='\\') numdirs++;
+    if (items[i].isdir && items[i].name[0]!=0) numdirs++;
+  }
+  TUnzipAllDir *dirs = new TUnzipAllDir[numdirs>0?numdirs:1];
+  numdirs=0;
+  for (int i=0; i<numitems; i++)
+  { const char *name=items[i].name;
+    for (const char *c=name; *c!=0; c++) if (*c=='\\') {dirs[numdirs].name=name; dirs[numdirs].len=(int)(c-name); numdirs++;}
+    if (items[i].isdir && name[0]!=0) {dirs[numdirs].name=name; dirs[numdirs].len=(int)strlen(name); numdirs++;}
+  }
+  qsort(dirs,numdirs,sizeof(TUnzipAllDir),CompareUnzipAllDirs);
+  size_t blen=strlen(basedir);
+  for (int i=0; i<numdirs; i++)
+  { if (i>0 && CompareUnzipAllDirs(&dirs[i-1],&dirs[i])==0) continue;
+    if (dirs[i].len==0 || blen+dirs[i].len>=MAX_PATH) continue;
+    char cd[MAX_PATH]; memcpy(cd,basedir,blen); memcpy(cd+blen,dirs[i].name,dirs[i].len); cd[blen+dirs[i].len]=0;
+    CreateDirectoryA(cd,NULL);
+  }
+  delete[] dirs;
+  //
+  // Now only the files are left to do. Share them out, biggest first.
+  int numfiles=0;
+  for (int i=0; i<numitems; i++) if (!items[i].isdir) items[numfiles++]=items[i];
+  qsort(items,numfiles,sizeof(TUnzipAllItem),CompareUnzipAllItems);
+  if (nthreads<=0) {SYSTEM_INFO si; GetSystemInfo(&si); nthreads=(int)si.dwNumberOfProcessors;}
+  if (srcflags==ZIP_HANDLE) nthreads=1; // a duplicated handle shares its file pointer, so no parallelism
+  if (nthreads>MAXIMUM_WAIT_OBJECTS) nthreads=MAXIMUM_WAIT_OBJECTS;
+  if (nthreads>numfiles) nthreads=numfiles;
+  TUnzipAllJob job;
+  job.owner=this; job.basedir=basedir; job.items=items; job.numitems=numfiles;
+  job.ownfile = nthreads>1; job.next=0; job.err=(LONG)zres;
+  if (nthreads<=1) UnzipAllWorker(&job);
+  else
+  { HANDLE threads[MAXIMUM_WAIT_OBJECTS]; int numthreads=0;
+    for (int i=0; i<nthreads; i++)
+    { DWORD tid; HANDLE ht = CreateThread(NULL,0,UnzipAllWorker,&job,0,&tid);
+      if (ht!=NULL) threads[numthreads++]=ht;
+    }
+    if (numthreads==0) {job.ownfile=false; UnzipAllWorker(&job);}
+    else
+    { WaitForMultipleObjects(numthreads,threads,TRUE,INFINITE);
+      for (int i=0; i<numthreads; i++) CloseHandle(threads[i]);
+    }
+  }
+  delete[] items;
+  return (ZRESULT)job.err;
+}
+#else
+ZRESULT TUnzip::UnzipAll(const char *,int)
+{ return ZR_ARGS;
+}
+#endif
+
 ZRESULT TUnzip::Close()
 { if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
   if (uf!=0) unzClose(uf); uf=0;
@@ -3963,6 +4897,15 @@ ZRESULT UnzipItem(HZIP hz, int index, void *dst, unsigned int len, DWORD flags)
   return lasterrorU;
 }
 
+ZRESULT UnzipAllItems(HZIP hz, const char *dir, int nthreads)
+{ if (hz==0) {lasterrorU=ZR_ARGS;return ZR_ARGS;}
+  TUnzipHandleData *han = (TUnzipHandleData*)hz;
+  if (han->flag!=1) {lasterrorU=ZR_ZMODE;return ZR_ZMODE;}
+  TUnzip *unz = han->unz;
+  lasterrorU = unz->UnzipAll(dir,nthreads);
+  return lasterrorU;
+}
+
 ZRESULT CloseZipU(HZIP hz)
 { if (hz==0) {lasterrorU=ZR_ARGS;return ZR_ARGS;}
   TUnzipHandleData *han = (TUnzipHandleData*)hz;
@@ -6,7 +6,25 @@
 // at www.gzip.org/zlib, by Jean-Loup Gailly and Mark Adler. The original
 // copyright notice may be found in unzip.cpp. THe repackaging was done
 // by Lucian Wischik to simplify its use in Windows/C++.
-
+// It also builds on Linux, for the tests, where a ZIP_HANDLE is a file
+// descriptor (cast to void*), and items can only be unzipped to memory.
+
+#ifndef _WIN32
+// just enough of windows.h for this header, for when it isn't there
+typedef unsigned long DWORD;
+#ifndef DECLARE_HANDLE
+#define DECLARE_HANDLE(name) struct name##__ { int unused; }; typedef struct name##__ *name
+#endif
+#define __int64 long long
+#define MAX_PATH 260
+typedef struct {DWORD dwLowDateTime; DWORD dwHighDateTime;} FILETIME;
+#define FILE_ATTRIBUTE_READONLY  0x01
+#define FILE_ATTRIBUTE_HIDDEN    0x02
+#define FILE_ATTRIBUTE_SYSTEM    0x04
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_ARCHIVE   0x20
+#define FILE_ATTRIBUTE_NORMAL    0x80
+#endif
 
 #ifndef _zip_H
 DECLARE_HANDLE(HZIP);
@@ -26,8 +44,8 @@ typedef struct
   char name[MAX_PATH];       // filename within the zip
   DWORD attr;                // attributes, as in GetFileAttributes.
   FILETIME atime,ctime,mtime;// access, create, modify filetimes
-  long comp_size;            // sizes of item, compressed and uncompressed. These
-  long unc_size;             // may be -1 if not yet known (e.g. being streamed in)
+  __int64 comp_size;         // sizes of item, compressed and uncompressed. These
+  __int64 unc_size;          // may be -1 if not yet known (e.g. being streamed in)
 } ZIPENTRY;
 
 
@@ -42,13 +60,28 @@ HZIP OpenZip(void *z,unsigned int len,DWORD flags);
 // accessed in increasing order, and an item may only be unzipped once,
 // although GetZipItem can be called immediately before and after unzipping
 // it. If it's opened in any other way, then full random access is possible.
-// Note: pipe input is not yet implemented.
+// Through a pipe, the items are read from their local headers as the bytes
+// arrive, so each one can be got and unzipped as soon as it has come in,
+// without waiting for the rest of the zip. Asking for an earlier item than
+// the current one gives ZR_SEEK, and unzipping an item a second time gives
+// ZR_PARTIALUNZ. An item that was stored (not deflated) with its sizes left
+// to a trailing data descriptor can't be read through a pipe (ZR_CORRUPT).
+// Anything that can't seek is treated like a pipe, including a file name
+// that names one.
+// Zip64 files (bigger than 4gb, or with more than 65535 items) can be
+// opened in all of these ways. Otherwise the central directory is read in
+// a single go when the zip is opened, so getting at any item costs no more
+// reads of the zip than unzipping it does.
+// Items may be stored, deflated, or compressed with our own fast method
+// (LZ4-style blocks, see lz4blocks.h), which unzips many times faster than
+// deflate at the cost of a bigger zip. Other zip tools can't read that one.
 
 ZRESULT GetZipItem(HZIP hz, int index, ZIPENTRY *ze);
 // GetZipItem - call this to get information about an item in the zip.
 // If index is -1 and the file wasn't opened through a pipe,
 // then it returns information about the whole zipfile
 // (and in particular ze.index returns the number of index items).
+// An index past the last item gives ZR_ARGS.
 // Note: the item might be a directory (ze.attr & FILE_ATTRIBUTE_DIRECTORY)
 // See below for notes on what happens when you unzip such an item.
 // Note: if you are opening the zip through a pipe, then random access
@@ -80,7 +113,19 @@ ZRESULT UnzipItem(HZIP hz, int index, void *dst, unsigned int len, DWORD flags);
 // subdirectories have been created. Also, the item may itself be a directory.
 // If you unzip a directory with ZIP_FILENAME, then the directory gets created.
 // If you unzip it to a handle or a memory block, then nothing gets created
-// and it emits 0 bytes.
+// and it emits 0 bytes. On Linux only ZIP_MEMORY works (ZR_ARGS otherwise).
+
+ZRESULT UnzipAllItems(HZIP hz, const char *dir, int nthreads);
+// UnzipAllItems - unzips every item in the zip into the directory dir. If dir
+// is relative it's taken relative to the current directory, and if it's NULL
+// or "" the current directory itself is used. This is much quicker than calling
+// UnzipItem(...,ZIP_FILENAME) on each item in turn: the directory tree is created
+// just once up-front, each file is preallocated to its uncompressed size, and
+// the files are shared out between nthreads worker threads (0 means one per
+// processor). Items with absolute names or with ".." in them are not unzipped,
+// and ZR_ARGS is returned once the rest are done. If the zip was opened through
+// a handle, everything is unzipped on the calling thread. Windows only: on
+// Linux it gives ZR_ARGS.
 
 ZRESULT CloseZip(HZIP hz);
 // CloseZip - the zip handle must be closed with this function.
@@ -0,0 +1,1009 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "zip.h"
+#include "lz4blocks.h"
+
+
+// THIS FILE is the zipping half that goes with unzip.cpp: CreateZip, ZipAdd
+// and CloseZip. The deflate below is our own: LZ77 over hash chains, with
+// lazy matching at the higher levels, and each block sent with whichever of
+// dynamic huffman, fixed huffman or stored comes out smallest. What it adds
+// to a plain deflater is that it works on many pieces at once. The items
+// added to a zip are kept in memory until there's a batch of them, and then
+// every item of the batch, and every ZIP_CHUNK of the bigger ones, is
+// compressed in parallel, pigz-style. The chunks are joined back into one
+// ordinary deflate stream by ending each with a sync flush.
+//
+// The zips that come out are plain ones (no zip64, so under 4gb), which
+// any unzip can read, apart from items stored with ZIP_LZ4BLOCKS.
+
+
+typedef unsigned char uch;
+typedef unsigned short ush;
+typedef unsigned long ulg;
+
+
+#define ZIP_CHUNK     (256*1024)         // how much of an item each deflate job gets
+#define ZIP_BATCH     (64*1024*1024)     // how much gets added before a batch is compressed
+#define ZIP_DICT      32768              // the deflate window: the history a chunk is primed with
+#define ZIP_MAXSYMS   16384              // symbols per deflate block
+#define ZIP_MAXMATCH  258
+#define ZIP_MINMATCH  3
+#define ZIP_HASHBITS  15
+#define ZIP_HASHSIZE  (1<<ZIP_HASHBITS)
+
+
+// ---------------------------------------------------------------------------
+// crc32, with crc32_combine so that chunks can each have theirs worked out
+// by the thread that compresses them.
+
+ulg zcrc_table[256];
+
+void zcrc_init()
+{ for (ulg n=0; n<256; n++)
+  { ulg c=n;
+    for (int k=0; k<8; k++) c = (c&1) ? (0xedb88320L ^ (c>>1)) : (c>>1);
+    zcrc_table[n]=c;
+  }
+}
+
+ulg zcrc32(ulg crc, const uch *buf, unsigned int len)
+{ crc = crc ^ 0xffffffffL;
+  while (len>0) {crc = zcrc_table[(crc^*buf++)&0xff] ^ (crc>>8); len--;}
+  return crc ^ 0xffffffffL;
+}
+
+// crc32_combine works by treating "append n zero bytes" as a linear map on
+// the crc, a 32x32 matrix over GF(2), and squaring it up to n.
+ulg gf2_times(const ulg *mat, ulg vec)
+{ ulg sum=0;
+  while (vec) {if (vec&1) sum^=*mat; vec>>=1; mat++;}
+  return sum;
+}
+
+void gf2_square(ulg *square, const ulg *mat)
+{ for (int n=0; n<32; n++) square[n]=gf2_times(mat,mat[n]);
+}
+
+ulg zcrc32_combine(ulg crc1, ulg crc2, ulg len2)
+{ if (len2==0) return crc1;
+  ulg even[32], odd[32];
+  odd[0]=0xedb88320L; // the operator for one zero bit
+  ulg row=1;
+  for (int n=1; n<32; n++) {odd[n]=row; row<<=1;}
+  gf2_square(even,odd); // two zero bits
+  gf2_square(odd,even); // four
+  do
+  { gf2_square(even,odd); // the first time round, one zero byte
+    if (len2&1) crc1=gf2_times(even,crc1);
+    len2>>=1;
+    if (len2==0) break;
+    gf2_square(odd,even);
+    if (len2&1) crc1=gf2_times(odd,crc1);
+    len2>>=1;
+  } while (len2!=0);
+  return crc1^crc2;
+}
+
+
+// ---------------------------------------------------------------------------
+// A buffer that grows as it's written to. Everything that's compressed goes
+// into one of these before it's written out.
+
+typedef struct
+{ uch *buf; unsigned int len,cap;
+  bool failed;                     // it couldn't grow
+} TZipBuf;
+
+void zbuf_init(TZipBuf *b) {b->buf=0; b->len=0; b->cap=0; b->failed=false;}
+void zbuf_free(TZipBuf *b) {if (b->buf!=0) free(b->buf); zbuf_init(b);}
+
+bool zbuf_reserve(TZipBuf *b, unsigned int n)
+{ if (b->failed) return false;
+  if (b->len+n<=b->cap) return true;
+  unsigned int cap = b->cap<4096 ? 4096 : b->cap;
+  while (cap<b->len+n) cap*=2;
+  uch *nb = (uch*)realloc(b->buf,cap);
+  if (nb==0) {b->failed=true; return false;}
+  b->buf=nb; b->cap=cap; return true;
+}
+
+void zbuf_put(TZipBuf *b, const void *src, unsigned int n)
+{ if (!zbuf_reserve(b,n)) return;
+  memcpy(b->buf+b->len,src,n); b->len+=n;
+}
+
+void zbuf_put16(TZipBuf *b, unsigned int v) {uch c[2]; c[0]=(uch)v; c[1]=(uch)(v>>8); zbuf_put(b,c,2);}
+void zbuf_put32(TZipBuf *b, ulg v) {zbuf_put16(b,(unsigned int)(v&0xffff)); zbuf_put16(b,(unsigned int)((v>>16)&0xffff));}
+
+
+// ---------------------------------------------------------------------------
+// deflate
+
+const int zlen_base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+const int zlen_extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+const int zdist_base[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+const int zdist_extra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+const uch zclen_order[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+uch zlen_code[ZIP_MAXMATCH+1];  // match length -> index into zlen_base
+uch zdist_code[512];            // distance-1 -> index into zdist_base: the first 256 directly, then by (distance-1)>>7
+
+void zdeflate_init()
+{ for (int c=0; c<29; c++)
+  { int n = 1<<zlen_extra[c];
+    for (int i=0; i<n && zlen_base[c]+i<=ZIP_MAXMATCH; i++) zlen_code[zlen_base[c]+i]=(uch)c;
+  }
+  zlen_code[258]=28;
+  for (int c=0; c<30; c++)
+  { int n = 1<<zdist_extra[c];
+    for (int i=0; i<n; i++)
+    { int d = zdist_base[c]-1+i;
+      if (d<256) zdist_code[d]=(uch)c;
+      else zdist_code[256+(d>>7)]=(uch)c;
+    }
+  }
+}
+
+int zdistcode(int dist)
+{ int d=dist-1;
+  return d<256 ? zdist_code[d] : zdist_code[256+(d>>7)];
+}
+
+// how hard each level tries: zlib's table, near enough
+typedef struct {int good_length, max_lazy, nice_length, max_chain; bool lazy;} TZipLevel;
+const TZipLevel zlevels[10] =
+{ {0,0,0,0,false},          // 0: stored
+  {4,4,8,4,false},          // 1: fastest
+  {4,5,16,8,false},
+  {4,6,32,32,false},
+  {4,4,16,16,true},         // 4: lazy matching from here on
+  {8,16,32,32,true},
+  {8,16,128,128,true},      // 6: the default
+  {8,32,128,256,true},
+  {32,128,258,1024,true},
+  {32,258,258,4096,true}    // 9: smallest
+};
+
+
+typedef struct
+{ TZipBuf *out;
+  ulg bitbuf; int bitcount;
+  // lz77
+  int *head;                 // ZIP_HASHSIZE: the latest position+1 with each hash, 0 for none
+  int *prev;                 // one per byte of data: the previous position+1 with the same hash
+  const uch *data; int datalen;
+  // the symbols of the block in progress
+  ush *sym_lc;               // literal, or match length
+  ush *sym_dist;             // 0 for a literal, or match distance
+  int nsyms;
+  int block_start;           // where in data the block in progress started
+} TDeflate;
+
+
+void zbits(TDeflate *d, ulg value, int n)
+{ d->bitbuf |= value<<d->bitcount; d->bitcount+=n;
+  while (d->bitcount>=8)
+  { uch c=(uch)(d->bitbuf&0xff); zbuf_put(d->out,&c,1);
+    d->bitbuf>>=8; d->bitcount-=8;
+  }
+}
+
+void zbits_align(TDeflate *d)
+{ if (d->bitcount>0) zbits(d,0,8-d->bitcount);
+}
+
+// Huffman code lengths for freq[0..n-1], none longer than maxlen. It's a
+// plain huffman tree, and if that goes too deep, lengths are traded around
+// (longest shortened, some shorter one lengthened) until it fits again.
+void zhuff_lengths(const ulg *freq, int n, int maxlen, uch *lengths)
+{ int sym[320]; int nsym=0;
+  for (int i=0; i<n; i++) {lengths[i]=0; if (freq[i]!=0) sym[nsym++]=i;}
+  if (nsym==0) return;
+  if (nsym==1) {lengths[sym[0]]=1; return;}
+  // sort by frequency, least first (insertion sort: there are at most 286)
+  for (int i=1; i<nsym; i++)
+  { int s=sym[i]; int j=i;
+    while (j>0 && freq[sym[j-1]]>freq[s]) {sym[j]=sym[j-1]; j--;}
+    sym[j]=s;
+  }
+  // Two-queue huffman: leaves in sorted order, and internal nodes, which
+  // come out in increasing order of weight anyway.
+  ulg weight[640]; int parent[640];
+  for (int i=0; i<nsym; i++) weight[i]=freq[sym[i]];
+  int nleaf=nsym, nnode=nsym, li=0, ni=nsym;
+  while (nnode-nsym<nsym-1)
+  { int pick[2];
+    for (int k=0; k<2; k++)
+    { if (li<nleaf && (ni>=nnode || weight[li]<=weight[ni])) pick[k]=li++;
+      else pick[k]=ni++;
+    }
+    weight[nnode]=weight[pick[0]]+weight[pick[1]];
+    parent[pick[0]]=nnode; parent[pick[1]]=nnode;
+    nnode++;
+  }
+  // depths: the root is the last node
+  int depth[640]; depth[nnode-1]=0;
+  for (int i=nnode-2; i>=0; i--) depth[i]=depth[parent[i]]+1;
+  // count how many codes of each length, folding the too-long ones into maxlen
+  int count[32]; for (int i=0; i<32; i++) count[i]=0;
+  for (int i=0; i<nsym; i++) count[depth[i]>maxlen ? maxlen : depth[i]]++;
+  // then fix the kraft sum, which may now be over 1
+  ulg total=0;
+  for (int i=1; i<=maxlen; i++) total += (ulg)count[i]<<(maxlen-i);
+  while (total > (1UL<<maxlen))
+  { count[maxlen]--;
+    for (int i=maxlen-1; i>0; i--)
+    { if (count[i]!=0) {count[i]--; count[i+1]+=2; break;}
+    }
+    total--;
+  }
+  // the most frequent (i.e. last in sym) get the shortest codes
+  int k=nsym-1;
+  for (int len=1; len<=maxlen; len++)
+  { for (int c=count[len]; c>0; c--) lengths[sym[k--]]=(uch)len;
+  }
+}
+
+// Canonical codes from the lengths, bit-reversed, since deflate sends
+// huffman codes starting from their most significant bit.
+void zhuff_codes(const uch *lengths, int n, ush *codes)
+{ int count[16], next[16];
+  for (int i=0; i<16; i++) count[i]=0;
+  for (int i=0; i<n; i++) count[lengths[i]]++;
+  count[0]=0;
+  int code=0;
+  for (int len=1; len<16; len++) {code=(code+count[len-1])<<1; next[len]=code;}
+  for (int i=0; i<n; i++)
+  { int len=lengths[i]; if (len==0) {codes[i]=0; continue;}
+    int c=next[len]++, r=0;
+    for (int b=0; b<len; b++) {r=(r<<1)|(c&1); c>>=1;}
+    codes[i]=(ush)r;
+  }
+}
+
+// The code length codes of a dynamic block: the lit/len and dist lengths,
+// run-length encoded with 16 (repeat the last 3-6 times), 17 (3-10 zeros)
+// and 18 (11-138 zeros). Each entry of rle is code | extra<<8.
+int zrle_lengths(const uch *lengths, int n, ush *rle, ulg *freq)
+{ int nrle=0;
+  for (int i=0; i<n; )
+  { int len=lengths[i], run=1;
+    while (i+run<n && lengths[i+run]==len) run++;
+    i+=run;
+    if (len==0)
+    { while (run>=11) {int r = run>138?138:run; rle[nrle++]=(ush)(18|((r-11)<<8)); freq[18]++; run-=r;}
+      if (run>=3) {rle[nrle++]=(ush)(17|((run-3)<<8)); freq[17]++; run=0;}
+    }
+    else
+    { rle[nrle++]=(ush)len; freq[len]++; run--;
+      while (run>=3) {int r = run>6?6:run; rle[nrle++]=(ush)(16|((r-3)<<8)); freq[16]++; run-=r;}
+    }
+    while (run>0) {rle[nrle++]=(ush)len; freq[len]++; run--;}
+  }
+  return nrle;
+}
+
+// Sends the block in progress (symbols block_start..end of the data that
+// they cover), as whichever kind of block is smallest.
+void zflush_block(TDeflate *d, int end, bool last)
+{ ulg lfreq[286], dfreq[30];
+  for (int i=0; i<286; i++) lfreq[i]=0;
+  for (int i=0; i<30; i++) dfreq[i]=0;
+  for (int i=0; i<d->nsyms; i++)
+  { if (d->sym_dist[i]==0) lfreq[d->sym_lc[i]]++;
+    else {lfreq[257+zlen_code[d->sym_lc[i]]]++; dfreq[zdistcode(d->sym_dist[i])]++;}
+  }
+  lfreq[256]=1;
+  // an inflater needs at least one distance code, and is happier with two
+  int nd=0; for (int i=0; i<30; i++) if (dfreq[i]!=0) nd++;
+  if (nd<2) {if (dfreq[0]==0) dfreq[0]=1; else dfreq[1]=1;}
+  if (nd==0) dfreq[1]=1;
+
+  uch llen[286], dlen[30];
+  zhuff_lengths(lfreq,286,15,llen);
+  zhuff_lengths(dfreq,30,15,dlen);
+  int hlit=286; while (hlit>257 && llen[hlit-1]==0) hlit--;
+  int hdist=30; while (hdist>1 && dlen[hdist-1]==0) hdist--;
+  uch all[316]; memcpy(all,llen,hlit); memcpy(all+hlit,dlen,hdist);
+  ush rle[316]; ulg cfreq[19]; for (int i=0; i<19; i++) cfreq[i]=0;
+  int nrle = zrle_lengths(all,hlit+hdist,rle,cfreq);
+  // inflaters want the code length code complete, which takes two symbols
+  int nc=0; for (int i=0; i<19; i++) if (cfreq[i]!=0) nc++;
+  if (nc<2) {if (cfreq[0]==0) cfreq[0]=1; else cfreq[1]=1;}
+  uch clen[19]; zhuff_lengths(cfreq,19,7,clen);
+  int hclen=19; while (hclen>4 && clen[zclen_order[hclen-1]]==0) hclen--;
+
+  // what each kind of block would cost, in bits
+  ulg dyn=3+5+5+4+3*hclen, fix=3;
+  for (int i=0; i<nrle; i++)
+  { int c=rle[i]&0xff; dyn+=clen[c];
+    if (c==16) dyn+=2; else if (c==17) dyn+=3; else if (c==18) dyn+=7;
+  }
+  for (int i=0; i<286; i++)
+  { if (lfreq[i]==0) continue;
+    int extra = i>=257 ? zlen_extra[i-257] : 0;
+    int flen = i<144 ? 8 : i<256 ? 9 : i<280 ? 7 : 8;
+    dyn += lfreq[i]*(llen[i]+extra); fix += lfreq[i]*(flen+extra);
+  }
+  for (int i=0; i<30; i++)
+  { if (dfreq[i]==0 || i>=hdist) continue;
+    dyn += dfreq[i]*(dlen[i]+zdist_extra[i]); fix += dfreq[i]*(5+zdist_extra[i]);
+  }
+  int rawlen = end-d->block_start;
+  ulg stored = 0; // including the padding to a byte, and 4 bytes of length per 64k
+  { int left=rawlen, bc=d->bitcount;
+    do
+    { int n = left>65535 ? 65535 : left;
+      stored += 3 + ((8-((bc+3)&7))&7) + 32 + 8*(ulg)n;
+      bc=0; left-=n;
+    } while (left>0);
+  }
+
+  if (stored<=dyn && stored<=fix)
+  { int pos=d->block_start, left=rawlen;
+    do
+    { int n = left>65535 ? 65535 : left;
+      zbits(d,(last && n==left)?1:0,1); zbits(d,0,2); zbits_align(d);
+      zbits(d,n,16); zbits(d,(~n)&0xffff,16);
+      zbuf_put(d->out,d->data+pos,n);
+      pos+=n; left-=n;
+    } while (left>0);
+  }
+  else
+  { ush lcode[288], dcode[30];
+    uch flen[288], fdlen[30];
+    const uch *ll=llen, *dl=dlen;
+    if (fix<dyn)
+    { for (int i=0; i<288; i++) flen[i] = (uch)(i<144 ? 8 : i<256 ? 9 : i<280 ? 7 : 8);
+      for (int i=0; i<30; i++) fdlen[i]=5;
+      ll=flen; dl=fdlen;
+      zhuff_codes(flen,288,lcode); zhuff_codes(fdlen,30,dcode);
+      zbits(d,last?1:0,1); zbits(d,1,2);
+    }
+    else
+    { zhuff_codes(llen,286,lcode); zhuff_codes(dlen,30,dcode);
+      ush ccode[19]; zhuff_codes(clen,19,ccode);
+      zbits(d,last?1:0,1); zbits(d,2,2);
+      zbits(d,hlit-257,5); zbits(d,hdist-1,5); zbits(d,hclen-4,4);
+      for (int i=0; i<hclen; i++) zbits(d,clen[zclen_order[i]],3);
+      for (int i=0; i<nrle; i++)
+      { int c=rle[i]&0xff, x=rle[i]>>8;
+        zbits(d,ccode[c],clen[c]);
+        if (c==16) zbits(d,x,2); else if (c==17) zbits(d,x,3); else if (c==18) zbits(d,x,7);
+      }
+    }
+    for (int i=0; i<d->nsyms; i++)
+    { if (d->sym_dist[i]==0) {int c=d->sym_lc[i]; zbits(d,lcode[c],ll[c]); continue;}
+      int len=d->sym_lc[i], lc=zlen_code[len];
+      zbits(d,lcode[257+lc],ll[257+lc]);
+      if (zlen_extra[lc]) zbits(d,len-zlen_base[lc],zlen_extra[lc]);
+      int dist=d->sym_dist[i], dc=zdistcode(dist);
+      zbits(d,dcode[dc],dl[dc]);
+      if (zdist_extra[dc]) zbits(d,dist-zdist_base[dc],zdist_extra[dc]);
+    }
+    zbits(d,lcode[256],ll[256]);
+  }
+  d->nsyms=0; d->block_start=end;
+}
+
+unsigned int zhash(const uch *p) {return ((p[0]<<10)^(p[1]<<5)^p[2]) & (ZIP_HASHSIZE-1);}
+
+void zinsert(TDeflate *d, int pos)
+{ unsigned int h=zhash(d->data+pos);
+  d->prev[pos]=d->head[h]; d->head[h]=pos+1;
+}
+
+// The longest match for pos, among the earlier positions with the same hash,
+// that's longer than prevlen. Returns its length, and its distance in *dist.
+int zlongest_match(TDeflate *d, int pos, int prevlen, const TZipLevel *lv, int *dist)
+{ int maxlen = d->datalen-pos; if (maxlen>ZIP_MAXMATCH) maxlen=ZIP_MAXMATCH;
+  if (maxlen<ZIP_MINMATCH) return 0;
+  int chain = lv->max_chain;
+  if (prevlen>=lv->good_length) chain>>=2;
+  int best=prevlen<ZIP_MINMATCH-1 ? ZIP_MINMATCH-1 : prevlen;
+  const uch *scan=d->data+pos;
+  int cand=d->prev[pos];
+  while (cand!=0 && chain-->0)
+  { int cpos=cand-1;
+    if (pos-cpos>ZIP_DICT) break;
+    const uch *m=d->data+cpos;
+    if (m[best]==scan[best] && m[0]==scan[0] && m[1]==scan[1])
+    { int len=2;
+      while (len<maxlen && m[len]==scan[len]) len++;
+      if (len>best)
+      { best=len; *dist=pos-cpos;
+        if (len>=lv->nice_length || len>=maxlen) break;
+      }
+    }
+    cand=d->prev[cpos];
+  }
+  return best>=ZIP_MINMATCH && best>prevlen ? best : 0;
+}
+
+void zsym(TDeflate *d, int lc, int dist, int end)
+{ d->sym_lc[d->nsyms]=(ush)lc; d->sym_dist[d->nsyms]=(ush)dist; d->nsyms++;
+  if (d->nsyms==ZIP_MAXSYMS) zflush_block(d,end,false);
+}
+
+// Deflates data[histlen..histlen+len) as raw deflate blocks, with
+// data[0..histlen) as history that matches may refer back into. If last, the
+// final block is marked as such; otherwise the output ends with a sync flush,
+// so that the next chunk's output can follow straight on from it. The output
+// always ends on a byte boundary.
+bool zdeflate_chunk(const uch *data, int histlen, int len, bool last, int level, TZipBuf *out)
+{ const TZipLevel *lv = &zlevels[level<1||level>9 ? 6 : level];
+  TDeflate d; d.out=out; d.bitbuf=0; d.bitcount=0;
+  d.data=data; d.datalen=histlen+len;
+  d.head=(int*)calloc(ZIP_HASHSIZE,sizeof(int));
+  d.prev=(int*)malloc((d.datalen+1)*sizeof(int));
+  d.sym_lc=(ush*)malloc(ZIP_MAXSYMS*sizeof(ush));
+  d.sym_dist=(ush*)malloc(ZIP_MAXSYMS*sizeof(ush));
+  d.nsyms=0; d.block_start=histlen;
+  bool ok = d.head!=0 && d.prev!=0 && d.sym_lc!=0 && d.sym_dist!=0;
+  if (ok)
+  { for (int i=0; i+ZIP_MINMATCH<=histlen; i++) zinsert(&d,i);
+    int pos=histlen, end=histlen+len;
+    int prevlen=0, prevdist=0; bool havelit=false; // for lazy matching: the match (or literal) at pos-1 that's on hold
+    while (pos<end)
+    { int mlen=0, mdist=0;
+      if (pos+ZIP_MINMATCH<=end)
+      { zinsert(&d,pos);
+        if (!lv->lazy || prevlen<lv->max_lazy) mlen=zlongest_match(&d,pos,lv->lazy?prevlen:0,lv,&mdist);
+      }
+      if (!lv->lazy)
+      { if (mlen>=ZIP_MINMATCH)
+        { zsym(&d,mlen,mdist,pos+mlen);
+          for (int i=1; i<mlen; i++) if (pos+i+ZIP_MINMATCH<=end) zinsert(&d,pos+i);
+          pos+=mlen;
+        }
+        else {zsym(&d,data[pos],0,pos+1); pos++;}
+        continue;
+      }
+      // lazy: a match found at pos-1 is only taken if pos hasn't a longer one
+      if (prevlen>=ZIP_MINMATCH && mlen<=prevlen)
+      { zsym(&d,prevlen,prevdist,pos-1+prevlen);
+        for (int i=1; i<prevlen-1; i++) if (pos+i+ZIP_MINMATCH<=end) zinsert(&d,pos+i);
+        pos+=prevlen-1; prevlen=0; havelit=false;
+        continue;
+      }
+      if (havelit) zsym(&d,data[pos-1],0,pos);
+      prevlen=mlen; prevdist=mdist; havelit=true;
+      pos++;
+    }
+    if (havelit) zsym(&d,data[pos-1],0,pos);
+    zflush_block(&d,end,last);
+    if (!last)
+    { // the sync flush: an empty stored block
+      zbits(&d,0,1); zbits(&d,0,2); zbits_align(&d);
+      zbits(&d,0,16); zbits(&d,0xffff,16);
+    }
+    zbits_align(&d);
+  }
+  if (d.head!=0) free(d.head);
+  if (d.prev!=0) free(d.prev);
+  if (d.sym_lc!=0) free(d.sym_lc);
+  if (d.sym_dist!=0) free(d.sym_dist);
+  return ok && !out->failed;
+}
+
+
+// ---------------------------------------------------------------------------
+// Threads. A batch is compressed by starting a pool of workers, each of
+// which takes the next job until there are none left, and then waiting for
+// them all: nothing more is needed in the way of synchronisation.
+
+#ifdef _WIN32
+typedef HANDLE TZipThread;
+#define ZIP_THREADFUNC DWORD WINAPI
+#define ZIP_THREADRET 0
+long zatomic_inc(volatile long *v) {return InterlockedIncrement(v);}
+bool zthread_start(TZipThread *t, LPTHREAD_START_ROUTINE fn, void *param)
+{ DWORD tid; *t=CreateThread(NULL,0,fn,param,0,&tid); return *t!=NULL;}
+void zthread_join(TZipThread t) {WaitForSingleObject(t,INFINITE); CloseHandle(t);}
+int zprocessors() {SYSTEM_INFO si; GetSystemInfo(&si); return (int)si.dwNumberOfProcessors;}
+#else
+typedef pthread_t TZipThread;
+#define ZIP_THREADFUNC void*
+#define ZIP_THREADRET 0
+long zatomic_inc(volatile long *v) {return __sync_add_and_fetch(v,1);}
+bool zthread_start(TZipThread *t, void *(*fn)(void*), void *param) {return pthread_create(t,NULL,fn,param)==0;}
+void zthread_join(TZipThread t) {pthread_join(t,NULL);}
+int zprocessors() {long n=sysconf(_SC_NPROCESSORS_ONLN); return n>0 ? (int)n : 1;}
+#endif
+
+
+// ---------------------------------------------------------------------------
+// The zip itself
+
+typedef struct
+{ char name[260];
+  uch *data; unsigned int len;  // all of the item, uncompressed
+  int method, level;            // what was asked for: it may still end up stored
+  unsigned int align;
+  ulg dostime;                  // date<<16 | time
+  ulg attr;                     // external attributes: unix mode<<16 | dos attributes
+  bool isdir;
+  int firstjob, numjobs;
+} TZipItem;
+
+typedef struct
+{ int item;
+  unsigned int start, len;      // which part of the item's data
+  TZipBuf out;                  // it, compressed
+  ulg crc;                      // the crc of that part
+  bool ok;
+} TZipJob;
+
+typedef struct
+{ char name[260];
+  int method; ulg dostime, crc, csize, usize, attr, offset;
+  TZipBuf extra;                // for the central directory
+} TZipCentral;
+
+class TZip
+{ public:
+  TZip() : hfout(0), mustclose(false), obuf(0), olen(0), ocap(0), ogrow(false), writ(0), ended(false), failed(false),
+           method(ZIP_DEFLATE), level(6), align(0), nthreads(0),
+           items(0), numitems(0), capitems(0), pending(0), central(0), numcentral(0), capcentral(0) {}
+  ~TZip() {Clear();}
+
+  FILE *hfout; bool mustclose;        // writing to a file
+#ifdef _WIN32
+  HANDLE hout;                        // or to a handle
+#endif
+  uch *obuf; ulg olen,ocap; bool ogrow; // or to memory
+  ulg writ;                           // how much has been written so far
+  bool ended, failed;
+  int method, level; unsigned int align; int nthreads;
+  TZipItem *items; int numitems, capitems; ulg pending; // the batch that's waiting to be compressed
+  TZipCentral *central; int numcentral, capcentral;
+
+  ZRESULT Create(void *z,unsigned int len,DWORD flags);
+  ZRESULT SetOptions(int method,int level,unsigned int align,int nthreads);
+  ZRESULT Add(const char *dstzn,void *src,unsigned int len,DWORD flags);
+  ZRESULT Flush();
+  ZRESULT Write(const void *buf,unsigned int len);
+  ZRESULT WriteItem(TZipItem *it,TZipJob *jobs);
+  ZRESULT GetMemory(void **pbuf,unsigned long *plen);
+  ZRESULT Close();
+  void Clear();
+};
+
+
+ZRESULT TZip::Create(void *z,unsigned int len,DWORD flags)
+{ if (flags==ZIP_FILENAME)
+  { hfout=fopen((const char*)z,"wb");
+    if (hfout==0) return ZR_NOFILE;
+    mustclose=true; return ZR_OK;
+  }
+#ifdef _WIN32
+  if (flags==ZIP_HANDLE)
+  { HANDLE hf=(HANDLE)z;
+    if (!DuplicateHandle(GetCurrentProcess(),hf,GetCurrentProcess(),&hout,0,FALSE,DUPLICATE_SAME_ACCESS)) return ZR_NODUPH;
+    return ZR_OK;
+  }
+#endif
+  if (flags==ZIP_MEMORY)
+  { if (z==0) {ogrow=true; ocap=0; obuf=0;}
+    else {obuf=(uch*)z; ocap=len; ogrow=false;}
+    olen=0; return ZR_OK;
+  }
+  return ZR_ARGS;
+}
+
+ZRESULT TZip::SetOptions(int amethod,int alevel,unsigned int aalign,int anthreads)
+{ if (amethod!=ZIP_STORE && amethod!=ZIP_DEFLATE && amethod!=ZIP_LZ4BLOCKS) return ZR_ARGS;
+  if (alevel<0 || alevel>9 || anthreads<0) return ZR_ARGS;
+  if (aalign!=0 && (aalign&(aalign-1))!=0) return ZR_ARGS; // a power of two
+  method=amethod; level=alevel==0?6:alevel; align=aalign; nthreads=anthreads;
+  return ZR_OK;
+}
+
+ZRESULT TZip::Write(const void *buf,unsigned int len)
+{ if (len==0) return ZR_OK;
+  if (writ+len<writ) return ZR_MEMSIZE; // over 4gb, which needs zip64
+  if (hfout!=0)
+  { if (fwrite(buf,1,len,hfout)!=len) return ZR_WRITE;
+  }
+#ifdef _WIN32
+  else if (hout!=0)
+  { DWORD w; if (!WriteFile(hout,buf,len,&w,NULL) || w!=len) return ZR_WRITE;
+  }
+#endif
+  else
+  { if (olen+len>ocap)
+    { if (!ogrow) return ZR_MEMSIZE;
+      ulg ncap = ocap<65536 ? 65536 : ocap;
+      while (ncap<olen+len) ncap*=2;
+      uch *nb=(uch*)realloc(obuf,ncap);
+      if (nb==0) return ZR_NOALLOC;
+      obuf=nb; ocap=ncap;
+    }
+    memcpy(obuf+olen,buf,len); olen+=len;
+  }
+  writ+=len;
+  return ZR_OK;
+}
+
+
+ulg zdostime(time_t t)
+{ struct tm *tm = localtime(&t);
+  if (tm==0 || tm->tm_year<80) return (0<<25)|(1<<21)|(1<<16); // 1980-01-01
+  return ((ulg)(tm->tm_year-80)<<25) | ((ulg)(tm->tm_mon+1)<<21) | ((ulg)tm->tm_mday<<16) |
+         ((ulg)tm->tm_hour<<11) | ((ulg)tm->tm_min<<5) | ((ulg)tm->tm_sec>>1);
+}
+
+ZRESULT TZip::Add(const char *dstzn,void *src,unsigned int len,DWORD flags)
+{ if (ended) return ZR_ENDED;
+  if (failed) return ZR_FAILED;
+  if (dstzn==0 || strlen(dstzn)+2>sizeof(items[0].name)) return ZR_ARGS;
+  if (numitems==capitems)
+  { int ncap = capitems==0 ? 64 : capitems*2;
+    TZipItem *ni=(TZipItem*)realloc(items,ncap*sizeof(TZipItem));
+    if (ni==0) return ZR_NOALLOC;
+    items=ni; capitems=ncap;
+  }
+  TZipItem *it=&items[numitems];
+  memset(it,0,sizeof(TZipItem));
+  strcpy(it->name,dstzn);
+  for (char *c=it->name; *c!=0; c++) if (*c=='\\') *c='/';
+  it->method=method; it->level=level; it->align=align;
+  it->dostime=zdostime(time(NULL));
+  it->attr=0x81A40000 | 0x20; // -rw-r--r--, and archive
+  if (flags==ZIP_FOLDER)
+  { it->isdir=true; it->method=ZIP_STORE;
+    it->attr=0x41ED0000 | 0x10; // drwxr-xr-x, and directory
+    size_t n=strlen(it->name);
+    if (n==0 || it->name[n-1]!='/') strcat(it->name,"/");
+  }
+  else if (flags==ZIP_MEMORY)
+  { it->data=(uch*)malloc(len>0?len:1);
+    if (it->data==0) return ZR_NOALLOC;
+    if (len>0) memcpy(it->data,src,len);
+    it->len=len;
+  }
+  else if (flags==ZIP_FILENAME)
+  { FILE *f=fopen((const char*)src,"rb");
+    if (f==0) return ZR_NOFILE;
+    struct stat st;
+    if (stat((const char*)src,&st)==0) it->dostime=zdostime(st.st_mtime);
+    fseek(f,0,SEEK_END); long flen=ftell(f); fseek(f,0,SEEK_SET);
+    if (flen<0) {fclose(f); return ZR_READ;}
+    it->data=(uch*)malloc(flen>0?flen:1);
+    if (it->data==0) {fclose(f); return ZR_NOALLOC;}
+    if (flen>0 && fread(it->data,1,flen,f)!=(size_t)flen) {fclose(f); free(it->data); return ZR_READ;}
+    fclose(f);
+    it->len=(unsigned int)flen;
+  }
+#ifdef _WIN32
+  else if (flags==ZIP_HANDLE)
+  { // read to the end: it may be a pipe, so there's no knowing how much in advance
+    TZipBuf b; zbuf_init(&b);
+    for (;;)
+    { if (!zbuf_reserve(&b,65536)) {zbuf_free(&b); return ZR_NOALLOC;}
+      DWORD red=0; BOOL ok=ReadFile((HANDLE)src,b.buf+b.len,65536,&red,NULL);
+      if (!ok || red==0) break;
+      b.len+=red;
+    }
+    it->data=b.buf; it->len=b.len;
+    if (it->data==0) it->data=(uch*)malloc(1);
+  }
+#endif
+  else return ZR_ARGS;
+  numitems++;
+  pending+=it->len;
+  if (pending>=ZIP_BATCH) return Flush();
+  return ZR_OK;
+}
+
+
+typedef struct
+{ TZipItem *items; TZipJob *jobs; int numjobs;
+  volatile long next;
+} TZipBatch;
+
+ZIP_THREADFUNC ZipWorker(void *param)
+{ TZipBatch *b=(TZipBatch*)param;
+  for (;;)
+  { long i=zatomic_inc(&b->next)-1;
+    if (i>=b->numjobs) break;
+    TZipJob *j=&b->jobs[i]; TZipItem *it=&b->items[j->item];
+    j->crc=zcrc32(0,it->data+j->start,j->len);
+    if (it->method==ZIP_DEFLATE)
+    { unsigned int hist = j->start<ZIP_DICT ? j->start : ZIP_DICT;
+      bool last = j->start+j->len==it->len;
+      j->ok=zdeflate_chunk(it->data+j->start-hist,(int)hist,(int)j->len,last,it->level,&j->out);
+    }
+    else if (it->method==ZIP_LZ4BLOCKS && j->len>0)
+    { // one block: the header, then it compressed, or stored if it won't shrink
+      j->ok=zbuf_reserve(&j->out,8+j->len);
+      if (j->ok)
+      { unsigned int c = LZ4BlockCompress(it->data+j->start,j->len,j->out.buf+8,j->len-1);
+        if (c==0) {memcpy(j->out.buf+8,it->data+j->start,j->len); j->out.len=8+j->len;}
+        else j->out.len=8+c;
+        uch *h=j->out.buf; ulg cw = c==0 ? (0x80000000UL|j->len) : c;
+        h[0]=(uch)cw; h[1]=(uch)(cw>>8); h[2]=(uch)(cw>>16); h[3]=(uch)(cw>>24);
+        h[4]=(uch)j->len; h[5]=(uch)(j->len>>8); h[6]=(uch)(j->len>>16); h[7]=(uch)(j->len>>24);
+      }
+    }
+    else j->ok=true; // stored, or empty: only the crc was needed
+  }
+  return ZIP_THREADRET;
+}
+
+ZRESULT TZip::Flush()
+{ if (numitems==0) return ZR_OK;
+  // Share every item out into jobs: a stored item or a small one is a single
+  // job, a big one gets one per chunk (or per block, for ZIP_LZ4BLOCKS).
+  int numjobs=0;
+  for (int i=0; i<numitems; i++)
+  { TZipItem *it=&items[i];
+    unsigned int chunk = it->method==ZIP_LZ4BLOCKS ? LZ4BLOCKS_BLOCKSIZE : ZIP_CHUNK;
+    it->firstjob=numjobs;
+    it->numjobs = it->method==ZIP_STORE || it->len==0 ? 1 : (int)((it->len+chunk-1)/chunk);
+    numjobs+=it->numjobs;
+  }
+  TZipJob *jobs=(TZipJob*)calloc(numjobs,sizeof(TZipJob));
+  if (jobs==0) {failed=true; return ZR_NOALLOC;}
+  for (int i=0; i<numitems; i++)
+  { TZipItem *it=&items[i];
+    unsigned int chunk = it->numjobs==1 ? it->len : it->method==ZIP_LZ4BLOCKS ? LZ4BLOCKS_BLOCKSIZE : ZIP_CHUNK;
+    for (int k=0; k<it->numjobs; k++)
+    { TZipJob *j=&jobs[it->firstjob+k];
+      j->item=i; j->start=k*chunk; j->len = it->len-j->start<chunk ? it->len-j->start : chunk;
+      zbuf_init(&j->out);
+    }
+  }
+  // the biggest items' jobs don't need to go first: the chunks keep them all about the same size
+  TZipBatch batch; batch.items=items; batch.jobs=jobs; batch.numjobs=numjobs; batch.next=0;
+  int nt = nthreads>0 ? nthreads : zprocessors();
+  if (nt>numjobs) nt=numjobs;
+  if (nt>64) nt=64;
+  TZipThread threads[64]; int started=0;
+  for (int t=1; t<nt; t++) {if (zthread_start(&threads[started],ZipWorker,&batch)) started++;}
+  ZipWorker(&batch); // this thread works too
+  for (int t=0; t<started; t++) zthread_join(threads[t]);
+  //
+  ZRESULT zres=ZR_OK;
+  for (int i=0; i<numitems && zres==ZR_OK; i++) zres=WriteItem(&items[i],jobs);
+  for (int j=0; j<numjobs; j++) zbuf_free(&jobs[j].out);
+  free(jobs);
+  for (int i=0; i<numitems; i++) if (items[i].data!=0) free(items[i].data);
+  numitems=0; pending=0;
+  if (zres!=ZR_OK) failed=true;
+  return zres;
+}
+
+ZRESULT TZip::WriteItem(TZipItem *it,TZipJob *jobs)
+{ TZipJob *j=&jobs[it->firstjob];
+  for (int k=0; k<it->numjobs; k++) if (!j[k].ok) return ZR_FLATE;
+  ulg crc=j[0].crc, csize=j[0].out.len;
+  for (int k=1; k<it->numjobs; k++) {crc=zcrc32_combine(crc,j[k].crc,j[k].len); csize+=j[k].out.len;}
+  int method=it->method;
+  if (method==ZIP_LZ4BLOCKS) csize+=4; // the end marker
+  if (method!=ZIP_STORE && csize>=it->len) method=ZIP_STORE; // changed its mind: it didn't shrink
+  if (method==ZIP_STORE) csize=it->len;
+  if (it->isdir) {crc=0; csize=0;}
+  //
+  if (numcentral==capcentral)
+  { int ncap = capcentral==0 ? 64 : capcentral*2;
+    TZipCentral *nc=(TZipCentral*)realloc(central,ncap*sizeof(TZipCentral));
+    if (nc==0) return ZR_NOALLOC;
+    central=nc; capcentral=ncap;
+  }
+  TZipCentral *c=&central[numcentral]; memset(c,0,sizeof(TZipCentral)); zbuf_init(&c->extra);
+  numcentral++;
+  strcpy(c->name,it->name);
+  c->method=method; c->dostime=it->dostime; c->crc=crc; c->csize=csize; c->usize=it->len;
+  c->attr=it->attr; c->offset=writ;
+  unsigned int namelen=(unsigned int)strlen(it->name);
+  //
+  TZipBuf h; zbuf_init(&h);
+  zbuf_put32(&h,0x04034b50);
+  zbuf_put16(&h,method==ZIP_STORE?10:20);  // version needed to extract
+  zbuf_put16(&h,0);                         // flags
+  zbuf_put16(&h,method);
+  zbuf_put32(&h,it->dostime);
+  zbuf_put32(&h,crc); zbuf_put32(&h,csize); zbuf_put32(&h,it->len);
+  unsigned int extralen=0;
+  if (method==ZIP_STORE && it->align>1 && !it->isdir)
+  { // pad the extra field out so that the data starts on a multiple of align
+    ulg datapos = writ+30+namelen+6;
+    extralen = 6 + (unsigned int)((it->align-(datapos%it->align))%it->align);
+  }
+  zbuf_put16(&h,namelen); zbuf_put16(&h,extralen);
+  zbuf_put(&h,it->name,namelen);
+  if (extralen>0)
+  { zbuf_put16(&h,ZIP_EXTRA_ALIGNMENT); zbuf_put16(&h,extralen-4); zbuf_put16(&h,it->align);
+    if (zbuf_reserve(&h,extralen-6)) {memset(h.buf+h.len,0,extralen-6); h.len+=extralen-6;}
+  }
+  if (h.failed) {zbuf_free(&h); return ZR_NOALLOC;}
+  ZRESULT zres=Write(h.buf,h.len);
+  zbuf_free(&h);
+  if (zres!=ZR_OK) return zres;
+  //
+  if (method==ZIP_STORE) return Write(it->data,it->len);
+  if (method==ZIP_DEFLATE && it->numjobs>1)
+  { // where the sync flush points are: after every chunk but the last
+    ulg at=0; int npoints=it->numjobs-1;
+    if (4+4*npoints<=65535)
+    { zbuf_put16(&c->extra,ZIP_EXTRA_SYNCPOINTS); zbuf_put16(&c->extra,4+4*npoints);
+      zbuf_put32(&c->extra,ZIP_CHUNK);
+      for (int k=0; k<npoints; k++) {at+=j[k].out.len; zbuf_put32(&c->extra,at);}
+    }
+  }
+  for (int k=0; k<it->numjobs && zres==ZR_OK; k++) zres=Write(j[k].out.buf,j[k].out.len);
+  if (method==ZIP_LZ4BLOCKS && zres==ZR_OK) {uch end[4]={0,0,0,0}; zres=Write(end,4);}
+  return zres;
+}
+
+ZRESULT TZip::GetMemory(void **pbuf,unsigned long *plen)
+{ if (obuf==0 && !ogrow) return ZR_NOTMMAP;
+  if (!ended) {ZRESULT zres=Close(); if (zres!=ZR_OK) return zres;}
+  *pbuf=obuf; *plen=olen;
+  return ZR_OK;
+}
+
+ZRESULT TZip::Close()
+{ if (ended) return ZR_OK;
+  ZRESULT zres = failed ? ZR_FAILED : Flush();
+  ended=true;
+  if (zres==ZR_OK)
+  { // the central directory, then its end record
+    ulg cdstart=writ;
+    TZipBuf h; zbuf_init(&h);
+    for (int i=0; i<numcentral; i++)
+    { TZipCentral *c=&central[i];
+      unsigned int namelen=(unsigned int)strlen(c->name);
+      zbuf_put32(&h,0x02014b50);
+      zbuf_put16(&h,(3<<8)|20);                 // made by: unix, 2.0 (so the attributes' upper half is a st_mode)
+      zbuf_put16(&h,c->method==ZIP_STORE?10:20);
+      zbuf_put16(&h,0);
+      zbuf_put16(&h,c->method);
+      zbuf_put32(&h,c->dostime);
+      zbuf_put32(&h,c->crc); zbuf_put32(&h,c->csize); zbuf_put32(&h,c->usize);
+      zbuf_put16(&h,namelen); zbuf_put16(&h,c->extra.len); zbuf_put16(&h,0);
+      zbuf_put16(&h,0); zbuf_put16(&h,0);       // disk, internal attributes
+      zbuf_put32(&h,c->attr);
+      zbuf_put32(&h,c->offset);
+      zbuf_put(&h,c->name,namelen);
+      zbuf_put(&h,c->extra.buf,c->extra.len);
+    }
+    if (numcentral>0xFFFF) zres=ZR_MEMSIZE; // needs zip64
+    ulg cdsize=h.len;
+    zbuf_put32(&h,0x06054b50);
+    zbuf_put16(&h,0); zbuf_put16(&h,0);
+    zbuf_put16(&h,numcentral); zbuf_put16(&h,numcentral);
+    zbuf_put32(&h,cdsize); zbuf_put32(&h,cdstart);
+    zbuf_put16(&h,0);
+    if (h.failed) zres=ZR_NOALLOC;
+    if (zres==ZR_OK) zres=Write(h.buf,h.len);
+    zbuf_free(&h);
+  }
+  if (hfout!=0) {if (fclose(hfout)!=0 && zres==ZR_OK) zres=ZR_WRITE; hfout=0;}
+#ifdef _WIN32
+  if (hout!=0) {CloseHandle(hout); hout=0;}
+#endif
+  if (zres!=ZR_OK) failed=true;
+  return zres;
+}
+
+void TZip::Clear()
+{ for (int i=0; i<numitems; i++) if (items[i].data!=0) free(items[i].data);
+  if (items!=0) free(items);
+  items=0; numitems=0;
+  for (int i=0; i<numcentral; i++) zbuf_free(&central[i].extra);
+  if (central!=0) free(central);
+  central=0; numcentral=0;
+  if (hfout!=0) {fclose(hfout); hfout=0;}
+  if (ogrow && obuf!=0) free(obuf);
+  obuf=0;
+}
+
+
+
+
+ZRESULT lasterrorZ=ZR_OK;
+
+unsigned int FormatZipMessageZ(ZRESULT code, char *buf,unsigned int len)
+{ if (code==ZR_RECENT) code=lasterrorZ;
+  const char *msg="unknown zip result code";
+  switch (code)
+  { case ZR_OK: msg="Success"; break;
+    case ZR_NODUPH: msg="Culdn't duplicate handle"; break;
+    case ZR_NOFILE: msg="Couldn't create/open file"; break;
+    case ZR_NOALLOC: msg="Failed to allocate memory"; break;
+    case ZR_WRITE: msg="Error writing to file"; break;
+    case ZR_NOTFOUND: msg="File not found in the zipfile"; break;
+    case ZR_MORE: msg="Still more data to unzip"; break;
+    case ZR_CORRUPT: msg="Zipfile is corrupt or not a zipfile"; break;
+    case ZR_READ: msg="Error reading file"; break;
+    case ZR_ARGS: msg="Caller: faulty arguments"; break;
+    case ZR_PARTIALUNZ: msg="Caller: the file had already been partially unzipped"; break;
+    case ZR_NOTMMAP: msg="Caller: can only get memory of a memory zipfile"; break;
+    case ZR_MEMSIZE: msg="Caller: not enough space allocated for memory zipfile"; break;
+    case ZR_FAILED: msg="Caller: there was a previous error"; break;
+    case ZR_ENDED: msg="Caller: additions to the zip have already been ended"; break;
+    case ZR_ZMODE: msg="Caller: mixing creation and opening of zip"; break;
+    case ZR_NOTINITED: msg="Zip-bug: internal initialisation not completed"; break;
+    case ZR_SEEK: msg="Zip-bug: trying to seek the unseekable"; break;
+    case ZR_MISSIZE: msg="Zip-bug: the anticipated size turned out wrong"; break;
+    case ZR_NOCHANGE: msg="Zip-bug: tried to change mind, but not allowed"; break;
+    case ZR_FLATE: msg="Zip-bug: an internal error during flation"; break;
+  }
+  unsigned int mlen=(unsigned int)strlen(msg);
+  if (buf==0 || len==0) return mlen;
+  unsigned int n=mlen; if (n+1>len) n=len-1;
+  memcpy(buf,msg,n); buf[n]=0;
+  return mlen;
+}
+
+
+typedef struct
+{ DWORD flag;
+  TZip *zip;
+} TZipHandleData;
+
+HZIP CreateZipZ(void *z,unsigned int len,DWORD flags)
+{ static bool inited=false;
+  if (!inited) {zcrc_init(); zdeflate_init(); inited=true;} // before any worker threads could want them
+  TZip *zip = new TZip();
+#ifdef _WIN32
+  zip->hout=0;
+#endif
+  lasterrorZ = zip->Create(z,len,flags);
+  if (lasterrorZ!=ZR_OK) {delete zip; return 0;}
+  TZipHandleData *han = new TZipHandleData;
+  han->flag=2; han->zip=zip; return (HZIP)han;
+}
+
+ZRESULT ZipSetOptions(HZIP hz, int method, int level, unsigned int align, int nthreads)
+{ if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  lasterrorZ = han->zip->SetOptions(method,level,align,nthreads);
+  return lasterrorZ;
+}
+
+ZRESULT ZipAdd(HZIP hz,const char *dstzn, void *src,unsigned int len, DWORD flags)
+{ if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  lasterrorZ = han->zip->Add(dstzn,src,len,flags);
+  return lasterrorZ;
+}
+
+ZRESULT ZipGetMemory(HZIP hz, void **buf, unsigned long *len)
+{ if (hz==0) {if (buf!=0) *buf=0; if (len!=0) *len=0; lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  lasterrorZ = han->zip->GetMemory(buf,len);
+  return lasterrorZ;
+}
+
+ZRESULT CloseZipZ(HZIP hz)
+{ if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  lasterrorZ = han->zip->Close();
+  delete han->zip;
+  delete han;
+  return lasterrorZ;
+}
+
+bool IsZipHandleZ(HZIP hz)
+{ if (hz==0) return false;
+  TZipHandleData *han = (TZipHandleData*)hz;
+  return (han->flag==2);
+}
@@ -0,0 +1,178 @@
+#ifndef _zip_H
+#define _zip_H
+
+// ZIPPING functions -- for building zip files.
+// This is the companion to unzip.h, with the same style of interface, so
+// that the two can be used side by side (see the end of this file). The
+// deflate in zip.cpp is written for this library rather than taken from
+// zlib, and unlike unzip.cpp none of zip.cpp needs Windows: it also gets
+// built on Linux, as part of the zippack tool that builds the frame packs.
+
+#ifndef _WIN32
+// just enough of windows.h for this header, for when it isn't there
+typedef unsigned long DWORD;
+#ifndef DECLARE_HANDLE
+#define DECLARE_HANDLE(name) struct name##__ { int unused; }; typedef struct name##__ *name
+#endif
+#endif
+
+#ifndef _unzip_H
+DECLARE_HANDLE(HZIP);
+#endif
+// An HZIP identifies a zip file that is being created
+
+typedef DWORD ZRESULT;
+// return codes from any of the zip functions. Listed later.
+
+#define ZIP_HANDLE   1
+#define ZIP_FILENAME 2
+#define ZIP_MEMORY   3
+#define ZIP_FOLDER   4
+
+#define ZIP_STORE     0       // compression methods, for ZipSetOptions
+#define ZIP_DEFLATE   8
+#define ZIP_LZ4BLOCKS 0x4C34  // our own fast one. See lz4blocks.h
+
+
+HZIP CreateZip(void *z,unsigned int len,DWORD flags);
+// CreateZip - call this to start the creation of a zip file.
+// As the zip is being created, it will be stored somewhere:
+// to a file (by name):      CreateZip("c:\\test.zip",0, ZIP_FILENAME);
+// to a file (by handle):    CreateZip(hfile,0, ZIP_HANDLE);  (Windows only)
+// in a fixed memory block:  CreateZip(buf,len, ZIP_MEMORY);
+// in memory that grows:     CreateZip(0,0, ZIP_MEMORY);
+// For a fixed block, ZR_MEMSIZE is returned if the zip outgrows it. Either
+// way, ZipGetMemory gets at the result.
+
+ZRESULT ZipSetOptions(HZIP hz, int method, int level, unsigned int align, int nthreads);
+// ZipSetOptions - how the items added from now on are to be stored.
+// method is ZIP_DEFLATE (the default), ZIP_STORE or ZIP_LZ4BLOCKS. level is
+// for deflate, 1 (fastest) to 9 (smallest), and 0 means 6. An item that
+// doesn't get any smaller is stored instead.
+// align: if it's not 0, the data of each stored item starts at a multiple
+// of it within the zip (padded out with an extra field in its local header),
+// so that e.g. with 4096 a stored item can be used straight from a mapping
+// of the zip, page by page.
+// nthreads: how many threads compress at once (0, the default, means one per
+// processor). Items are compressed in parallel with each other, and big
+// items are also split into chunks that are deflated in parallel, pigz-style:
+// each chunk ends on a sync flush point (byte-aligned, after an empty stored
+// block) and is primed with the 32k of data before it, so the result is a
+// single ordinary deflate stream. Where those points are is recorded in the
+// item's central directory extra field (see ZIP_EXTRA_SYNCPOINTS), so that a
+// reader may start inflating at any of them, with the 32k of uncompressed
+// data before it as the dictionary.
+
+#define ZIP_EXTRA_SYNCPOINTS 0x7073 // "sp": u32 chunk size, then the u32 offset within the item's
+                                    // data of the sync flush point at the end of each chunk but the last
+#define ZIP_EXTRA_ALIGNMENT  0xD935 // u16 alignment, then padding. The same as Android's zipalign uses
+
+ZRESULT ZipAdd(HZIP hz,const char *dstzn, void *src,unsigned int len, DWORD flags);
+// ZipAdd - call this for each file to be added to the zip.
+// dstzn is the name that the file will be stored as in the zip file.
+// The file to be added to the zip can come
+// from a file (by name):   ZipAdd(hz,"file.dat", "c:\\docs\\origfile.dat",0, ZIP_FILENAME);
+// from a file (by handle): ZipAdd(hz,"file.dat", hfile,0, ZIP_HANDLE);  (Windows only)
+// from a memory block:     ZipAdd(hz,"file.dat", buf,buflen, ZIP_MEMORY);
+// as a directory:          ZipAdd(hz,"subdir",   0,0, ZIP_FOLDER);
+// The data is copied, so src may be freed as soon as ZipAdd returns. Items
+// are compressed a batch at a time, so an error in one may only be reported
+// by a later ZipAdd, or by CloseZip.
+
+ZRESULT ZipGetMemory(HZIP hz, void **buf, unsigned long *len);
+// ZipGetMemory - If the zip was created in memory, via ZipCreate(0,ZIP_MEMORY),
+// then this function will return information about that memory block.
+// buf will receive a pointer to its start, and len its length.
+// Note: you can't add any more after calling this.
+
+ZRESULT CloseZip(HZIP hz);
+// CloseZip - the zip handle must be closed with this function.
+
+unsigned int FormatZipMessage(ZRESULT code, char *buf,unsigned int len);
+// FormatZipMessage - given an error code, formats it as a string.
+// It returns the length of the error message. If buf/len points
+// to a real buffer, then it also writes as much as possible into there.
+
+
+// These are the result codes:
+#define ZR_OK         0x00000000     // nb. the pseudo-code zr-recent is never returned,
+#define ZR_RECENT     0x00000001     // but can be passed to FormatZipMessage.
+// The following come from general system stuff (e.g. files not openable)
+#define ZR_GENMASK    0x0000FF00
+#define ZR_NODUPH     0x00000100     // couldn't duplicate the handle
+#define ZR_NOFILE     0x00000200     // couldn't create/open the file
+#define ZR_NOALLOC    0x00000300     // failed to allocate some resource
+#define ZR_WRITE      0x00000400     // a general error writing to the file
+#define ZR_NOTFOUND   0x00000500     // couldn't find that file in the zip
+#define ZR_MORE       0x00000600     // there's still more data to be unzipped
+#define ZR_CORRUPT    0x00000700     // the zipfile is corrupt or not a zipfile
+#define ZR_READ       0x00000800     // a general error reading the file
+// The following come from mistakes on the part of the caller
+#define ZR_CALLERMASK 0x00FF0000
+#define ZR_ARGS       0x00010000     // general mistake with the arguments
+#define ZR_NOTMMAP    0x00020000     // tried to ZipGetMemory, but that only works on mmap zipfiles, which yours wasn't
+#define ZR_MEMSIZE    0x00030000     // the memory size is too small
+#define ZR_FAILED     0x00040000     // the thing was already failed when you called this function
+#define ZR_ENDED      0x00050000     // the zip creation has already been closed
+#define ZR_MISSIZE    0x00060000     // the indicated input file size turned out mistaken
+#define ZR_PARTIALUNZ 0x00070000     // the file had already been partially unzipped
+#define ZR_ZMODE      0x00080000     // tried to mix creating/opening a zip
+// The following come from bugs within the zip library itself
+#define ZR_BUGMASK    0xFF000000
+#define ZR_NOTINITED  0x01000000     // initialisation didn't work
+#define ZR_SEEK       0x02000000     // trying to seek in an unseekable file
+#define ZR_NOCHANGE   0x04000000     // changed its mind on storage, but not allowed
+#define ZR_FLATE      0x05000000     // an internal error in the de/inflation code
+
+
+
+
+
+// e.g.
+//
+// (1) Traditional use, creating a zipfile from existing files
+//     HZIP hz = CreateZip("c:\\simple1.zip",0,ZIP_FILENAME);
+//     ZipAdd(hz,"znsimple.bmp", "c:\\simple.bmp",0, ZIP_FILENAME);
+//     ZipAdd(hz,"znsimple.txt", "c:\\simple.txt",0, ZIP_FILENAME);
+//     CloseZip(hz);
+//
+// (2) Frames for the screensaver: stored, page-aligned, so that they can be
+//     used in place; and everything else deflated on 8 threads
+//     HZIP hz = CreateZip("Edw590SCR.zip",0,ZIP_FILENAME);
+//     ZipSetOptions(hz,ZIP_STORE,0,4096,8);
+//     ZipAdd(hz,"1.bmp", "frames/1.bmp",0, ZIP_FILENAME);
+//     ZipSetOptions(hz,ZIP_DEFLATE,9,0,8);
+//     ZipAdd(hz,"readme.txt", "readme.txt",0, ZIP_FILENAME);
+//     CloseZip(hz);
+//
+// (3) Creating a zip in memory that grows as needed
+//     HZIP hz = CreateZip(0,0,ZIP_MEMORY);
+//     ZipAdd(hz,"file.dat", buf,buflen, ZIP_MEMORY);
+//     void *zbuf; unsigned long zlen; ZipGetMemory(hz,&zbuf,&zlen);
+//     ... use zbuf ...
+//     CloseZip(hz);  // zbuf is freed here
+
+
+
+// Now we indulge in a little skullduggery so that the code works whether
+// the user has included just zip or both zip and unzip.
+// Idea: if header files for both zip and unzip are present, then presumably
+// the cpp files for zip and unzip are both present, so we will call
+// one or the other of them based on a dynamic choice. If the header file
+// for only one is present, then we will bind to that particular one.
+HZIP CreateZipZ(void *z,unsigned int len,DWORD flags);
+ZRESULT CloseZipZ(HZIP hz);
+unsigned int FormatZipMessageZ(ZRESULT code, char *buf,unsigned int len);
+bool IsZipHandleZ(HZIP hz);
+#define CreateZip CreateZipZ
+#ifdef _unzip_H
+#undef CloseZip
+#define CloseZip(hz) (IsZipHandleZ(hz)?CloseZipZ(hz):CloseZipU(hz))
+#else
+#define CloseZip CloseZipZ
+#define FormatZipMessage FormatZipMessageZ
+#endif
+
+
+
+#endif // _zip_H
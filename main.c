@@ -46,7 +46,21 @@
 #include <stdio.h>
 #include <windows.h>
 #include <time.h>
+#include "Utils/Activity.h"
+#include "Utils/Frame.h"
 #include "Utils/General.h"
+#include "Utils/Glitch.h"
+#include "Utils/Governor.h"
+#include "Utils/Measure.h"
+#include "Utils/Pacer.h"
+#include "Utils/Pipeline.h"
+#include "Utils/Preview.h"
+#include "Utils/Remote.h"
+#include "Utils/Render.h"
+#include "Utils/Schedule.h"
+#include "Utils/Surface.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Wall.h"
 #include "Utils/unzip.h"
 
 #define MAX_MONITORS_EDW590 100
@@ -60,6 +74,7 @@ enum TScrMode {
 enum TScrMode scr_mode_GL = MODE_NONE;
 HINSTANCE hInstance_GL = NULL;
 
+// The image picked last, for all the monitors (by the pipeline's thread: it's on them a frame or 2 later).
 int image_num_GL = 0;
 
 struct TSaverSettings {
@@ -68,7 +83,6 @@ struct TSaverSettings {
 	DWORD MouseThreshold;  // in pixels
 	POINT InitCursorPos;
 	DWORD InitTime;        // in ms
-	UINT  idTimer;         // a timer id, because this particular saver uses a timer
 	BOOL  IsDialogActive;
 	BOOL  ReallyClose;     // for NT, so we know if a WM_CLOSE came from us or it.
 };
@@ -79,12 +93,100 @@ struct MonitorInfo {
 	LONG y;
 	LONG width;
 	LONG height;
+	int refresh;            // in millihertz, or 0 if not known
 };
 
 int num_monitors_GL = 0;
 struct MonitorInfo monitors_GL[MAX_MONITORS_EDW590] = {0};
 
-HBITMAP images_GL[80] = {0};
+struct Frame images_GL[80] = {0};
+
+// The filter the surfaces scale the frames with: a ScaleFilter, or -1 for area-average when shrinking and bilinear
+// when enlarging.
+int scale_filter_GL = -1;
+// The threads the surfaces scale the frames on (NULL to scale on the window's own thread only).
+struct ThreadPool *scale_pool_GL = NULL;
+
+// The frame rate, and how the render thread waits for each frame (a PacerBackend). Each monitor gets the rate nearest
+// to it that fits its refresh rate (see Schedule.h), or the one in display_fps_GL if that's not 0, in the order
+// Windows lists them.
+int pacer_fps_GL = 30;
+int pacer_backend_GL = PACER_TIMER;
+int display_fps_GL[MAX_MONITORS_EDW590] = {0};
+// The frame rate in the Display Properties preview, which is far too small for 30 to be worth it
+int preview_fps_GL = PREVIEW_FPS;
+// The quality levels the render thread steps down through when the frames take longer than they have, and back up
+// again (see Governor.h), best first. Without governor_enabled_GL, it stays on the first one.
+int governor_enabled_GL = 1;
+struct GovernorLevel governor_levels_GL[] = {
+	{100, -1,             1},
+	{100, SCALE_BILINEAR, 1},
+	{100, SCALE_BILINEAR, 2},
+	{67,  SCALE_BILINEAR, 2},
+	{50,  SCALE_NEAREST,  2},
+	{33,  SCALE_NEAREST,  3},
+};
+// Whether to make glitched frames out of the first image (see Glitch.h) rather than show the zip's frames, and the
+// seed they're made with (0 for a different one each run). Off until the generated look has been approved.
+int glitch_engine_GL = 0;
+unsigned int glitch_seed_GL = 0;
+// How to go from each frame to the next (a TransitionKind), and over how many ticks. Each frame's then shown for that
+// many ticks at least, so the transitions get to finish. Cuts until the look has been approved, like the glitches.
+int transition_GL = TRANSITION_CUT;
+int transition_ticks_GL = 4;
+// Whether to present only the tiles of the windows that changed from the frame before (see Canvas.h)
+int dirty_tiles_GL = 1;
+// Whether to show each frame across all the monitors, as one big picture, rather than all of it on each (see Wall.h),
+// and how many pixels of it the monitors' bezels hide, between those side by side and between those one above the
+// other. Off until the look has been approved, like the glitches.
+int wall_mode_GL = 0;
+int wall_bezel_x_GL = 0;
+int wall_bezel_y_GL = 0;
+// Set, with render_lock_GL held, whenever the saver windows have moved, changed size or gone, or the monitors have
+// changed, for the render thread to work out where the wall goes on them again (only then, not every frame)
+BOOL wall_moved_GL = TRUE;
+// How to draw over a remote desktop connection, where every changed pixel is traffic (see Remote.h), and when: 0 never,
+// 1 when the session is a remote one, 2 always (to try it out locally). remote_session_GL says whether it is, and is
+// looked at again whenever the session changes.
+int remote_mode_GL = 1;
+struct RemotePolicy remote_policy_GL = {5, 10, 5};
+volatile LONG remote_session_GL = 0;
+// The saver windows: one per monitor, or just the preview one
+HWND windows_GL[MAX_MONITORS_EDW590] = {0};
+int num_windows_GL = 0;
+// Each window's monitor's refresh rate and FPS, as in MonitorInfo and display_fps_GL
+int window_refresh_GL[MAX_MONITORS_EDW590] = {0};
+int window_fps_GL[MAX_MONITORS_EDW590] = {0};
+volatile LONG render_quit_GL = 0;
+// Held while windows_GL or the windows' surfaces get touched. The render thread only holds it to pick the surfaces it
+// draws on and to hand them back after (see Surface's busy), not while it draws or loads the frames, so this thread
+// never waits long for it.
+CRITICAL_SECTION render_lock_GL;
+
+// Whether the saver can be seen, and so drawn (see Activity.h). Changed with render_lock_GL held, and then
+// render_wake_GL is set, for the render thread to see to it.
+struct Activity activity_GL;
+HANDLE render_wake_GL = NULL;
+// How much of the decoded frames to keep once it's been suspended for a while, in bytes
+long long cache_budget_GL = 32 * 1024 * 1024;
+
+// For measuring how long it takes the saver to go away: milliseconds of synthetic work the render thread adds to each
+// frame's drawing (with the surfaces busy, as a slow frame would have them), and about the input that closed the
+// saver: how long it waited in the queue, and the performance counter when it got handled. The time from it to
+// DestroyWindow() gets measured (see Measure.h), with measurements_GL.
+int render_load_ms_GL = 0;
+DWORD input_wait_GL = 0;
+LARGE_INTEGER input_counter_GL = {0};
+// What the render thread measured last: how long the stages of the last frame took (making it, and drawing it), the
+// quality level it was drawn at, and how many bytes a second of the windows have been changing lately. Copied in with
+// render_lock_GL held, once a frame, so it's never read half-written.
+struct Measurements {
+	struct PipelineTimings pipeline;
+	struct RenderTimings render;
+	int level;
+	long long changing;
+};
+struct Measurements measurements_GL = {0};
 
 
 // The 2 functions below were copied from https://stackoverflow.com/a/8712996/8228163.
@@ -111,6 +213,29 @@ __inline int c99_snprintf(char *outBuf, size_t size, const char *format, ...) {
     return count;
 }
 
+// A MeasureHook: a line of OutputDebugString() for each measurement.
+static void debugMeasure(void *context, const char *name, long long value, const char *unit) {
+	char message[128];
+	c99_snprintf(message, sizeof(message), "Edw590SCR: %s: %lld %s" NL, name, value, unit);
+	OutputDebugStringA(message);
+	(void) context;
+}
+
+// Passes measurements on to Measure().
+static void measureFrame(const struct Measurements *measurements) {
+	Measure("frame.select", measurements->pipeline.select, "us");
+	Measure("frame.decode", measurements->pipeline.decode, "us");
+	Measure("frame.convert", measurements->pipeline.convert, "us");
+	Measure("render.prepare", measurements->render.prepare, "us");
+	Measure("render.scale", measurements->render.scale, "us");
+	Measure("render.transition", measurements->render.transition, "us");
+	Measure("render.tiles", measurements->render.tiles, "us");
+	Measure("render.present", measurements->render.present, "us");
+	Measure("render.presented", measurements->render.bytes_presented, "B");
+	Measure("render.level", measurements->level, "");
+	Measure("remote.changing", measurements->changing, "B/s");
+}
+
 
 BOOL VerifyPassword(HWND hwnd) {
 	// Under NT, we return TRUE immediately. This lets the saver quit, and the system manages passwords.
@@ -162,6 +287,11 @@ void ChangePassword(HWND hwnd) {
 }
 
 void CloseSaverWindow() {
+	if (input_counter_GL.QuadPart == 0) {
+		// The message time is only as precise as GetTickCount(), so it's only used for the wait in the queue
+		input_wait_GL = GetTickCount() - (DWORD) GetMessageTime();
+		QueryPerformanceCounter(&input_counter_GL);
+	}
 	ss.ReallyClose = TRUE;
 	PostMessage(ss.hwnd, WM_CLOSE, 0, 0);
 }
@@ -198,26 +328,26 @@ void EndDialog2() {
 	CloseHandle(hFile);
 }*/
 
-HBITMAP getImage(int img_num, HDC hdc) {
+BOOL getImage(int img_num, struct Frame *frame) {
 	HRSRC hrsrc = FindResource(hInstance_GL, TEXT("ZIPFILE"), RT_RCDATA);
 	if (hrsrc == NULL) {
-		return NULL;
+		return FALSE;
 	}
 	DWORD size = SizeofResource(hInstance_GL, hrsrc);
 	if (size == 0) {
-		return NULL;
+		return FALSE;
 	}
 	HGLOBAL hglob = LoadResource(hInstance_GL, hrsrc);
 	if (hglob == NULL) {
-		return NULL;
+		return FALSE;
 	}
 	void *buf = LockResource(hglob);
 	if (buf == NULL) {
-		return NULL;
+		return FALSE;
 	}
 	HZIP hzip = OpenZip(buf, size, ZIP_MEMORY);
 	if (hzip == NULL) {
-		return NULL;
+		return FALSE;
 	}
 
 	char image_name[100] = {0};
@@ -226,68 +356,53 @@ HBITMAP getImage(int img_num, HDC hdc) {
 	ZIPENTRY zip_entry = {0};
 	int index = 0;
 	FindZipItem(hzip, image_name, TRUE, &index, &zip_entry);
-	if (index == -1) {
-		return NULL;
+	if (index == -1 || zip_entry.unc_size < 0 || zip_entry.unc_size > 0x7FFFFFFF) {
+		CloseZip(hzip);
+
+		return FALSE;
 	}
 
-	char *image_buf = (char *) malloc(zip_entry.unc_size);
+	char *image_buf = (char *) malloc((size_t) zip_entry.unc_size);
 	if (image_buf == NULL) {
-		return NULL;
+		CloseZip(hzip);
+
+		return FALSE;
 	}
 
-	long unc_size = zip_entry.unc_size;
-	DWORD zip_result = UnzipItem(hzip, index, image_buf, zip_entry.unc_size, ZIP_MEMORY);
+	long unc_size = (long) zip_entry.unc_size;
+	DWORD zip_result = UnzipItem(hzip, index, image_buf, (unsigned int) unc_size, ZIP_MEMORY);
 	while (zip_result == ZR_MORE) {
 		unc_size++;
 		zip_result = UnzipItem(hzip, index, image_buf, unc_size, ZIP_MEMORY);
 	}
+	CloseZip(hzip);
 
 	if (zip_result != ZR_OK) {
-		char str[100] = {0};
-		c99_snprintf(str, sizeof(str), "ZIP error: %lu; index: %d; unc_size: %lu\n", zip_result, index, zip_entry.unc_size);
+		free(image_buf);
 
-		return NULL;
+		return FALSE;
 	}
 
-	CloseZip(hzip);
-
-
+	// Straight to 32 bpp pixels, which is what the scaler works in (no GDI bitmap in between).
+	BOOL ok = FrameFromBMP(frame, image_buf, (unsigned long) zip_entry.unc_size);
+	free(image_buf);
 
-	if (unc_size < sizeof(BITMAPFILEHEADER)) {
-		return NULL;
-	}
+	return ok;
+}
 
-	// Parse BMP headers
-	const BITMAPFILEHEADER *fileHeader = (BITMAPFILEHEADER *) image_buf;
-	if (fileHeader->bfType != 0x4D42) { // Check if 'BM'
-		return NULL;
+// Passes a message about the session or the monitors' power on to activity_GL, and wakes the render thread if that's
+// suspended or resumed the saver.
+static void noteActivity(UINT msg, WPARAM wParam, LPARAM lParam) {
+	EnterCriticalSection(&render_lock_GL);
+	int changed = ActivityMessage(&activity_GL, msg, wParam, lParam);
+	LeaveCriticalSection(&render_lock_GL);
+	if (changed && render_wake_GL != NULL) {
+		SetEvent(render_wake_GL);
 	}
-
-	const BITMAPINFOHEADER *infoHeader = (BITMAPINFOHEADER *)((BYTE *) image_buf + sizeof(BITMAPFILEHEADER));
-	const void *pixelData = (BYTE *) image_buf + fileHeader->bfOffBits;
-
-	// Create the DIB Bitmap
-	HBITMAP hbitmap = CreateDIBitmap(
-			hdc,
-			infoHeader,                // Bitmap information
-			CBM_INIT,                  // Initialize bitmap with data
-			pixelData,                 // Pointer to the actual pixel data
-			(BITMAPINFO *)infoHeader,  // Pointer to bitmap information
-			DIB_RGB_COLORS             // RGB color format
-	);
-
-	free(image_buf);
-
-	return hbitmap;
 }
 
 LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-	static HBITMAP hBitmap = {0};
-	HDC hdc = NULL;
-	PAINTSTRUCT ps = {0};
-	BITMAP bitmap = {0};
-	HDC hdc_mem = NULL;
-	HGDIOBJ oldBitmap = NULL;
+	struct Surface *surface = (struct Surface *) GetWindowLongPtr(hwnd, GWLP_USERDATA);
 
 	switch (msg) {
 		case WM_CREATE: {
@@ -295,86 +410,88 @@ LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			GetCursorPos(&ss.InitCursorPos);
 			ss.InitTime = GetTickCount();
 
-			ss.idTimer = SetTimer(hwnd, 0, 33, NULL); // 1 s / 30 FPS = 33ms
-
-			srand(time(NULL));
+			const CREATESTRUCT *create_struct = (CREATESTRUCT *) lParam;
+			surface = SurfaceCreate(hwnd, create_struct->cx, create_struct->cy);
+			if (surface == NULL) {
+				return -1;
+			}
+			surface->canvas.filter = scale_filter_GL;
+			surface->canvas.transition = transition_GL;
+			surface->canvas.transition_steps = transition_ticks_GL;
+			surface->canvas.dirty_tiles = dirty_tiles_GL;
+			SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR) surface);
 
 			return 0;
 		}
-		case WM_TIMER: {
-			InvalidateRect(hwnd, NULL, TRUE);
+		case WM_MOVE:
+		case WM_DISPLAYCHANGE: {
+			EnterCriticalSection(&render_lock_GL);
+			wall_moved_GL = TRUE;
+			LeaveCriticalSection(&render_lock_GL);
 
-			return 0;
+			break;
 		}
-		case WM_PAINT: {
-			hdc = BeginPaint(hwnd, &ps);
-			if (hdc == NULL) {
-				return 0;
-			}
-
-			hdc_mem = CreateCompatibleDC(hdc);
-			if (hdc_mem == NULL) {
-				return 0;
-			}
-
-			// Pick a random frame (number between 0 and 79)
-			image_num_GL = rand() % 80;
-			hBitmap = images_GL[image_num_GL];
-			if (hBitmap == NULL) {
-				hBitmap = getImage(image_num_GL, hdc);
-				images_GL[image_num_GL] = hBitmap;
-			}
-
-			if (hBitmap == NULL) {
-				return 0;
+		case WM_SIZE: {
+			if (surface != NULL) {
+				EnterCriticalSection(&render_lock_GL);
+				if (surface->busy) {
+					surface->new_width = LOWORD(lParam);
+					surface->new_height = HIWORD(lParam);
+				} else {
+					SurfaceResize(surface, LOWORD(lParam), HIWORD(lParam));
+				}
+				wall_moved_GL = TRUE;
+				LeaveCriticalSection(&render_lock_GL);
+				// The bars have moved, so this time all of the window gets painted.
+				InvalidateRect(hwnd, NULL, FALSE);
 			}
 
-			oldBitmap = SelectObject(hdc_mem, hBitmap);
-			if (oldBitmap == NULL) {
-				return 0;
+			return 0;
+		}
+		case WM_SHOWWINDOW: {
+			// Shown or hidden: the render thread checks which
+			if (render_wake_GL != NULL) {
+				SetEvent(render_wake_GL);
 			}
 
-			if (GetObject(hBitmap, sizeof(bitmap), &bitmap) == 0) {
-				return 0;
-			}
+			break;
+		}
+		case WM_WTSSESSION_CHANGE_EDW590:
+			// Connecting to the session from somewhere else may well have made it a remote one, or not one any more
+			InterlockedExchange(&remote_session_GL, GetSystemMetrics(SM_REMOTESESSION) != 0);
+			// fall through
+		case WM_POWERBROADCAST: {
+			noteActivity(msg, wParam, lParam);
 
-			RECT rect;
-			if (!GetWindowRect(hwnd, &rect)) {
-				return 0;
-			}
-			int window_width = rect.right - rect.left;
-			int window_height = rect.bottom - rect.top;
-
-			if (window_width >= window_height) {
-				// If the window is wider than it is tall, we need to center the image horizontally and stretch it
-				// vertically to fill the window
-				double aspect_ratio = (double) bitmap.bmWidth / bitmap.bmHeight;
-				int image_width = (int) (window_height * aspect_ratio);
-				int x = window_width / 2 - image_width / 2;
-				if (!StretchBlt(hdc, x, 0, image_width, window_height, hdc_mem, 0, 0, bitmap.bmWidth, bitmap.bmHeight,
-				                SRCCOPY)) {
-					return 0;
-				}
+			break;
+		}
+		case WM_ERASEBKGND: {
+			// Everything is painted from the back buffer, bars included, so erasing would just be painting it all twice.
+			return 1;
+		}
+		case WM_PAINT: {
+			// The render thread puts the frames on the window. This is only for when some of it needs painting again
+			// (it's just been uncovered, say), so the back buffer is just copied back. BeginPaint() clips the window's
+			// DC, which the render thread uses too (CS_OWNDC), to what needs painting, so that can't be while the
+			// render thread's drawing on it: then it gets painted again once that's done.
+			EnterCriticalSection(&render_lock_GL);
+			if (surface != NULL && surface->busy) {
+				ValidateRect(hwnd, NULL);
+				surface->repaint = TRUE;
 			} else {
-				// Else, opposite of the above.
-				double aspect_ratio = (double) bitmap.bmHeight / bitmap.bmWidth;
-				int image_height = (int) (window_width * aspect_ratio);
-				int y = window_height / 2 - image_height / 2;
-				if (!StretchBlt(hdc, 0, y, window_width, image_height, hdc_mem, 0, 0, bitmap.bmWidth, bitmap.bmHeight,
-								SRCCOPY)) {
-					return 0;
+				PAINTSTRUCT ps = {0};
+				HDC hdc = BeginPaint(hwnd, &ps);
+				if (hdc != NULL) {
+					if (surface != NULL) {
+						SurfacePresent(surface, hdc, &ps.rcPaint);
+					}
+					EndPaint(hwnd, &ps);
 				}
 			}
-
-			if (SelectObject(hdc_mem, oldBitmap) == NULL) {
-				return 0;
-			}
-			if (!DeleteDC(hdc_mem)) {
-				return 0;
-			}
-
-			if (!EndPaint(hwnd, &ps)) {
-				return 0;
+			LeaveCriticalSection(&render_lock_GL);
+			// Uncovered, maybe, after being all covered up
+			if (render_wake_GL != NULL) {
+				SetEvent(render_wake_GL);
 			}
 
 			return 0;
@@ -427,6 +544,7 @@ LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			return 0;
 		}
 		case WM_SYSCOMMAND: {
+			noteActivity(msg, wParam, lParam);
 			if (scr_mode_GL == MODE_SAVER) {
 				if (wParam == SC_SCREENSAVE || wParam == SC_CLOSE) {
 					return 0;
@@ -445,6 +563,21 @@ LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 				}
 
 				if (CanClose) {
+					if (input_counter_GL.QuadPart != 0) {
+						LARGE_INTEGER counter;
+						LARGE_INTEGER frequency;
+						QueryPerformanceCounter(&counter);
+						QueryPerformanceFrequency(&frequency);
+						long long us = (long long) input_wait_GL * 1000 +
+									   (counter.QuadPart - input_counter_GL.QuadPart) * 1000000 / frequency.QuadPart;
+						EnterCriticalSection(&render_lock_GL);
+						struct Measurements measurements = measurements_GL;
+						LeaveCriticalSection(&render_lock_GL);
+						Measure("close.input_to_destroy", us, "us");
+						Measure("close.render_load", render_load_ms_GL, "ms");
+						measureFrame(&measurements);
+						input_counter_GL.QuadPart = 0;
+					}
 					DestroyWindow(hwnd);
 				}
 			}
@@ -456,11 +589,26 @@ LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			break;
 		}
 		case WM_DESTROY: {
-			if (ss.idTimer != 0) {
-				KillTimer(hwnd, ss.idTimer);
+			// Out of windows_GL first, so the render thread leaves it alone from now on
+			EnterCriticalSection(&render_lock_GL);
+			for (int i = 0; i < num_windows_GL; i++) {
+				if (windows_GL[i] == hwnd) {
+					windows_GL[i] = windows_GL[--num_windows_GL];
+					break;
+				}
+			}
+			wall_moved_GL = TRUE;
+			SetWindowLongPtr(hwnd, GWLP_USERDATA, 0);
+			if (surface != NULL && surface->busy) {
+				// Rather than wait for the render thread to finish with it, it's left for it to free
+				surface->closed = TRUE;
+			} else {
+				SurfaceDestroy(surface);
+			}
+			LeaveCriticalSection(&render_lock_GL);
+			if (hwnd == activity_GL.hwnd) {
+				ActivityUnregister(&activity_GL);
 			}
-			ss.idTimer = 0;
-			DeleteObject(hBitmap);
 			PostQuitMessage(0);
 
 			return 0;
@@ -472,16 +620,38 @@ LRESULT CALLBACK SaverWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 	return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+// The refresh rate of the display called device, in millihertz, or 0 if it's not known. Windows only says it in
+// whole Hz, rounded down, so the NTSC ones (59.94 Hz and the like) come out 1 short of a usual rate, and are taken to
+// be those.
+static int refreshOf(LPCTSTR device) {
+	static const int ntsc_rates[] = {24, 30, 48, 60, 72, 120, 144, 240};
+	DEVMODE mode = {0};
+	mode.dmSize = sizeof(DEVMODE);
+	if (!EnumDisplaySettings(device, ENUM_CURRENT_SETTINGS, &mode) || mode.dmDisplayFrequency <= 1) {
+		return 0; // 0 and 1 mean the hardware's default, whatever it is
+	}
+
+	int hz = (int) mode.dmDisplayFrequency;
+	for (int i = 0; i < (int) (sizeof(ntsc_rates) / sizeof(ntsc_rates[0])); i++) {
+		if (hz + 1 == ntsc_rates[i]) {
+			return (int) ((long long) ntsc_rates[i] * 1000000 / 1001);
+		}
+	}
+
+	return hz * 1000;
+}
+
 BOOL CALLBACK MonitorEnumProc(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMonitor, LPARAM dwData) {
-	MONITORINFO info;
-	info.cbSize = sizeof(MONITORINFO);
-	GetMonitorInfo(hMonitor, &info);
+	MONITORINFOEX info;
+	info.cbSize = sizeof(MONITORINFOEX);
+	GetMonitorInfo(hMonitor, (MONITORINFO *) &info);
 
 	struct MonitorInfo *monitor_info = &monitors_GL[num_monitors_GL];
 	monitor_info->x = info.rcMonitor.left;
 	monitor_info->y = info.rcMonitor.top;
 	monitor_info->width = info.rcMonitor.right - info.rcMonitor.left;
 	monitor_info->height = info.rcMonitor.bottom - info.rcMonitor.top;
+	monitor_info->refresh = refreshOf(info.szDevice);
 
 	num_monitors_GL++;
 
@@ -492,22 +662,441 @@ BOOL CALLBACK MonitorEnumProc(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMoni
 	return TRUE;
 }
 
+// Whether any of the saver windows can be seen: shown, not minimised, and not covered up. Windows with desktop
+// composition always says they're not covered, but then nothing there is covering a saver anyway. Call with
+// render_lock_GL held.
+static BOOL anyWindowShowing(void) {
+	for (int i = 0; i < num_windows_GL; i++) {
+		HWND hwnd = windows_GL[i];
+		if (!IsWindowVisible(hwnd) || IsIconic(hwnd)) {
+			continue;
+		}
+		HDC hdc = GetDC(hwnd);
+		RECT clip;
+		int region = hdc != NULL ? GetClipBox(hdc, &clip) : ERROR;
+		ReleaseDC(hwnd, hdc);
+		if (region != NULLREGION) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+// Lets go of what can be made again, once the saver's been suspended for a while (and the pipeline's been stopped,
+// with the glitched frames): the canvases' plans, and the decoded frames past cache_budget_GL (bar the one on the
+// screens).
+static void releaseCaches(void) {
+	ActivityTrimFrames(images_GL, 80, image_num_GL, cache_budget_GL);
+
+	EnterCriticalSection(&render_lock_GL);
+	for (int i = 0; i < num_windows_GL; i++) {
+		struct Surface *surface = (struct Surface *) GetWindowLongPtr(windows_GL[i], GWLP_USERDATA);
+		if (surface != NULL) {
+			CanvasRelease(&surface->canvas);
+		}
+	}
+	LeaveCriticalSection(&render_lock_GL);
+}
+
+// Sets canvas up for drawing over a remote desktop connection or not, as remote says.
+static void configureCanvas(struct Canvas *canvas, int remote) {
+	if (remote) {
+		RemoteApply(&remote_policy_GL, canvas);
+
+		return;
+	}
+
+	canvas->transition = transition_GL;
+	canvas->dirty_tiles = dirty_tiles_GL;
+	if (canvas->channel_bits != 8) {
+		canvas->channel_bits = 8;
+		canvas->frame = NULL;
+	}
+}
+
+// Puts wall on the saver windows, where they are, if they've moved since it last was (see wall_moved_GL). Needs
+// render_lock_GL held. Returns FALSE if it can't be (there's no memory for it, say): then the windows draw the frames
+// themselves, until they move again.
+static BOOL setUpWall(struct Wall *wall) {
+	if (!wall_moved_GL) {
+		return wall->num_monitors > 0;
+	}
+	wall_moved_GL = FALSE;
+
+	struct RenderTarget *screens[MAX_MONITORS_EDW590];
+	struct CanvasRect desktop[MAX_MONITORS_EDW590];
+	int num_screens = 0;
+	for (int i = 0; i < num_windows_GL; i++) {
+		struct Surface *surface = (struct Surface *) GetWindowLongPtr(windows_GL[i], GWLP_USERDATA);
+		RECT rect;
+		if (surface != NULL && GetWindowRect(windows_GL[i], &rect)) {
+			screens[num_screens] = &surface->target;
+			desktop[num_screens].left = rect.left;
+			desktop[num_screens].top = rect.top;
+			desktop[num_screens].right = rect.right;
+			desktop[num_screens].bottom = rect.bottom;
+			num_screens++;
+		}
+	}
+
+	return WallSetMonitors(wall, screens, desktop, num_screens, wall_bezel_x_GL, wall_bezel_y_GL);
+}
+
+// The render thread's done drawing on surface: does what the window's thread left for it to do meanwhile (see
+// Surface's busy). Needs render_lock_GL held.
+static void handBack(struct Surface *surface) {
+	surface->busy = FALSE;
+	if (surface->closed) {
+		SurfaceDestroy(surface);
+
+		return;
+	}
+	if (surface->new_width > 0 || surface->new_height > 0) {
+		SurfaceResize(surface, surface->new_width, surface->new_height);
+		surface->new_width = 0;
+		surface->new_height = 0;
+		surface->repaint = TRUE;
+	}
+	if (surface->repaint) {
+		surface->repaint = FALSE;
+		InvalidateRect(surface->hwnd, NULL, FALSE);
+	}
+}
+
+// Makes the next of the preview's frames, from a full size image that's freed again straight away. The images are
+// spread out over all 80. Returns FALSE if it couldn't be made.
+static BOOL addPreviewFrame(struct Preview *preview) {
+	RECT rect = {0};
+	EnterCriticalSection(&render_lock_GL);
+	if (num_windows_GL > 0) {
+		GetClientRect(windows_GL[0], &rect);
+	}
+	LeaveCriticalSection(&render_lock_GL);
+
+	struct Frame full = {0};
+	if (!getImage(preview->num_frames * 80 / PREVIEW_MAX_FRAMES, &full)) {
+		return FALSE;
+	}
+	BOOL ok = PreviewAddFrame(preview, &full, rect.right, rect.bottom);
+	FrameFree(&full);
+
+	return ok;
+}
+
+// What the pipeline's thread makes the frames with (see produceFrame()).
+struct Producer {
+	struct Clock *clock;
+	BOOL previewing;
+	struct Preview preview;
+	BOOL preview_failed;
+	unsigned int glitch_seed;
+	BOOL seeded;
+};
+
+static long long elapsed(struct Clock *clock, long long *since) {
+	long long now = clock->now(clock);
+	long long time = now - *since;
+	*since = now;
+
+	return time;
+}
+
+// A PipelineProduce, for the pipeline's thread: picks the next frame, and loads and glitches it as need be.
+static int produceFrame(void *context, struct PipelineItem *item) {
+	struct Producer *producer = (struct Producer *) context;
+	struct Preview *preview = &producer->preview;
+	struct Clock *clock = producer->clock;
+	if (!producer->seeded) {
+		srand(time(NULL)); // rand() is per thread
+		producer->seeded = TRUE;
+	}
+
+	long long since = clock->now(clock);
+	if (producer->previewing && !producer->preview_failed && preview->num_frames < PREVIEW_MAX_FRAMES) {
+		producer->preview_failed = !addPreviewFrame(preview);
+		item->timings.decode += elapsed(clock, &since);
+	}
+
+	if (glitch_engine_GL) {
+		// The item's glitches on the first image, the same ones every time for the same seed
+		image_num_GL = 0;
+		struct Frame *base = producer->previewing ? &preview->frames[0] : &images_GL[0];
+		item->timings.select += elapsed(clock, &since);
+		if (!producer->previewing && base->pixels == NULL && getImage(0, base)) {
+			ScaleBuildMips(base, NULL);
+		}
+		item->timings.decode += elapsed(clock, &since);
+		if (base->pixels == NULL) {
+			return 0;
+		}
+		if (item->buffer.width != base->width || item->buffer.height != base->height) {
+			FrameFree(&item->buffer);
+			if (!FrameAlloc(&item->buffer, base->width, base->height)) {
+				return 0;
+			}
+		}
+		struct GlitchPlan plan;
+		GlitchPlanInit(&plan, base->width, base->height, producer->glitch_seed, (unsigned long) item->sequence);
+		GlitchFrame(&plan, base, &item->buffer, NULL);
+		item->frame = &item->buffer;
+		item->timings.convert += elapsed(clock, &since);
+	} else if (producer->previewing) {
+		if (preview->num_frames == 0) {
+			return 0;
+		}
+		int index = rand() % preview->num_frames;
+		image_num_GL = index * 80 / PREVIEW_MAX_FRAMES;
+		item->frame = &preview->frames[index];
+		item->timings.select += elapsed(clock, &since);
+	} else {
+		// Pick a random frame (number between 0 and 79), for all the monitors. It's only ever decoded (and given its
+		// mips, for the smaller monitors to scale from) the first time, and then only scaled once per resolution (see
+		// ScaleJobsTiled()).
+		image_num_GL = rand() % 80;
+		struct Frame *frame = &images_GL[image_num_GL];
+		item->timings.select += elapsed(clock, &since);
+		if (frame->pixels == NULL && getImage(image_num_GL, frame)) {
+			ScaleBuildMips(frame, NULL);
+		}
+		item->timings.decode += elapsed(clock, &since);
+		if (frame->pixels == NULL) {
+			return 0;
+		}
+		item->frame = frame;
+	}
+
+	return 1;
+}
+
+// Draws the frames on the saver windows, each on time, until render_quit_GL is set. Loading, scaling and presenting
+// all happen off the windows' own thread, so however long they take, it's free for the input that closes the saver.
+// They happen without render_lock_GL too, the surfaces being drawn on marked busy instead, so the window's thread
+// never has to wait for them (see Surface's busy).
+//
+// The frames are picked, loaded and glitched on a pipeline's thread (see Pipeline.h), a frame or 2 ahead, and only
+// scaled and presented here. All the monitors show the same frame, and RenderFrame() scales it for all of them at
+// once on scale_pool_GL's threads, and presents it on all of them together. If the next frame isn't ready in time,
+// the one before stays up a tick longer.
+//
+// Each monitor is presented at its own rate, though, a whole number of its refreshes (see Schedule.h). It's the first
+// one's that the frames change at: the others show whichever is the latest when their turn comes.
+//
+// While nobody can see them (see Activity.h), it doesn't wait for frames at all, just for render_wake_GL.
+//
+// The preview gets a few small frames instead (see Preview.h), made one a frame at the start, at preview_fps_GL.
+//
+// With transitions (transition_GL), each frame is held for transition_ticks_GL ticks, the canvases taking a step
+// towards it on each one.
+//
+// With wall_mode_GL, the frame's scaled once for all the monitors together instead, across all of them (see Wall.h),
+// and they all get it at the first one's rate.
+//
+// Over a remote desktop connection, it goes by remote_policy_GL instead. How many bytes a second are changing goes in
+// measurements_GL, with the rest.
+DWORD WINAPI RenderThread(LPVOID param) {
+	struct Clock *clock = (struct Clock *) param;
+	BOOL previewing = scr_mode_GL == MODE_PREVIEW;
+	struct Producer producer = {0};
+	producer.clock = clock;
+	producer.previewing = previewing;
+	PreviewInit(&producer.preview);
+	producer.glitch_seed = glitch_seed_GL != 0 ? glitch_seed_GL : (unsigned int) time(NULL);
+	struct Pipeline *pipeline = NULL;
+	struct Schedule schedule;
+	ScheduleInit(&schedule, clock, previewing ? preview_fps_GL : pacer_fps_GL, (enum PacerBackend) pacer_backend_GL);
+	// Each window keeps its display for good, however windows_GL gets shuffled as the others go
+	EnterCriticalSection(&render_lock_GL);
+	for (int i = 0; i < num_windows_GL; i++) {
+		struct Surface *surface = (struct Surface *) GetWindowLongPtr(windows_GL[i], GWLP_USERDATA);
+		int display = ScheduleAddDisplay(&schedule, window_refresh_GL[i], previewing ? 0 : window_fps_GL[i]);
+		if (surface != NULL) {
+			surface->display = display >= 0 ? display : 0;
+		}
+	}
+	LeaveCriticalSection(&render_lock_GL);
+	unsigned char due[SCHEDULE_MAX_DISPLAYS] = {0};
+	struct Governor governor;
+	GovernorInit(&governor, governor_levels_GL, sizeof(governor_levels_GL) / sizeof(governor_levels_GL[0]),
+				 pacer_fps_GL);
+	struct RenderTarget *targets[MAX_MONITORS_EDW590];
+	struct Surface *busy[MAX_MONITORS_EDW590];
+	struct Wall wall;
+	WallInit(&wall);
+	struct PipelineItem *held = NULL;   // the item whose frame is on the screens
+	int hold = 0;
+	int remote = -1;
+	struct RemoteMeter meter;   // how many bytes a second of the windows have been changing
+	RemoteMeterInit(&meter, clock->now(clock));
+	struct RenderTimings timings;
+	while (!render_quit_GL) {
+		EnterCriticalSection(&render_lock_GL);
+		ActivitySet(&activity_GL, ACTIVITY_HIDDEN, !anyWindowShowing());
+		long long wait = -1;
+		enum ActivityAction action = ActivityPoll(&activity_GL, clock->now(clock), &wait);
+		LeaveCriticalSection(&render_lock_GL);
+		if (action == ACTIVITY_SLEEP) {
+			DWORD ms = wait < 0 ? INFINITE : (DWORD) ((wait + 999) / 1000);
+			if (render_wake_GL != NULL) {
+				WaitForSingleObject(render_wake_GL, ms);
+			} else {
+				Sleep(ms == INFINITE ? 250 : ms);
+			}
+			continue;
+		}
+		if (action == ACTIVITY_RELEASE) {
+			// The pipeline's thread uses the decoded frames too, so it goes first (and the glitched frames with it)
+			PipelineDestroy(pipeline);
+			pipeline = NULL;
+			held = NULL;
+			hold = 0;
+			releaseCaches();
+			EnterCriticalSection(&render_lock_GL);
+			WallFree(&wall);
+			// With no monitors now, so it has to be put on them again
+			wall_moved_GL = TRUE;
+			LeaveCriticalSection(&render_lock_GL);
+			continue;
+		}
+		if (pipeline == NULL) {
+			pipeline = PipelineCreate(clock, produceFrame, &producer);
+			if (pipeline == NULL) {
+				Sleep(250);
+				continue;
+			}
+		}
+		if (action == ACTIVITY_RESUME) {
+			ScheduleRestart(&schedule);
+		}
+
+		int now_remote = remote_mode_GL == 2 || (remote_mode_GL == 1 && remote_session_GL);
+		if (now_remote != remote) {
+			remote = now_remote;
+			int fps = previewing ? preview_fps_GL : pacer_fps_GL;
+			if (remote) {
+				fps = RemoteFps(&remote_policy_GL, fps);
+			}
+			ScheduleSetFps(&schedule, fps);
+			GovernorInit(&governor, governor_levels_GL, sizeof(governor_levels_GL) / sizeof(governor_levels_GL[0]),
+						 fps);
+		}
+
+		ScheduleWait(&schedule, due);
+		long long work_start = clock->now(clock);
+
+		struct PipelineItem *item = NULL;
+		if (!due[0]) {
+			// Not a new frame's turn: just the other monitors getting the one there is
+		} else if (hold > 0) {
+			hold--;
+		} else {
+			item = PipelineTake(pipeline);
+		}
+		if (item != NULL) {
+			if (held != NULL) {
+				PipelineRelease(pipeline, held);
+			}
+			held = item;
+			if (remote) {
+				hold = remote_policy_GL.hold_ticks - 1;
+			} else {
+				hold = transition_GL != TRANSITION_CUT ? transition_ticks_GL - 1 : 0;
+			}
+		}
+		if (held == NULL) {
+			continue;
+		}
+		struct Frame *frame = held->frame;
+
+		const struct GovernorLevel *level = GovernorCurrent(&governor);
+		int filter = level->filter >= 0 ? level->filter : scale_filter_GL;
+		EnterCriticalSection(&render_lock_GL);
+		int num_targets = 0;
+		int num_busy = 0;
+		if (wall_mode_GL && !previewing && setUpWall(&wall)) {
+			if (due[0]) {
+				CanvasSetQuality(&wall.canvas, filter, level->divisor);
+				configureCanvas(&wall.canvas, remote);
+				targets[num_targets++] = &wall.target;
+				// It gets drawn on all of the windows
+				for (int i = 0; i < num_windows_GL; i++) {
+					struct Surface *surface = (struct Surface *) GetWindowLongPtr(windows_GL[i], GWLP_USERDATA);
+					if (surface != NULL) {
+						surface->busy = TRUE;
+						busy[num_busy++] = surface;
+					}
+				}
+			}
+		} else {
+			for (int i = 0; i < num_windows_GL; i++) {
+				struct Surface *surface = (struct Surface *) GetWindowLongPtr(windows_GL[i], GWLP_USERDATA);
+				if (surface != NULL && due[surface->display]) {
+					CanvasSetQuality(&surface->canvas, filter, level->divisor);
+					configureCanvas(&surface->canvas, remote);
+					targets[num_targets++] = &surface->target;
+					surface->busy = TRUE;
+					busy[num_busy++] = surface;
+				}
+			}
+		}
+		LeaveCriticalSection(&render_lock_GL);
+
+		if (render_load_ms_GL > 0) {
+			DWORD start = GetTickCount();
+			while (GetTickCount() - start < (DWORD) render_load_ms_GL) {
+				// synthetic load
+			}
+		}
+		RenderFrame(targets, num_targets, frame, scale_pool_GL, clock, &timings);
+		RemoteMeterAdd(&meter, clock->now(clock), timings.bytes_presented);
+
+		EnterCriticalSection(&render_lock_GL);
+		for (int i = 0; i < num_busy; i++) {
+			handBack(busy[i]);
+		}
+		measurements_GL.pipeline = held->timings;
+		measurements_GL.render = timings;
+		measurements_GL.level = governor.level;
+		measurements_GL.changing = meter.rate;
+		LeaveCriticalSection(&render_lock_GL);
+
+		// All of this thread's work counts, not just RenderFrame()'s (the making of the frames is on another thread)
+		if (governor_enabled_GL && !previewing && due[0] &&
+			GovernorUpdate(&governor, clock->now(clock) - work_start)) {
+			ScheduleSetFps(&schedule, GovernorFps(&governor));
+		}
+	}
+	PipelineDestroy(pipeline);
+	PreviewFree(&producer.preview);
+	WallFree(&wall);
+
+	return 0;
+}
+
 void DoSaver(HWND hparwnd) {
 	WNDCLASS wnd_class = {0};
-	wnd_class.style = CS_HREDRAW | CS_VREDRAW;
+	wnd_class.style = CS_HREDRAW | CS_VREDRAW | CS_OWNDC;
 	wnd_class.lpfnWndProc = SaverWindowProc;
 	wnd_class.cbClsExtra = 0;
 	wnd_class.cbWndExtra = 0;
 	wnd_class.hInstance = hInstance_GL;
 	wnd_class.hIcon = NULL;
 	wnd_class.hCursor = NULL;
-	wnd_class.hbrBackground = (HBRUSH) GetStockObject(BLACK_BRUSH);
+	wnd_class.hbrBackground = NULL; // the surfaces paint their own bars
 	wnd_class.lpszMenuName = NULL;
 	wnd_class.lpszClassName = "ScrClass";
 
 	if (RegisterClass(&wnd_class) == 0) {
 		return;
 	}
+	InitializeCriticalSection(&render_lock_GL);
+	ActivityInit(&activity_GL, 5000000, 250000);
+	render_wake_GL = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	// A thread per processor for the full screen windows. The preview one is too small to be worth it.
+	if (scr_mode_GL == MODE_SAVER) {
+		scale_pool_GL = ThreadPoolCreate(0);
+	}
 
 	HWND hScrWindow = NULL;
 	if (scr_mode_GL == MODE_PREVIEW) {
@@ -517,6 +1106,9 @@ void DoSaver(HWND hparwnd) {
 		int cy = rc.bottom - rc.top;
 		hScrWindow = CreateWindowExA(0, "ScrClass", "Edw590", WS_CHILD | WS_VISIBLE, 0, 0, cx, cy, hparwnd, NULL,
 		                             hInstance_GL, NULL);
+		if (hScrWindow != NULL) {
+			windows_GL[num_windows_GL++] = hScrWindow;
+		}
 	} else {
 		EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, 0);
 		for (int i = 0; i < num_monitors_GL; i++) {
@@ -533,27 +1125,74 @@ void DoSaver(HWND hparwnd) {
 										 NULL,
 										 hInstance_GL,
 										 NULL);
+			if (hScrWindow != NULL) {
+				window_refresh_GL[num_windows_GL] = monitor_info->refresh;
+				window_fps_GL[num_windows_GL] = display_fps_GL[i];
+				windows_GL[num_windows_GL++] = hScrWindow;
+			}
 		}
 	}
 
 	if (hScrWindow == NULL) {
+		ThreadPoolDestroy(scale_pool_GL);
+		scale_pool_GL = NULL;
+		if (render_wake_GL != NULL) {
+			CloseHandle(render_wake_GL);
+			render_wake_GL = NULL;
+		}
+		DeleteCriticalSection(&render_lock_GL);
+
 		return;
 	}
+	// One window's enough to hear about the session and the monitors' power
+	ActivityRegister(&activity_GL, windows_GL[0]);
 
 	UINT dummy;
 	if (scr_mode_GL == MODE_SAVER) {
 		SystemParametersInfo(SPI_SCREENSAVERRUNNING, 1, &dummy, 0);
 	}
 
+	remote_session_GL = GetSystemMetrics(SM_REMOTESESSION) != 0;
+
+	// From here on, this thread only pumps messages and checks the input: the drawing is all on the render thread.
+	struct Clock *clock = ClockCreateSystem();
+	HANDLE render_thread = NULL;
+	render_quit_GL = 0;
+	if (clock != NULL) {
+		render_thread = CreateThread(NULL, 0, RenderThread, clock, 0, NULL);
+	}
+
 	MSG msg;
 	while (GetMessage(&msg, NULL, 0, 0)) {
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
 	}
 
+	if (render_thread != NULL) {
+		InterlockedExchange(&render_quit_GL, 1);
+		if (render_wake_GL != NULL) {
+			SetEvent(render_wake_GL);
+		}
+		WaitForSingleObject(render_thread, INFINITE);
+		CloseHandle(render_thread);
+	}
+	ClockDestroySystem(clock);
+	num_windows_GL = 0;
+
 	if (scr_mode_GL == MODE_SAVER) {
 		SystemParametersInfo(SPI_SCREENSAVERRUNNING, 0, &dummy, 0);
 	}
+
+	ThreadPoolDestroy(scale_pool_GL);
+	scale_pool_GL = NULL;
+	for (int i = 0; i < 80; i++) {
+		FrameFree(&images_GL[i]);
+	}
+	if (render_wake_GL != NULL) {
+		CloseHandle(render_wake_GL);
+		render_wake_GL = NULL;
+	}
+	DeleteCriticalSection(&render_lock_GL);
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd) {
@@ -561,6 +1200,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	ss.PasswordDelay = 15;
 
 	hInstance_GL = hInstance;
+	MeasureSetHook(debugMeasure, NULL);
 	char *c = GetCommandLine();
 	if (*c == '\"') {
 		c++;
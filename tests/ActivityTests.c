@@ -0,0 +1,197 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include "Tests.h"
+#include "../Utils/Activity.h"
+
+// The Activity rules (see Activity.h), with made-up visibility, session and power events, and a render thread that
+// does what main.c's does: sets ACTIVITY_HIDDEN each time round, draws a frame on ACTIVITY_RUN, and on ACTIVITY_SLEEP
+// sleeps as long as it's told, or until an event that changes whether it's suspended wakes it.
+
+#define SECOND 1000000LL
+#define RELEASE_DELAY (5 * SECOND)  // what main.c uses
+#define POLL_INTERVAL (SECOND / 4)
+#define FRAME 33333
+#define END (80 * SECOND)
+
+// The events from window messages. Whether the windows are hidden isn't one: it gets looked at (see hidden()).
+struct Event {
+	long long time;
+	unsigned int reason;
+	int on;
+};
+
+static const struct Event events[] = {
+	{10 * SECOND, ACTIVITY_LOCKED, 1},
+	{30 * SECOND, ACTIVITY_LOCKED, 0},
+	{40 * SECOND, ACTIVITY_DISPLAY_OFF, 1},
+	{43 * SECOND, ACTIVITY_DISPLAY_OFF, 0},
+	{50 * SECOND, ACTIVITY_DISCONNECTED, 1},
+	{52 * SECOND, ACTIVITY_LOCKED, 1},
+	{58 * SECOND, ACTIVITY_DISCONNECTED, 0},
+	{70 * SECOND, ACTIVITY_LOCKED, 0},
+};
+#define NUM_EVENTS ((int) (sizeof(events) / sizeof(events[0])))
+
+// The suspensions that should come of them (and of hidden()): when each starts (to within a frame, as it's noticed
+// when the next one would be drawn), when it ends (to within the polling interval if it's by the windows showing
+// again), and whether it's long enough for the caches to be released.
+struct Suspension {
+	long long start;
+	long long end;
+	int polled;
+	int released;
+};
+
+static const struct Suspension suspensions[] = {
+	{1 * SECOND, 4 * SECOND, 1, 0},
+	{10 * SECOND, 30 * SECOND, 0, 1},
+	{40 * SECOND, 43 * SECOND, 0, 0},
+	{50 * SECOND, 70 * SECOND, 0, 1},
+};
+#define NUM_SUSPENSIONS ((int) (sizeof(suspensions) / sizeof(suspensions[0])))
+
+static int hidden(long long time) {
+	return (time >= 1 * SECOND && time < 4 * SECOND) || (time >= 12 * SECOND && time < 20 * SECOND);
+}
+
+// When the next of the events from the next'th on would wake the render thread, or -1 for never.
+static long long nextWake(const struct Activity *activity, int next) {
+	struct Activity copy = *activity;
+	for (int i = next; i < NUM_EVENTS; i++) {
+		if (ActivitySet(&copy, events[i].reason, events[i].on)) {
+			return events[i].time;
+		}
+	}
+
+	return -1;
+}
+
+static void checkEvents(void) {
+	struct Activity activity;
+	ActivityInit(&activity, RELEASE_DELAY, POLL_INTERVAL);
+	long long starts[NUM_SUSPENSIONS];
+	long long ends[NUM_SUSPENSIONS];
+	long long releases[NUM_SUSPENSIONS];
+	int num_starts = 0;
+	int num_ends = 0;
+	int num_releases = 0;
+	int wakes = 0;
+
+	long long time = 0;
+	int next = 0;
+	while (time < END) {
+		for (; next < NUM_EVENTS && events[next].time <= time; next++) {
+			ActivitySet(&activity, events[next].reason, events[next].on);
+		}
+		ActivitySet(&activity, ACTIVITY_HIDDEN, hidden(time));
+		int was_suspended = activity.suspended;
+		long long wait = -1;
+		enum ActivityAction action = ActivityPoll(&activity, time, &wait);
+		if (activity.suspended && !was_suspended && num_starts < NUM_SUSPENSIONS) {
+			starts[num_starts++] = activity.suspended_at;
+		}
+		if (action == ACTIVITY_RUN || action == ACTIVITY_RESUME) {
+			// Nothing gets drawn that nobody can see
+			CHECK(activity.reasons == 0 && !activity.suspended);
+			if (action == ACTIVITY_RESUME && num_ends < NUM_SUSPENSIONS) {
+				ends[num_ends++] = time;
+			}
+			time += FRAME;
+		} else if (action == ACTIVITY_RELEASE) {
+			if (num_releases < NUM_SUSPENSIONS) {
+				releases[num_releases++] = time;
+			}
+		} else {
+			// Never asleep for good with only the polled reasons to wake it up
+			CHECK(wait >= 0 || (activity.reasons & ACTIVITY_POLLED) == 0);
+			CHECK(wait < 0 || wait <= POLL_INTERVAL || (activity.reasons & ACTIVITY_POLLED) == 0);
+			long long wake = nextWake(&activity, next);
+			if (wait >= 0 && (wake < 0 || time + wait < wake)) {
+				wake = time + wait;
+			}
+			CHECK(wake > time);
+			time = wake;
+			wakes++;
+		}
+	}
+
+	CHECK(num_starts == NUM_SUSPENSIONS && num_ends == NUM_SUSPENSIONS && activity.suspensions == NUM_SUSPENSIONS);
+	long long suspended_time = 0;
+	int released = 0;
+	for (int i = 0; i < num_starts && i < num_ends; i++) {
+		const struct Suspension *expected = &suspensions[i];
+		int ok = starts[i] >= expected->start && starts[i] < expected->start + FRAME;
+		ok = ok && (expected->polled ? ends[i] >= expected->end && ends[i] <= expected->end + POLL_INTERVAL
+								   : ends[i] == expected->end);
+		if (!CHECK(ok)) {
+			printf("activity: suspension %d from %lld to %lld\n", i, starts[i], ends[i]);
+		}
+		suspended_time += ends[i] - starts[i];
+		if (expected->released) {
+			CHECK(released < num_releases && releases[released] == starts[i] + RELEASE_DELAY);
+			released++;
+		}
+	}
+	CHECK(num_releases == released && activity.suspended_time == suspended_time);
+	// Polled 4 times a second while hidden, and otherwise only woken when there's something to do
+	if (!CHECK(wakes <= 3 * 4 + 5 * 4 + 10)) {
+		printf("activity: woken %d times while suspended\n", wakes);
+	}
+}
+
+// ActivitySet() says when a reason starts or ends a suspension, and not when it's one of several.
+static void checkSet(void) {
+	struct Activity activity;
+	ActivityInit(&activity, RELEASE_DELAY, POLL_INTERVAL);
+	CHECK(ActivitySet(&activity, ACTIVITY_LOCKED, 1));
+	CHECK(!ActivitySet(&activity, ACTIVITY_LOCKED, 1));
+	CHECK(!ActivitySet(&activity, ACTIVITY_DISPLAY_OFF, 1));
+	CHECK(!ActivitySet(&activity, ACTIVITY_LOCKED, 0));
+	CHECK(ActivitySet(&activity, ACTIVITY_DISPLAY_OFF, 0));
+	CHECK(!ActivitySet(&activity, ACTIVITY_DISPLAY_OFF, 0) && activity.reasons == 0);
+}
+
+// ActivityTrimFrames() frees the first frames but the one kept, until the rest fit the budget.
+static void checkTrim(void) {
+	struct Frame frames[4];
+	for (int i = 0; i < 4; i++) {
+		if (!TestPicture(&frames[i], 16, 16, 0)) {
+			return;
+		}
+	}
+	long long size = (long long) frames[0].stride * frames[0].height * 4;
+	CHECK(ActivityTrimFrames(frames, 4, 1, 4 * size) == 0);
+	CHECK(ActivityTrimFrames(frames, 4, 1, 2 * size + 1) == 2 * size);
+	CHECK(frames[0].pixels == NULL && frames[1].pixels != NULL && frames[2].pixels == NULL && frames[3].pixels != NULL);
+	CHECK(ActivityTrimFrames(frames, 4, 1, 0) == size && frames[1].pixels != NULL && frames[3].pixels == NULL);
+	FrameFree(&frames[1]);
+}
+
+int ActivityTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkSet();
+	checkEvents();
+	checkTrim();
+
+	return 0;
+}
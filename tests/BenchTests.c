@@ -0,0 +1,261 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Clock.h"
+#include "../Utils/Offscreen.h"
+#include "../Utils/Render.h"
+#include "../Utils/Scaler.h"
+#include "../Utils/ThreadPool.h"
+#include "../Utils/Transition.h"
+
+// Benchmarks of the rendering on offscreen monitors, so they run anywhere, with no windows or displays. For each,
+// how long a tick takes, and in which stages. They check that every monitor ends up with the frame too, so with
+// --quick (smaller, shorter, fewer monitors) they're a test as well.
+//
+// monitors: 1 to 8 monitors of mixed sizes, and of the same size, with all of them rendered together (one
+// RenderFrame(), as the render thread does) and one after another (the way it was before).
+// transitions: each kind of transition (see Transition.h) on 1, 4 and 8 monitors, a new frame every
+// TRANSITION_TICKS ticks, so the transitions all finish.
+// cores: one 4K monitor on 1 thread, then on twice as many each time up to one per processor, with how many pixels a
+// second each gets through and how many times faster than on 1 thread that is: how well the scaling spreads out.
+//
+// usage: edw590scr_tests bench [--quick]
+
+#define BENCH_MAX_MONITORS 8
+#define TRANSITION_TICKS 4
+#define CORES_WIDTH 3840
+#define CORES_HEIGHT 2160
+
+// The monitors, in the order they're added: the common sizes, one portrait
+static const int monitor_sizes[BENCH_MAX_MONITORS][2] = {
+	{1920, 1080}, {2560, 1440}, {1920, 1080}, {1280, 1024}, {3840, 2160}, {1920, 1080}, {1080, 1920}, {2560, 1440},
+};
+
+struct Bench {
+	int quick;
+	int ticks;
+	struct Frame frames[2];     // shown in turn, so every tick has a new frame to scale
+	struct ThreadPool *pool;
+	struct Clock *clock;
+};
+
+struct Monitors {
+	struct Offscreen *offscreens[BENCH_MAX_MONITORS];
+	struct RenderTarget *targets[BENCH_MAX_MONITORS];
+	int num_monitors;
+};
+
+// num_monitors monitors, all of the first size if same, at a quarter of the size with --quick.
+static int createMonitors(struct Monitors *monitors, const struct Bench *bench, int num_monitors, int same) {
+	memset(monitors, 0, sizeof(*monitors));
+	for (int i = 0; i < num_monitors; i++) {
+		const int *size = monitor_sizes[same ? 0 : i];
+		int divisor = bench->quick ? 4 : 1;
+		monitors->offscreens[i] = OffscreenCreate(size[0] / divisor, size[1] / divisor);
+		if (monitors->offscreens[i] == NULL) {
+			return 0;
+		}
+		monitors->targets[i] = &monitors->offscreens[i]->target;
+		monitors->num_monitors++;
+	}
+
+	return 1;
+}
+
+static void destroyMonitors(struct Monitors *monitors) {
+	for (int i = 0; i < monitors->num_monitors; i++) {
+		OffscreenDestroy(monitors->offscreens[i]);
+	}
+}
+
+static void addTimings(struct RenderTimings *total, const struct RenderTimings *timings) {
+	total->prepare += timings->prepare;
+	total->scale += timings->scale;
+	total->transition += timings->transition;
+	total->tiles += timings->tiles;
+	total->present += timings->present;
+	total->bytes_presented += timings->bytes_presented;
+}
+
+// Renders bench's ticks on monitors, all together or one after another, with a new frame every hold ticks, and
+// returns how long it took in all, in microseconds, with the stages' times added up in total.
+static long long runTicks(const struct Bench *bench, struct Monitors *monitors, int together, int hold,
+						  struct RenderTimings *total) {
+	memset(total, 0, sizeof(*total));
+	long long elapsed = 0;
+	for (int tick = 0; tick < bench->ticks; tick++) {
+		const struct Frame *frame = &bench->frames[tick / hold % 2];
+		struct RenderTimings timings;
+		long long start = bench->clock->now(bench->clock);
+		if (together) {
+			CHECK(RenderFrame(monitors->targets, monitors->num_monitors, frame, bench->pool, bench->clock, &timings));
+			addTimings(total, &timings);
+		} else {
+			for (int i = 0; i < monitors->num_monitors; i++) {
+				CHECK(RenderFrame(&monitors->targets[i], 1, frame, bench->pool, bench->clock, &timings));
+				addTimings(total, &timings);
+			}
+		}
+		elapsed += bench->clock->now(bench->clock) - start;
+
+		for (int i = 0; i < monitors->num_monitors; i++) {
+			const struct Offscreen *offscreen = monitors->offscreens[i];
+			size_t size = (size_t) offscreen->canvas.width * offscreen->canvas.height * 4;
+			CHECK(memcmp(offscreen->front, offscreen->back, size) == 0);
+		}
+	}
+
+	return elapsed;
+}
+
+static void printTicks(const char *name, const struct Bench *bench, long long elapsed,
+					   const struct RenderTimings *total) {
+	double ticks = bench->ticks;
+	printf("bench: %-30s %7.2f ms a tick (prepare %.2f, scale %.2f, transition %.2f, tiles %.2f, present %.2f), "
+		   "%.1f MB presented\n", name, elapsed / ticks / 1000, total->prepare / ticks / 1000,
+		   total->scale / ticks / 1000, total->transition / ticks / 1000, total->tiles / ticks / 1000,
+		   total->present / ticks / 1000, total->bytes_presented / ticks / 1048576);
+}
+
+static void benchMonitors(const struct Bench *bench) {
+	static const int quick_counts[] = {1, 2, 8};
+	static const int counts[] = {1, 2, 3, 4, 5, 6, 7, 8};
+	const int *num_monitors = bench->quick ? quick_counts : counts;
+	int num_counts = bench->quick ? 3 : 8;
+	for (int same = 0; same < 2; same++) {
+		for (int c = 0; c < num_counts; c++) {
+			for (int together = 1; together >= 0; together--) {
+				struct Monitors monitors;
+				if (!CHECK(createMonitors(&monitors, bench, num_monitors[c], same))) {
+					destroyMonitors(&monitors);
+					return;
+				}
+				struct RenderTimings total;
+				long long elapsed = runTicks(bench, &monitors, together, 1, &total);
+				char name[64];
+				sprintf(name, "%d %s monitor%s %s", num_monitors[c], same ? "same size" : "mixed",
+						num_monitors[c] > 1 ? "s" : "", together ? "together" : "apart");
+				printTicks(name, bench, elapsed, &total);
+				destroyMonitors(&monitors);
+			}
+		}
+	}
+}
+
+static void benchTransitions(const struct Bench *bench) {
+	static const char *const names[] = {"cut", "crossfade", "wipe", "dissolve"};
+	static const int counts[] = {1, 4, 8};
+	for (int kind = TRANSITION_CUT; kind <= TRANSITION_DISSOLVE; kind++) {
+		for (int c = 0; c < 3; c++) {
+			struct Monitors monitors;
+			if (!CHECK(createMonitors(&monitors, bench, counts[c], 0))) {
+				destroyMonitors(&monitors);
+				return;
+			}
+			for (int i = 0; i < monitors.num_monitors; i++) {
+				monitors.offscreens[i]->canvas.transition = kind;
+				monitors.offscreens[i]->canvas.transition_steps = TRANSITION_TICKS;
+			}
+			struct RenderTimings total;
+			long long elapsed = runTicks(bench, &monitors, 1, TRANSITION_TICKS, &total);
+			char name[64];
+			sprintf(name, "%s on %d monitor%s", names[kind], counts[c], counts[c] > 1 ? "s" : "");
+			printTicks(name, bench, elapsed, &total);
+			destroyMonitors(&monitors);
+		}
+	}
+}
+
+static void benchCores(const struct Bench *bench) {
+	int divisor = bench->quick ? 4 : 1;
+	int most = ThreadPoolProcessors();
+	double one_thread = 0;
+	for (int num_threads = 1;; num_threads = num_threads * 2 < most ? num_threads * 2 : most) {
+		struct Bench cores = *bench;
+		struct Monitors monitors;
+		memset(&monitors, 0, sizeof(monitors));
+		cores.pool = ThreadPoolCreate(num_threads);
+		monitors.offscreens[0] = OffscreenCreate(CORES_WIDTH / divisor, CORES_HEIGHT / divisor);
+		if (!CHECK(cores.pool != NULL && monitors.offscreens[0] != NULL)) {
+			ThreadPoolDestroy(cores.pool);
+			OffscreenDestroy(monitors.offscreens[0]);
+
+			return;
+		}
+		monitors.targets[0] = &monitors.offscreens[0]->target;
+		monitors.num_monitors = 1;
+
+		struct RenderTimings total;
+		long long elapsed = runTicks(&cores, &monitors, 1, 1, &total);
+		double pixels_per_us = (double) CORES_WIDTH / divisor * (CORES_HEIGHT / divisor) * cores.ticks /
+							   (elapsed > 0 ? elapsed : 1);
+		if (num_threads == 1) {
+			one_thread = pixels_per_us;
+		}
+		char name[64];
+		sprintf(name, "%d x %d on %d thread%s", CORES_WIDTH / divisor, CORES_HEIGHT / divisor, num_threads,
+				num_threads > 1 ? "s" : "");
+		printTicks(name, &cores, elapsed, &total);
+		printf("bench: %-30s %7.1f megapixels a second, %.2f times 1 thread's\n", name, pixels_per_us,
+			   pixels_per_us / one_thread);
+		ThreadPoolDestroy(cores.pool);
+		destroyMonitors(&monitors);
+		if (num_threads == most) {
+			break;
+		}
+	}
+}
+
+int BenchTests(int argc, char **argv) {
+	struct Bench bench;
+	memset(&bench, 0, sizeof(bench));
+	bench.quick = argc >= 1 && strcmp(argv[0], "--quick") == 0;
+	if (argc != bench.quick) {
+		printf("usage: edw590scr_tests bench [--quick]\n");
+
+		return 1;
+	}
+	bench.ticks = bench.quick ? 2 * TRANSITION_TICKS : 60;
+
+	// Photos bigger than any of the monitors, with mips, as they're loaded
+	int width = bench.quick ? 1000 : 4000;
+	int height = bench.quick ? 667 : 2667;
+	bench.pool = ThreadPoolCreate(0);
+	bench.clock = ClockCreateSystem();
+	int ok = bench.pool != NULL && bench.clock != NULL && TestPicture(&bench.frames[0], width, height, 0x20) &&
+			 TestPicture(&bench.frames[1], width, height, 0xE0) && ScaleBuildMips(&bench.frames[0], bench.pool) &&
+			 ScaleBuildMips(&bench.frames[1], bench.pool);
+	if (ok) {
+		printf("bench: %d threads, %d ticks of %d x %d frames\n", ThreadPoolSize(bench.pool), bench.ticks, width,
+			   height);
+		benchMonitors(&bench);
+		benchTransitions(&bench);
+		benchCores(&bench);
+	}
+
+	FrameFree(&bench.frames[0]);
+	FrameFree(&bench.frames[1]);
+	ThreadPoolDestroy(bench.pool);
+	ClockDestroySystem(bench.clock);
+
+	return ok ? 0 : 1;
+}
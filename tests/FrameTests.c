@@ -0,0 +1,120 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+
+// FrameAlloc()'s limits, and FrameFromBMP() on .bmp headers that say sizes it mustn't believe: none of them may get
+// as far as allocating, let alone writing, the pixels.
+
+static void put16(unsigned char *p, unsigned int value) {
+	p[0] = (unsigned char) value;
+	p[1] = (unsigned char) (value >> 8);
+}
+
+static void put32(unsigned char *p, unsigned int value) {
+	put16(p, value & 0xFFFF);
+	put16(p + 2, value >> 16);
+}
+
+// A 32 bpp .bmp header for width x height, with the 2 x 2 pixels in pixels after it (top row first if height is
+// negative). That's all the pixel data there is, whatever the header says.
+static void makeBMP(unsigned char *bmp, int width, int height, const unsigned int *pixels) {
+	memset(bmp, 0, 14 + 40);
+	bmp[0] = 'B';
+	bmp[1] = 'M';
+	put32(bmp + 2, 14 + 40 + 16);
+	put32(bmp + 10, 14 + 40);
+	put32(bmp + 14, 40);
+	put32(bmp + 18, (unsigned int) width);
+	put32(bmp + 22, (unsigned int) height);
+	put16(bmp + 26, 1);
+	put16(bmp + 28, 32);
+	for (int i = 0; i < 4; i++) {
+		put32(bmp + 14 + 40 + i * 4, pixels[i]);
+	}
+}
+
+static void checkAlloc(void) {
+	static const int bad[][2] = {
+		{0, 1}, {1, 0}, {-1, 1}, {1, INT_MIN}, {32769, 1}, {1, 32769},
+		{32768, 32768}, {32768, 8193}, {16385, 16384}, {INT_MAX, INT_MAX},
+	};
+	for (int i = 0; i < (int) (sizeof(bad) / sizeof(bad[0])); i++) {
+		struct Frame frame;
+		if (!CHECK(!FrameAlloc(&frame, bad[i][0], bad[i][1]) && frame.pixels == NULL)) {
+			printf("frame: %d x %d got allocated\n", bad[i][0], bad[i][1]);
+			FrameFree(&frame);
+		}
+	}
+
+	// The longest there may be, which is few pixels
+	struct Frame frame;
+	CHECK(FrameAlloc(&frame, 32768, 1) && frame.width == 32768 && frame.height == 1 && frame.stride == 32768);
+	FrameFree(&frame);
+	CHECK(FrameAlloc(&frame, 1, 1) && frame.pixels != NULL);
+	FrameFree(&frame);
+	CHECK(frame.pixels == NULL);
+}
+
+static void checkBMP(void) {
+	static const unsigned int pixels[4] = {0x112233, 0x445566, 0x778899, 0xAABBCC};
+	unsigned char bmp[14 + 40 + 16];
+	struct Frame frame;
+
+	// Bottom-up, then top-down
+	makeBMP(bmp, 2, 2, pixels);
+	if (CHECK(FrameFromBMP(&frame, bmp, sizeof(bmp)))) {
+		CHECK(frame.pixels[0] == pixels[2] && frame.pixels[1] == pixels[3] && frame.pixels[frame.stride] == pixels[0]);
+	}
+	FrameFree(&frame);
+	makeBMP(bmp, 2, -2, pixels);
+	if (CHECK(FrameFromBMP(&frame, bmp, sizeof(bmp)))) {
+		CHECK(frame.pixels[0] == pixels[0] && frame.pixels[1] == pixels[1] && frame.pixels[frame.stride] == pixels[2]);
+	}
+	FrameFree(&frame);
+
+	// Sizes that don't fit, or that there aren't the pixels for
+	static const int bad[][2] = {
+		{32768, 32768}, {32768, -32768}, {2, INT_MIN}, {INT_MIN, 2}, {2, 3}, {3, 2}, {0, 2}, {65536, 1},
+	};
+	for (int i = 0; i < (int) (sizeof(bad) / sizeof(bad[0])); i++) {
+		makeBMP(bmp, bad[i][0], bad[i][1], pixels);
+		if (!CHECK(!FrameFromBMP(&frame, bmp, sizeof(bmp)) && frame.pixels == NULL)) {
+			printf("frame: a .bmp of %d x %d got decoded\n", bad[i][0], bad[i][1]);
+			FrameFree(&frame);
+		}
+	}
+
+	// And one that's cut short
+	makeBMP(bmp, 2, 2, pixels);
+	CHECK(!FrameFromBMP(&frame, bmp, sizeof(bmp) - 1));
+}
+
+int FrameTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkAlloc();
+	checkBMP();
+
+	return 0;
+}
@@ -0,0 +1,319 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Glitch.h"
+#include "../Utils/Simd.h"
+#include "../Utils/ThreadPool.h"
+
+// The glitched frames (see Glitch.h).
+//
+// seed: the same seed and tick always give the same plan and the same frame, on the threads or not, and other ticks
+// other ones.
+// rows: plans made up by hand, with shifts and channels past both ends of the rows, at odd widths, against a plain
+// version of the rows here, and then with noise and jitter too, with each of the SIMD levels compiled in (see
+// simd_enabled_GL): nothing may differ by a bit.
+// bounds: the bands and blocks of many ticks' plans for tiny frames, 1 x 1 and up, all inside the frame, and nothing
+// written outside it.
+
+#define PADDING 0xDEADBEEF  // what's after the end of each row, which must still be there after
+#define BOUNDS_TICKS 2000
+
+static const int widths[] = {1, 2, 3, 4, 5, 7, 9, 17, 33, 101};
+
+// The SIMD levels compiled in, from 0 (plain C).
+static int simdLevels(void) {
+#if defined(EDW590SCR_AVX2)
+	return 3;
+#elif defined(EDW590SCR_SSE2)
+	return 2;
+#else
+	return 1;
+#endif
+}
+
+static unsigned int random_state = 590;
+
+static unsigned int randomPixel(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return random_state;
+}
+
+// A width x height frame, with padding pixels more to each row: of noise, or all PADDING.
+static int paddedFrame(struct Frame *frame, int width, int height, int padding, int noise) {
+	if (!FrameAlloc(frame, width + padding, height)) {
+		return 0;
+	}
+	frame->width = width;
+	for (int i = 0; i < frame->stride * height; i++) {
+		frame->pixels[i] = noise ? randomPixel() : PADDING;
+	}
+
+	return 1;
+}
+
+static int clampIndex(int i, int width) {
+	return i < 0 ? 0 : i >= width ? width - 1 : i;
+}
+
+// What GlitchRows() should make, for a plan with no noise or jitter: each row moved and its channels pulled apart,
+// every index clamped to the row, then the blocks over it.
+static void glitchPlainly(const struct GlitchPlan *plan, const struct Frame *src, unsigned int *out, int stride) {
+	for (int y = 0; y < plan->height; y++) {
+		const unsigned int *in = src->pixels + (size_t) y * src->stride;
+		unsigned int *row = out + (size_t) y * stride;
+		int shift = 0;
+		int red_shift = plan->red_shift;
+		int blue_shift = plan->blue_shift;
+		for (int i = 0; i < plan->num_bands; i++) {
+			if (y >= plan->bands[i].top && y < plan->bands[i].bottom) {
+				shift = plan->bands[i].shift;
+				red_shift = plan->bands[i].red_shift;
+				blue_shift = plan->bands[i].blue_shift;
+			}
+		}
+		for (int x = 0; x < plan->width; x++) {
+			row[x] = (in[clampIndex(x - shift + red_shift, plan->width)] & 0xFF0000) |
+					 (in[clampIndex(x - shift, plan->width)] & 0xFF00) |
+					 (in[clampIndex(x - shift + blue_shift, plan->width)] & 0xFF);
+		}
+		for (int i = 0; i < plan->num_blocks; i++) {
+			const struct GlitchBlock *block = &plan->blocks[i];
+			if (y < block->y || y >= block->y + block->height) {
+				continue;
+			}
+			const unsigned int *from = src->pixels + (size_t) (block->src_y + y - block->y) * src->stride;
+			for (int x = 0; x < block->width; x++) {
+				unsigned int p = from[block->src_x + x];
+				row[block->x + x] = block->swap ? (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16) : p;
+			}
+		}
+	}
+}
+
+// A plan for width x 10 made up by hand: the rows outside the bands, then one band a row, each shifted and pulled
+// apart further than the last (past both ends of the row, for the last few), and 2 blocks, one with red and blue
+// swapped. With messy, the bands have noise and jitter as well.
+static void handPlan(struct GlitchPlan *plan, int width, int messy) {
+	static const unsigned int noise_masks[] = {0x070707, 0x1F1F1F, 0x7F7F7F, 0xFFFFFF};
+	memset(plan, 0, sizeof(*plan));
+	plan->width = width;
+	plan->height = 10;
+	plan->seed = 0x5EED;
+	plan->red_shift = -1;
+	plan->blue_shift = 2;
+	int shifts[GLITCH_MAX_BANDS] = {0, 1, -1, 3, -5, width - 1, width + 4, -width - 4};
+	for (int i = 0; i < GLITCH_MAX_BANDS; i++) {
+		struct GlitchBand *band = &plan->bands[i];
+		band->top = i + 1;
+		band->bottom = i + 2;
+		band->shift = shifts[i];
+		band->red_shift = i % 2 == 0 ? i * 3 - width : width - i;
+		band->blue_shift = i % 3 == 0 ? width + i : -i;
+		if (messy) {
+			band->jitter = i % 2 == 0 ? i + 1 : 0;
+			band->noise = noise_masks[i % 4];
+		}
+	}
+	plan->num_bands = GLITCH_MAX_BANDS;
+	// One over the whole of the first row and the last, swapped, and one over the right half of the bands
+	plan->blocks[0].width = width;
+	plan->blocks[0].height = 1;
+	plan->blocks[0].src_y = 5;
+	plan->blocks[0].swap = 1;
+	plan->blocks[1] = plan->blocks[0];
+	plan->blocks[1].y = 9;
+	plan->blocks[1].src_y = 0;
+	plan->blocks[2].x = width / 2;
+	plan->blocks[2].y = 2;
+	plan->blocks[2].width = width - width / 2;
+	plan->blocks[2].height = 5;
+	plan->blocks[2].src_y = 4;
+	plan->num_blocks = 3;
+}
+
+static void checkRows(void) {
+	for (int w = 0; w < (int) (sizeof(widths) / sizeof(widths[0])); w++) {
+		int width = widths[w];
+		struct Frame src;
+		struct Frame expected;
+		struct Frame actual;
+		memset(&expected, 0, sizeof(expected));
+		memset(&actual, 0, sizeof(actual));
+		if (!CHECK(paddedFrame(&src, width, 10, 3, 1) && paddedFrame(&expected, width, 10, 5, 0) &&
+				   paddedFrame(&actual, width, 10, 5, 0))) {
+			FrameFree(&src);
+			FrameFree(&expected);
+			FrameFree(&actual);
+
+			return;
+		}
+		size_t size = (size_t) expected.stride * expected.height * 4;
+
+		for (int messy = 0; messy < 2; messy++) {
+			struct GlitchPlan plan;
+			handPlan(&plan, width, messy);
+			for (int level = 0; level < simdLevels(); level++) {
+				simd_enabled_GL = level;
+				struct Frame *dst = level == 0 ? &expected : &actual;
+				GlitchRows(&plan, &src, dst, 0, plan.height);
+				if (level == 0 && !messy) {
+					// The plain version, into actual, to compare with
+					glitchPlainly(&plan, &src, actual.pixels, actual.stride);
+				}
+				if ((level > 0 || !messy) && !CHECK(memcmp(expected.pixels, actual.pixels, size) == 0)) {
+					printf("glitch: %d wide%s: SIMD level %d differs\n", width, messy ? ", messy" : "", level);
+				}
+			}
+			simd_enabled_GL = 2;
+		}
+		for (int y = 0; y < expected.height; y++) {
+			for (int x = width; x < expected.stride; x++) {
+				CHECK(expected.pixels[(size_t) y * expected.stride + x] == PADDING);
+			}
+		}
+		FrameFree(&src);
+		FrameFree(&expected);
+		FrameFree(&actual);
+	}
+}
+
+static void checkSeed(struct ThreadPool *pool) {
+	struct Frame src;
+	struct Frame first;
+	struct Frame second;
+	memset(&first, 0, sizeof(first));
+	memset(&second, 0, sizeof(second));
+	if (!CHECK(TestPicture(&src, 320, 200, 0x30) && FrameAlloc(&first, 320, 200) && FrameAlloc(&second, 320, 200))) {
+		FrameFree(&src);
+		FrameFree(&first);
+		FrameFree(&second);
+
+		return;
+	}
+	size_t size = (size_t) 320 * 200 * 4;
+
+	int bursts = 0;
+	int others = 0;
+	for (unsigned long tick = 0; tick < 64; tick++) {
+		struct GlitchPlan plan;
+		struct GlitchPlan again;
+		GlitchPlanInit(&plan, 320, 200, 590, tick);
+		GlitchPlanInit(&again, 320, 200, 590, tick);
+		if (!CHECK(memcmp(&plan, &again, sizeof(plan)) == 0)) {
+			printf("glitch: tick %lu's plan came out different the second time\n", tick);
+		}
+		bursts += plan.num_bands > 0;
+
+		// On the threads, and not
+		GlitchFrame(&plan, &src, &first, pool);
+		GlitchFrame(&again, &src, &second, NULL);
+		if (!CHECK(memcmp(first.pixels, second.pixels, size) == 0)) {
+			printf("glitch: tick %lu's frame came out different the second time\n", tick);
+		}
+
+		// Another seed, and the next tick
+		GlitchPlanInit(&again, 320, 200, 591, tick);
+		others += memcmp(&plan, &again, sizeof(plan)) != 0;
+		GlitchPlanInit(&again, 320, 200, 590, tick + 1);
+		others += memcmp(&plan, &again, sizeof(plan)) != 0;
+	}
+	// Most ticks are calm, but not all of them, and the seed and the tick both make a difference
+	CHECK(bursts > 0 && bursts < 64);
+	CHECK(others > 64);
+
+	FrameFree(&src);
+	FrameFree(&first);
+	FrameFree(&second);
+}
+
+static void checkBounds(void) {
+	static const int sizes[][2] = {{1, 1}, {3, 2}, {2, 3}, {1, 9}, {9, 1}, {16, 9}, {41, 61}};
+	for (int s = 0; s < (int) (sizeof(sizes) / sizeof(sizes[0])); s++) {
+		int width = sizes[s][0];
+		int height = sizes[s][1];
+		struct Frame src;
+		struct Frame dst;
+		memset(&dst, 0, sizeof(dst));
+		if (!CHECK(paddedFrame(&src, width, height, 0, 1) && paddedFrame(&dst, width, height, 1, 0))) {
+			FrameFree(&src);
+			FrameFree(&dst);
+
+			return;
+		}
+
+		int wrong = 0;
+		for (unsigned long tick = 0; tick < BOUNDS_TICKS && !wrong; tick++) {
+			struct GlitchPlan plan;
+			GlitchPlanInit(&plan, width, height, 590 + s, tick);
+			wrong |= plan.num_bands < 0 || plan.num_bands > GLITCH_MAX_BANDS;
+			wrong |= plan.num_blocks < 0 || plan.num_blocks > GLITCH_MAX_BLOCKS;
+			for (int i = 0; i < plan.num_bands && !wrong; i++) {
+				const struct GlitchBand *band = &plan.bands[i];
+				wrong |= band->top < 0 || band->bottom <= band->top || band->bottom > height;
+			}
+			for (int i = 0; i < plan.num_blocks && !wrong; i++) {
+				const struct GlitchBlock *block = &plan.blocks[i];
+				wrong |= block->width < 1 || block->height < 1;
+				wrong |= block->x < 0 || block->x + block->width > width || block->y < 0 ||
+						 block->y + block->height > height;
+				wrong |= block->src_x < 0 || block->src_x + block->width > width || block->src_y < 0 ||
+						 block->src_y + block->height > height;
+			}
+			if (wrong) {
+				printf("glitch: tick %lu's plan for %d x %d goes outside it\n", tick, width, height);
+				break;
+			}
+			GlitchRows(&plan, &src, &dst, 0, height);
+			for (int y = 0; y < height; y++) {
+				wrong |= dst.pixels[(size_t) y * dst.stride + width] != PADDING;
+			}
+			if (wrong) {
+				printf("glitch: tick %lu wrote outside %d x %d\n", tick, width, height);
+			}
+		}
+		CHECK(!wrong);
+		FrameFree(&src);
+		FrameFree(&dst);
+	}
+}
+
+int GlitchTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	struct ThreadPool *pool = ThreadPoolCreate(3);
+	if (pool == NULL) {
+		return 1;
+	}
+
+	checkSeed(pool);
+	checkRows();
+	checkBounds();
+
+	ThreadPoolDestroy(pool);
+
+	return 0;
+}
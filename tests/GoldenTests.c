@@ -0,0 +1,191 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Clock.h"
+#include "../Utils/Glitch.h"
+#include "../Utils/Offscreen.h"
+#include "../Utils/Render.h"
+#include "../Utils/Scaler.h"
+
+// Renders a few frames at a few sets of monitor sizes, on Offscreen targets, and compares what ends up in each one's
+// front buffer (what would be on the screen) with the golden images: <case>_<target>_<frame>.bmp in the directory
+// given. With --update first, it writes them instead, for after a change that's meant to change the pictures (look at
+// them first). A picture that's wrong is written to <case>_<target>_<frame>.actual.bmp in the current directory, to
+// look at. It also says how long each stage took, for each case.
+//
+// usage: edw590scr_tests golden [--update] dir
+
+#define GOLDEN_MAX_TARGETS 4
+#define GOLDEN_MAX_FRAMES 4
+
+enum Picture {
+	PICTURE_WIDE,           // 16:9
+	PICTURE_SQUARE,         // 4:3, so the bars move
+	PICTURE_BIG,            // bigger than the targets, with mips
+	PICTURE_GLITCHED,       // PICTURE_WIDE, glitched
+	NUM_PICTURES
+};
+
+struct GoldenCase {
+	const char *name;
+	int num_targets;
+	int sizes[GOLDEN_MAX_TARGETS][2];
+	int filter;             // a ScaleFilter, or -1
+	int divisor;
+	int num_frames;
+	enum Picture pictures[GOLDEN_MAX_FRAMES];
+};
+
+static const struct GoldenCase cases[] = {
+	{"single", 1, {{128, 72}}, -1, 1, 3, {PICTURE_WIDE, PICTURE_SQUARE, PICTURE_BIG}},
+	// Portrait, 4:3, and 2 the same size (scaled once, copied to the other)
+	{"monitors", 4, {{128, 72}, {72, 128}, {100, 75}, {128, 72}}, -1, 1, 2, {PICTURE_GLITCHED, PICTURE_SQUARE}},
+	// The governor's cheapest level
+	{"low", 1, {{128, 72}}, SCALE_NEAREST, 3, 2, {PICTURE_BIG, PICTURE_SQUARE}},
+};
+
+static int makePictures(struct Frame *pictures) {
+	memset(pictures, 0, NUM_PICTURES * sizeof(struct Frame));
+	if (!TestPicture(&pictures[PICTURE_WIDE], 192, 108, 0x40) ||
+		!TestPicture(&pictures[PICTURE_SQUARE], 144, 108, 0x90) ||
+		!TestPicture(&pictures[PICTURE_BIG], 1024, 576, 0xC0) || !ScaleBuildMips(&pictures[PICTURE_BIG], NULL) ||
+		!FrameAlloc(&pictures[PICTURE_GLITCHED], 192, 108)) {
+		return 0;
+	}
+
+	struct GlitchPlan plan;
+	GlitchPlanInit(&plan, 192, 108, 590, 7);
+	GlitchFrame(&plan, &pictures[PICTURE_WIDE], &pictures[PICTURE_GLITCHED], NULL);
+
+	return 1;
+}
+
+// Compares target's front buffer with the golden image at path, or writes it there if update.
+static void compareGolden(const struct Offscreen *target, const char *path, const char *name, int update) {
+	int width = target->canvas.width;
+	int height = target->canvas.height;
+	if (update) {
+		CHECK(TestWriteBMP(path, target->front, width, height, width));
+
+		return;
+	}
+
+	struct Frame golden;
+	if (!TestReadBMP(path, &golden)) {
+		printf("golden: no %s\n", path);
+		CHECK(!"golden image missing");
+
+		return;
+	}
+	int differ = 0;
+	if (golden.width == width && golden.height == height) {
+		for (int y = 0; y < height; y++) {
+			const unsigned int *row = target->front + (size_t) y * width;
+			for (int x = 0; x < width; x++) {
+				differ += (row[x] & 0xFFFFFF) != golden.pixels[(size_t) y * golden.stride + x];
+			}
+		}
+	} else {
+		differ = width * height;
+	}
+	if (differ != 0) {
+		char actual[256];
+		sprintf(actual, "%s.actual.bmp", name);
+		TestWriteBMP(actual, target->front, width, height, width);
+		printf("golden: %s: %d pixels differ (see %s)\n", name, differ, actual);
+	}
+	CHECK(differ == 0);
+	FrameFree(&golden);
+}
+
+static void runCase(const struct GoldenCase *test, const struct Frame *pictures, struct ThreadPool *pool,
+					struct Clock *clock, const char *dir, int update) {
+	struct Offscreen *offscreens[GOLDEN_MAX_TARGETS];
+	struct RenderTarget *targets[GOLDEN_MAX_TARGETS];
+	for (int i = 0; i < test->num_targets; i++) {
+		offscreens[i] = OffscreenCreate(test->sizes[i][0], test->sizes[i][1]);
+		if (!CHECK(offscreens[i] != NULL)) {
+			return;
+		}
+		CanvasSetQuality(&offscreens[i]->canvas, test->filter, test->divisor);
+		targets[i] = &offscreens[i]->target;
+	}
+
+	struct RenderTimings total;
+	memset(&total, 0, sizeof(total));
+	for (int f = 0; f < test->num_frames; f++) {
+		struct RenderTimings timings;
+		CHECK(RenderFrame(targets, test->num_targets, &pictures[test->pictures[f]], pool, clock, &timings));
+		total.prepare += timings.prepare;
+		total.scale += timings.scale;
+		total.transition += timings.transition;
+		total.tiles += timings.tiles;
+		total.present += timings.present;
+		total.bytes_presented += timings.bytes_presented;
+
+		for (int i = 0; i < test->num_targets; i++) {
+			const struct Offscreen *target = offscreens[i];
+			char name[64];
+			char path[1024];
+			sprintf(name, "%s_%d_%d", test->name, i, f);
+			sprintf(path, "%s/%s.bmp", dir, name);
+			// All of what's been drawn has been presented, bars and all
+			CHECK(memcmp(target->front, target->back, (size_t) target->canvas.width * target->canvas.height * 4) == 0);
+			compareGolden(target, path, name, update);
+		}
+	}
+	printf("golden: %-8s %d frames: prepare %lld us, scale %lld us, transition %lld us, tiles %lld us, "
+		   "present %lld us, %lld bytes presented\n", test->name, test->num_frames, total.prepare, total.scale,
+		   total.transition, total.tiles, total.present, total.bytes_presented);
+
+	for (int i = 0; i < test->num_targets; i++) {
+		OffscreenDestroy(offscreens[i]);
+	}
+}
+
+int GoldenTests(int argc, char **argv) {
+	int update = argc >= 1 && strcmp(argv[0], "--update") == 0;
+	if (argc != 1 + update) {
+		printf("usage: edw590scr_tests golden [--update] dir\n");
+
+		return 1;
+	}
+	const char *dir = argv[update];
+
+	struct Frame pictures[NUM_PICTURES];
+	struct ThreadPool *pool = ThreadPoolCreate(2);
+	struct Clock *clock = ClockCreateSystem();
+	int ok = makePictures(pictures) && pool != NULL && clock != NULL;
+	if (ok) {
+		for (int i = 0; i < (int) (sizeof(cases) / sizeof(cases[0])); i++) {
+			runCase(&cases[i], pictures, pool, clock, dir, update);
+		}
+	}
+
+	for (int i = 0; i < NUM_PICTURES; i++) {
+		FrameFree(&pictures[i]);
+	}
+	ThreadPoolDestroy(pool);
+	ClockDestroySystem(clock);
+
+	return ok ? 0 : 1;
+}
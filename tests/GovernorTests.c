@@ -0,0 +1,132 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include "Tests.h"
+#include "../Utils/Governor.h"
+
+// The Governor (see Governor.h), fed made-up frame times for a machine that's fast, slow, or only just too slow for
+// the best level, to see that it steps down when it has to, back up when it can, and doesn't keep going up and down.
+
+static const struct GovernorLevel levels[] = {
+	{100, -1, 1},   // 30 FPS: 33333 us a frame
+	{75, -1, 1},    // 22: 45454
+	{50, 0, 2},     // 15: 66666
+};
+
+// How long a frame takes at each level, in microseconds.
+struct Machine {
+	long long frame_times[3];
+};
+
+// Runs num_frames frames on machine. Returns how many of them were at level 0.
+static int run(struct Governor *governor, const struct Machine *machine, int num_frames) {
+	int best = 0;
+	for (int i = 0; i < num_frames; i++) {
+		best += governor->level == 0;
+		GovernorUpdate(governor, machine->frame_times[governor->level]);
+	}
+
+	return best;
+}
+
+// How many frames of frame_time it takes for the level to change, or -1 if it hasn't in most.
+static int framesToChange(struct Governor *governor, long long frame_time, int most) {
+	for (int i = 1; i <= most; i++) {
+		if (GovernorUpdate(governor, frame_time)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void checkSteps(void) {
+	struct Governor governor;
+	GovernorInit(&governor, levels, 3, 30);
+	CHECK(GovernorFps(&governor) == 30 && GovernorCurrent(&governor)->divisor == 1);
+
+	// Fast enough: stays, even with the odd slow frame
+	for (int i = 0; i < 1000; i++) {
+		CHECK(!GovernorUpdate(&governor, i % 100 == 50 ? 100000 : 10000));
+	}
+	CHECK(governor.level == 0 && governor.changes == 0);
+
+	// Over 90% of the period: down once the average has got there and stayed for 8 frames, and no further while
+	// level 1 keeps up
+	int frames = framesToChange(&governor, 32000, 1000);
+	if (!CHECK(frames >= 8 && frames <= 30)) {
+		printf("governor: stepped down after %d frames\n", frames);
+	}
+	CHECK(governor.level == 1 && GovernorFps(&governor) == 22);
+	CHECK(framesToChange(&governor, 32000, 1000) == -1);
+
+	// Far too slow for either: down to the cheapest after 8 frames (the average gets there at once), and never further
+	CHECK(framesToChange(&governor, 200000, 1000) == 8 && framesToChange(&governor, 200000, 1000) == -1);
+	CHECK(governor.level == 2 && GovernorCurrent(&governor)->filter == 0 && GovernorCurrent(&governor)->divisor == 2);
+
+	// Under 60% of the better level's period: up a level after 60 frames of it, once the average has come down
+	frames = framesToChange(&governor, 20000, 1000);
+	CHECK(frames > 60 && frames < 100 && governor.level == 1);
+	// 20 ms isn't under 60% of level 0's 33 ms, so no further, but 10 ms is
+	CHECK(framesToChange(&governor, 20000, 1000) == -1);
+	CHECK(framesToChange(&governor, 10000, 1000) == 60 && governor.level == 0 && governor.changes == 4);
+}
+
+// A machine on which level 1 looks like it has room for level 0, but level 0 is too slow: each failed try up makes
+// the next wait twice as long, so it spends next to no time trying, and then, once the machine's faster (nothing else
+// running on it, say), it does go up again and stays there.
+static void checkFlapping(void) {
+	static const struct Machine borderline = {{32000, 15000, 15000}};
+	static const struct Machine faster = {{12000, 9000, 9000}};
+	struct Governor governor;
+	GovernorInit(&governor, levels, 3, 30);
+	int best = run(&governor, &borderline, 20000);
+	if (!CHECK(governor.changes < 40 && best < 20000 / 20)) {
+		printf("governor: %lld changes, %d frames at level 0 of 20000\n", governor.changes, best);
+	}
+	CHECK(governor.level == 1 && governor.up_after == 1800);
+
+	run(&governor, &faster, 2000);
+	CHECK(governor.level == 0);
+	long long changes = governor.changes;
+	run(&governor, &faster, 10000);
+	CHECK(governor.level == 0 && governor.changes == changes && governor.up_after < 1800);
+}
+
+// No levels: just the configured FPS.
+static void checkNoLevels(void) {
+	struct Governor governor;
+	GovernorInit(&governor, NULL, 0, 24);
+	CHECK(governor.num_levels == 1 && GovernorFps(&governor) == 24 && GovernorCurrent(&governor)->filter == -1);
+	for (int i = 0; i < 100; i++) {
+		CHECK(!GovernorUpdate(&governor, 1000000));
+	}
+}
+
+int GovernorTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkSteps();
+	checkFlapping();
+	checkNoLevels();
+
+	return 0;
+}
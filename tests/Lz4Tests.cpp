@@ -0,0 +1,347 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/lz4blocks.h"
+#include "../Utils/unzip.h"
+#include "../Utils/zip.h"
+extern "C" {
+#include "../Utils/Clock.h"
+}
+
+// Benchmarks of the LZ4 blocks (see lz4blocks.h): lz4blocks.cpp's compressor against unzip.cpp's decoder, on their
+// own and through the zip code. They check everything decodes to what went in, so with --quick (less data, fewer
+// rounds) they're a test as well.
+//
+// decode: a picture, one colour all over, short repeats (whose matches overlap what they copy) and noise, in blocks
+// of LZ4BLOCKS_BLOCKSIZE, each decoded with unzlocal_LZ4Decode(): how fast, and how many times memcpy's time.
+// corrupt: blocks that are cut short, have the wrong size or have bytes changed at random must be turned down, or at
+// least not be read or written out of bounds (which an ASan build catches: the buffers are exactly the sizes given).
+// unzip: the picture zipped with deflate and with the LZ4 blocks, and unzipped from memory with UnzipItem(), which
+// is what the LZ4 blocks are for.
+//
+// usage: edw590scr_tests lz4 [--quick]
+
+#define LZ4_KINDS 4
+#define CORRUPT_BLOCKSIZE (64 * 1024)
+
+// unzip.cpp's, not in unzip.h. Returns 0 (UNZ_OK) if src was a good block of exactly dstlen bytes.
+int unzlocal_LZ4Decode(const unsigned char *src, unsigned long srclen, unsigned char *dst, unsigned long dstlen);
+
+struct Lz4Bench {
+	int quick;
+	int rounds;
+	unsigned int seed;
+	struct Clock *clock;
+};
+
+struct Blocks {
+	unsigned char *data;        // what went in
+	unsigned int len;
+	int num_blocks;
+	unsigned char **blocks;     // compressed, one for each LZ4BLOCKS_BLOCKSIZE of data
+	unsigned int *sizes;
+};
+
+static unsigned int nextRandom(struct Lz4Bench *bench) {
+	bench->seed = bench->seed * 1103515245 + 12345;
+
+	return bench->seed >> 16;
+}
+
+// The kind of data to compress: what a zip of pictures holds, and the extremes either way.
+static void fillData(struct Lz4Bench *bench, int kind, const struct Frame *picture, unsigned char *data,
+					 unsigned int len) {
+	switch (kind) {
+		case 0:
+			memcpy(data, picture->pixels, len);
+			break;
+		case 1:
+			for (unsigned int i = 0; i < len; i++) {
+				data[i] = (unsigned char) (i % 4 == 3 ? 0 : 0x40);
+			}
+			break;
+		case 2:
+			// A pattern 1 to 7 bytes long, a different one every 4k
+			for (unsigned int i = 0; i < len; i += 4096) {
+				unsigned int period = 1 + (i / 4096) % 7;
+				for (unsigned int j = 0; j < period && i + j < len; j++) {
+					data[i + j] = (unsigned char) nextRandom(bench);
+				}
+				for (unsigned int j = period; j < 4096 && i + j < len; j++) {
+					data[i + j] = data[i + j - period];
+				}
+			}
+			break;
+		default:
+			for (unsigned int i = 0; i < len; i++) {
+				data[i] = (unsigned char) nextRandom(bench);
+			}
+			break;
+	}
+}
+
+static void freeBlocks(struct Blocks *blocks) {
+	for (int i = 0; i < blocks->num_blocks && blocks->blocks != NULL; i++) {
+		free(blocks->blocks[i]);
+	}
+	free(blocks->blocks);
+	free(blocks->sizes);
+	free(blocks->data);
+	memset(blocks, 0, sizeof(*blocks));
+}
+
+// data (which blocks then owns) compressed, a block for each LZ4BLOCKS_BLOCKSIZE of it. Returns 0 if out of memory or
+// a block didn't compress.
+static int compressBlocks(struct Blocks *blocks, unsigned char *data, unsigned int len) {
+	memset(blocks, 0, sizeof(*blocks));
+	blocks->data = data;
+	blocks->len = len;
+	int num_blocks = (int) ((len + LZ4BLOCKS_BLOCKSIZE - 1) / LZ4BLOCKS_BLOCKSIZE);
+	blocks->blocks = (unsigned char **) calloc(num_blocks, sizeof(*blocks->blocks));
+	blocks->sizes = (unsigned int *) calloc(num_blocks, sizeof(*blocks->sizes));
+	if (blocks->blocks == NULL || blocks->sizes == NULL) {
+		return 0;
+	}
+	for (int i = 0; i < num_blocks; i++) {
+		unsigned int offset = (unsigned int) i * LZ4BLOCKS_BLOCKSIZE;
+		unsigned int n = len - offset < LZ4BLOCKS_BLOCKSIZE ? len - offset : LZ4BLOCKS_BLOCKSIZE;
+		unsigned int bound = LZ4BlockBound(n);
+		blocks->blocks[i] = (unsigned char *) malloc(bound);
+		blocks->num_blocks++;
+		if (blocks->blocks[i] == NULL) {
+			return 0;
+		}
+		blocks->sizes[i] = LZ4BlockCompress(data + offset, n, blocks->blocks[i], bound);
+		if (blocks->sizes[i] == 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Decodes all of blocks into out. Returns 0 if any of them wouldn't.
+static int decodeBlocks(const struct Blocks *blocks, unsigned char *out) {
+	int ok = 1;
+	for (int i = 0; i < blocks->num_blocks; i++) {
+		unsigned int offset = (unsigned int) i * LZ4BLOCKS_BLOCKSIZE;
+		unsigned int n = blocks->len - offset < LZ4BLOCKS_BLOCKSIZE ? blocks->len - offset : LZ4BLOCKS_BLOCKSIZE;
+		ok &= unzlocal_LZ4Decode(blocks->blocks[i], blocks->sizes[i], out + offset, n) == 0;
+	}
+
+	return ok;
+}
+
+static void benchDecode(struct Lz4Bench *bench, const struct Frame *picture) {
+	static const char *const names[LZ4_KINDS] = {"picture", "one colour", "short repeats", "noise"};
+	unsigned int len = (unsigned int) picture->stride * picture->height * 4;
+	unsigned char *out = (unsigned char *) malloc(len);
+	unsigned char *copy = (unsigned char *) malloc(len);
+	for (int kind = 0; kind < LZ4_KINDS && CHECK(out != NULL && copy != NULL); kind++) {
+		// Zeroed, as it's freed below even if data never made it to compressBlocks()
+		struct Blocks blocks;
+		memset(&blocks, 0, sizeof(blocks));
+		unsigned char *data = (unsigned char *) malloc(len);
+		if (data != NULL) {
+			fillData(bench, kind, picture, data, len);
+		}
+		if (!CHECK(data != NULL && compressBlocks(&blocks, data, len))) {
+			printf("lz4: %s didn't compress\n", names[kind]);
+			freeBlocks(&blocks);
+			break;
+		}
+		unsigned int compressed = 0;
+		for (int i = 0; i < blocks.num_blocks; i++) {
+			compressed += blocks.sizes[i];
+		}
+
+		// Once first, so neither the decoding nor the copying has the pages to fault in
+		memset(out, 0, len);
+		int ok = decodeBlocks(&blocks, out);
+		memcpy(copy, blocks.data, len);
+		long long start = bench->clock->now(bench->clock);
+		for (int round = 0; round < bench->rounds; round++) {
+			ok &= decodeBlocks(&blocks, out);
+		}
+		long long decoding = bench->clock->now(bench->clock) - start;
+		if (!CHECK(ok) || !CHECK(memcmp(out, blocks.data, len) == 0)) {
+			printf("lz4: %s didn't decode right\n", names[kind]);
+		}
+		start = bench->clock->now(bench->clock);
+		for (int round = 0; round < bench->rounds; round++) {
+			memcpy(copy, blocks.data, len);
+		}
+		long long copying = bench->clock->now(bench->clock) - start;
+
+		double mb = (double) len * bench->rounds / 1048576;
+		printf("lz4: %-14s %5.1f MB, to %5.1f%% of it: decodes at %7.1f MB/s, in %.2f times memcpy's time\n",
+			   names[kind], len / 1048576.0, 100.0 * compressed / len, mb * 1000000 / (decoding > 0 ? decoding : 1),
+			   (double) decoding / (copying > 0 ? copying : 1));
+		freeBlocks(&blocks);
+	}
+	free(out);
+	free(copy);
+}
+
+// Decodes src, srclen bytes, into dstlen bytes, each in a block of exactly its size. Returns what the decoder did.
+static int decodeExactly(const unsigned char *src, unsigned int srclen, unsigned int dstlen) {
+	unsigned char *exact_src = (unsigned char *) malloc(srclen > 0 ? srclen : 1);
+	unsigned char *exact_dst = (unsigned char *) malloc(dstlen > 0 ? dstlen : 1);
+	int result = -1;
+	if (CHECK(exact_src != NULL && exact_dst != NULL)) {
+		memcpy(exact_src, src, srclen);
+		result = unzlocal_LZ4Decode(exact_src, srclen, exact_dst, dstlen);
+	}
+	free(exact_src);
+	free(exact_dst);
+
+	return result;
+}
+
+static void checkCorrupt(struct Lz4Bench *bench, const struct Frame *picture) {
+	const unsigned char *data = (const unsigned char *) picture->pixels;
+	unsigned int bound = LZ4BlockBound(CORRUPT_BLOCKSIZE);
+	unsigned char *block = (unsigned char *) malloc(bound);
+	unsigned char *changed = (unsigned char *) malloc(bound);
+	unsigned int size = block != NULL ? LZ4BlockCompress(data, CORRUPT_BLOCKSIZE, block, bound) : 0;
+	if (!CHECK(changed != NULL && size > 0)) {
+		free(block);
+		free(changed);
+
+		return;
+	}
+
+	CHECK(decodeExactly(block, size, CORRUPT_BLOCKSIZE) == 0);
+	CHECK(decodeExactly(block, size - 1, CORRUPT_BLOCKSIZE) != 0);
+	CHECK(decodeExactly(block, size / 2, CORRUPT_BLOCKSIZE) != 0);
+	CHECK(decodeExactly(block, 0, CORRUPT_BLOCKSIZE) != 0);
+	CHECK(decodeExactly(block, size, CORRUPT_BLOCKSIZE - 1) != 0);
+	CHECK(decodeExactly(block, size, CORRUPT_BLOCKSIZE + 1) != 0);
+
+	// Changed bytes can still make a good block (in a literal, say), so these only mustn't go out of bounds
+	int tries = bench->quick ? 200 : 2000;
+	int turned_down = 0;
+	for (int i = 0; i < tries; i++) {
+		memcpy(changed, block, size);
+		for (int n = 1 + nextRandom(bench) % 3; n > 0; n--) {
+			changed[nextRandom(bench) % size] = (unsigned char) nextRandom(bench);
+		}
+		turned_down += decodeExactly(changed, size, CORRUPT_BLOCKSIZE) != 0;
+	}
+	printf("lz4: %d of %d blocks with bytes changed turned down\n", turned_down, tries);
+	free(block);
+	free(changed);
+}
+
+// Unzips item 0 of hz, len bytes, into out (which has room for one more). Returns 0 if it didn't.
+static int unzipItem(HZIP hz, unsigned char *out, unsigned int len) {
+	ZRESULT zr = UnzipItem(hz, 0, out, len + 1, ZIP_MEMORY);
+	// Even when it all fits, it only says it's done when asked for more (see UnzipItem())
+	if (zr == ZR_MORE) {
+		zr = UnzipItem(hz, 0, out + len, 1, ZIP_MEMORY);
+	}
+
+	return zr == ZR_OK;
+}
+
+// Unzips item 0 of the zip in memory into out, once and then rounds times. Returns how long the rounds took, or -1 if
+// it didn't work.
+static long long unzipRounds(const struct Lz4Bench *bench, void *zip, unsigned long zip_len, unsigned char *out,
+							 unsigned int len) {
+	HZIP hz = OpenZip(zip, (unsigned int) zip_len, ZIP_MEMORY);
+	if (hz == 0) {
+		return -1;
+	}
+	int ok = unzipItem(hz, out, len);
+	long long start = bench->clock->now(bench->clock);
+	for (int round = 0; round < bench->rounds && ok; round++) {
+		ok = unzipItem(hz, out, len);
+	}
+	long long elapsed = bench->clock->now(bench->clock) - start;
+	CloseZip(hz);
+
+	return ok ? elapsed : -1;
+}
+
+static void benchUnzip(const struct Lz4Bench *bench, const struct Frame *picture) {
+	static const int methods[] = {ZIP_DEFLATE, ZIP_LZ4BLOCKS};
+	static const char *const names[] = {"deflate", "lz4 blocks"};
+	unsigned int len = (unsigned int) picture->stride * picture->height * 4;
+	unsigned char *out = (unsigned char *) malloc(len + 1);
+	double speeds[2] = {0, 0};
+	for (int m = 0; m < 2 && CHECK(out != NULL); m++) {
+		HZIP hz = CreateZip(0, 0, ZIP_MEMORY);
+		void *zip = NULL;
+		unsigned long zip_len = 0;
+		int zipped = hz != 0 && ZipSetOptions(hz, methods[m], 6, 0, 0) == ZR_OK &&
+					 ZipAdd(hz, "picture.raw", picture->pixels, len, ZIP_MEMORY) == ZR_OK &&
+					 ZipGetMemory(hz, &zip, &zip_len) == ZR_OK;
+		long long elapsed = zipped ? unzipRounds(bench, zip, zip_len, out, len) : -1;
+		CloseZip(hz);
+		if (!CHECK(elapsed >= 0) || !CHECK(memcmp(out, picture->pixels, len) == 0)) {
+			printf("lz4: the picture didn't unzip right with %s\n", names[m]);
+			break;
+		}
+		speeds[m] = (double) len * bench->rounds / 1048576 * 1000000 / (elapsed > 0 ? elapsed : 1);
+		printf("lz4: unzip %-10s %5.1f MB, to %5.1f%% of it: %7.1f MB/s\n", names[m], len / 1048576.0,
+			   100.0 * zip_len / len, speeds[m]);
+	}
+	if (speeds[0] > 0 && speeds[1] > 0) {
+		printf("lz4: the lz4 blocks unzip %.1f times as fast as deflate\n", speeds[1] / speeds[0]);
+	}
+	free(out);
+}
+
+int Lz4Tests(int argc, char **argv) {
+	struct Lz4Bench bench;
+	memset(&bench, 0, sizeof(bench));
+	bench.quick = argc >= 1 && strcmp(argv[0], "--quick") == 0;
+	if (argc != bench.quick) {
+		printf("usage: edw590scr_tests lz4 [--quick]\n");
+
+		return 1;
+	}
+	bench.rounds = bench.quick ? 2 : 20;
+	bench.seed = 590;
+
+	// A 1080p picture, or a quarter of one with --quick
+	struct Frame picture;
+	memset(&picture, 0, sizeof(picture));
+	int width = bench.quick ? 480 : 1920;
+	int height = bench.quick ? 270 : 1080;
+	bench.clock = ClockCreateSystem();
+	int ok = bench.clock != NULL && TestPicture(&picture, width, height, 0x40);
+	if (ok) {
+		printf("lz4: %d rounds of %d x %d pictures' worth\n", bench.rounds, width, height);
+		benchDecode(&bench, &picture);
+		checkCorrupt(&bench, &picture);
+		benchUnzip(&bench, &picture);
+	}
+
+	FrameFree(&picture);
+	ClockDestroySystem(bench.clock);
+
+	return ok ? 0 : 1;
+}
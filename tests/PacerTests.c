@@ -0,0 +1,182 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include "Tests.h"
+#include "../Utils/Pacer.h"
+
+// The Pacer (see Pacer.h), on a virtual clock, so every wait is worked out to the microsecond: frames skipped rather
+// than rushed out when it's fallen behind, the spin margin following the timer's oversleeping, and changes of rate that
+// leave the next frame where it was.
+
+#define PERIOD_30 33333     // 1 / 30 s, in microseconds, rounded down as the Pacer does
+
+// A whole period late: the frames that were missed get skipped, and the next one after is on time again.
+static void checkSkipping(void) {
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	struct Pacer pacer;
+	PacerInit(&pacer, &clock.clock, 30, PACER_TIMER);
+	for (int i = 0; i < 3; i++) {
+		CHECK(PacerWait(&pacer) == i && pacer.late == 0);
+	}
+
+	// Less than a period late: no skipping, just late
+	clock.time += 50000;
+	CHECK(PacerWait(&pacer) == 3 && pacer.late == 16666 && pacer.skipped == 0);
+
+	// Frame 4's due at 133333. At 266766 that's 4 periods late, and frame 8 is the one due
+	clock.time = 266766;
+	long long frame = PacerWait(&pacer);
+	if (!CHECK(frame == 8 && pacer.skipped == 4)) {
+		printf("pacer: frame %lld after skipping %lld\n", frame, pacer.skipped);
+	}
+	CHECK(clock.time == 266766 && pacer.late == 100);
+	CHECK(PacerWait(&pacer) == 9 && clock.time == 300000 && pacer.late == 0 && pacer.skipped == 4);
+
+	// PacerRestart() after a long time away: nothing skipped, and the next frame's due at once
+	clock.time += 10000000;
+	PacerRestart(&pacer);
+	CHECK(PacerWait(&pacer) == 10 && pacer.late == 0 && pacer.skipped == 4);
+	CHECK(PacerWait(&pacer) == 11 && pacer.late == 0 && clock.time == 10300000 + PERIOD_30);
+}
+
+// The spin margin: up to just over the timer's oversleeping at once, back down slowly, and never over a quarter of a
+// frame. While it's over the oversleeping, the frames come exactly on time.
+static void checkSpinMargin(void) {
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	clock.oversleep = 3000;
+	struct Pacer pacer;
+	PacerInit(&pacer, &clock.clock, 30, PACER_SPIN);
+	CHECK(PacerWait(&pacer) == 0 && pacer.spin_margin == 2000);
+
+	// Wakes 1000 after the deadline, the margin being too small, and then it's 500 more than the oversleeping
+	CHECK(PacerWait(&pacer) == 1 && pacer.late == 1000 && pacer.spin_margin == 3500);
+	for (int i = 0; i < 10; i++) {
+		PacerWait(&pacer);
+		CHECK(pacer.late == 0 && pacer.spin_margin == 3500);
+	}
+
+	// A better timer: a sixteenth of the way down each frame
+	clock.oversleep = 0;
+	PacerWait(&pacer);
+	CHECK(pacer.late == 0 && pacer.spin_margin == 3500 - 3000 / 16);
+	for (int i = 0; i < 100; i++) {
+		PacerWait(&pacer);
+		CHECK(pacer.late == 0);
+	}
+	if (!CHECK(pacer.spin_margin >= 500 && pacer.spin_margin < 600)) {
+		printf("pacer: spin margin %lld after 100 frames\n", pacer.spin_margin);
+	}
+
+	// A timer that's hopeless: no more than a quarter of a frame spent spinning, even if the frames are late
+	clock.oversleep = 20000;
+	PacerWait(&pacer);
+	CHECK(pacer.spin_margin == PERIOD_30 / 4);
+	PacerWait(&pacer);
+	CHECK(pacer.late == 20000 - PERIOD_30 / 4 && pacer.skipped == 0);
+
+	// And a 1 ms timer (timeBeginPeriod(1)), with a bit of oversleeping on top: on time again, once it's learned it
+	clock.oversleep = 1000;
+	clock.granularity = 1000;
+	for (int i = 0; i < 10; i++) {
+		PacerWait(&pacer);
+	}
+	for (int i = 0; i < 30; i++) {
+		PacerWait(&pacer);
+		CHECK(pacer.late == 0);
+	}
+}
+
+// Changing the rate: the next frame's due when it was, and the ones after at the new rate from there, so the frame
+// times never jump back or leave a gap.
+static void checkRateChanges(void) {
+	static const long long rates[] = {60000, 37500, 24000, 144000, 30000, 1000, 59940};
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	struct Pacer pacer;
+	PacerInit(&pacer, &clock.clock, 30, PACER_TIMER);
+	for (int i = 0; i < 10; i++) {
+		PacerWait(&pacer);
+	}
+	CHECK(PacerDeadline(&pacer) == 10 * 1000000 / 30);
+
+	long long last = clock.time;
+	long long frame = 10;
+	for (int r = 0; r < (int) (sizeof(rates) / sizeof(rates[0])); r++) {
+		long long deadline = PacerDeadline(&pacer);
+		PacerSetRate(&pacer, rates[r]);
+		if (!CHECK(PacerDeadline(&pacer) == deadline)) {
+			printf("pacer: setting %lld mHz moved the next frame from %lld to %lld\n", rates[r], deadline,
+				   PacerDeadline(&pacer));
+		}
+		for (int i = 0; i < 5; i++) {
+			deadline = PacerDeadline(&pacer);
+			CHECK(PacerWait(&pacer) == frame++ && clock.time == deadline);
+			// Each at the rate since the last change, give or take a microsecond of rounding
+			long long period = clock.time - last;
+			CHECK(i == 0 || ((period - 1) * rates[r] < 1000000000 && (period + 1) * rates[r] > 1000000000));
+			last = clock.time;
+		}
+	}
+	CHECK(pacer.skipped == 0);
+
+	// PacerSetFps() is the same in whole FPS
+	long long deadline = PacerDeadline(&pacer);
+	PacerSetFps(&pacer, 50);
+	CHECK(PacerDeadline(&pacer) == deadline && pacer.rate == 50000);
+	PacerWait(&pacer);
+	PacerWait(&pacer);
+	CHECK(clock.time == deadline + 20000);
+}
+
+// On refreshes: each frame on the refresh nearest its deadline, and the refresh interval learned on the way.
+static void checkRefreshes(void) {
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	clock.refresh = 16667;
+	struct Pacer pacer;
+	PacerInit(&pacer, &clock.clock, 30, PACER_REFRESH);
+	for (int i = 0; i < 60; i++) {
+		PacerWait(&pacer);
+		CHECK(clock.time % clock.refresh == 0 || i == 0);
+		CHECK(pacer.late > -clock.refresh / 2 - 1 && pacer.late <= clock.refresh / 2);
+	}
+	CHECK(pacer.refresh == 16667 && pacer.skipped == 0);
+
+	// With no display, it spins instead
+	clock.refresh = 0;
+	for (int i = 0; i < 10; i++) {
+		PacerWait(&pacer);
+		CHECK(pacer.late == 0);
+	}
+}
+
+int PacerTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkSkipping();
+	checkSpinMargin();
+	checkRateChanges();
+	checkRefreshes();
+
+	return 0;
+}
@@ -0,0 +1,313 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "Tests.h"
+#include "../Utils/Clock.h"
+#include "../Utils/Pipeline.h"
+#include "../Utils/Queue.h"
+
+// The lock-free queue (see Queue.h) and the pipeline that hands the frames over in it (see Pipeline.h).
+//
+// queue: on one thread, full and empty and the order, with the counters wrapping round too. Then between 2 threads,
+// a push thread that waits whenever it's full and a pop thread that waits whenever it's empty: every item must come
+// out once, in order. It says how many items a second get through.
+// pipeline: the items come in the order they were made, each with its own frame; no more than PIPELINE_SLOTS are ever
+// out at once; and one whose frame couldn't be made is made again. It says how many items a second get through, made,
+// taken and given back.
+// shutdown: PipelineDestroy() has to come back at once while the pipeline's thread waits for an item to come back,
+// and while its frames keep failing to be made.
+//
+// usage: edw590scr_tests pipeline [--quick]
+
+#define WAIT_US 1000000     // the longest anything here may take to happen
+
+struct Pusher {
+	struct Queue *queue;
+	struct Clock *clock;
+	unsigned int count;
+};
+
+// Pushes 1 to count, in order, waiting whenever the queue's full.
+#ifdef _WIN32
+static DWORD WINAPI pushThread(LPVOID param) {
+#else
+static void *pushThread(void *param) {
+#endif
+	struct Pusher *pusher = (struct Pusher *) param;
+	for (unsigned int i = 1; i <= pusher->count; i++) {
+		while (!QueuePush(pusher->queue, (void *) (size_t) i)) {
+			pusher->clock->yield(pusher->clock);
+		}
+	}
+#ifdef _WIN32
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+static void checkQueueAlone(void) {
+	struct Queue queue;
+	QueueInit(&queue, 0);
+	CHECK(queue.capacity == 1);
+	QueueInit(&queue, 100);
+	CHECK(queue.capacity == QUEUE_MAX_ITEMS);
+	QueueInit(&queue, 3);
+	CHECK(queue.capacity == 4);
+
+	CHECK(QueuePop(&queue) == NULL);
+	for (int i = 1; i <= 4; i++) {
+		CHECK(QueuePush(&queue, (void *) (size_t) i));
+	}
+	CHECK(!QueuePush(&queue, (void *) (size_t) 5) && QueueCount(&queue) == 4);
+	for (int i = 1; i <= 4; i++) {
+		CHECK(QueuePop(&queue) == (void *) (size_t) i);
+	}
+	CHECK(QueuePop(&queue) == NULL && QueueCount(&queue) == 0);
+
+	// Round past where the counters wrap, a few at a time
+	queue.head = queue.tail = UINT_MAX - 5;
+	size_t pushed = 1;
+	size_t popped = 1;
+	int wrong = 0;
+	for (int round = 0; round < 8; round++) {
+		for (int i = 0; i < 3; i++) {
+			wrong |= !QueuePush(&queue, (void *) pushed++);
+		}
+		for (int i = 0; i < 2 + round % 2 * 2; i++) {
+			wrong |= QueuePop(&queue) != (void *) popped++;
+		}
+		wrong |= QueueCount(&queue) != (int) (pushed - popped);
+	}
+	CHECK(!wrong);
+}
+
+static void checkQueueThreads(struct Clock *clock, int quick) {
+	struct Queue queue;
+	QueueInit(&queue, PIPELINE_SLOTS);
+	struct Pusher pusher;
+	pusher.queue = &queue;
+	pusher.clock = clock;
+	pusher.count = quick ? 100000 : 5000000;
+	long long start = clock->now(clock);
+#ifdef _WIN32
+	HANDLE thread = CreateThread(NULL, 0, pushThread, &pusher, 0, NULL);
+	if (!CHECK(thread != NULL)) {
+		return;
+	}
+#else
+	pthread_t thread;
+	if (!CHECK(pthread_create(&thread, NULL, pushThread, &pusher) == 0)) {
+		return;
+	}
+#endif
+
+	unsigned int expected = 1;
+	int wrong = 0;
+	while (expected <= pusher.count) {
+		void *item = QueuePop(&queue);
+		if (item == NULL) {
+			clock->yield(clock);
+			continue;
+		}
+		wrong |= item != (void *) (size_t) expected;
+		expected++;
+	}
+#ifdef _WIN32
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+	long long elapsed = clock->now(clock) - start;
+
+	if (!CHECK(!wrong) || !CHECK(QueuePop(&queue) == NULL)) {
+		printf("pipeline: the items didn't come out of the queue in the order they went in\n");
+	}
+	printf("pipeline: %u items through a queue of %d between 2 threads in %.1f ms: %.1f million a second\n",
+		   pusher.count, queue.capacity, elapsed / 1000.0, (double) pusher.count / (elapsed > 0 ? elapsed : 1));
+}
+
+struct Producer {
+	int calls;          // how many times produce() has been called
+	int fail_call;      // the one that fails (from 1), or 0
+	int fail_always;
+};
+
+// A PipelineProduce: makes the frame the item's own buffer, with the item's sequence in its first pixel.
+static int produce(void *context, struct PipelineItem *item) {
+	struct Producer *producer = (struct Producer *) context;
+	producer->calls++;
+	if (producer->fail_always || producer->calls == producer->fail_call) {
+		return 0;
+	}
+	if (item->buffer.pixels == NULL && !FrameAlloc(&item->buffer, 4, 4)) {
+		return 0;
+	}
+
+	item->buffer.pixels[0] = (unsigned int) item->sequence;
+	item->frame = &item->buffer;
+	item->timings.convert++;
+
+	return 1;
+}
+
+// The next item made, waiting up to wait microseconds for it. NULL if there wasn't one by then.
+static struct PipelineItem *take(struct Pipeline *pipeline, struct Clock *clock, long long wait) {
+	long long start = clock->now(clock);
+	for (;;) {
+		struct PipelineItem *item = PipelineTake(pipeline);
+		if (item != NULL || clock->now(clock) - start >= wait) {
+			return item;
+		}
+		clock->yield(clock);
+	}
+}
+
+// Whether item is the one made sequence-th, as produce() makes them.
+static int isItem(const struct PipelineItem *item, long long sequence) {
+	return item != NULL && item->sequence == sequence && item->frame == &item->buffer &&
+		   item->buffer.pixels[0] == (unsigned int) sequence && item->timings.convert == 1 && item->made > 0;
+}
+
+static void checkPipeline(struct Clock *clock, int quick) {
+	// The second frame fails, and is made again
+	struct Producer producer;
+	memset(&producer, 0, sizeof(producer));
+	producer.fail_call = 2;
+	struct Pipeline *pipeline = PipelineCreate(clock, produce, &producer);
+	if (!CHECK(pipeline != NULL)) {
+		return;
+	}
+
+	// Taken and given back one at a time, in order
+	for (int i = 0; i < 8; i++) {
+		struct PipelineItem *item = take(pipeline, clock, WAIT_US);
+		if (!CHECK(isItem(item, i))) {
+			printf("pipeline: item %d isn't what was made %d-th\n", item != NULL ? (int) item->sequence : -1, i);
+			break;
+		}
+		PipelineRelease(pipeline, item);
+	}
+
+	// All of them out at once: then there are no more until one comes back
+	struct PipelineItem *out[PIPELINE_SLOTS];
+	for (int i = 0; i < PIPELINE_SLOTS; i++) {
+		out[i] = take(pipeline, clock, WAIT_US);
+		CHECK(isItem(out[i], 8 + i));
+	}
+	CHECK(take(pipeline, clock, 50000) == NULL);
+	if (out[1] != NULL) {
+		PipelineRelease(pipeline, out[1]);
+		CHECK(isItem(take(pipeline, clock, WAIT_US), 8 + PIPELINE_SLOTS));
+	}
+	PipelineDestroy(pipeline);
+	CHECK(producer.calls == 8 + PIPELINE_SLOTS + 2);
+
+	// And as fast as they go
+	memset(&producer, 0, sizeof(producer));
+	pipeline = PipelineCreate(clock, produce, &producer);
+	if (!CHECK(pipeline != NULL)) {
+		return;
+	}
+	int count = quick ? 10000 : 200000;
+	int wrong = 0;
+	long long start = clock->now(clock);
+	for (int i = 0; i < count && !wrong; i++) {
+		struct PipelineItem *item = take(pipeline, clock, WAIT_US);
+		wrong = !isItem(item, i);
+		if (item != NULL) {
+			PipelineRelease(pipeline, item);
+		}
+	}
+	long long elapsed = clock->now(clock) - start;
+	PipelineDestroy(pipeline);
+	CHECK(!wrong);
+	printf("pipeline: %d items made, taken and given back in %.1f ms: %.2f us each\n", count, elapsed / 1000.0,
+		   (double) elapsed / count);
+}
+
+// PipelineDestroy()s pipeline, and checks it didn't take long.
+static void checkDestroy(struct Pipeline *pipeline, struct Clock *clock, const char *when) {
+	long long start = clock->now(clock);
+	PipelineDestroy(pipeline);
+	long long elapsed = clock->now(clock) - start;
+	if (!CHECK(elapsed < WAIT_US)) {
+		printf("pipeline: destroying it %s took %.1f ms\n", when, elapsed / 1000.0);
+	}
+}
+
+static void checkShutdown(struct Clock *clock) {
+	struct Producer producer;
+	memset(&producer, 0, sizeof(producer));
+	struct Pipeline *pipeline = PipelineCreate(clock, produce, &producer);
+	if (CHECK(pipeline != NULL)) {
+		checkDestroy(pipeline, clock, "straight away");
+	}
+
+	// With all the items out, its thread waits for one to come back, for ever
+	memset(&producer, 0, sizeof(producer));
+	pipeline = PipelineCreate(clock, produce, &producer);
+	if (CHECK(pipeline != NULL)) {
+		for (int i = 0; i < PIPELINE_SLOTS; i++) {
+			CHECK(take(pipeline, clock, WAIT_US) != NULL);
+		}
+		checkDestroy(pipeline, clock, "with all the items out");
+	}
+
+	// With no frames to be had, it keeps waiting a while and trying again
+	memset(&producer, 0, sizeof(producer));
+	producer.fail_always = 1;
+	pipeline = PipelineCreate(clock, produce, &producer);
+	if (CHECK(pipeline != NULL)) {
+		CHECK(take(pipeline, clock, 50000) == NULL);
+		checkDestroy(pipeline, clock, "with no frames to be had");
+		CHECK(producer.calls >= 1);
+	}
+}
+
+int PipelineTests(int argc, char **argv) {
+	int quick = argc >= 1 && strcmp(argv[0], "--quick") == 0;
+	if (argc != quick) {
+		printf("usage: edw590scr_tests pipeline [--quick]\n");
+
+		return 1;
+	}
+	struct Clock *clock = ClockCreateSystem();
+	if (clock == NULL) {
+		return 1;
+	}
+
+	checkQueueAlone();
+	checkQueueThreads(clock, quick);
+	checkPipeline(clock, quick);
+	checkShutdown(clock);
+
+	ClockDestroySystem(clock);
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Preview.h"
+#include "../Utils/Schedule.h"
+
+// The preview's frames (see Preview.h).
+//
+// frames: no more than PREVIEW_MAX_FRAMES of them, each as big as fits the preview and no bigger (nor bigger than the
+// frame it came from), with a window too thin for any of it turned down rather than made 0 pixels wide.
+// footprint: at the usual preview size, all of them together in less than a single full size 1920 x 1080 frame's
+// eighth, and PreviewBytes() adding them up right. A frame of one colour stays that colour, the box filter averaging
+// it.
+// rate: a second of virtual time at PREVIEW_FPS, on a 60 Hz display: PREVIEW_FPS frames, evenly spaced.
+
+#define PREVIEW_WIDTH 152   // what Display Properties gives it
+#define PREVIEW_HEIGHT 112
+#define FULL_BYTES (1920 * 1080 * 4)
+
+static void checkFrames(const struct Frame *full, const struct Frame *small) {
+	struct Preview preview;
+	PreviewInit(&preview);
+	CHECK(preview.num_frames == 0 && PreviewBytes(&preview) == 0);
+
+	// 16:9 into 152 x 112: as wide as the window, and 85 high
+	for (int i = 0; i < PREVIEW_MAX_FRAMES; i++) {
+		CHECK(PreviewAddFrame(&preview, full, PREVIEW_WIDTH, PREVIEW_HEIGHT) && preview.num_frames == i + 1);
+	}
+	for (int i = 0; i < preview.num_frames; i++) {
+		const struct Frame *frame = &preview.frames[i];
+		if (!CHECK(frame->width == PREVIEW_WIDTH && frame->height == PREVIEW_WIDTH * 1080 / 1920)) {
+			printf("preview: frame %d is %d x %d\n", i, frame->width, frame->height);
+		}
+	}
+	// And no room for another
+	CHECK(!PreviewAddFrame(&preview, full, PREVIEW_WIDTH, PREVIEW_HEIGHT) && preview.num_frames == PREVIEW_MAX_FRAMES);
+	PreviewFree(&preview);
+	CHECK(preview.num_frames == 0 && PreviewBytes(&preview) == 0);
+
+	// A frame smaller than the window stays as it is, and one too thin to show any of turns up nothing
+	PreviewInit(&preview);
+	CHECK(PreviewAddFrame(&preview, small, PREVIEW_WIDTH, PREVIEW_HEIGHT));
+	CHECK(preview.frames[0].width == small->width && preview.frames[0].height == small->height);
+	CHECK(memcmp(preview.frames[0].pixels, small->pixels, (size_t) small->width * small->height * 4) == 0);
+	CHECK(!PreviewAddFrame(&preview, full, 1, PREVIEW_HEIGHT) && preview.num_frames == 1);
+	CHECK(!PreviewAddFrame(&preview, full, 0, 0) && preview.num_frames == 1);
+	CHECK(PreviewAddFrame(&preview, full, PREVIEW_WIDTH, 1) && preview.frames[1].height == 1);
+	PreviewFree(&preview);
+}
+
+static void checkFootprint(struct Frame *full) {
+	struct Preview preview;
+	PreviewInit(&preview);
+	for (int i = 0; i < full->width * full->height; i++) {
+		full->pixels[i] = 0x3060C0;
+	}
+	while (PreviewAddFrame(&preview, full, PREVIEW_WIDTH, PREVIEW_HEIGHT)) {
+	}
+	CHECK(preview.num_frames == PREVIEW_MAX_FRAMES);
+
+	long long bytes = 0;
+	for (int i = 0; i < preview.num_frames; i++) {
+		const struct Frame *frame = &preview.frames[i];
+		bytes += (long long) frame->stride * frame->height * 4;
+		int flat = 1;
+		for (int j = 0; j < frame->stride * frame->height; j++) {
+			flat &= frame->pixels[j] == 0x3060C0;
+		}
+		CHECK(flat);
+	}
+	CHECK(PreviewBytes(&preview) == bytes);
+	CHECK(bytes <= (long long) PREVIEW_WIDTH * PREVIEW_HEIGHT * 4 * PREVIEW_MAX_FRAMES);
+	if (!CHECK(bytes < FULL_BYTES / 8)) {
+		printf("preview: %lld bytes for %d frames\n", bytes, preview.num_frames);
+	}
+	PreviewFree(&preview);
+}
+
+static void checkRate(void) {
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	struct Schedule schedule;
+	ScheduleInit(&schedule, &clock.clock, PREVIEW_FPS, PACER_TIMER);
+	CHECK(ScheduleAddDisplay(&schedule, 60000, 0) == 0 && schedule.displays[0].interval == 60 / PREVIEW_FPS);
+
+	unsigned char due[SCHEDULE_MAX_DISPLAYS];
+	int frames = 0;
+	long long last = -1;
+	while (1) {
+		ScheduleWait(&schedule, due);
+		if (clock.time >= 1000000) {
+			break;
+		}
+		if (due[0]) {
+			if (last >= 0 && !CHECK(clock.time - last == 1000000 / PREVIEW_FPS)) {
+				printf("preview: a frame %lld us after the last\n", clock.time - last);
+			}
+			frames++;
+			last = clock.time;
+		}
+	}
+	if (!CHECK(frames == PREVIEW_FPS)) {
+		printf("preview: %d frames in a second\n", frames);
+	}
+	// Which is less than the saver's own rate, or it's no saving at all
+	CHECK(PREVIEW_FPS < 30);
+}
+
+int PreviewTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	struct Frame full;
+	struct Frame small;
+	if (!CHECK(TestPicture(&full, 1920, 1080, 0x20) && TestPicture(&small, 100, 60, 0x40))) {
+		FrameFree(&full);
+		FrameFree(&small);
+
+		return 1;
+	}
+
+	checkFrames(&full, &small);
+	checkFootprint(&full);
+	checkRate();
+
+	FrameFree(&full);
+	FrameFree(&small);
+
+	return 0;
+}
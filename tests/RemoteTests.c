@@ -0,0 +1,169 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include "Tests.h"
+#include "../Utils/Offscreen.h"
+#include "../Utils/Remote.h"
+
+// The remote desktop policy (see Remote.h), without a remote desktop: the same slideshow drawn the usual way and the
+// policy's way onto an offscreen target, with the bytes presented counted, to see how much less a remote session would
+// have to send. And the RemoteMeter that counts them a second at a time in main.c.
+
+#define WIDTH 256
+#define HEIGHT 144
+#define NUM_FRAMES 4
+#define SECONDS 3
+
+// Frame k: the same picture each time, but with the bottom 2 bits of every channel different (like the noise of a
+// video, or a JPEG's), and a small black square somewhere else on each.
+static int makeFrames(struct Frame *frames) {
+	for (int k = 0; k < NUM_FRAMES; k++) {
+		if (!TestPicture(&frames[k], WIDTH, HEIGHT, 0x30)) {
+			return 0;
+		}
+		for (int y = 0; y < HEIGHT; y++) {
+			unsigned int *row = frames[k].pixels + (size_t) y * frames[k].stride;
+			for (int x = 0; x < WIDTH; x++) {
+				unsigned int noise = (unsigned int) (x * 7 + y * 13 + k) & 3;
+				row[x] = (row[x] & 0xFCFCFC) | noise * 0x010101;
+				if (x >= 20 + k * 60 && x < 36 + k * 60 && y >= 64 && y < 80) {
+					row[x] = 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+// Shows frames for SECONDS at fps ticks a second, each for hold ticks, with policy's rules or (for NULL) the usual
+// ones. Returns the bytes a second presented after the first frame (which is all of it, either way).
+static long long slideshow(const struct Frame *frames, const struct RemotePolicy *policy, int fps, int hold) {
+	struct Offscreen *offscreen = OffscreenCreate(WIDTH, HEIGHT);
+	if (offscreen == NULL) {
+		return -1;
+	}
+	if (policy != NULL) {
+		RemoteApply(policy, &offscreen->canvas);
+		fps = RemoteFps(policy, fps);
+		hold = policy->hold_ticks;
+	}
+
+	struct RenderTarget *target = &offscreen->target;
+	long long bytes = 0;
+	for (int tick = 0; tick <= SECONDS * fps; tick++) {
+		struct RenderTimings timings;
+		long long written = offscreen->bytes_written;
+		CHECK(RenderFrame(&target, 1, &frames[tick / hold % NUM_FRAMES], NULL, NULL, &timings));
+		// What's counted is what got presented
+		CHECK(timings.bytes_presented == offscreen->bytes_written - written);
+		if (tick > 0) {
+			bytes += timings.bytes_presented;
+		}
+	}
+	OffscreenDestroy(offscreen);
+
+	return bytes / SECONDS;
+}
+
+static void checkSlideshow(void) {
+	struct Frame frames[NUM_FRAMES];
+	if (!makeFrames(frames)) {
+		return;
+	}
+
+	// The usual way: the noise changes every pixel, so all of each frame gets presented, 30 times a second
+	long long local = slideshow(frames, NULL, 30, 1);
+	if (!CHECK(local == 30LL * WIDTH * HEIGHT * 4)) {
+		printf("remote: %lld bytes a second the usual way\n", local);
+	}
+
+	// The policy's: a new frame every 2 seconds (5 FPS, held for 10 ticks), the noise cut off with the bottom 3 bits,
+	// so only the tiles the squares are in change: no more than 8 64 x 64 tiles (2 squares on 4 each) every 2 seconds
+	struct RemotePolicy policy = {5, 10, 5};
+	long long remote = slideshow(frames, &policy, 30, 1);
+	printf("remote: %lld bytes a second the usual way, %lld the remote policy's\n", local, remote);
+	CHECK(remote >= 0 && remote <= 8 * 64 * 64 * 4 / 2);
+	CHECK(remote * 100 < local);
+
+	// Only the bits cut, all frames shown: the 2 tiles the squares are in and were in, 30 times a second
+	struct RemotePolicy bits_only = {0, 1, 5};
+	long long cut = slideshow(frames, &bits_only, 30, 1);
+	if (!CHECK(cut == 30LL * 2 * 64 * 64 * 4)) {
+		printf("remote: %lld bytes a second with only the bits cut\n", cut);
+	}
+
+	for (int k = 0; k < NUM_FRAMES; k++) {
+		FrameFree(&frames[k]);
+	}
+}
+
+static void checkPolicy(void) {
+	struct RemotePolicy policy = {5, 10, 5};
+	CHECK(RemoteFps(&policy, 30) == 5 && RemoteFps(&policy, 3) == 3);
+	policy.fps = 0;
+	CHECK(RemoteFps(&policy, 30) == 30);
+
+	// The canvas: tiles on, transitions off, and drawn again whenever the bits change
+	struct Canvas canvas;
+	CanvasInit(&canvas);
+	canvas.dirty_tiles = 0;
+	canvas.transition = TRANSITION_CROSSFADE;
+	struct Frame frame;
+	canvas.frame = &frame;
+	RemoteApply(&policy, &canvas);
+	CHECK(canvas.dirty_tiles && canvas.transition == TRANSITION_CUT);
+	CHECK(canvas.channel_bits == 5 && canvas.frame == NULL);
+	canvas.frame = &frame;
+	RemoteApply(&policy, &canvas);
+	CHECK(canvas.frame == &frame);
+	policy.channel_bits = 1;
+	RemoteApply(&policy, &canvas);
+	CHECK(canvas.channel_bits == 4 && canvas.frame == NULL);
+	policy.channel_bits = 12;
+	RemoteApply(&policy, &canvas);
+	CHECK(canvas.channel_bits == 8);
+	CanvasFree(&canvas);
+}
+
+static void checkMeter(void) {
+	struct RemoteMeter meter;
+	RemoteMeterInit(&meter, 5000000);
+	RemoteMeterAdd(&meter, 5000000, 100);
+	RemoteMeterAdd(&meter, 5500000, 100);
+	CHECK(meter.rate == -1 && meter.total == 200);
+	// The second's done at 6 s: the 200 bytes in it, and the 300 now are the next second's
+	RemoteMeterAdd(&meter, 6000000, 300);
+	CHECK(meter.rate == 200 && meter.bytes == 300 && meter.total == 500);
+	// And a longer one counts as what it is
+	RemoteMeterAdd(&meter, 8000000, 0);
+	CHECK(meter.rate == 150 && meter.total == 500);
+}
+
+int RemoteTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkMeter();
+	checkPolicy();
+	checkSlideshow();
+
+	return 0;
+}
@@ -0,0 +1,413 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Scaler.h"
+#include "../Utils/Simd.h"
+#include "../Utils/ThreadPool.h"
+
+// The scaler's SIMD kernels (see Simd.h) against its plain C ones: every filter, shrinking and enlarging, at odd
+// sizes and with rows further apart than they're wide, with each of the SIMD levels compiled in (see simd_enabled_GL),
+// and nothing may differ by a bit. The mips too, and then the mips themselves: the chain halving (rounding down) until
+// the next would be under 16 pixels either way, each pixel the rounded average of the 2 x 2 under it, on the threads or
+// not; ScalePickMip() picking the smallest level that's still big enough; and a frame whose mips can't be allocated
+// left just as it was. And ScaleJobsTiled() with jobs that scale the same frame the same way, which only get scaled
+// once: every job's pixels as ScaleFrame() makes them, copied or not.
+
+#define PADDING 0xDEADBEEF  // what's after the end of each destination row, which must still be there after
+
+static const int src_sizes[][2] = {{1, 1}, {3, 5}, {17, 13}, {33, 7}, {101, 67}, {640, 361}};
+static const int dst_sizes[][2] = {{1, 1}, {7, 3}, {31, 17}, {50, 50}, {199, 101}, {1283, 721}};
+static const int paddings[] = {0, 1, 3, 7, 5};  // pixels on the end of the rows
+
+static unsigned int random_state = 590;
+
+static unsigned int randomPixel(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return random_state;
+}
+
+// A width x height frame of noise (alpha and all), with padding pixels more to each row.
+static int noiseFrame(struct Frame *frame, int width, int height, int padding) {
+	if (!FrameAlloc(frame, width + padding, height)) {
+		return 0;
+	}
+	frame->width = width;
+	for (int i = 0; i < frame->stride * height; i++) {
+		frame->pixels[i] = randomPixel();
+	}
+
+	return 1;
+}
+
+// The SIMD levels compiled in, from 0 (plain C).
+static int simdLevels(void) {
+#if defined(EDW590SCR_AVX2)
+	return 3;
+#elif defined(EDW590SCR_SSE2)
+	return 2;
+#else
+	return 1;
+#endif
+}
+
+// Scales src into dst (dst_width x height, rows stride apart, filled with PADDING first) with each SIMD level, and
+// in 2 halves, and on pool's threads too, and checks they all come out as the plain C one.
+static void checkScale(const struct Frame *src, int dst_width, int dst_height, int stride, enum ScaleFilter filter,
+					   struct ThreadPool *pool, unsigned int *expected, unsigned int *actual) {
+	struct ScalePlan plan;
+	if (!CHECK(ScalePlanInit(&plan, src->width, src->height, dst_width, dst_height, filter))) {
+		return;
+	}
+	size_t size = (size_t) stride * dst_height;
+	for (int level = 0; level < simdLevels(); level++) {
+		simd_enabled_GL = level;
+		unsigned int *dst = level == 0 ? expected : actual;
+		for (size_t i = 0; i < size; i++) {
+			dst[i] = PADDING;
+		}
+		CHECK(ScaleFrame(&plan, src, dst, stride));
+		if (level > 0 && !CHECK(memcmp(expected, actual, size * 4) == 0)) {
+			printf("scaler: filter %d, %d x %d (stride %d) to %d x %d (stride %d): SIMD level %d differs\n", filter,
+				   src->width, src->height, src->stride, dst_width, dst_height, stride, level);
+		}
+
+		// The same in 2 goes, as the threads do it
+		for (size_t i = 0; i < size; i++) {
+			actual[i] = PADDING;
+		}
+		CHECK(ScaleRows(&plan, src, actual, stride, dst_height / 3, dst_height));
+		CHECK(ScaleRows(&plan, src, actual, stride, 0, dst_height / 3));
+		if (!CHECK(memcmp(expected, actual, size * 4) == 0)) {
+			printf("scaler: filter %d, %d x %d to %d x %d: SIMD level %d differs in 2 goes\n", filter, src->width,
+				   src->height, dst_width, dst_height, level);
+		}
+
+		// And in bands on the threads, twice: the second time with the scratch the first left in the plan
+		for (int go = 0; go < 2; go++) {
+			for (size_t i = 0; i < size; i++) {
+				actual[i] = PADDING;
+			}
+			CHECK(ScaleFrameTiled(&plan, src, actual, stride, pool));
+			if (!CHECK(memcmp(expected, actual, size * 4) == 0)) {
+				printf("scaler: filter %d, %d x %d to %d x %d: SIMD level %d differs on the threads\n", filter,
+					   src->width, src->height, dst_width, dst_height, level);
+			}
+		}
+	}
+	for (int y = 0; y < dst_height; y++) {
+		for (int x = dst_width; x < stride; x++) {
+			CHECK(expected[(size_t) y * stride + x] == PADDING);
+		}
+	}
+	simd_enabled_GL = 2;
+	ScalePlanFree(&plan);
+}
+
+static void checkScaling(void) {
+	const int num_src = (int) (sizeof(src_sizes) / sizeof(src_sizes[0]));
+	const int num_dst = (int) (sizeof(dst_sizes) / sizeof(dst_sizes[0]));
+	const int num_paddings = (int) (sizeof(paddings) / sizeof(paddings[0]));
+	size_t most = (size_t) (dst_sizes[num_dst - 1][0] + 7) * dst_sizes[num_dst - 1][1];
+	unsigned int *expected = (unsigned int *) malloc(most * 4);
+	unsigned int *actual = (unsigned int *) malloc(most * 4);
+	struct ThreadPool *pool = ThreadPoolCreate(3);
+	if (!CHECK(expected != NULL && actual != NULL && pool != NULL)) {
+		free(expected);
+		free(actual);
+		ThreadPoolDestroy(pool);
+
+		return;
+	}
+
+	int n = 0;
+	for (int s = 0; s < num_src; s++) {
+		struct Frame src;
+		if (!noiseFrame(&src, src_sizes[s][0], src_sizes[s][1], paddings[s % num_paddings])) {
+			break;
+		}
+		for (int d = 0; d < num_dst; d++) {
+			int stride = dst_sizes[d][0] + paddings[(s + d) % num_paddings];
+			for (int filter = SCALE_NEAREST; filter <= SCALE_AREA; filter++) {
+				checkScale(&src, dst_sizes[d][0], dst_sizes[d][1], stride, (enum ScaleFilter) filter, pool,
+						   expected, actual);
+				n++;
+			}
+		}
+		FrameFree(&src);
+	}
+	printf("scaler: %d scalings, each with %d SIMD levels\n", n, simdLevels());
+
+	ThreadPoolDestroy(pool);
+	free(expected);
+	free(actual);
+}
+
+// The mips, at odd sizes and strides, with each level.
+static void checkMips(void) {
+	static const int sizes[][2] = {{32, 32}, {33, 35}, {100, 67}, {257, 129}, {1001, 37}};
+	for (int s = 0; s < (int) (sizeof(sizes) / sizeof(sizes[0])); s++) {
+		struct Frame expected;
+		if (!noiseFrame(&expected, sizes[s][0], sizes[s][1], paddings[s])) {
+			return;
+		}
+		struct Frame actual;
+		if (!FrameAlloc(&actual, expected.stride, expected.height)) {
+			FrameFree(&expected);
+
+			return;
+		}
+		actual.width = expected.width;
+		memcpy(actual.pixels, expected.pixels, (size_t) expected.stride * expected.height * 4);
+
+		simd_enabled_GL = 0;
+		CHECK(ScaleBuildMips(&expected, NULL));
+		for (int level = 1; level < simdLevels(); level++) {
+			simd_enabled_GL = level;
+			struct Frame copy = actual;
+			CHECK(ScaleBuildMips(&copy, NULL));
+			const struct Frame *a = expected.mips;
+			const struct Frame *b = copy.mips;
+			for (; a != NULL && b != NULL; a = a->mips, b = b->mips) {
+				CHECK(a->width == b->width && a->height == b->height);
+				if (!CHECK(memcmp(a->pixels, b->pixels, (size_t) a->width * a->height * 4) == 0)) {
+					printf("scaler: the %d x %d mip of %d x %d differs at SIMD level %d\n", a->width, a->height,
+						   expected.width, expected.height, level);
+				}
+			}
+			CHECK(a == NULL && b == NULL);
+			// Without the mips again, for the next level
+			actual.pixels = copy.pixels;
+		}
+		simd_enabled_GL = 2;
+		FrameFree(&expected);
+		FrameFree(&actual);
+	}
+}
+
+// The rounded average of the 2 x 2 pixels at 2 * x, 2 * y in src.
+static unsigned int average(const struct Frame *src, int x, int y) {
+	const unsigned int *row0 = src->pixels + (size_t) 2 * y * src->stride + 2 * x;
+	const unsigned int *row1 = row0 + src->stride;
+	unsigned int out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		unsigned int sum = ((row0[0] >> shift) & 0xFF) + ((row0[1] >> shift) & 0xFF) + ((row1[0] >> shift) & 0xFF) +
+						   ((row1[1] >> shift) & 0xFF);
+		out |= ((sum + 2) >> 2) << shift;
+	}
+
+	return out;
+}
+
+static void checkMipChain(struct ThreadPool *pool) {
+	// Each with how many mips it has, and the size of the last, which is still 16 either way
+	static const int chains[][5] = {
+		{101, 67, 2, 25, 16},
+		{33, 1000, 1, 16, 500},
+		{67, 35, 1, 33, 17},        // 16 x 8 would be too small
+		{257, 129, 3, 32, 16},
+		{31, 500, 0, 31, 500},      // under 32 wide: none at all
+		{16, 16, 0, 16, 16},
+	};
+	for (int c = 0; c < (int) (sizeof(chains) / sizeof(chains[0])); c++) {
+		const int *chain = chains[c];
+		for (int threads = 0; threads < 2; threads++) {
+			struct Frame frame;
+			if (!noiseFrame(&frame, chain[0], chain[1], paddings[c % 5])) {
+				return;
+			}
+			CHECK(ScaleBuildMips(&frame, threads ? pool : NULL));
+			// Built already: nothing to do
+			struct Frame *mips = frame.mips;
+			CHECK(ScaleBuildMips(&frame, pool) && frame.mips == mips);
+
+			const struct Frame *src = &frame;
+			int num_levels = 0;
+			for (const struct Frame *level = frame.mips; level != NULL; level = level->mips) {
+				if (!CHECK(level->width == src->width / 2 && level->height == src->height / 2)) {
+					break;
+				}
+				CHECK(level->width >= 16 && level->height >= 16 && level->stride == level->width);
+				int wrong = 0;
+				for (int y = 0; y < level->height; y++) {
+					for (int x = 0; x < level->width; x++) {
+						wrong += level->pixels[(size_t) y * level->stride + x] != average(src, x, y);
+					}
+				}
+				if (!CHECK(wrong == 0)) {
+					printf("scaler: %d pixels of the %d x %d mip of %d x %d aren't the average\n", wrong,
+						   level->width, level->height, chain[0], chain[1]);
+				}
+				src = level;
+				num_levels++;
+			}
+			// The last one's the smallest that'll do
+			CHECK(src->width / 2 < 16 || src->height / 2 < 16);
+			if (!CHECK(num_levels == chain[2] && src->width == chain[3] && src->height == chain[4])) {
+				printf("scaler: %d mips for %d x %d, the last %d x %d\n", num_levels, chain[0], chain[1], src->width,
+					   src->height);
+			}
+			FrameFree(&frame);
+		}
+	}
+}
+
+struct PickCase {
+	int width;
+	int height;
+	int picked;     // the width of the one it should pick
+};
+
+static const struct PickCase picks[] = {
+	{2000, 2000, 1024},     // bigger than the frame: the frame
+	{1024, 768, 1024},
+	{600, 400, 1024},       // 512 x 384 isn't quite tall enough
+	{512, 384, 512},        // exactly one of them
+	{300, 100, 512},
+	{256, 1, 256},
+	{33, 24, 64},
+	{32, 24, 32},
+	{10, 10, 32},           // the smallest there is
+	{0, 0, 32},
+};
+
+static void checkPickMip(void) {
+	struct Frame frame;
+	if (!noiseFrame(&frame, 1024, 768, 0)) {
+		return;
+	}
+	// Without mips, it can only be the frame
+	CHECK(ScalePickMip(&frame, 1, 1) == &frame);
+	CHECK(ScaleBuildMips(&frame, NULL));
+	for (int i = 0; i < (int) (sizeof(picks) / sizeof(picks[0])); i++) {
+		const struct Frame *picked = ScalePickMip(&frame, picks[i].width, picks[i].height);
+		if (!CHECK(picked->width == picks[i].picked)) {
+			printf("scaler: %d x %d picked the %d x %d mip\n", picks[i].width, picks[i].height, picked->width,
+				   picked->height);
+		}
+		CHECK(picked->width >= picks[i].width || picked == &frame);
+		CHECK(picked->height >= picks[i].height || picked == &frame);
+	}
+	FrameFree(&frame);
+}
+
+// A frame whose rows are said to be so far apart that making room for its mips would take more than the whole of the
+// address space: the realloc() fails, and the frame has to come out of it just as it went in.
+static void checkMipsFailing(void) {
+	if (sizeof(size_t) <= 4) {
+		return;     // it'd wrap, rather than fail
+	}
+	struct Frame frame;
+	if (!noiseFrame(&frame, 32, 32768, 0)) {
+		return;
+	}
+	unsigned int *pixels = frame.pixels;
+	unsigned int first = pixels[0];
+	unsigned int last = pixels[32 * 32768 - 1];
+	frame.stride = 0x7FFFFFFF;
+	CHECK(!ScaleBuildMips(&frame, NULL));
+	CHECK(frame.pixels == pixels && frame.mips == NULL && frame.width == 32 && frame.height == 32768);
+	CHECK(pixels[0] == first && pixels[32 * 32768 - 1] == last);
+	CHECK(ScalePickMip(&frame, 16, 16) == &frame);
+	frame.stride = 32;
+	FrameFree(&frame);
+}
+
+#define NUM_JOBS 4
+
+// The jobs: 0 and 1 the same (but with plans of their own, and different strides), and then 2 with another filter and
+// 3 from another frame, which are scaled in their own right.
+static void checkJobs(struct ThreadPool *pool) {
+	static const enum ScaleFilter filters[NUM_JOBS] = {SCALE_AREA, SCALE_AREA, SCALE_BILINEAR, SCALE_AREA};
+	static const int job_paddings[NUM_JOBS] = {3, 0, 1, 0};
+	const int width = 199;
+	const int height = 101;
+	struct Frame srcs[2];
+	memset(srcs, 0, sizeof(srcs));
+	struct ScalePlan plans[NUM_JOBS];
+	memset(plans, 0, sizeof(plans));
+	unsigned int *expected = (unsigned int *) malloc((size_t) (width + 3) * height * 4);
+	unsigned int *actual[NUM_JOBS] = {NULL};
+	int ok = expected != NULL && noiseFrame(&srcs[0], 640, 361, 2) && noiseFrame(&srcs[1], 640, 361, 0);
+	for (int i = 0; i < NUM_JOBS; i++) {
+		actual[i] = (unsigned int *) malloc((size_t) (width + job_paddings[i]) * height * 4);
+		ok = ok && actual[i] != NULL && ScalePlanInit(&plans[i], 640, 361, width, height, filters[i]);
+	}
+
+	for (int threads = 0; threads < 2 && CHECK(ok); threads++) {
+		struct ScaleJob jobs[NUM_JOBS];
+		for (int i = 0; i < NUM_JOBS; i++) {
+			int stride = width + job_paddings[i];
+			for (int j = 0; j < stride * height; j++) {
+				actual[i][j] = PADDING;
+			}
+			jobs[i].plan = &plans[i];
+			jobs[i].src = &srcs[i == 3];
+			jobs[i].dst = actual[i];
+			jobs[i].dst_stride = stride;
+		}
+		CHECK(ScaleJobsTiled(jobs, NUM_JOBS, threads ? pool : NULL));
+
+		for (int i = 0; i < NUM_JOBS; i++) {
+			int stride = width + job_paddings[i];
+			for (int j = 0; j < stride * height; j++) {
+				expected[j] = PADDING;
+			}
+			CHECK(ScaleFrame(&plans[i], jobs[i].src, expected, stride));
+			if (!CHECK(memcmp(expected, actual[i], (size_t) stride * height * 4) == 0)) {
+				printf("scaler: job %d of ScaleJobsTiled() isn't what ScaleFrame() makes%s\n", i,
+					   threads ? ", on the threads" : "");
+			}
+		}
+	}
+
+	for (int i = 0; i < NUM_JOBS; i++) {
+		ScalePlanFree(&plans[i]);
+		free(actual[i]);
+	}
+	FrameFree(&srcs[0]);
+	FrameFree(&srcs[1]);
+	free(expected);
+}
+
+int ScalerTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkScaling();
+	checkMips();
+
+	struct ThreadPool *pool = ThreadPoolCreate(3);
+	if (pool == NULL) {
+		return 1;
+	}
+	checkMipChain(pool);
+	checkPickMip();
+	checkMipsFailing();
+	checkJobs(pool);
+	ThreadPoolDestroy(pool);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include "Tests.h"
+#include "../Utils/Schedule.h"
+
+// The Schedule (see Schedule.h): how many refreshes each frame is up for, on all sorts of displays, and then a second
+// of virtual time on a made-up mix of them, with every frame where it should be.
+
+struct IntervalCase {
+	int refresh;
+	int fps;
+	int interval;
+};
+
+static const struct IntervalCase intervals[] = {
+	{60000, 30, 2},
+	{59940, 30, 2},
+	{75000, 30, 3},     // 25 FPS, rather than 37.5
+	{144000, 30, 5},    // 28.8
+	{165000, 30, 6},    // 27.5
+	{120000, 30, 4},
+	{120000, 45, 3},    // 40, rather than 60
+	{72000, 30, 3},     // 36 and 24 are as near as each other, and it's the lower
+	{60000, 60, 1},
+	{60000, 100, 1},    // can't go faster than the refreshes
+	{30000, 1, 30},
+	{0, 30, 0},         // not known
+	{60000, 0, 0},
+};
+
+static void checkIntervals(void) {
+	for (int i = 0; i < (int) (sizeof(intervals) / sizeof(intervals[0])); i++) {
+		const struct IntervalCase *test = &intervals[i];
+		int interval = ScheduleInterval(test->refresh, test->fps);
+		if (!CHECK(interval == test->interval)) {
+			printf("schedule: %d FPS on %d mHz: %d refreshes, not %d\n", test->fps, test->refresh, interval,
+				   test->interval);
+		}
+	}
+}
+
+// A second of 30 FPS on 60, 75, 144 Hz and one not known, and a second 60 Hz one: each display due on its own rate,
+// not a microsecond early, the 60 Hz ones together.
+static void checkWaits(void) {
+	static const int refreshes[] = {60000, 75000, 144000, 0, 60000};
+	static const int frames[] = {30, 25, 29, 30, 30};  // in a second (with the one at 0 and not the one at 1 s)
+	const int num_displays = (int) (sizeof(refreshes) / sizeof(refreshes[0]));
+
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	clock.time = 1000;
+	struct Schedule schedule;
+	ScheduleInit(&schedule, &clock.clock, 30, PACER_TIMER);
+	for (int i = 0; i < num_displays; i++) {
+		CHECK(ScheduleAddDisplay(&schedule, refreshes[i], 0) == i);
+	}
+	CHECK(schedule.displays[1].pacer.rate == 25000 && schedule.displays[3].pacer.rate == 30000);
+
+	unsigned char due[SCHEDULE_MAX_DISPLAYS];
+	int counts[SCHEDULE_MAX_DISPLAYS] = {0};
+	long long last[SCHEDULE_MAX_DISPLAYS];
+	ScheduleWait(&schedule, due);
+	for (int i = 0; i < num_displays; i++) {
+		CHECK(due[i]);  // all start together
+		counts[i]++;
+		last[i] = clock.time;
+	}
+	while (1) {
+		long long deadlines[SCHEDULE_MAX_DISPLAYS];
+		for (int i = 0; i < num_displays; i++) {
+			deadlines[i] = PacerDeadline(&schedule.displays[i].pacer);
+		}
+		ScheduleWait(&schedule, due);
+		if (clock.time >= 1000 + 1000000) {
+			break;
+		}
+		CHECK(due[0] == due[4]);
+		for (int i = 0; i < num_displays; i++) {
+			if (!due[i]) {
+				CHECK(deadlines[i] > clock.time);
+				continue;
+			}
+			// Exactly on time (the timer's perfect), and a frame's length since the last, to the microsecond
+			long long rate = schedule.displays[i].pacer.rate;
+			long long period = clock.time - last[i];
+			CHECK(deadlines[i] == clock.time);
+			CHECK((period - 1) * rate < 1000000000 && (period + 1) * rate > 1000000000);
+			counts[i]++;
+			last[i] = clock.time;
+		}
+	}
+	for (int i = 0; i < num_displays; i++) {
+		if (!CHECK(counts[i] == frames[i])) {
+			printf("schedule: %d frames in a second on %d mHz\n", counts[i], refreshes[i]);
+		}
+	}
+	CHECK(schedule.displays[0].pacer.skipped == 0 && schedule.displays[2].pacer.skipped == 0);
+}
+
+// Displays with an FPS of their own keep it when the schedule's changes, and PACER_REFRESH only goes to the displays
+// with the first one's refresh.
+static void checkFps(void) {
+	struct VirtualClock clock;
+	ClockInitVirtual(&clock);
+	struct Schedule schedule;
+	ScheduleInit(&schedule, &clock.clock, 30, PACER_REFRESH);
+	ScheduleAddDisplay(&schedule, 60000, 0);
+	ScheduleAddDisplay(&schedule, 60000, 20);
+	ScheduleAddDisplay(&schedule, 75000, 0);
+	CHECK(schedule.displays[0].interval == 2 && schedule.displays[1].interval == 3);
+	CHECK(schedule.displays[1].pacer.backend == PACER_REFRESH && schedule.displays[2].pacer.backend == PACER_SPIN);
+
+	ScheduleSetFps(&schedule, 60);
+	CHECK(schedule.displays[0].interval == 1 && schedule.displays[0].pacer.rate == 60000);
+	CHECK(schedule.displays[1].interval == 3 && schedule.displays[1].pacer.rate == 20000);
+	CHECK(schedule.displays[2].interval == 1 && schedule.displays[2].pacer.rate == 75000);
+
+	// No more than SCHEDULE_MAX_DISPLAYS
+	for (int i = 3; i < SCHEDULE_MAX_DISPLAYS; i++) {
+		ScheduleAddDisplay(&schedule, 60000, 0);
+	}
+	CHECK(ScheduleAddDisplay(&schedule, 60000, 0) == -1 && schedule.num_displays == SCHEDULE_MAX_DISPLAYS);
+}
+
+int ScheduleTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	checkIntervals();
+	checkWaits();
+	checkFps();
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Tests.h"
+
+struct Suite {
+	const char *name;
+	int (*run)(int argc, char **argv);
+};
+
+static const struct Suite suites[] = {
+	{"activity", ActivityTests},
+	{"bench", BenchTests},
+	{"frame", FrameTests},
+	{"glitch", GlitchTests},
+	{"golden", GoldenTests},
+	{"governor", GovernorTests},
+	{"lz4", Lz4Tests},
+	{"pacer", PacerTests},
+	{"pipeline", PipelineTests},
+	{"preview", PreviewTests},
+	{"remote", RemoteTests},
+	{"scaler", ScalerTests},
+	{"schedule", ScheduleTests},
+	{"tiles", TileTests},
+	{"unzip", UnzipTests},
+	{"wall", WallTests},
+};
+
+static int failures = 0;
+
+int TestCheck(int ok, const char *what, const char *file, int line) {
+	if (!ok) {
+		printf("%s:%d: CHECK(%s) failed\n", file, line, what);
+		failures++;
+	}
+
+	return ok;
+}
+
+int TestPicture(struct Frame *frame, int width, int height, unsigned int tint) {
+	if (!FrameAlloc(frame, width, height)) {
+		return 0;
+	}
+
+	int cx = width / 2;
+	int cy = height / 2;
+	int radius = (width < height ? width : height) / 3;
+	for (int y = 0; y < height; y++) {
+		unsigned int *row = frame->pixels + (size_t) y * frame->stride;
+		for (int x = 0; x < width; x++) {
+			unsigned int r = (unsigned int) (x * 255 / (width > 1 ? width - 1 : 1));
+			unsigned int g = (unsigned int) (y * 255 / (height > 1 ? height - 1 : 1));
+			unsigned int b = (tint + (unsigned int) (x ^ y) * 3) & 0xFF;
+			int d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+			if (x % 16 == 0 || y % 16 == 0) {
+				r = g = b = 0xFF;
+			} else if (d2 >= (radius - 2) * (radius - 2) && d2 <= radius * radius) {
+				r = g = b = 0;
+			}
+			row[x] = (r << 16) | (g << 8) | b;
+		}
+	}
+
+	return 1;
+}
+
+static void put16(unsigned char *p, unsigned int value) {
+	p[0] = (unsigned char) value;
+	p[1] = (unsigned char) (value >> 8);
+}
+
+static void put32(unsigned char *p, unsigned int value) {
+	put16(p, value & 0xFFFF);
+	put16(p + 2, value >> 16);
+}
+
+int TestWriteBMP(const char *path, const unsigned int *pixels, int width, int height, int stride) {
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		return 0;
+	}
+
+	unsigned int row_bytes = ((unsigned int) width * 3 + 3) & ~3U;
+	unsigned char header[14 + 40] = {0};
+	header[0] = 'B';
+	header[1] = 'M';
+	put32(header + 2, sizeof(header) + row_bytes * height);
+	put32(header + 10, sizeof(header));
+	put32(header + 14, 40);
+	put32(header + 18, (unsigned int) width);
+	put32(header + 22, (unsigned int) -height); // top-down
+	put16(header + 26, 1);
+	put16(header + 28, 24);
+	int ok = fwrite(header, sizeof(header), 1, file) == 1;
+	unsigned char *row = (unsigned char *) calloc(row_bytes, 1);
+	ok = ok && row != NULL;
+	for (int y = 0; y < height && ok; y++) {
+		const unsigned int *src = pixels + (size_t) y * stride;
+		for (int x = 0; x < width; x++) {
+			row[x * 3] = (unsigned char) src[x];
+			row[x * 3 + 1] = (unsigned char) (src[x] >> 8);
+			row[x * 3 + 2] = (unsigned char) (src[x] >> 16);
+		}
+		ok = fwrite(row, row_bytes, 1, file) == 1;
+	}
+	free(row);
+
+	return fclose(file) == 0 && ok;
+}
+
+int TestReadBMP(const char *path, struct Frame *frame) {
+	memset(frame, 0, sizeof(*frame));
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	void *buf = len > 0 ? malloc((size_t) len) : NULL;
+	int ok = buf != NULL && fread(buf, (size_t) len, 1, file) == 1 && FrameFromBMP(frame, buf, (unsigned long) len);
+	free(buf);
+	fclose(file);
+
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	int num_suites = (int) (sizeof(suites) / sizeof(suites[0]));
+	for (int i = 0; argc >= 2 && i < num_suites; i++) {
+		if (strcmp(argv[1], suites[i].name) == 0) {
+			int result = suites[i].run(argc - 2, argv + 2);
+			printf("%s: %s\n", suites[i].name, result == 0 && failures == 0 ? "passed" : "FAILED");
+
+			return result == 0 && failures == 0 ? 0 : 1;
+		}
+	}
+
+	printf("usage: edw590scr_tests suite [arguments]\nsuites:");
+	for (int i = 0; i < num_suites; i++) {
+		printf(" %s", suites[i].name);
+	}
+	printf("\n");
+
+	return 2;
+}
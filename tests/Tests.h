@@ -0,0 +1,78 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef EDW590SCR_TESTS_H
+#define EDW590SCR_TESTS_H
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../Utils/Frame.h"
+
+// The tests of everything that builds without Windows, run by ctest. They're one program, edw590scr_tests, whose first
+// argument is which suite to run (see the list in Tests.c); the rest of the arguments are the suite's.
+//
+// A CHECK that fails says where, and the suite goes on, so one run shows all that's wrong. The suite fails if any did.
+// The suites that test the zip code are C++, as it is, so this is C++ too.
+
+#define CHECK(cond) TestCheck((cond) != 0, #cond, __FILE__, __LINE__)
+
+// TestCheck - what CHECK() calls. Returns ok.
+int TestCheck(int ok, const char *what, const char *file, int line);
+
+// TestPicture - a width x height test picture: gradients, with a grid of lines and a ring, so that anything scaled or
+// copied wrong shows. tint makes different pictures of the same size. Returns 0 if out of memory.
+int TestPicture(struct Frame *frame, int width, int height, unsigned int tint);
+
+// TestWriteBMP - writes width x height pixels, rows stride pixels apart, to path, as a 24 bpp .bmp. Returns 0 if it
+// couldn't.
+int TestWriteBMP(const char *path, const unsigned int *pixels, int width, int height, int stride);
+
+// TestReadBMP - reads a .bmp into frame (see FrameFromBMP()). Returns 0 if it couldn't.
+int TestReadBMP(const char *path, struct Frame *frame);
+
+// The suites. argc and argv are what comes after the suite's name. Each returns 0, or 1 if it couldn't run at all
+// (and it fails too if any of its CHECKs did).
+int ActivityTests(int argc, char **argv);
+int BenchTests(int argc, char **argv);
+int FrameTests(int argc, char **argv);
+int GlitchTests(int argc, char **argv);
+int GoldenTests(int argc, char **argv);
+int GovernorTests(int argc, char **argv);
+int Lz4Tests(int argc, char **argv);
+int PacerTests(int argc, char **argv);
+int PipelineTests(int argc, char **argv);
+int PreviewTests(int argc, char **argv);
+int RemoteTests(int argc, char **argv);
+int ScalerTests(int argc, char **argv);
+int ScheduleTests(int argc, char **argv);
+int TileTests(int argc, char **argv);
+int UnzipTests(int argc, char **argv);
+int WallTests(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#endif //EDW590SCR_TESTS_H
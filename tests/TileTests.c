@@ -0,0 +1,182 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Offscreen.h"
+#include "../Utils/Render.h"
+
+// The dirty tiles (see Canvas.h): how many bytes get presented for frames that change nothing, a pixel, a few tiles or
+// all of them, and that what's presented is always enough for the front buffer to end up as the frame. Even when a
+// changed tile's signature is the same as before, which is made to happen by giving the canvas the new frame's
+// signatures, from another one, before it gets to it.
+
+#define TILE_BYTES (CANVAS_TILE_SIZE * CANVAS_TILE_SIZE * 4)
+
+// A copy of from, with the pixels at the num_points (x, y)s in points inverted.
+static int changed(struct Frame *frame, const struct Frame *from, const int *points, int num_points) {
+	if (!FrameAlloc(frame, from->width, from->height)) {
+		return 0;
+	}
+	for (int y = 0; y < from->height; y++) {
+		memcpy(frame->pixels + (size_t) y * frame->stride, from->pixels + (size_t) y * from->stride, from->width * 4);
+	}
+	for (int i = 0; i < num_points; i++) {
+		unsigned int *pixel = frame->pixels + (size_t) points[i * 2 + 1] * frame->stride + points[i * 2];
+		*pixel = ~*pixel & 0xFFFFFF;
+	}
+
+	return 1;
+}
+
+// Renders frame on offscreen, and returns how many bytes got presented (or -1 if it didn't get it).
+static long long present(struct Offscreen *offscreen, const struct Frame *frame) {
+	struct RenderTarget *target = &offscreen->target;
+	struct RenderTimings timings;
+	long long written = offscreen->bytes_written;
+	if (!RenderFrame(&target, 1, frame, NULL, NULL, &timings)) {
+		return -1;
+	}
+
+	CHECK(timings.bytes_presented == offscreen->bytes_written - written);
+	size_t size = (size_t) offscreen->canvas.width * offscreen->canvas.height * 4;
+	if (!CHECK(memcmp(offscreen->front, offscreen->back, size) == 0)) {
+		printf("tiles: the front buffer isn't the frame\n");
+	}
+
+	return timings.bytes_presented;
+}
+
+static int failPresent(struct RenderTarget *target, const struct CanvasRect *rects, int num_rects) {
+	(void) target;
+	(void) rects;
+	(void) num_rects;
+
+	return 0;
+}
+
+struct Step {
+	int frame;
+	long long bytes;    // presented for it
+};
+
+// Presents the frames num_steps steps say, and checks the bytes presented for each.
+static void checkSteps(const char *name, struct Offscreen *offscreen, const struct Frame *frames,
+					   const struct Step *steps, int num_steps) {
+	for (int i = 0; i < num_steps; i++) {
+		long long bytes = present(offscreen, &frames[steps[i].frame]);
+		if (!CHECK(bytes == steps[i].bytes)) {
+			printf("tiles: %s: step %d presented %lld bytes, not %lld\n", name, i, bytes, steps[i].bytes);
+		}
+	}
+}
+
+int TileTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	// 256 x 192: 4 x 3 tiles. And a 4:3 one for a 16:9 target
+	static const int one[] = {70, 70};
+	static const int two[] = {10, 10, 200, 150};
+	static const int corner[] = {63, 63, 64, 63, 63, 64, 64, 64};   // where 4 tiles meet
+	static const int every[] = {0, 0, 64, 0, 128, 0, 192, 0, 0, 64, 64, 64, 128, 64, 192, 64, 0, 128, 64, 128,
+								128, 128, 255, 191};
+	static const int bottom[] = {150, 140};
+	struct Frame frames[9];
+	if (!TestPicture(&frames[0], 256, 192, 0x60) || !changed(&frames[1], &frames[0], NULL, 0) ||
+		!changed(&frames[2], &frames[0], one, 1) || !changed(&frames[3], &frames[0], two, 2) ||
+		!changed(&frames[4], &frames[0], corner, 4) || !changed(&frames[5], &frames[0], every, 12) ||
+		!TestPicture(&frames[6], 192, 144, 0xA0) || !changed(&frames[7], &frames[6], NULL, 0) ||
+		!changed(&frames[8], &frames[6], bottom, 1)) {
+		return 1;
+	}
+
+	// All of it the first time, then only what's changed since the last one: from the frame to a copy, and back
+	static const struct Step same_size[] = {
+		{0, 256 * 192 * 4},
+		{1, 0},
+		{2, TILE_BYTES},
+		{0, TILE_BYTES},
+		{3, 2 * TILE_BYTES},
+		{1, 2 * TILE_BYTES},
+		{4, 4 * TILE_BYTES},
+		{4, 0},
+		{0, 4 * TILE_BYTES},
+		{5, 12 * TILE_BYTES},
+		{1, 12 * TILE_BYTES},
+	};
+	struct Offscreen *offscreen = OffscreenCreate(256, 192);
+	if (offscreen == NULL) {
+		return 1;
+	}
+	checkSteps("same size", offscreen, frames, same_size, sizeof(same_size) / sizeof(same_size[0]));
+
+	// After a present fails, who knows what's on the screen: all of it again
+	int (*real_present)(struct RenderTarget *, const struct CanvasRect *, int) = offscreen->target.present;
+	offscreen->target.present = failPresent;
+	CHECK(present(offscreen, &frames[2]) == -1);
+	offscreen->target.present = real_present;
+	CHECK(present(offscreen, &frames[2]) == 256 * 192 * 4);
+	CHECK(present(offscreen, &frames[1]) == TILE_BYTES);
+
+	// A tile that's changed, but with the same signature as before: still presented
+	struct Offscreen *other = OffscreenCreate(256, 192);
+	if (other == NULL) {
+		return 1;
+	}
+	CHECK(present(other, &frames[2]) == 256 * 192 * 4);
+	CHECK(present(offscreen, &frames[1]) == 0);
+	size_t hashes = (size_t) offscreen->canvas.tiles_x * offscreen->canvas.tiles_y * sizeof(unsigned int);
+	memcpy(offscreen->canvas.tile_hashes, other->canvas.tile_hashes, hashes);
+	if (!CHECK(present(offscreen, &frames[2]) == TILE_BYTES)) {
+		printf("tiles: a tile with the same signature as before didn't get presented\n");
+	}
+	CHECK(present(offscreen, &frames[2]) == 0);
+	OffscreenDestroy(other);
+
+	// Without the tiles: all of the frame, every time
+	offscreen->canvas.dirty_tiles = 0;
+	CHECK(present(offscreen, &frames[0]) == 256 * 192 * 4);
+	CHECK(present(offscreen, &frames[1]) == 256 * 192 * 4);
+	OffscreenDestroy(offscreen);
+
+	// Pillarboxed on 256 x 144: the bars with the first frame, then tiles of the frame's part only (the bottom row of
+	// them is only 16 high)
+	static const struct Step pillarbox[] = {
+		{6, 256 * 144 * 4},
+		{7, 0},
+		{8, CANVAS_TILE_SIZE * 16 * 4},
+		{6, CANVAS_TILE_SIZE * 16 * 4},
+		{0, 256 * 144 * 4},     // 16:9 after all: no bars, so the whole canvas again, for where they were
+		{6, 256 * 144 * 4},
+	};
+	offscreen = OffscreenCreate(256, 144);
+	if (offscreen == NULL) {
+		return 1;
+	}
+	checkSteps("pillarbox", offscreen, frames, pillarbox, sizeof(pillarbox) / sizeof(pillarbox[0]));
+	OffscreenDestroy(offscreen);
+
+	for (int i = 0; i < 9; i++) {
+		FrameFree(&frames[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,821 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+#include "Tests.h"
+#include "../Utils/unzip.h"
+#include "../Utils/zip.h"
+extern "C" {
+#include "../Utils/Clock.h"
+}
+
+// unzip.cpp, on zips made with zip.cpp and then laid out again the ways other zip writers lay them out.
+//
+// stream: a zip read through a pipe that never has more than 1 to 7 bytes in it at a time, the worst a network or
+// another process could hand it over in: each item must come out whole, and the first one before the rest of the zip
+// has even been written. It says how long the first item took to come out, and all of them.
+//
+// zip64: the same zip as zip64, from memory, after a stub and from a file, with the items got at out of order, and
+// through the pipe too.
+//
+// all: UnzipAllItems() on 4 threads, with files in folders, one read-only, an empty folder and a file whose name would
+// take it out of the folder it's unzipped into, which mustn't be. Windows only: elsewhere it must just say it can't.
+//
+// round trip: zip.cpp on 4 threads, at levels 1, 6 and 9, with empty items, small ones and ones several of its
+// chunks long (deflated, stored, with our LZ4 blocks, and noise that won't get any smaller), which must come out of
+// unzip.cpp byte for byte. The big deflated ones must say where their chunks' sync points are.
+//
+// This suite is C++, as unzip.cpp and zip.cpp are.
+
+#define UNZIP_MAX_ITEMS 8
+
+struct Buffer {
+	unsigned char *data;
+	size_t len;
+	size_t size;
+};
+
+static int put(struct Buffer *buffer, const void *data, size_t len) {
+	if (buffer->len + len > buffer->size) {
+		size_t size = buffer->size * 2 > buffer->len + len ? buffer->size * 2 : buffer->len + len + 4096;
+		unsigned char *grown = (unsigned char *) realloc(buffer->data, size);
+		if (grown == NULL) {
+			return 0;
+		}
+		buffer->data = grown;
+		buffer->size = size;
+	}
+	memcpy(buffer->data + buffer->len, data, len);
+	buffer->len += len;
+
+	return 1;
+}
+
+static int put16(struct Buffer *buffer, unsigned int value) {
+	unsigned char bytes[2] = {(unsigned char) value, (unsigned char) (value >> 8)};
+
+	return put(buffer, bytes, 2);
+}
+
+static int put32(struct Buffer *buffer, unsigned int value) {
+	return put16(buffer, value & 0xFFFF) && put16(buffer, value >> 16);
+}
+
+static int put64(struct Buffer *buffer, unsigned long long value) {
+	return put32(buffer, (unsigned int) (value & 0xFFFFFFFF)) && put32(buffer, (unsigned int) (value >> 32));
+}
+
+static unsigned int get16(const unsigned char *p) {
+	return p[0] | ((unsigned int) p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char *p) {
+	return get16(p) | (get16(p + 2) << 16);
+}
+
+static void set16(unsigned char *p, unsigned int value) {
+	p[0] = (unsigned char) value;
+	p[1] = (unsigned char) (value >> 8);
+}
+
+static void set32(unsigned char *p, unsigned int value) {
+	set16(p, value & 0xFFFF);
+	set16(p + 2, value >> 16);
+}
+
+// The items, as they go in and should come out.
+struct Items {
+	int num_items;
+	const char *names[UNZIP_MAX_ITEMS];
+	int methods[UNZIP_MAX_ITEMS];
+	struct Frame pictures[UNZIP_MAX_ITEMS];
+};
+
+static unsigned int itemSize(const struct Items *items, int i) {
+	return (unsigned int) items->pictures[i].width * items->pictures[i].height * 4;
+}
+
+// Test pictures of different sizes (their pixels are the items), deflated, stored and with our LZ4 blocks in turn.
+static int makeItems(struct Items *items) {
+	static const char *const names[] = {"1.raw", "2.raw", "3.raw", "4.raw", "5.raw", "6.raw"};
+	static const int methods[] = {ZIP_DEFLATE, ZIP_STORE, ZIP_LZ4BLOCKS};
+	memset(items, 0, sizeof(*items));
+	for (int i = 0; i < 6; i++) {
+		items->names[i] = names[i];
+		items->methods[i] = methods[i % 3];
+		// Without padding, so the pixels are the item's bytes
+		if (!TestPicture(&items->pictures[i], 64, 40 + i * 8, i * 0x30)) {
+			return 0;
+		}
+		items->num_items++;
+	}
+
+	return 1;
+}
+
+static void freeItems(struct Items *items) {
+	for (int i = 0; i < items->num_items; i++) {
+		FrameFree(&items->pictures[i]);
+	}
+}
+
+// The items zipped up by zip.cpp, into zip.
+static int zipItems(const struct Items *items, struct Buffer *zip) {
+	HZIP hz = CreateZip(0, 0, ZIP_MEMORY);
+	if (hz == 0) {
+		return 0;
+	}
+	int ok = 1;
+	for (int i = 0; i < items->num_items && ok; i++) {
+		ok = ZipSetOptions(hz, items->methods[i], 6, 0, 1) == ZR_OK &&
+			 ZipAdd(hz, items->names[i], items->pictures[i].pixels, itemSize(items, i), ZIP_MEMORY) == ZR_OK;
+	}
+	void *data = NULL;
+	unsigned long len = 0;
+	ok = ok && ZipGetMemory(hz, &data, &len) == ZR_OK && put(zip, data, len);
+	CloseZip(hz);
+
+	return ok;
+}
+
+#define RELAY_DESCRIPTORS   1   // the crc and sizes of items that aren't stored go after their data (flag bit 3)
+#define RELAY_ZIP64         2   // zip64 sizes, offsets and end of central directory, for everything
+
+// zip laid out again, on the end of out, the way other zip writers lay them out (see RELAY_*). With
+// RELAY_DESCRIPTORS, the way a zip that's written straight to a pipe has them: the reader only finds out where such an
+// item ends by unzipping it. The offsets are from where it starts in out, so anything already in out is like the stub
+// of a self-extracting zip.
+static int relayZip(const struct Buffer *zip, int relay, struct Buffer *out) {
+	const unsigned char *end = zip->data + zip->len - 22;
+	if (zip->len < 22 || get32(end) != 0x06054b50) {
+		return 0;
+	}
+	int zip64 = (relay & RELAY_ZIP64) != 0;
+	int num_entries = (int) get16(end + 10);
+	const unsigned char *entry = zip->data + get32(end + 16);
+	size_t base = out->len;
+	struct Buffer central = {NULL, 0, 0};
+	int ok = 1;
+	for (int i = 0; i < num_entries && ok; i++) {
+		unsigned int crc = get32(entry + 16);
+		unsigned int comp_size = get32(entry + 20);
+		unsigned int unc_size = get32(entry + 24);
+		unsigned int name_len = get16(entry + 28);
+		unsigned int extra_len = get16(entry + 30);
+		unsigned int comment_len = get16(entry + 32);
+		const unsigned char *local = zip->data + get32(entry + 42);
+		unsigned int local_name_len = get16(local + 26);
+		unsigned int local_extra_len = get16(local + 28);
+		int descriptor = (relay & RELAY_DESCRIPTORS) != 0 && get16(entry + 10) != 0;
+		unsigned int offset = (unsigned int) (out->len - base);
+
+		// The local header, with its zip64 extra field (the sizes, unless they come after) first
+		unsigned char header[30];
+		memcpy(header, local, 30);
+		if (descriptor) {
+			set16(header + 6, get16(header + 6) | 8);
+			set32(header + 14, 0);
+		}
+		set32(header + 18, zip64 ? 0xFFFFFFFF : descriptor ? 0 : comp_size);
+		set32(header + 22, zip64 ? 0xFFFFFFFF : descriptor ? 0 : unc_size);
+		if (zip64) {
+			set16(header + 4, 45);
+			set16(header + 28, local_extra_len + 20);
+		}
+		ok = put(out, header, 30) && put(out, local + 30, local_name_len);
+		if (zip64) {
+			ok = ok && put16(out, 0x0001) && put16(out, 16) && put64(out, descriptor ? 0 : unc_size) &&
+				 put64(out, descriptor ? 0 : comp_size);
+		}
+		ok = ok && put(out, local + 30 + local_name_len, local_extra_len) &&
+			 put(out, local + 30 + local_name_len + local_extra_len, comp_size);
+		if (descriptor) {
+			ok = ok && put32(out, 0x08074b50) && put32(out, crc);
+			ok = ok && (zip64 ? put64(out, comp_size) && put64(out, unc_size) :
+						put32(out, comp_size) && put32(out, unc_size));
+		}
+
+		// And its central directory entry, with a zip64 extra field of all three
+		memcpy(header, entry, 30);
+		if (descriptor) {
+			set16(header + 8, get16(header + 8) | 8);
+		}
+		if (zip64) {
+			set16(header + 6, 45);
+			set32(header + 20, 0xFFFFFFFF);
+			set32(header + 24, 0xFFFFFFFF);
+		}
+		unsigned char rest[16];
+		memcpy(rest, entry + 30, 16);
+		if (zip64) {
+			set16(rest, extra_len + 28);
+		}
+		set32(rest + 12, zip64 ? 0xFFFFFFFF : offset);
+		ok = ok && put(&central, header, 30) && put(&central, rest, 16) && put(&central, entry + 46, name_len);
+		if (zip64) {
+			ok = ok && put16(&central, 0x0001) && put16(&central, 24) && put64(&central, unc_size) &&
+				 put64(&central, comp_size) && put64(&central, offset);
+		}
+		ok = ok && put(&central, entry + 46 + name_len, extra_len + comment_len);
+		entry += 46 + name_len + extra_len + comment_len;
+	}
+
+	unsigned int central_offset = (unsigned int) (out->len - base);
+	ok = ok && put(out, central.data, central.len);
+	if (zip64) {
+		unsigned int record_offset = (unsigned int) (out->len - base);
+		ok = ok && put32(out, 0x06064b50) && put64(out, 44) && put16(out, 45) && put16(out, 45) && put32(out, 0) &&
+			 put32(out, 0) && put64(out, num_entries) && put64(out, num_entries) && put64(out, central.len) &&
+			 put64(out, central_offset);
+		ok = ok && put32(out, 0x07064b50) && put32(out, 0) && put64(out, record_offset) && put32(out, 1);
+	}
+	ok = ok && put32(out, 0x06054b50) && put32(out, 0) && put16(out, zip64 ? 0xFFFF : num_entries) &&
+		 put16(out, zip64 ? 0xFFFF : num_entries) && put32(out, zip64 ? 0xFFFFFFFF : (unsigned int) central.len) &&
+		 put32(out, zip64 ? 0xFFFFFFFF : central_offset) && put16(out, 0);
+	free(central.data);
+
+	return ok;
+}
+
+// Unzips item i into buf (at least its size plus one), and checks that it's the picture. Returns 0 if it wasn't.
+static int checkItem(HZIP hz, const struct Items *items, int i, unsigned char *buf) {
+	unsigned int size = itemSize(items, i);
+	ZRESULT zr = UnzipItem(hz, i, buf, size + 1, ZIP_MEMORY);
+	// Even when it all fits, it only says it's done when asked for more (see UnzipItem())
+	if (zr == ZR_MORE) {
+		zr = UnzipItem(hz, i, buf + size, 1, ZIP_MEMORY);
+	}
+	if (!CHECK(zr == ZR_OK) || !CHECK(memcmp(buf, items->pictures[i].pixels, size) == 0)) {
+		printf("unzip: item %d (%s) didn't come out right (0x%lx)\n", i, items->names[i], (unsigned long) zr);
+
+		return 0;
+	}
+
+	return 1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// A pipe that the zip trickles through.
+
+#ifdef _WIN32
+typedef HANDLE PipeEnd;
+#else
+typedef int PipeEnd;
+#endif
+
+struct Trickle {
+	const struct Buffer *zip;
+	PipeEnd read_end;
+	PipeEnd write_end;
+	volatile long written;      // how much of the zip has been put in the pipe so far
+};
+
+// How much is in the pipe, waiting to be read.
+static long pending(const struct Trickle *trickle) {
+#ifdef _WIN32
+	DWORD available = 0;
+	if (!PeekNamedPipe(trickle->read_end, NULL, 0, NULL, &available, NULL)) {
+		return 0;
+	}
+
+	return (long) available;
+#else
+	int available = 0;
+	if (ioctl(trickle->read_end, FIONREAD, &available) != 0) {
+		return 0;
+	}
+
+	return available;
+#endif
+}
+
+// Writes the zip 1 to 7 bytes at a time, each time waiting for the pipe to be empty again first, so that no read
+// gets more than those few bytes. Then closes its end.
+#ifdef _WIN32
+static DWORD WINAPI trickleThread(LPVOID param) {
+#else
+static void *trickleThread(void *param) {
+#endif
+	struct Trickle *trickle = (struct Trickle *) param;
+	const struct Buffer *zip = trickle->zip;
+	unsigned int seed = 1;
+	size_t pos = 0;
+	while (pos < zip->len) {
+		seed = seed * 1103515245 + 12345;
+		size_t n = 1 + (seed >> 16) % 7;
+		if (n > zip->len - pos) {
+			n = zip->len - pos;
+		}
+#ifdef _WIN32
+		DWORD written = 0;
+		if (!WriteFile(trickle->write_end, zip->data + pos, (DWORD) n, &written, NULL) || written != n) {
+			break;
+		}
+#else
+		if (write(trickle->write_end, zip->data + pos, n) != (ssize_t) n) {
+			break;
+		}
+#endif
+		pos += n;
+		trickle->written = (long) pos;
+		while (pending(trickle) > 0) {
+#ifdef _WIN32
+			SwitchToThread();
+#else
+			sched_yield();
+#endif
+		}
+	}
+#ifdef _WIN32
+	CloseHandle(trickle->write_end);
+
+	return 0;
+#else
+	close(trickle->write_end);
+
+	return NULL;
+#endif
+}
+
+// Reads what's left in the pipe, to its end.
+static void drain(struct Trickle *trickle) {
+	unsigned char buf[256];
+	for (;;) {
+#ifdef _WIN32
+		DWORD red = 0;
+		if (!ReadFile(trickle->read_end, buf, sizeof(buf), &red, NULL) || red == 0) {
+			break;
+		}
+#else
+		if (read(trickle->read_end, buf, sizeof(buf)) <= 0) {
+			break;
+		}
+#endif
+	}
+}
+
+// Unzips the items of zip as it trickles through a pipe, in turn, bar two that get skipped over.
+static void checkStream(const struct Items *items, const struct Buffer *zip, struct Clock *clock,
+						unsigned char *buf) {
+	struct Trickle trickle;
+	trickle.zip = zip;
+	trickle.written = 0;
+#ifdef _WIN32
+	if (!CHECK(CreatePipe(&trickle.read_end, &trickle.write_end, NULL, 0))) {
+		return;
+	}
+	HANDLE thread = CreateThread(NULL, 0, trickleThread, &trickle, 0, NULL);
+	if (!CHECK(thread != NULL)) {
+		CloseHandle(trickle.read_end);
+		CloseHandle(trickle.write_end);
+
+		return;
+	}
+	HZIP hz = OpenZip(trickle.read_end, 0, ZIP_HANDLE);
+#else
+	int fds[2];
+	if (!CHECK(pipe(fds) == 0)) {
+		return;
+	}
+	trickle.read_end = fds[0];
+	trickle.write_end = fds[1];
+	pthread_t thread;
+	if (!CHECK(pthread_create(&thread, NULL, trickleThread, &trickle) == 0)) {
+		close(fds[0]);
+		close(fds[1]);
+
+		return;
+	}
+	HZIP hz = OpenZip((void *) (size_t) fds[0], 0, ZIP_HANDLE);
+#endif
+	long long start = clock->now(clock);
+	long long first = 0;
+	long first_written = 0;
+
+	CHECK(hz != 0);
+	for (int i = 0; hz != 0 && i < items->num_items; i++) {
+		ZIPENTRY ze;
+		if (!CHECK(GetZipItem(hz, i, &ze) == ZR_OK)) {
+			break;
+		}
+		CHECK(strcmp(ze.name, items->names[i]) == 0);
+		// The sizes of those with data descriptors aren't known until they've been unzipped
+		int stored = items->methods[i] == ZIP_STORE;
+		CHECK(ze.unc_size == (stored ? (long long) itemSize(items, i) : -1));
+		// Skipped: a deflated one, whose end can only be found by inflating it, and a stored one
+		if (i == 3 || i == 4) {
+			continue;
+		}
+		if (checkItem(hz, items, i, buf) && i == 0) {
+			first = clock->now(clock) - start;
+			first_written = trickle.written;
+		}
+		CHECK(GetZipItem(hz, i, &ze) == ZR_OK && ze.unc_size == (long long) itemSize(items, i));
+		if (i > 0) {
+			CHECK(GetZipItem(hz, i - 1, &ze) == ZR_SEEK);
+		}
+		CHECK(UnzipItem(hz, i, buf, itemSize(items, i) + 1, ZIP_MEMORY) == ZR_PARTIALUNZ);
+	}
+	if (hz != 0) {
+		ZIPENTRY ze;
+		CHECK(GetZipItem(hz, items->num_items, &ze) == ZR_ARGS);
+		CloseZip(hz);
+	}
+	long long total = clock->now(clock) - start;
+
+	drain(&trickle);
+#ifdef _WIN32
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	CloseHandle(trickle.read_end);
+#else
+	pthread_join(thread, NULL);
+	close(fds[0]);
+#endif
+
+	// The first item came out before the rest of the zip had been written
+	if (!CHECK(first_written > 0 && first_written < (long) zip->len / 2)) {
+		printf("unzip: the first item only came out after %ld of %ld bytes\n", first_written, (long) zip->len);
+	}
+	printf("unzip: stream of %ld bytes, 1 to 7 at a time: first item after %ld bytes, %.1f ms; all in %.1f ms\n",
+		   (long) zip->len, first_written, first / 1000.0, total / 1000.0);
+}
+
+static void checkStreams(const struct Items *items, struct Clock *clock, unsigned char *buf) {
+	struct Buffer zip = {NULL, 0, 0};
+	struct Buffer streamed = {NULL, 0, 0};
+	if (CHECK(zipItems(items, &zip) && relayZip(&zip, RELAY_DESCRIPTORS, &streamed))) {
+		checkStream(items, &streamed, clock, buf);
+	}
+	free(zip.data);
+	free(streamed.data);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+// Opens zip, from memory or from the file path if it's not NULL, and gets at and unzips the items out of order, by
+// index (each of which goes straight to the item's central directory entry) and by name.
+static void checkRandomAccess(const struct Items *items, const struct Buffer *zip, const char *path, const char *what,
+							  unsigned char *buf) {
+	static const int order[] = {5, 2, 0, 3, 1, 4, 4, 0};
+	HZIP hz;
+	if (path != NULL) {
+		FILE *file = fopen(path, "wb");
+		int written = file != NULL && fwrite(zip->data, zip->len, 1, file) == 1;
+		if (file != NULL) {
+			fclose(file);
+		}
+		if (!CHECK(written)) {
+			remove(path);
+
+			return;
+		}
+		hz = OpenZip((void *) path, 0, ZIP_FILENAME);
+	} else {
+		hz = OpenZip(zip->data, (unsigned int) zip->len, ZIP_MEMORY);
+	}
+	if (!CHECK(hz != 0)) {
+		printf("unzip: %s: couldn't open it\n", what);
+		if (path != NULL) {
+			remove(path);
+		}
+
+		return;
+	}
+
+	ZIPENTRY ze;
+	CHECK(GetZipItem(hz, -1, &ze) == ZR_OK && ze.index == items->num_items);
+	int wrong = 0;
+	for (int k = 0; k < (int) (sizeof(order) / sizeof(order[0])); k++) {
+		int i = order[k];
+		wrong |= !CHECK(GetZipItem(hz, i, &ze) == ZR_OK && ze.index == i && strcmp(ze.name, items->names[i]) == 0);
+		wrong |= !CHECK(ze.unc_size == (long long) itemSize(items, i) && ze.comp_size > 0);
+		wrong |= !checkItem(hz, items, i, buf);
+	}
+	int index = -1;
+	wrong |= !CHECK(FindZipItem(hz, items->names[3], false, &index, &ze) == ZR_OK && index == 3);
+	wrong |= !CHECK(GetZipItem(hz, items->num_items, &ze) == ZR_ARGS);
+	if (wrong) {
+		printf("unzip: %s: the items didn't all come out right\n", what);
+	}
+	CloseZip(hz);
+	if (path != NULL) {
+		remove(path);
+	}
+}
+
+// The same zip as zip64: sizes and offsets only in the zip64 extra fields, and the end of the central directory only
+// in the zip64 record. In memory, after a stub (so the record isn't where its locator says), from a file, and through
+// the pipe, where the data descriptors have 8 byte sizes.
+static void checkZip64(const struct Items *items, struct Clock *clock, unsigned char *buf) {
+	struct Buffer zip = {NULL, 0, 0};
+	struct Buffer zip64 = {NULL, 0, 0};
+	struct Buffer stubbed = {NULL, 0, 0};
+	struct Buffer streamed = {NULL, 0, 0};
+	unsigned char stub[1000];
+	memset(stub, 'S', sizeof(stub));
+	if (CHECK(zipItems(items, &zip) && relayZip(&zip, RELAY_ZIP64, &zip64) && put(&stubbed, stub, sizeof(stub)) &&
+			  relayZip(&zip, RELAY_ZIP64, &stubbed) && relayZip(&zip, RELAY_ZIP64 | RELAY_DESCRIPTORS, &streamed))) {
+		checkRandomAccess(items, &zip, NULL, "zip", buf);
+		checkRandomAccess(items, &zip64, NULL, "zip64", buf);
+		checkRandomAccess(items, &stubbed, NULL, "zip64 after a stub", buf);
+		checkRandomAccess(items, &zip64, "unzip_zip64.zip", "zip64 from a file", buf);
+		checkStream(items, &streamed, clock, buf);
+	}
+	free(zip.data);
+	free(zip64.data);
+	free(stubbed.data);
+	free(streamed.data);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define TRIP_ITEMS 7
+#define TRIP_BIG (3 * 256 * 1024 + 12345)   // 3 of zip.cpp's chunks and a bit
+
+struct TripItem {
+	const char *name;
+	int method;
+	unsigned int len;
+	int kind;               // 0 for text, 1 for noise
+};
+
+static const struct TripItem trip_items[TRIP_ITEMS] = {
+	{"empty.raw", ZIP_DEFLATE, 0, 0},
+	{"empty-stored.raw", ZIP_STORE, 0, 0},
+	{"small.txt", ZIP_DEFLATE, 1000, 0},
+	{"big.txt", ZIP_DEFLATE, TRIP_BIG, 0},
+	{"big-stored.txt", ZIP_STORE, TRIP_BIG, 0},
+	{"big.lz4", ZIP_LZ4BLOCKS, TRIP_BIG, 0},
+	{"noise.raw", ZIP_DEFLATE, TRIP_BIG, 1},
+};
+
+// Something that compresses, but not to nothing: lines of words, from a few hundred made up ones.
+static void fillTrip(unsigned char *data, unsigned int len, int kind) {
+	unsigned int seed = 590 + kind;
+	unsigned int column = 0;
+	for (unsigned int i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (kind == 1) {
+			data[i] = (unsigned char) (seed >> 16);
+		} else if (column > 60 && (seed >> 16) % 8 == 0) {
+			data[i] = '\n';
+			column = 0;
+		} else {
+			unsigned int word = (seed >> 16) % 300;
+			data[i] = (unsigned char) (word % 7 == 0 ? ' ' : 'a' + (word * (column + 1)) % 26);
+			column++;
+		}
+	}
+}
+
+// How many sync points the central directory entry at entry says its item has, or -1 if it doesn't say.
+static int syncPoints(const unsigned char *entry) {
+	unsigned int name_len = get16(entry + 28);
+	unsigned int extra_len = get16(entry + 30);
+	const unsigned char *extra = entry + 46 + name_len;
+	for (unsigned int pos = 0; pos + 4 <= extra_len; pos += 4 + get16(extra + pos + 2)) {
+		unsigned int len = get16(extra + pos + 2);
+		if (get16(extra + pos) == ZIP_EXTRA_SYNCPOINTS && len >= 4) {
+			return (int) ((len - 4) / 4);
+		}
+	}
+
+	return -1;
+}
+
+static void checkRoundTrip(int level, unsigned char *data, unsigned char *out) {
+	HZIP hz = CreateZip(0, 0, ZIP_MEMORY);
+	int ok = hz != 0;
+	for (int i = 0; i < TRIP_ITEMS && ok; i++) {
+		const struct TripItem *item = &trip_items[i];
+		fillTrip(data, item->len, item->kind);
+		ok = ZipSetOptions(hz, item->method, level, 0, 4) == ZR_OK &&
+			 ZipAdd(hz, item->name, data, item->len, ZIP_MEMORY) == ZR_OK;
+	}
+	void *zipped = NULL;
+	unsigned long len = 0;
+	struct Buffer zip = {NULL, 0, 0};
+	ok = ok && ZipGetMemory(hz, &zipped, &len) == ZR_OK && put(&zip, zipped, len);
+	if (hz != 0) {
+		CloseZip(hz);
+	}
+	if (!CHECK(ok)) {
+		printf("unzip: couldn't zip the round trip at level %d\n", level);
+		free(zip.data);
+
+		return;
+	}
+
+	hz = OpenZip(zip.data, (unsigned int) zip.len, ZIP_MEMORY);
+	ZIPENTRY ze;
+	if (!CHECK(hz != 0 && GetZipItem(hz, -1, &ze) == ZR_OK && ze.index == TRIP_ITEMS)) {
+		if (hz != 0) {
+			CloseZip(hz);
+		}
+		free(zip.data);
+
+		return;
+	}
+	const unsigned char *entry = zip.data + get32(zip.data + zip.len - 22 + 16);
+	for (int i = 0; i < TRIP_ITEMS; i++) {
+		const struct TripItem *item = &trip_items[i];
+		fillTrip(data, item->len, item->kind);
+		int right = CHECK(GetZipItem(hz, i, &ze) == ZR_OK && strcmp(ze.name, item->name) == 0);
+		right &= CHECK(ze.unc_size == (long long) item->len);
+		// Room for a byte more, which it mustn't touch
+		memset(out, 0xAA, item->len + 1);
+		ZRESULT zr = UnzipItem(hz, i, out, item->len + 1, ZIP_MEMORY);
+		right &= CHECK(zr == ZR_OK || (zr == ZR_MORE && UnzipItem(hz, i, out + item->len, 1, ZIP_MEMORY) == ZR_OK));
+		right &= CHECK(memcmp(out, data, item->len) == 0 && out[item->len] == 0xAA);
+		// Noise doesn't get smaller, so it's stored instead, and then there are no chunks to say anything about
+		int expected = item->method == ZIP_DEFLATE && item->kind == 0 && item->len > 256 * 1024 ? 3 : -1;
+		right &= CHECK(syncPoints(entry) == expected);
+		if (!right) {
+			printf("unzip: %s didn't come out right at level %d (0x%lx)\n", item->name, level, (unsigned long) zr);
+		}
+		entry += 46 + get16(entry + 28) + get16(entry + 30) + get16(entry + 32);
+	}
+	CloseZip(hz);
+	free(zip.data);
+}
+
+static void checkRoundTrips(void) {
+	unsigned char *data = (unsigned char *) malloc(TRIP_BIG);
+	unsigned char *out = (unsigned char *) malloc(TRIP_BIG + 1);
+	if (CHECK(data != NULL && out != NULL)) {
+		checkRoundTrip(1, data, out);
+		checkRoundTrip(6, data, out);
+		checkRoundTrip(9, data, out);
+	}
+	free(data);
+	free(out);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define ALL_ITEMS 5
+#define ALL_READ_ONLY 3     // the item that's made read-only
+#define ALL_ESCAPE 4        // and the one that would get out
+
+static const struct TripItem all_items[ALL_ITEMS] = {
+	{"a.txt", ZIP_DEFLATE, 1000, 0},
+	{"sub/b.txt", ZIP_STORE, 0, 0},
+	{"sub/deeper/c.txt", ZIP_DEFLATE, TRIP_BIG, 0},
+	{"read-only.txt", ZIP_DEFLATE, 100, 1},
+	{"../unzip_all_escape.txt", ZIP_DEFLATE, 10, 0},
+};
+
+#ifdef _WIN32
+// Whether the file at path holds the item's bytes.
+static int unzippedRight(const char *path, const struct TripItem *item, unsigned char *data, unsigned char *out) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	size_t len = fread(out, 1, item->len + 1, file);
+	fclose(file);
+	fillTrip(data, item->len, item->kind);
+
+	return len == item->len && memcmp(out, data, len) == 0;
+}
+#endif
+
+static void checkUnzipAllWith(unsigned char *data, unsigned char *out) {
+	HZIP hz = CreateZip(0, 0, ZIP_MEMORY);
+	int ok = hz != 0;
+	for (int i = 0; i < ALL_ITEMS && ok; i++) {
+		const struct TripItem *item = &all_items[i];
+		fillTrip(data, item->len, item->kind);
+		ok = ZipSetOptions(hz, item->method, 6, 0, 4) == ZR_OK &&
+			 ZipAdd(hz, item->name, data, item->len, ZIP_MEMORY) == ZR_OK;
+	}
+	ok = ok && ZipAdd(hz, "empty", 0, 0, ZIP_FOLDER) == ZR_OK;
+	void *zipped = NULL;
+	unsigned long len = 0;
+	struct Buffer zip = {NULL, 0, 0};
+	ok = ok && ZipGetMemory(hz, &zipped, &len) == ZR_OK && put(&zip, zipped, len);
+	if (hz != 0) {
+		CloseZip(hz);
+	}
+	if (!CHECK(ok)) {
+		free(zip.data);
+
+		return;
+	}
+	// r--r--r--, and archive
+	unsigned char *entry = zip.data + get32(zip.data + zip.len - 22 + 16);
+	for (int i = 0; i < ALL_READ_ONLY; i++) {
+		entry += 46 + get16(entry + 28) + get16(entry + 30) + get16(entry + 32);
+	}
+	set32(entry + 38, 0x81240000 | 0x20);
+
+	hz = OpenZip(zip.data, (unsigned int) zip.len, ZIP_MEMORY);
+	if (!CHECK(hz != 0)) {
+		free(zip.data);
+
+		return;
+	}
+#ifdef _WIN32
+	char temp[MAX_PATH];
+	char dir[MAX_PATH];
+	char path[MAX_PATH * 2];
+	GetTempPathA(MAX_PATH, temp);
+	sprintf(dir, "%sedw590scr_unzip_all_%lu", temp, (unsigned long) GetCurrentProcessId());
+	// The one that would get out is left out, and that's said once the rest are done
+	CHECK(UnzipAllItems(hz, dir, 4) == ZR_ARGS);
+	for (int i = 0; i < ALL_ITEMS; i++) {
+		const struct TripItem *item = &all_items[i];
+		sprintf(path, "%s\\%s", dir, item->name);
+		for (char *c = path; *c != 0; c++) {
+			*c = *c == '/' ? '\\' : *c;
+		}
+		DWORD attr = GetFileAttributesA(path);
+		if (i == ALL_ESCAPE) {
+			CHECK(attr == INVALID_FILE_ATTRIBUTES);
+			continue;
+		}
+		if (!CHECK(unzippedRight(path, item, data, out))) {
+			printf("unzip: %s didn't come out right\n", item->name);
+		}
+		CHECK(attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) == 0);
+		CHECK(((attr & FILE_ATTRIBUTE_READONLY) != 0) == (i == ALL_READ_ONLY));
+		SetFileAttributesA(path, FILE_ATTRIBUTE_NORMAL);
+		DeleteFileA(path);
+	}
+	static const char *const folders[] = {"empty", "sub\\deeper", "sub", ""};
+	for (int i = 0; i < (int) (sizeof(folders) / sizeof(folders[0])); i++) {
+		sprintf(path, "%s\\%s", dir, folders[i]);
+		DWORD attr = GetFileAttributesA(path);
+		CHECK(attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0);
+		CHECK(RemoveDirectoryA(path));
+	}
+#else
+	CHECK(UnzipAllItems(hz, "unzip_all", 4) == ZR_ARGS);
+	(void) out;
+#endif
+	CloseZip(hz);
+	free(zip.data);
+}
+
+static void checkUnzipAll(void) {
+	unsigned char *data = (unsigned char *) malloc(TRIP_BIG);
+	unsigned char *out = (unsigned char *) malloc(TRIP_BIG + 1);
+	if (CHECK(data != NULL && out != NULL)) {
+		checkUnzipAllWith(data, out);
+	}
+	free(data);
+	free(out);
+}
+
+int UnzipTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	struct Items items;
+	memset(&items, 0, sizeof(items));
+	struct Clock *clock = ClockCreateSystem();
+	unsigned char *buf = (unsigned char *) malloc(64 * 1024);
+	int ok = clock != NULL && buf != NULL && makeItems(&items);
+	if (ok) {
+		checkStreams(&items, clock, buf);
+		checkZip64(&items, clock, buf);
+		checkRoundTrips();
+		checkUnzipAll();
+	}
+
+	freeItems(&items);
+	free(buf);
+	if (clock != NULL) {
+		ClockDestroySystem(clock);
+	}
+
+	return ok ? 0 : 1;
+}
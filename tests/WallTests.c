@@ -0,0 +1,192 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "Tests.h"
+#include "../Utils/Offscreen.h"
+#include "../Utils/Render.h"
+#include "../Utils/Wall.h"
+
+// The video wall (see Wall.h): where WallLayout() puts irregular layouts of monitors, and that what each monitor then
+// shows is its part of the wall, exactly, and only the parts that changed get copied to it.
+
+#define WALL_TEST_MAX 4
+
+struct WallCase {
+	const char *name;
+	int num_monitors;
+	struct CanvasRect desktop[WALL_TEST_MAX];
+	int bezel_x;
+	int bezel_y;
+	struct CanvasRect crops[WALL_TEST_MAX];     // where they should go
+	int width;
+	int height;
+};
+
+static const struct WallCase cases[] = {
+	// Left of the primary one, so starting at -1920. Each of the 2 seams adds a bezel
+	{"row", 3, {{-1920, 0, 0, 1080}, {0, 0, 1920, 1080}, {1920, 0, 3840, 1080}}, 60, 0,
+	 {{0, 0, 1920, 1080}, {1980, 0, 3900, 1080}, {3960, 0, 5880, 1080}}, 5880, 1080},
+	{"stacked", 2, {{0, -1080, 1920, 0}, {0, 0, 1920, 1080}}, 60, 40,
+	 {{0, 0, 1920, 1080}, {0, 1120, 1920, 2200}}, 1920, 2200},
+	// The corner of the box with no monitor in it is left over
+	{"L", 3, {{0, 0, 1920, 1080}, {0, 1080, 1920, 2160}, {1920, 1080, 3840, 2160}}, 50, 40,
+	 {{0, 0, 1920, 1080}, {0, 1120, 1920, 2200}, {1970, 1120, 3890, 2200}}, 3890, 2200},
+	// Side by side, but one lower than the other: a seam across, none down
+	{"offset", 2, {{0, 0, 1920, 1080}, {1920, 300, 3840, 1380}}, 30, 30,
+	 {{0, 0, 1920, 1080}, {1950, 300, 3870, 1380}}, 3870, 1380},
+	// All different sizes (one portrait), above and left of the origin
+	{"mixed", 3, {{-1280, -1024, 0, 0}, {0, -720, 2560, 720}, {2560, -720, 3640, 1200}}, 20, 20,
+	 {{0, 0, 1280, 1024}, {1300, 304, 3860, 1744}, {3880, 304, 4960, 2224}}, 4960, 2224},
+	// One wide monitor under 2: the 2 meet it along the same seam, which only counts once
+	{"under", 3, {{0, 0, 1920, 1080}, {1920, 0, 3840, 1080}, {0, 1080, 3840, 3240}}, 10, 10,
+	 {{0, 0, 1920, 1080}, {1930, 0, 3850, 1080}, {0, 1090, 3840, 3250}}, 3850, 3250},
+	// Not touching: no seam, so no bezel
+	{"gap", 2, {{0, 0, 1920, 1080}, {2000, 0, 3920, 1080}}, 50, 50,
+	 {{0, 0, 1920, 1080}, {2000, 0, 3920, 1080}}, 3920, 1080},
+};
+
+static int sameRect(const struct CanvasRect *a, const struct CanvasRect *b) {
+	return a->left == b->left && a->top == b->top && a->right == b->right && a->bottom == b->bottom;
+}
+
+static void checkLayout(const struct WallCase *test) {
+	struct CanvasRect crops[WALL_TEST_MAX];
+	int width;
+	int height;
+	WallLayout(test->desktop, test->num_monitors, test->bezel_x, test->bezel_y, crops, &width, &height);
+	if (!CHECK(width == test->width && height == test->height)) {
+		printf("wall: %s: %d x %d, not %d x %d\n", test->name, width, height, test->width, test->height);
+	}
+	for (int i = 0; i < test->num_monitors; i++) {
+		if (!CHECK(sameRect(&crops[i], &test->crops[i]))) {
+			printf("wall: %s: monitor %d at %d, %d - %d, %d\n", test->name, i, crops[i].left, crops[i].top,
+				   crops[i].right, crops[i].bottom);
+		}
+	}
+}
+
+// Whether each monitor's front buffer is its crop of the wall's canvas.
+static int monitorsMatch(const struct Wall *wall, struct Offscreen *const *monitors) {
+	int match = 1;
+	for (int i = 0; i < wall->num_monitors; i++) {
+		const struct CanvasRect *crop = &wall->monitors[i].crop;
+		int width = crop->right - crop->left;
+		for (int y = crop->top; y < crop->bottom && match; y++) {
+			match = memcmp(monitors[i]->front + (size_t) (y - crop->top) * width,
+						   wall->pixels + (size_t) y * wall->canvas.width + crop->left, width * 4) == 0;
+		}
+	}
+
+	return match;
+}
+
+// Renders frames on a wall of test's monitors, at a tenth of their size (so the numbers stay small).
+static void checkRender(const struct WallCase *test, const struct Frame *frames) {
+	struct Offscreen *monitors[WALL_TEST_MAX];
+	struct RenderTarget *targets[WALL_TEST_MAX];
+	struct CanvasRect desktop[WALL_TEST_MAX];
+	for (int i = 0; i < test->num_monitors; i++) {
+		const struct CanvasRect *rect = &test->desktop[i];
+		desktop[i].left = rect->left / 10;
+		desktop[i].top = rect->top / 10;
+		desktop[i].right = rect->right / 10;
+		desktop[i].bottom = rect->bottom / 10;
+		monitors[i] = OffscreenCreate(desktop[i].right - desktop[i].left, desktop[i].bottom - desktop[i].top);
+		targets[i] = &monitors[i]->target;
+	}
+
+	struct Wall wall;
+	WallInit(&wall);
+	CHECK(WallSetMonitors(&wall, targets, desktop, test->num_monitors, test->bezel_x / 10, test->bezel_y / 10));
+	struct RenderTarget *target = &wall.target;
+	for (int f = 0; f < 3; f++) {
+		long long written[WALL_TEST_MAX];
+		for (int i = 0; i < test->num_monitors; i++) {
+			written[i] = monitors[i]->bytes_written;
+		}
+		CHECK(RenderFrame(&target, 1, &frames[f % 2], NULL, NULL, NULL));
+		if (!CHECK(monitorsMatch(&wall, monitors))) {
+			printf("wall: %s: frame %d isn't what's on the monitors\n", test->name, f);
+		}
+		// After the first, only the changed tiles go to the monitors: less than all of any of them
+		for (int i = 0; i < test->num_monitors && f > 0; i++) {
+			CHECK(monitors[i]->bytes_written - written[i] < (long long) monitors[i]->canvas.width *
+				  monitors[i]->canvas.height * 4);
+		}
+	}
+
+	WallFree(&wall);
+	for (int i = 0; i < test->num_monitors; i++) {
+		OffscreenDestroy(monitors[i]);
+	}
+}
+
+int WallTests(int argc, char **argv) {
+	(void) argc;
+	(void) argv;
+
+	// 2 frames that only differ in a stripe down the middle
+	struct Frame frames[2];
+	if (!TestPicture(&frames[0], 640, 360, 0x20) || !TestPicture(&frames[1], 640, 360, 0x20)) {
+		return 1;
+	}
+	for (int y = 0; y < 360; y++) {
+		for (int x = 300; x < 340; x++) {
+			frames[1].pixels[(size_t) y * frames[1].stride + x] = 0xFF00FF;
+		}
+	}
+
+	for (int i = 0; i < (int) (sizeof(cases) / sizeof(cases[0])); i++) {
+		checkLayout(&cases[i]);
+		checkRender(&cases[i], frames);
+	}
+
+	// Changing nothing changes nothing, and a monitor that moves gets its whole crop again
+	struct Offscreen *monitors[2];
+	struct RenderTarget *targets[2];
+	struct CanvasRect desktop[2] = {{0, 0, 192, 108}, {192, 0, 384, 108}};
+	for (int i = 0; i < 2; i++) {
+		monitors[i] = OffscreenCreate(192, 108);
+		targets[i] = &monitors[i]->target;
+	}
+	struct Wall wall;
+	WallInit(&wall);
+	struct RenderTarget *target = &wall.target;
+	CHECK(WallSetMonitors(&wall, targets, desktop, 2, 0, 0));
+	CHECK(RenderFrame(&target, 1, &frames[0], NULL, NULL, NULL));
+	const unsigned int *pixels = wall.pixels;
+	CHECK(WallSetMonitors(&wall, targets, desktop, 2, 0, 0) && wall.monitors[0].pixels != NULL);
+	desktop[1].left += 8;
+	desktop[1].right += 8;
+	CHECK(WallSetMonitors(&wall, targets, desktop, 2, 0, 0) && wall.monitors[1].pixels == NULL);
+	CHECK(wall.pixels != pixels || wall.canvas.width == 392);
+	CHECK(RenderFrame(&target, 1, &frames[0], NULL, NULL, NULL) && monitorsMatch(&wall, monitors));
+	CHECK(!WallSetMonitors(&wall, targets, desktop, 0, 0, 0));
+	WallFree(&wall);
+	for (int i = 0; i < 2; i++) {
+		OffscreenDestroy(monitors[i]);
+	}
+
+	FrameFree(&frames[0]);
+	FrameFree(&frames[1]);
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+// Copyright 2024 Edw590
+//
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// zippack - builds Edw590SCR.zip (or any other zip) with our own zip writer,
+// so that the frames can be laid out the way the screensaver wants them.
+//
+//   zippack [-m store|deflate|lz4] [-l level] [-a align] [-j threads] [-C dir] out.zip paths...
+//
+// The options apply to the paths after them, so e.g.
+//   zippack -C Pictures -m store -a 4096 Edw590SCR.zip frames -m deflate -l 9 readme.txt
+// Directories are added with everything in them. Names in the zip are the
+// paths as given (relative to -C's directory), with '/' separators.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "../Utils/zip.h"
+
+static char base_dir[1024] = "";
+static int num_added = 0;
+
+static void usage(void) {
+	fprintf(stderr, "usage: zippack [-m store|deflate|lz4] [-l level] [-a align] [-j threads] [-C dir] out.zip paths...\n");
+	exit(2);
+}
+
+static bool failed(ZRESULT zr, const char *what) {
+	if (zr == ZR_OK) {
+		return false;
+	}
+	char msg[256];
+	FormatZipMessage(zr, msg, sizeof(msg));
+	fprintf(stderr, "zippack: %s: %s\n", what, msg);
+
+	return true;
+}
+
+// Adds path (relative to base_dir), and if it's a directory, everything in it.
+static bool addPath(HZIP hz, const char *path) {
+	char full[2048];
+	if (base_dir[0] != '\0') {
+		snprintf(full, sizeof(full), "%s/%s", base_dir, path);
+	} else {
+		snprintf(full, sizeof(full), "%s", path);
+	}
+
+#ifdef _WIN32
+	DWORD attr = GetFileAttributesA(full);
+	if (attr == INVALID_FILE_ATTRIBUTES) {
+		fprintf(stderr, "zippack: %s: not found\n", full);
+
+		return false;
+	}
+	bool is_dir = (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+	struct stat st;
+	if (stat(full, &st) != 0) {
+		fprintf(stderr, "zippack: %s: not found\n", full);
+
+		return false;
+	}
+	bool is_dir = S_ISDIR(st.st_mode);
+#endif
+
+	if (!is_dir) {
+		num_added++;
+
+		return !failed(ZipAdd(hz, path, full, 0, ZIP_FILENAME), path);
+	}
+
+	// "." is just where to start from, not something to have in the zip
+	bool is_top = strcmp(path, ".") == 0;
+	if (!is_top && failed(ZipAdd(hz, path, 0, 0, ZIP_FOLDER), path)) {
+		return false;
+	}
+	char child[2048];
+#ifdef _WIN32
+	char pattern[2048];
+	snprintf(pattern, sizeof(pattern), "%s/*", full);
+	WIN32_FIND_DATAA fd;
+	HANDLE hfind = FindFirstFileA(pattern, &fd);
+	if (hfind == INVALID_HANDLE_VALUE) {
+		return true;
+	}
+	do {
+		if (strcmp(fd.cFileName, ".") == 0 || strcmp(fd.cFileName, "..") == 0) {
+			continue;
+		}
+		if (is_top) {
+			snprintf(child, sizeof(child), "%s", fd.cFileName);
+		} else {
+			snprintf(child, sizeof(child), "%s/%s", path, fd.cFileName);
+		}
+		if (!addPath(hz, child)) {
+			FindClose(hfind);
+
+			return false;
+		}
+	} while (FindNextFileA(hfind, &fd));
+	FindClose(hfind);
+#else
+	DIR *dir = opendir(full);
+	if (dir == NULL) {
+		fprintf(stderr, "zippack: %s: can't read the directory\n", full);
+
+		return false;
+	}
+	struct dirent *de;
+	while ((de = readdir(dir)) != NULL) {
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+			continue;
+		}
+		if (is_top) {
+			snprintf(child, sizeof(child), "%s", de->d_name);
+		} else {
+			snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+		}
+		if (!addPath(hz, child)) {
+			closedir(dir);
+
+			return false;
+		}
+	}
+	closedir(dir);
+#endif
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int method = ZIP_DEFLATE;
+	int level = 6;
+	unsigned int align = 0;
+	int num_threads = 0;
+	HZIP hz = 0;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (arg[0] == '-' && arg[1] != '\0') {
+			if (arg[2] != '\0' || strchr("mlajC", arg[1]) == NULL || i + 1 >= argc) {
+				usage();
+			}
+			const char *val = argv[++i];
+			switch (arg[1]) {
+				case 'm':
+					if (strcmp(val, "store") == 0) {
+						method = ZIP_STORE;
+					} else if (strcmp(val, "deflate") == 0) {
+						method = ZIP_DEFLATE;
+					} else if (strcmp(val, "lz4") == 0) {
+						method = ZIP_LZ4BLOCKS;
+					} else {
+						usage();
+					}
+					break;
+				case 'l':
+					level = atoi(val);
+					break;
+				case 'a':
+					align = (unsigned int) atoi(val);
+					break;
+				case 'j':
+					num_threads = atoi(val);
+					break;
+				case 'C':
+					snprintf(base_dir, sizeof(base_dir), "%s", val);
+					break;
+			}
+			if (hz != 0 && failed(ZipSetOptions(hz, method, level, align, num_threads), "options")) {
+				CloseZip(hz);
+
+				return 1;
+			}
+			continue;
+		}
+
+		if (hz == 0) {
+			hz = CreateZip((void *) arg, 0, ZIP_FILENAME);
+			if (hz == 0) {
+				failed(ZR_RECENT, arg);
+
+				return 1;
+			}
+			if (failed(ZipSetOptions(hz, method, level, align, num_threads), "options")) {
+				CloseZip(hz);
+
+				return 1;
+			}
+			continue;
+		}
+
+		if (!addPath(hz, arg)) {
+			CloseZip(hz);
+
+			return 1;
+		}
+	}
+	if (hz == 0) {
+		usage();
+	}
+
+	if (failed(CloseZip(hz), "writing the zip")) {
+		return 1;
+	}
+	printf("zippack: %d files\n", num_added);
+
+	return 0;
+}